@@ -0,0 +1,523 @@
+/*
+ * alocador.c - Reuso de endereços de variáveis por vivacidade
+ *
+ * Cada área de dados (a do programa, nível 0, e a de cada sub-rotina, nível
+ * 1) é tratada à parte. O corpo é percorrido na ordem do código gerado (a
+ * de gerador_ast.c), e cada uso de variável recebe a posição seguinte; o
+ * intervalo de vida de uma variável vai do primeiro ao último uso, alargado
+ * para ser conservador:
+ *   - um uso dentro de um laço vale pelo laço mais externo inteiro, já que o
+ *     valor pode voltar pelo desvio para o início;
+ *   - uma variável viva na entrada da área (lida antes de escrita em algum
+ *     caminho, como depois de um if sem else) vive desde o início, e a
+ *     posição dela não passa antes por outra variável;
+ *   - globais usadas em alguma sub-rotina vivem o programa inteiro, pois as
+ *     chamadas não aparecem como uso.
+ * A escrita de uma atribuição conta depois da expressão. Com isso o
+ * intervalo cobre todo ponto em que a variável está viva: sem desvios para
+ * trás fora dos laços, um caminho até a leitura só anda para a frente, e o
+ * valor lido foi escrito antes no percurso ou vem da entrada.
+ *
+ * A vivacidade na entrada sai de uma análise para trás sobre a árvore, com
+ * um conjunto de bits por ponto. Os laços não precisam de iteração: a
+ * função de um comando é da forma gen ∪ (vivas ∩ passam), e o ponto fixo
+ * de um laço é o que entra nele unido ao que sai de uma passada pelo corpo.
+ *
+ * Os intervalos formam um grafo de intervalos, que a varredura linear colore
+ * com o mínimo de cores: em ordem de início, cada variável pega uma posição
+ * cujo ocupante já morreu ou uma nova. Variáveis nunca usadas ficam com a
+ * posição 0. Sem memória para a análise, a área fica como estava. A área
+ * do programa também fica como está quando o endereço de cada global é o
+ * da declaração (módulos: modulo.h).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "alocador.h"
+#include "ast.h"
+#include "tabsimb.h"
+
+// Vida de uma variável, em posições do percurso
+typedef struct {
+    int32_t inicio, fim;        // inicio 0: nunca usada
+    uint8_t viva_na_entrada;    // lida antes de escrita em algum caminho
+    uint8_t fixa;               // viva na área inteira
+} Vida;
+
+// Variável e início da sua vida, para a ordenação; também serve de
+// elemento do heap das posições ocupadas (inicio = fim da vida do ocupante,
+// var = posição)
+typedef struct {
+    int32_t inicio;
+    int32_t var;
+} Entrada;
+
+// Área de dados em análise
+typedef struct {
+    ArvoreAST *t;
+    int nivel;
+    int n_vars;
+    int reescrever;             // percurso que troca os endereços
+    Vida *vidas;
+    int *novo;                  // endereço novo de cada variável
+    int n_posicoes;
+    uint8_t *globais;           // sub-rotina: marca as globais usadas nela
+    int n_globais;
+
+    // Percurso
+    int32_t posicao;
+    int profundidade;           // laços abertos
+    int32_t inicio_laco;        // posição de entrada no laço mais externo
+    int *tocadas;               // variáveis usadas no laço mais externo
+    int n_tocadas;
+    int *laco;                  // último laço externo em que foi tocada
+    int n_lacos;
+
+    // Vivacidade
+    int palavras;               // uint64_t por conjunto de variáveis
+    NoId *pendentes;            // comandos das listas, do fim para o início
+    int n_pendentes, cap_pendentes;
+    int sem_memoria;
+} Area;
+
+// Variável local da área num AST_VAR (-1 se não for)
+static int local(const Area *ar, const NoAST *var) {
+    if (var->op != ar->nivel || var->u.endereco < 0 || var->u.endereco >= ar->n_vars) return -1;
+    return var->u.endereco;
+}
+
+static void usar(Area *ar, NoAST *var) {
+    if (ar->nivel > 0 && var->op == 0 && var->u.endereco >= 0 &&
+        var->u.endereco < ar->n_globais) {
+        ar->globais[var->u.endereco] = 1;
+    }
+
+    int v = local(ar, var);
+    if (v < 0) return;
+    if (ar->reescrever) {
+        var->u.endereco = ar->novo[v];
+        return;
+    }
+
+    Vida *vida = &ar->vidas[v];
+    int32_t p = ++ar->posicao;
+    if (vida->inicio == 0) vida->inicio = p;
+    vida->fim = p;
+    if (ar->profundidade > 0 && ar->laco[v] != ar->n_lacos) {
+        ar->laco[v] = ar->n_lacos;
+        ar->tocadas[ar->n_tocadas++] = v;
+    }
+}
+
+static void entrar_laco(Area *ar) {
+    if (ar->profundidade++ > 0 || ar->reescrever) return;
+    ar->inicio_laco = ++ar->posicao;
+    ar->n_lacos++;
+    ar->n_tocadas = 0;
+}
+
+// Ao sair do laço mais externo, quem foi usado nele vive o laço inteiro
+static void sair_laco(Area *ar) {
+    if (--ar->profundidade > 0 || ar->reescrever) return;
+    int32_t fim = ++ar->posicao;
+    for (int k = 0; k < ar->n_tocadas; k++) {
+        Vida *vida = &ar->vidas[ar->tocadas[k]];
+        if (vida->inicio > ar->inicio_laco) vida->inicio = ar->inicio_laco;
+        vida->fim = fim;
+    }
+}
+
+static void percorrer_exp(Area *ar, NoId raiz) {
+    for (NoId id = ast_inicio(ar->t, raiz); id <= raiz; id++) {
+        NoAST *no = ast_no(ar->t, id);
+        if (no->tipo == AST_VAR && !(no->flags & (AST_MORTO | AST_ALVO))) usar(ar, no);
+    }
+}
+
+static void percorrer_cmd(Area *ar, NoId id);
+
+static void percorrer_lista(Area *ar, NoId id) {
+    for (; id != 0; id = ast_no(ar->t, id)->prox) percorrer_cmd(ar, id);
+}
+
+// Mesma ordem de gerar_cmd
+static void percorrer_cmd(Area *ar, NoId id) {
+    const NoAST no = *ast_no(ar->t, id);
+
+    switch (no.tipo) {
+        case AST_ATRIB:
+            percorrer_exp(ar, no.b);
+            usar(ar, ast_no(ar->t, no.a));
+            break;
+        case AST_LEITURA:
+            usar(ar, ast_no(ar->t, no.a));
+            break;
+        case AST_ESCRITA:
+            percorrer_exp(ar, no.a);
+            break;
+        case AST_CHAMADA:
+            percorrer_exp(ar, id);
+            break;
+        case AST_RETORNO:
+            if (no.a != 0) percorrer_exp(ar, no.a);
+            break;
+        case AST_SE:
+            percorrer_exp(ar, no.a);
+            percorrer_cmd(ar, no.b);
+            if (no.c != 0) percorrer_cmd(ar, no.c);
+            break;
+        case AST_ENQUANTO:
+            entrar_laco(ar);
+            percorrer_exp(ar, no.a);
+            percorrer_cmd(ar, no.b);
+            sair_laco(ar);
+            break;
+        case AST_REPITA:
+            entrar_laco(ar);
+            percorrer_lista(ar, no.a);
+            percorrer_exp(ar, no.b);
+            sair_laco(ar);
+            break;
+        case AST_PARA:
+            if (no.a != 0) percorrer_cmd(ar, no.a);
+            entrar_laco(ar);
+            percorrer_exp(ar, no.b);
+            percorrer_cmd(ar, no.c);
+            percorrer_cmd(ar, no.u.d);
+            sair_laco(ar);
+            break;
+        case AST_BLOCO:
+            percorrer_lista(ar, no.a);
+            break;
+        default:
+            break;
+    }
+}
+
+// Variáveis da área lidas na expressão entram em vivas
+static void gerar_vivas(Area *ar, NoId raiz, uint64_t *vivas) {
+    for (NoId id = ast_inicio(ar->t, raiz); id <= raiz; id++) {
+        const NoAST *no = ast_no(ar->t, id);
+        if (no->tipo != AST_VAR || (no->flags & (AST_MORTO | AST_ALVO))) continue;
+        int v = local(ar, no);
+        if (v >= 0) vivas[v / 64] |= (uint64_t)1 << (v % 64);
+    }
+}
+
+// A variável escrita sai de vivas
+static void matar(Area *ar, NoId var, uint64_t *vivas) {
+    int v = local(ar, ast_no(ar->t, var));
+    if (v >= 0) vivas[v / 64] &= ~((uint64_t)1 << (v % 64));
+}
+
+static uint64_t* copiar_vivas(Area *ar, const uint64_t *vivas) {
+    uint64_t *c = malloc(sizeof(uint64_t) * (size_t)ar->palavras);
+    if (c == NULL) {
+        ar->sem_memoria = 1;
+        return NULL;
+    }
+    memcpy(c, vivas, sizeof(uint64_t) * (size_t)ar->palavras);
+    return c;
+}
+
+static void unir_vivas(Area *ar, uint64_t *vivas, const uint64_t *outras) {
+    for (int k = 0; k < ar->palavras; k++) vivas[k] |= outras[k];
+}
+
+static void vivas_cmd(Area *ar, NoId id, uint64_t *vivas);
+
+// Lista de comandos de trás para a frente, sem recursão no comprimento
+static void vivas_lista(Area *ar, NoId id, uint64_t *vivas) {
+    int base = ar->n_pendentes;
+
+    for (; id != 0; id = ast_no(ar->t, id)->prox) {
+        if (ar->n_pendentes == ar->cap_pendentes) {
+            int nova = ar->cap_pendentes ? ar->cap_pendentes * 2 : 256;
+            NoId *v = realloc(ar->pendentes, sizeof(NoId) * (size_t)nova);
+            if (v == NULL) {
+                ar->sem_memoria = 1;
+                ar->n_pendentes = base;
+                return;
+            }
+            ar->pendentes = v;
+            ar->cap_pendentes = nova;
+        }
+        ar->pendentes[ar->n_pendentes++] = id;
+    }
+    while (ar->n_pendentes > base && !ar->sem_memoria) {
+        vivas_cmd(ar, ar->pendentes[--ar->n_pendentes], vivas);
+    }
+    ar->n_pendentes = base;
+}
+
+// Troca as vivas depois do comando pelas vivas antes dele
+static void vivas_cmd(Area *ar, NoId id, uint64_t *vivas) {
+    const NoAST no = *ast_no(ar->t, id);
+    uint64_t *outras;
+
+    switch (no.tipo) {
+        case AST_ATRIB:
+            matar(ar, no.a, vivas);
+            gerar_vivas(ar, no.b, vivas);
+            break;
+        case AST_LEITURA:
+            matar(ar, no.a, vivas);
+            break;
+        case AST_ESCRITA:
+            gerar_vivas(ar, no.a, vivas);
+            break;
+        case AST_CHAMADA:
+            gerar_vivas(ar, id, vivas);
+            break;
+        case AST_RETORNO:
+            // Numa sub-rotina, nada depois do retorno lê a área
+            if (ar->nivel > 0) memset(vivas, 0, sizeof(uint64_t) * (size_t)ar->palavras);
+            if (no.a != 0) gerar_vivas(ar, no.a, vivas);
+            break;
+        case AST_SE:
+            if ((outras = copiar_vivas(ar, vivas)) == NULL) break;
+            vivas_cmd(ar, no.b, vivas);
+            if (no.c != 0) vivas_cmd(ar, no.c, outras);
+            unir_vivas(ar, vivas, outras);
+            free(outras);
+            gerar_vivas(ar, no.a, vivas);
+            break;
+        case AST_ENQUANTO:
+            gerar_vivas(ar, no.a, vivas);
+            if ((outras = copiar_vivas(ar, vivas)) == NULL) break;
+            vivas_cmd(ar, no.b, outras);
+            unir_vivas(ar, vivas, outras);
+            free(outras);
+            break;
+        case AST_REPITA:
+            // As vivas na condição entram no corpo; uma passada basta
+            gerar_vivas(ar, no.b, vivas);
+            vivas_lista(ar, no.a, vivas);
+            break;
+        case AST_PARA:
+            gerar_vivas(ar, no.b, vivas);
+            if ((outras = copiar_vivas(ar, vivas)) == NULL) break;
+            vivas_cmd(ar, no.c, outras);
+            vivas_cmd(ar, no.u.d, outras);
+            unir_vivas(ar, vivas, outras);
+            free(outras);
+            if (no.a != 0) vivas_cmd(ar, no.a, vivas);
+            break;
+        case AST_BLOCO:
+            vivas_lista(ar, no.a, vivas);
+            break;
+        default:
+            break;
+    }
+}
+
+// Marca as variáveis vivas na entrada do corpo; 0 se faltou memória
+static int vivas_na_entrada(Area *ar, NoId corpo) {
+    ar->palavras = ar->n_vars / 64 + 1;
+    uint64_t *vivas = calloc((size_t)ar->palavras, sizeof(uint64_t));
+    if (vivas == NULL) return 0;
+
+    vivas_cmd(ar, corpo, vivas);
+    for (int v = 0; v < ar->n_vars; v++) {
+        ar->vidas[v].viva_na_entrada = (vivas[v / 64] >> (v % 64)) & 1;
+    }
+    free(vivas);
+    free(ar->pendentes);
+    ar->pendentes = NULL;
+    ar->n_pendentes = ar->cap_pendentes = 0;
+    return !ar->sem_memoria;
+}
+
+static int comparar_entradas(const void *a, const void *b) {
+    const Entrada *x = a, *y = b;
+    if (x->inicio != y->inicio) return x->inicio < y->inicio ? -1 : 1;
+    return x->var < y->var ? -1 : x->var > y->var;
+}
+
+// Heap de mínimo das posições ocupadas, pelo fim da vida do ocupante
+static void subir(Entrada *h, int i) {
+    while (i > 0 && h[(i - 1) / 2].inicio > h[i].inicio) {
+        Entrada tmp = h[i];
+        h[i] = h[(i - 1) / 2];
+        h[(i - 1) / 2] = tmp;
+        i = (i - 1) / 2;
+    }
+}
+
+static void descer(Entrada *h, int n) {
+    int i = 0;
+    for (;;) {
+        int menor = i, e = 2 * i + 1, d = 2 * i + 2;
+        if (e < n && h[e].inicio < h[menor].inicio) menor = e;
+        if (d < n && h[d].inicio < h[menor].inicio) menor = d;
+        if (menor == i) return;
+        Entrada tmp = h[i];
+        h[i] = h[menor];
+        h[menor] = tmp;
+        i = menor;
+    }
+}
+
+// Varredura linear: preenche ar->novo e ar->n_posicoes
+static int colorir(Area *ar) {
+    Entrada *ordem = malloc(sizeof(Entrada) * ((size_t)ar->n_vars + 1));
+    Entrada *ocupadas = malloc(sizeof(Entrada) * ((size_t)ar->n_vars + 1));
+    int *livres = malloc(sizeof(int) * ((size_t)ar->n_vars + 1));
+    int n = 0, n_ocupadas = 0, n_livres = 0;
+
+    if (ordem == NULL || ocupadas == NULL || livres == NULL) {
+        free(ordem);
+        free(ocupadas);
+        free(livres);
+        return 0;
+    }
+
+    for (int v = 0; v < ar->n_vars; v++) {
+        Vida *vida = &ar->vidas[v];
+        ar->novo[v] = 0;
+        if (vida->fixa) {
+            vida->inicio = 0;
+            vida->fim = ar->posicao + 1;
+        } else if (vida->inicio == 0) {
+            continue;
+        } else if (vida->viva_na_entrada) {
+            vida->inicio = 0;
+        }
+        ordem[n].inicio = vida->inicio;
+        ordem[n].var = v;
+        n++;
+    }
+    qsort(ordem, (size_t)n, sizeof(Entrada), comparar_entradas);
+
+    ar->n_posicoes = 0;
+    for (int k = 0; k < n; k++) {
+        int v = ordem[k].var;
+
+        // Libera as posições cujos ocupantes morreram antes deste início
+        while (n_ocupadas > 0 && ocupadas[0].inicio < ordem[k].inicio) {
+            livres[n_livres++] = ocupadas[0].var;
+            ocupadas[0] = ocupadas[--n_ocupadas];
+            descer(ocupadas, n_ocupadas);
+        }
+
+        int posicao = n_livres > 0 ? livres[--n_livres] : ar->n_posicoes++;
+        ar->novo[v] = posicao;
+        ocupadas[n_ocupadas].inicio = ar->vidas[v].fim;
+        ocupadas[n_ocupadas].var = posicao;
+        subir(ocupadas, n_ocupadas++);
+    }
+
+    free(ordem);
+    free(ocupadas);
+    free(livres);
+    return 1;
+}
+
+// Endereços novos nas variáveis de uma lista de registros da tabela de
+// símbolos; retorna o registro seguinte aos n primeiros
+static RegistroTS* reescrever_ts(Area *ar, RegistroTS *r, long n) {
+    for (; r != NULL && n != 0; r = r->proximo, n--) {
+        if (r->categoria == CAT_VARIAVEL && r->nivel == ar->nivel &&
+            r->endereco >= 0 && r->endereco < ar->n_vars) {
+            r->endereco = ar->novo[r->endereco];
+        }
+    }
+    return r;
+}
+
+static int contar(const ArvoreAST *t, NoId id) {
+    int n = 0;
+    for (; id != 0; id = ast_no(t, id)->prox) n++;
+    return n;
+}
+
+// Calcula os endereços novos da área de um corpo (ar->novo) e prepara o
+// percurso que os aplica; 0 se faltou memória até para ar->novo (sem o
+// resto, a área fica com um endereço por variável)
+static int alocar_area(Area *ar, NoId corpo) {
+    int ok = 0;
+
+    ar->n_posicoes = ar->n_vars;
+    ar->vidas = calloc((size_t)ar->n_vars + 1, sizeof(Vida));
+    ar->novo = malloc(sizeof(int) * ((size_t)ar->n_vars + 1));
+    ar->tocadas = malloc(sizeof(int) * ((size_t)ar->n_vars + 1));
+    ar->laco = calloc((size_t)ar->n_vars + 1, sizeof(int));
+    if (ar->vidas != NULL && ar->novo != NULL && ar->tocadas != NULL && ar->laco != NULL) {
+        for (int v = 0; v < ar->n_vars; v++) {
+            ar->vidas[v].fixa = ar->nivel == 0 && v < ar->n_globais && ar->globais[v];
+        }
+        percorrer_cmd(ar, corpo);
+        ok = vivas_na_entrada(ar, corpo) && colorir(ar);
+    }
+    if (!ok) {
+        ar->n_posicoes = ar->n_vars;
+        if (ar->novo != NULL) {
+            for (int v = 0; v < ar->n_vars; v++) ar->novo[v] = v;
+        }
+    }
+    free(ar->vidas);
+    free(ar->tocadas);
+    free(ar->laco);
+    ar->vidas = NULL;
+    ar->tocadas = ar->laco = NULL;
+    ar->reescrever = 1;
+    return ar->novo != NULL;
+}
+
+long alocar_enderecos(ContextoCompilacao *ctx, int globais_fixas) {
+    ArvoreAST *t = ctx->ast;
+    NoAST *prg = ast_no(t, t->raiz);
+    NoId dcl_prg = prg->a, corpo_prg = prg->c, subs = prg->u.d;
+    int n_globais = contar(t, prg->b);
+    long economizadas = 0;
+    RegistroTS *fechado = ctx->ts.fechados;
+    Area ar;
+
+    // Globais usadas em cada sub-rotina (marcadas ao percorrer os corpos)
+    uint8_t *globais = calloc((size_t)n_globais + 1, 1);
+    if (globais == NULL) return 0;
+
+    for (NoId sub = subs; sub != 0; sub = ast_no(t, sub)->prox) {
+        NoAST *no = ast_no(t, sub);
+
+        memset(&ar, 0, sizeof(ar));
+        ar.t = t;
+        ar.nivel = 1;
+        ar.n_vars = no->u.endereco;
+        ar.globais = globais;
+        ar.n_globais = n_globais;
+        if (alocar_area(&ar, no->c)) {
+            percorrer_cmd(&ar, no->c);
+            economizadas += ar.n_vars - ar.n_posicoes;
+        }
+        no->u.endereco = ar.n_posicoes;
+
+        // Os símbolos da sub-rotina (parâmetros e locais) vêm juntos na
+        // lista de fechados, na ordem das sub-rotinas
+        fechado = reescrever_ts(&ar, fechado, contar(t, ast_no(t, no->a)->a) + contar(t, no->b));
+        free(ar.novo);
+    }
+
+    memset(&ar, 0, sizeof(ar));
+    ar.t = t;
+    ar.nivel = 0;
+    ar.n_vars = ast_no(t, dcl_prg)->u.endereco;
+    ar.globais = globais;
+    ar.n_globais = n_globais;
+    if (globais_fixas) {
+        ar.n_posicoes = ar.n_vars;
+    } else if (alocar_area(&ar, corpo_prg)) {
+        // As globais também aparecem nos corpos das sub-rotinas
+        percorrer_cmd(&ar, corpo_prg);
+        for (NoId sub = subs; sub != 0; sub = ast_no(t, sub)->prox) {
+            percorrer_cmd(&ar, ast_no(t, sub)->c);
+        }
+        reescrever_ts(&ar, ctx->ts.cabeca, -1);
+        economizadas += ar.n_vars - ar.n_posicoes;
+    }
+    ast_no(t, dcl_prg)->u.endereco = ar.n_posicoes;
+
+    free(ar.novo);
+    free(globais);
+    return economizadas;
+}
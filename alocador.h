@@ -0,0 +1,17 @@
+/*
+ * alocador.h - Reuso de endereços de variáveis por vivacidade (modo -O1)
+ */
+
+#ifndef ALOCADOR_H
+#define ALOCADOR_H
+
+#include "contexto.h"
+
+// Dá o mesmo endereço a variáveis de uma área de dados (programa ou
+// sub-rotina) cujos intervalos de vida não se sobrepõem, numa árvore já
+// checada pela semântica. Reescreve os AST_VAR e os endereços da tabela de
+// símbolos e grava o tamanho de cada área (ver ast.h); com globais_fixas,
+// só as áreas das sub-rotinas. Retorna o número de posições economizadas.
+long alocar_enderecos(ContextoCompilacao *ctx, int globais_fixas);
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * analex.c - Analisador Léxico da LPD
+ *
+ * Lê o arquivo do estado (EstadoLexico), um átomo por chamada de
+ * obter_atomo, e conta as linhas nele. Não há estado global. Comentários vão de '{' a '}' e podem ocupar
+ * várias linhas. O lexema guarda no máximo 99 caracteres; o que passa
+ * disso é lido e descartado. Cadeias ("...") e caracteres ('c') ficam com
+ * as aspas no lexema. Um caractere que não começa nenhum átomo devolve
+ * sEOF com ele no lexema: a análise para ali.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "analex.h"
+
+#define TAM_LEXEMA ((int)sizeof(((TInfoAtomo*)0)->lexema))
+
+typedef struct {
+    const char *palavra;
+    TAtomo atomo;
+} PalavraReservada;
+
+// Em ordem alfabética (bsearch)
+static const PalavraReservada reservadas[] = {
+    {"begin", sBEGIN},   {"bool", sBOOL},     {"char", sCHAR},     {"do", sDO},
+    {"e", sE},           {"else", sELSE},     {"end", sEND},       {"float", sFLOAT},
+    {"for", sFOR},       {"if", sIF},         {"int", sINT},       {"nao", sNAO},
+    {"ou", sOU},         {"prg", sPRG},       {"read", sREAD},     {"repeat", sREPEAT},
+    {"return", sRETURN}, {"subrot", sSUBROT}, {"then", sTHEN},     {"to", sTO},
+    {"until", sUNTIL},   {"var", sVAR},       {"void", sVOID},     {"while", sWHILE},
+    {"write", sWRITE},
+};
+
+static int comparar_palavra(const void *chave, const void *elemento) {
+    return strcmp(chave, ((const PalavraReservada*)elemento)->palavra);
+}
+
+// Acrescenta c ao lexema se ainda cabe (deixando espaço para o '\0')
+static void guardar(TInfoAtomo *r, int *n, int c) {
+    if (*n < TAM_LEXEMA - 1) r->lexema[(*n)++] = (char)c;
+}
+
+// Cadeia ou caractere: lê até o delimitador de fechamento (ou o fim da
+// linha, se ele falta). O delimitador final sempre entra no lexema
+static void ler_literal(FILE *fonte, TInfoAtomo *r, int *n, int delimitador) {
+    int c;
+
+    guardar(r, n, delimitador);
+    while ((c = getc(fonte)) != EOF && c != delimitador && c != '\n') {
+        if (*n < TAM_LEXEMA - 2) r->lexema[(*n)++] = (char)c;
+    }
+    if (c == '\n') ungetc(c, fonte);
+    guardar(r, n, delimitador);
+}
+
+void analex_iniciar(EstadoLexico *e, FILE *fonte, int linha) {
+    e->fonte = fonte;
+    e->linha = linha;
+}
+
+TInfoAtomo obter_atomo(EstadoLexico *e) {
+    FILE *fonte = e->fonte;
+    int linha = e->linha;
+    TInfoAtomo r;
+    int c, n = 0;
+
+    memset(&r, 0, sizeof(r));
+
+    // Espaços e comentários
+    for (;;) {
+        c = getc(fonte);
+        if (c == '\n') {
+            linha++;
+        } else if (c == '{') {
+            while ((c = getc(fonte)) != EOF && c != '}') {
+                if (c == '\n') linha++;
+            }
+            if (c == EOF) break;
+        } else if (c == EOF || !isspace(c)) {
+            break;
+        }
+    }
+
+    e->linha = linha;
+    r.linha = linha;
+    if (c == EOF) {
+        r.atomo = sEOF;
+        return r;
+    }
+
+    // Identificadores e palavras reservadas
+    if (isalpha(c) || c == '_') {
+        do {
+            guardar(&r, &n, c);
+            c = getc(fonte);
+        } while (isalnum(c) || c == '_');
+        ungetc(c, fonte);
+
+        const PalavraReservada *p = bsearch(r.lexema, reservadas,
+                                            sizeof(reservadas) / sizeof(reservadas[0]),
+                                            sizeof(reservadas[0]), comparar_palavra);
+        r.atomo = p != NULL ? p->atomo : sIDENT;
+        return r;
+    }
+
+    // Números: dígitos, com uma parte fracionária opcional
+    if (isdigit(c)) {
+        r.atomo = sNUM_INT;
+        do {
+            guardar(&r, &n, c);
+            c = getc(fonte);
+        } while (isdigit(c));
+        if (c == '.') {
+            r.atomo = sNUM_FLOAT;
+            do {
+                guardar(&r, &n, c);
+                c = getc(fonte);
+            } while (isdigit(c));
+        }
+        ungetc(c, fonte);
+        return r;
+    }
+
+    if (c == '"' || c == '\'') {
+        r.atomo = c == '"' ? sSTRING : sCHAR_CONST;
+        ler_literal(fonte, &r, &n, c);
+        return r;
+    }
+
+    guardar(&r, &n, c);
+    switch (c) {
+        case '<':
+            c = getc(fonte);
+            if (c == '-' || c == '=') {
+                guardar(&r, &n, c);
+                r.atomo = c == '-' ? sATRIB : sMENOR_IG;
+            } else {
+                ungetc(c, fonte);
+                r.atomo = sMENOR;
+            }
+            break;
+        case '>':
+            c = getc(fonte);
+            if (c == '=') {
+                guardar(&r, &n, c);
+                r.atomo = sMAIOR_IG;
+            } else {
+                ungetc(c, fonte);
+                r.atomo = sMAIOR;
+            }
+            break;
+        case '!':
+            // Só "!=": '!' sozinho não é átomo
+            c = getc(fonte);
+            if (c == '=') {
+                guardar(&r, &n, c);
+                r.atomo = sDIFERENTE;
+            } else {
+                ungetc(c, fonte);
+                r.atomo = sEOF;
+            }
+            break;
+        case '=': r.atomo = sIGUAL; break;
+        case '+': r.atomo = sSOMA; break;
+        case '-': r.atomo = sSUBT; break;
+        case '*': r.atomo = sMULT; break;
+        case '/': r.atomo = sDIV; break;
+        case '(': r.atomo = sABRE_PARENT; break;
+        case ')': r.atomo = sFECHA_PARENT; break;
+        case '[': r.atomo = sABRE_COLCH; break;
+        case ']': r.atomo = sFECHA_COLCH; break;
+        case '.': r.atomo = sPONTO; break;
+        case ',': r.atomo = sVIRG; break;
+        case ';': r.atomo = sPONTO_VIRG; break;
+        default:  r.atomo = sEOF; break;
+    }
+    return r;
+}
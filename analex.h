@@ -1,6 +1,6 @@
 /*
  * analex.h - Interface do Analisador Léxico
- * Este arquivo de cabeçalho deve ser fornecido junto com analex.o
+ * Implementação em analex.c
  */
 
 #ifndef ANALEX_H
@@ -68,11 +68,18 @@ typedef struct {
     char lexema[100];   // Lexema (texto) do token
 } TInfoAtomo;
 
-// Variável global do arquivo fonte (usada pelo analex.o)
-extern FILE *fonte;
+// Estado de uma leitura: arquivo fonte e linha atual. Cada leitura tem o
+// seu, e leituras de estados diferentes podem correr em threads diferentes
+typedef struct {
+    FILE *fonte;
+    int linha;
+} EstadoLexico;
+
+// Prepara o estado para ler fonte, começando na linha dada
+void analex_iniciar(EstadoLexico *e, FILE *fonte, int linha);
 
 // Função principal do analisador léxico
-// Retorna o próximo átomo do arquivo fonte
-TInfoAtomo obter_atomo(void);
+// Retorna o próximo átomo do arquivo fonte do estado
+TInfoAtomo obter_atomo(EstadoLexico *e);
 
 #endif
@@ -6,15 +6,184 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <setjmp.h>
 #include "asdr.h"
 #include "analex.h"
 #include "tabsimb.h"
 #include "gerador.h"
 
-// Variáveis globais
-TInfoAtomo lookahead;
-int linha_atual = 1;
-int erro_sintatico = 0;
+static void parse_cmd_id(ContextoCompilacao *ctx);
+static void parse_atrib_resto(ContextoCompilacao *ctx, const TInfoAtomo *id);
+static void parse_chamada(ContextoCompilacao *ctx, const char *nome);
+
+// Prepara o contexto de uma compilação (a fonte é aberta à parte)
+void inicializar_contexto(ContextoCompilacao *ctx, FILE *arquivo_mepa, FILE *diag,
+                          EstatisticasCompilacao *est) {
+    memset(&ctx->fonte, 0, sizeof(ctx->fonte));
+    ctx->linha_atual = 1;
+    ctx->erros = 0;
+    ctx->limites = LIMITES_PADRAO;
+    ctx->recuperar = NULL;
+    ctx->pilha_exp = NULL;
+    ctx->n_exp = ctx->cap_exp = 0;
+    ctx->prof_exp = 0;
+    ctx->chamadas = NULL;
+    ctx->n_cham = ctx->cap_cham = 0;
+    ctx->sub_atual = NULL;
+    ctx->rotulo_retorno[0] = '\0';
+    ctx->aninhamento = 0;
+    ctx->aninhamento_excedido = 0;
+    ctx->diag = diag;
+    ctx->est = est;
+    ctx->base_pilha = 0;
+    ctx->ast = NULL;
+    inicializar_tabela_simbolos(&ctx->ts);
+    inicializar_gerador(&ctx->ger, arquivo_mepa);
+    ctx->ts.est = est;
+    ctx->ger.est = est;
+}
+
+void liberar_contexto(ContextoCompilacao *ctx) {
+    lexico_fechar(&ctx->fonte);
+    liberar_tabela_simbolos(&ctx->ts);
+    liberar_gerador(&ctx->ger);
+    free(ctx->pilha_exp);
+    ctx->pilha_exp = NULL;
+    free(ctx->chamadas);
+    ctx->chamadas = NULL;
+}
+
+// Pico da pilha de C desde o início da análise (--stats), amostrado a cada
+// átomo: os pontos mais fundos do parser sempre consomem um
+static void medir_pilha(ContextoCompilacao *ctx) {
+    char marca;
+    long uso = (long)(ctx->base_pilha - (uintptr_t)&marca);
+    
+    if (ctx->base_pilha != 0 && uso > ctx->est->pilha_c) ctx->est->pilha_c = uso;
+}
+
+// Consome o átomo atual
+void avancar(ContextoCompilacao *ctx) {
+    ctx->lookahead = lexico_proximo(&ctx->fonte);
+    ctx->linha_atual = ctx->lookahead.linha;
+    if (EST_ATIVO(ctx->est)) medir_pilha(ctx);
+}
+
+// Interrompe a compilação, voltando a parse_programa
+void abortar(ContextoCompilacao *ctx) {
+    longjmp(ctx->fuga, 1);
+}
+
+// Conta um erro já relatado. Desliga a geração de código (o .mepa de um
+// programa com erros não é usado) e interrompe ao esgotar o limite
+void registrar_erro(ContextoCompilacao *ctx) {
+    ctx->erros++;
+    ctx->ger.arquivo_saida = NULL;
+    if (ctx->limites.max_erros > 0 && ctx->erros >= ctx->limites.max_erros) {
+        fprintf(ctx->diag, "Erro: limite de %d erros atingido; compilação interrompida\n",
+                ctx->limites.max_erros);
+        abortar(ctx);
+    }
+}
+
+// Erro sintático já relatado: volta ao ponto de recuperação mais interno
+// (o comando ou a declaração em análise), que descarta o resto dele. Fora
+// deles a análise termina, com 2 em vez de 1 no longjmp: o resto da
+// compilação não foi interrompido (ver parse_programa_ast)
+void recuperar(ContextoCompilacao *ctx) {
+    if (ctx->recuperar == NULL) longjmp(ctx->fuga, 2);
+    longjmp(*ctx->recuperar, 1);
+}
+
+// Modo pânico: descarta átomos até o fim do comando com erro. Pára depois
+// de um ';' ou antes de 'fim' (fecha o bloco em análise) no mesmo nível;
+// begin/end e repeat/until internos ao comando são pulados inteiros
+void sincronizar(ContextoCompilacao *ctx, TAtomo fim) {
+    int nivel = 0;
+
+    for (;;) {
+        TAtomo a = ctx->lookahead.atomo;
+
+        if (a == sEOF) return;
+        if (nivel == 0 && (a == fim || a == sPONTO_VIRG)) {
+            if (a == sPONTO_VIRG) avancar(ctx);
+            return;
+        }
+        if (a == sBEGIN || a == sREPEAT) nivel++;
+        else if ((a == sEND || a == sUNTIL) && nivel > 0) nivel--;
+        avancar(ctx);
+    }
+}
+
+// Modo pânico nas declarações: pára depois de um ';' ou antes do início
+// de outra declaração ou do bloco. Um 'var' fora de lugar é descartado:
+// parse_dcl só termina no bloco, e parar antes dele repetiria o erro
+// indefinidamente
+void sincronizar_dcl(ContextoCompilacao *ctx) {
+    for (;;) {
+        switch (ctx->lookahead.atomo) {
+            case sPONTO_VIRG:
+                avancar(ctx);
+                return;
+            case sINT: case sFLOAT: case sBOOL: case sCHAR:
+            case sSUBROT: case sBEGIN: case sEND: case sEOF:
+                return;
+            default:
+                avancar(ctx);
+        }
+    }
+}
+
+// Falta de memória na tabela de símbolos interrompe a compilação
+void sem_memoria_ts(ContextoCompilacao *ctx) {
+    fprintf(ctx->diag, "Erro: falha ao alocar memória para tabela de símbolos\n");
+    ctx->erros++;
+    abortar(ctx);
+}
+
+// Insere um identificador na tabela; uma redeclaração é relatada e
+// ignorada (vale a primeira, e o retorno é NULL)
+RegistroTS* declarar(ContextoCompilacao *ctx, const char *lexema, Categoria cat,
+                     TAtomo tipo, int endereco) {
+    RegistroTS *registro = ts_inserir(&ctx->ts, lexema, cat, tipo, endereco);
+    if (registro != NULL) return registro;
+
+    if (ctx->ts.erro == TS_ERRO_DUPLICADO) {
+        fprintf(ctx->diag, "Erro semântico: identificador '%s' já declarado\n", lexema);
+        registrar_erro(ctx);
+        return NULL;
+    }
+    sem_memoria_ts(ctx);
+    return NULL;
+}
+
+// Busca o identificador de uma variável ou parâmetro usado na linha dada;
+// relata e devolve NULL se não foi declarado ou se é uma sub-rotina
+RegistroTS* buscar_variavel(ContextoCompilacao *ctx, const char *lexema, int linha) {
+    RegistroTS *registro = ts_buscar(&ctx->ts, lexema);
+
+    if (registro == NULL) {
+        fprintf(ctx->diag, "Erro semântico (%d): variável '%s' não declarada\n",
+                linha, lexema);
+        registrar_erro(ctx);
+    } else if (registro->categoria == CAT_FUNCAO) {
+        fprintf(ctx->diag, "Erro semântico (%d): '%s' é uma sub-rotina, não uma variável\n",
+                linha, lexema);
+        registrar_erro(ctx);
+        registro = NULL;
+    }
+    return registro;
+}
+
+// Tipos aceitos por operadores booleanos e numéricos; TIPO_ERRO (operando
+// que já teve erro relatado) é aceito para não gerar erros em cascata
+int eh_bool(TipoDado tipo) {
+    return tipo == TIPO_BOOL || tipo == TIPO_ERRO;
+}
+
+int eh_numerico(TipoDado tipo) {
+    return tipo == TIPO_INT || tipo == TIPO_FLOAT || tipo == TIPO_ERRO;
+}
 
 // Função auxiliar: converter TAtomo para TipoDado
 TipoDado atomo_para_tipodado(TAtomo tipo) {
@@ -32,6 +201,9 @@ int tipos_compativeis(TipoDado tipo1, TipoDado tipo2) {
     // Tipos exatamente iguais são sempre compatíveis
     if (tipo1 == tipo2) return 1;
     
+    // Operando com erro já relatado
+    if (tipo1 == TIPO_ERRO || tipo2 == TIPO_ERRO) return 1;
+    
     // Conversão implícita: int pode ser atribuído a float
     if (tipo1 == TIPO_INT && tipo2 == TIPO_FLOAT) return 1;
     if (tipo1 == TIPO_FLOAT && tipo2 == TIPO_INT) return 1;
@@ -72,6 +244,8 @@ const char* nome_token(TAtomo token) {
         case sIDENT: return "identificador";
         case sNUM_INT: return "número inteiro";
         case sNUM_FLOAT: return "número real";
+        case sSTRING: return "cadeia";
+        case sCHAR_CONST: return "constante caractere";
         case sMENOR: return "<";
         case sMENOR_IG: return "<=";
         case sIGUAL: return "=";
@@ -99,710 +273,1221 @@ const char* nome_token(TAtomo token) {
 }
 
 // Função para reportar erro sintático
-void erro_sintatico_msg(const char *esperado, TAtomo encontrado) {
-    erro_sintatico = 1;
-    printf("Erro (%d): Esperado %s, encontrado '%s'\n", 
-           linha_atual, esperado, nome_token(encontrado));
-}
-
-// Inicializa o analisador léxico
-void inicializar_analex(FILE *arquivo) {
-    lookahead = obter_atomo();
-    linha_atual = lookahead.linha;
+void erro_sintatico_msg(ContextoCompilacao *ctx, const char *esperado, TAtomo encontrado) {
+    fprintf(ctx->diag, "Erro (%d): Esperado %s, encontrado '%s'\n", 
+           ctx->linha_atual, esperado, nome_token(encontrado));
+    registrar_erro(ctx);
 }
 
 // Função de verificação de token
-void verifica(TAtomo token_esperado) {
-    if (lookahead.atomo == token_esperado) {
-        lookahead = obter_atomo();
-        linha_atual = lookahead.linha;
+void verifica(ContextoCompilacao *ctx, TAtomo token_esperado) {
+    if (ctx->lookahead.atomo == token_esperado) {
+        avancar(ctx);
     } else {
         char msg[100];
         snprintf(msg, sizeof(msg), "token '%s'", nome_token(token_esperado));
-        erro_sintatico_msg(msg, lookahead.atomo);
-        exit(1); // Modo pânico: encerra compilação
+        erro_sintatico_msg(ctx, msg, ctx->lookahead.atomo);
+        recuperar(ctx); // Modo pânico: descarta o comando
     }
 }
 
 // Função principal do parser
-int parse_programa() {
-    erro_sintatico = 0;
-    parse_ini();
-    return !erro_sintatico;
+int parse_programa(ContextoCompilacao *ctx) {
+    char base;
+    
+    ctx->erros = 0;
+    ctx->recuperar = NULL;
+    ctx->base_pilha = (uintptr_t)&base;
+    if (setjmp(ctx->fuga) != 0) return 0;
+
+    // Bootstrap: carregar primeiro token
+    avancar(ctx);
+    parse_ini(ctx);
+    return ctx->erros == 0;
 }
 
 // <ini> ::= sPRG <id> ; [<dcl>] [<sub>] <bco> .
-void parse_ini() {
-    verifica(sPRG);
+void parse_ini(ContextoCompilacao *ctx) {
+    verifica(ctx, sPRG);
     
-    TInfoAtomo id = lookahead;
-    parse_id();
+    TInfoAtomo id = ctx->lookahead;
+    parse_id(ctx);
     
     // Inserir programa na tabela de símbolos
-    ts_inserir(id.lexema, CAT_PROGRAMA, sVOID, -1);
+    declarar(ctx, id.lexema, CAT_PROGRAMA, sVOID, -1);
     
-    verifica(sPONTO_VIRG);
+    verifica(ctx, sPONTO_VIRG);
     
     // Gerar instrução inicial
-    gera_instr_mepa(NULL, "INPP", NULL, NULL);
+    gera_instr_mepa(&ctx->ger, NULL, "INPP", NULL, NULL);
     
-    int qtde_vars = 0;
+    // A área global começa com as globais de um módulo importado
+    int qtde_vars = obter_proximo_endereco(&ctx->ts);
     
     // Declarações de variáveis (opcional)
-    if (lookahead.atomo == sVAR) {
-        qtde_vars = parse_dcl();
-        if (qtde_vars > 0) {
-            char buffer[20];
-            snprintf(buffer, sizeof(buffer), "%d", qtde_vars);
-            gera_instr_mepa(NULL, "AMEM", buffer, NULL);
-        }
+    if (ctx->lookahead.atomo == sVAR) qtde_vars += parse_dcl(ctx);
+    if (qtde_vars > 0) {
+        char buffer[20];
+        snprintf(buffer, sizeof(buffer), "%d", qtde_vars);
+        gera_instr_mepa(&ctx->ger, NULL, "AMEM", buffer, NULL);
     }
     
-    // Sub-rotinas (opcional) - ignoramos para simplificar
-    if (lookahead.atomo == sSUBROT) {
-        printf("Aviso: sub-rotinas não implementadas (ignorando)\n");
+    // Sub-rotinas (opcional): o código delas vem antes do bloco principal,
+    // que é alcançado por um desvio
+    char rotulo_principal[20] = "";
+    if (ctx->lookahead.atomo == sSUBROT) {
+        strcpy(rotulo_principal, novo_rotulo(&ctx->ger));
+        gera_instr_mepa(&ctx->ger, NULL, "DSVS", rotulo_principal, NULL);
+        parse_sub(ctx);
+        gera_instr_mepa(&ctx->ger, rotulo_principal, "NADA", NULL, NULL);
     }
     
     // Bloco principal
-    parse_bco();
+    parse_bco(ctx);
     
-    verifica(sPONTO);
+    verifica(ctx, sPONTO);
     
     // Finalizar programa
     if (qtde_vars > 0) {
         char buffer[20];
         snprintf(buffer, sizeof(buffer), "%d", qtde_vars);
-        gera_instr_mepa(NULL, "DMEM", buffer, NULL);
+        gera_instr_mepa(&ctx->ger, NULL, "DMEM", buffer, NULL);
     }
-    gera_instr_mepa(NULL, "PARA", NULL, NULL);
+    gera_instr_mepa(&ctx->ger, NULL, "PARA", NULL, NULL);
 }
 
 // <id> ::= sIDENT
-void parse_id() {
-    verifica(sIDENT);
+void parse_id(ContextoCompilacao *ctx) {
+    verifica(ctx, sIDENT);
 }
 
-// <dcl> ::= sVAR <dcl_var> ; { <dcl_var> ; }
-int parse_dcl() {
-    int total_vars = 0;
+// <sub> ::= sSUBROT <dcl_sub> ; { <dcl_sub> ; }
+// Sub-rotinas não se aninham: todas são de nível 1, e enxergam os próprios
+// parâmetros e locais e as variáveis globais declaradas antes de 'subrot'
+void parse_sub(ContextoCompilacao *ctx) {
+    verifica(ctx, sSUBROT);
+    
+    do {
+        parse_dcl_sub(ctx);
+        verifica(ctx, sPONTO_VIRG);
+    } while (ctx->lookahead.atomo == sVOID || ctx->lookahead.atomo == sINT ||
+             ctx->lookahead.atomo == sFLOAT || ctx->lookahead.atomo == sBOOL ||
+             ctx->lookahead.atomo == sCHAR);
+}
+
+// <dcl_sub> ::= (<tipo> | sVOID) <id> ( [<tipo> <id> {, <tipo> <id>}] ) ; [<dcl>] <bco>
+// Registro de ativação: resultado, argumentos, endereço de retorno e D[1]
+// salvo abaixo de D[1]; locais a partir de D[1] (ver mepa.h)
+void parse_dcl_sub(ContextoCompilacao *ctx) {
+    TAtomo tipo;
+    
+    if (ctx->lookahead.atomo == sVOID) {
+        verifica(ctx, sVOID);
+        tipo = sVOID;
+    } else {
+        tipo = parse_tipo(ctx);
+    }
     
-    verifica(sVAR);
+    TInfoAtomo id = ctx->lookahead;
+    parse_id(ctx);
+    
+    // A sub-rotina é global (e visível no próprio corpo: recursão); os
+    // parâmetros e locais, do escopo dela
+    RegistroTS *sub = declarar(ctx, id.lexema, CAT_FUNCAO, tipo,
+                               ctx->ts.n_subrotinas + 1);
+    int numero = sub != NULL ? sub->endereco : 0;
+    ts_abrir_escopo(&ctx->ts);
+    
+    // Parâmetros: o endereço provisório é a posição, corrigida depois de
+    // conhecido o total (o parâmetro i fica em -(n + 3) + i)
+    verifica(ctx, sABRE_PARENT);
+    int n_param = 0;
+    if (ctx->lookahead.atomo != sFECHA_PARENT) {
+        for (;;) {
+            TAtomo tipo_param = parse_tipo(ctx);
+            TInfoAtomo param = ctx->lookahead;
+            parse_id(ctx);
+            
+            declarar(ctx, param.lexema, CAT_PARAMETRO, tipo_param, ++n_param);
+            if (sub != NULL && !ts_adicionar_parametro(sub, tipo_param)) sem_memoria_ts(ctx);
+            
+            if (ctx->lookahead.atomo != sVIRG) break;
+            verifica(ctx, sVIRG);
+        }
+    }
+    verifica(ctx, sFECHA_PARENT);
+    for (RegistroTS *r = ctx->ts.cabeca; r != ctx->ts.base_escopo; r = r->proximo) {
+        r->endereco -= n_param + 3;
+    }
+    verifica(ctx, sPONTO_VIRG);
+    
+    // Entrada (rótulo R<número>) e rótulo do retorno
+    char entrada[20], buffer[20];
+    snprintf(entrada, sizeof(entrada), "R%d", numero);
+    gera_instr_mepa(&ctx->ger, entrada, "ENPR", "1", NULL);
+    strcpy(ctx->rotulo_retorno, novo_rotulo(&ctx->ger));
+    ctx->sub_atual = sub;
+    
+    int qtde_vars = 0;
+    if (ctx->lookahead.atomo == sVAR) {
+        qtde_vars = parse_dcl(ctx);
+        if (qtde_vars > 0) {
+            snprintf(buffer, sizeof(buffer), "%d", qtde_vars);
+            gera_instr_mepa(&ctx->ger, NULL, "AMEM", buffer, NULL);
+        }
+    }
     
-    total_vars += parse_dcl_var();
-    verifica(sPONTO_VIRG);
+    parse_bco(ctx);
     
-    while (lookahead.atomo == sINT || lookahead.atomo == sFLOAT || 
-           lookahead.atomo == sBOOL || lookahead.atomo == sCHAR) {
-        total_vars += parse_dcl_var();
-        verifica(sPONTO_VIRG);
+    gera_instr_mepa(&ctx->ger, ctx->rotulo_retorno, "NADA", NULL, NULL);
+    if (qtde_vars > 0) {
+        snprintf(buffer, sizeof(buffer), "%d", qtde_vars);
+        gera_instr_mepa(&ctx->ger, NULL, "DMEM", buffer, NULL);
     }
+    snprintf(buffer, sizeof(buffer), "%d", n_param);
+    gera_instr_mepa(&ctx->ger, NULL, "RTPR", "1", buffer);
+    
+    ts_fechar_escopo(&ctx->ts);
+    ctx->sub_atual = NULL;
+}
+
+// <dcl_var> ; com recuperação: num erro, descarta o resto da declaração
+static void parse_dcl_var_recuperavel(ContextoCompilacao *ctx, int *total_vars) {
+    jmp_buf ponto;
+    jmp_buf *anterior = ctx->recuperar;
+    
+    ctx->recuperar = &ponto;
+    if (setjmp(ponto) == 0) {
+        *total_vars += parse_dcl_var(ctx);
+        verifica(ctx, sPONTO_VIRG);
+    } else {
+        sincronizar_dcl(ctx);
+    }
+    ctx->recuperar = anterior;
+}
+
+// <dcl> ::= sVAR <dcl_var> ; { <dcl_var> ; }
+int parse_dcl(ContextoCompilacao *ctx) {
+    int total_vars = 0;
+    
+    verifica(ctx, sVAR);
+    
+    // Até o bloco, tudo é declaração: o que não começa com um tipo é
+    // relatado e descartado
+    do {
+        parse_dcl_var_recuperavel(ctx, &total_vars);
+    } while (ctx->lookahead.atomo != sBEGIN && ctx->lookahead.atomo != sSUBROT &&
+             ctx->lookahead.atomo != sEND && ctx->lookahead.atomo != sEOF);
     
     return total_vars;
 }
 
 // <dcl_var> ::= <tipo> <id> <mais_var>
-int parse_dcl_var() {
+int parse_dcl_var(ContextoCompilacao *ctx) {
     int count = 1;
-    TAtomo tipo = parse_tipo();
+    TAtomo tipo = parse_tipo(ctx);
     
-    TInfoAtomo id = lookahead;
-    parse_id();
+    TInfoAtomo id = ctx->lookahead;
+    parse_id(ctx);
     
     // Inserir variável na tabela de símbolos
-    int endereco = obter_proximo_endereco();
-    ts_inserir(id.lexema, CAT_VARIAVEL, tipo, endereco);
+    int endereco = obter_proximo_endereco(&ctx->ts);
+    declarar(ctx, id.lexema, CAT_VARIAVEL, tipo, endereco);
     
-    count += parse_mais_var(tipo);
+    count += parse_mais_var(ctx, tipo);
     
     return count;
 }
 
 // <tipo> ::= sINT | sFLOAT | sBOOL | sCHAR
-TAtomo parse_tipo() {
-    TAtomo tipo = lookahead.atomo;
+TAtomo parse_tipo(ContextoCompilacao *ctx) {
+    TAtomo tipo = ctx->lookahead.atomo;
     
     if (tipo == sINT) {
-        verifica(sINT);
+        verifica(ctx, sINT);
     } else if (tipo == sFLOAT) {
-        verifica(sFLOAT);
+        verifica(ctx, sFLOAT);
     } else if (tipo == sBOOL) {
-        verifica(sBOOL);
+        verifica(ctx, sBOOL);
     } else if (tipo == sCHAR) {
-        verifica(sCHAR);
+        verifica(ctx, sCHAR);
     } else {
-        erro_sintatico_msg("tipo (int, float, bool ou char)", tipo);
-        exit(1);
+        erro_sintatico_msg(ctx, "tipo (int, float, bool ou char)", tipo);
+        recuperar(ctx);
     }
     
     return tipo;
 }
 
 // <mais_var> ::= , <id> <mais_var> | ε
-int parse_mais_var(TAtomo tipo) {
+// (como laço: listas com milhares de variáveis não consomem pilha)
+int parse_mais_var(ContextoCompilacao *ctx, TAtomo tipo) {
     int count = 0;
     
-    if (lookahead.atomo == sVIRG) {
-        verifica(sVIRG);
+    while (ctx->lookahead.atomo == sVIRG) {
+        verifica(ctx, sVIRG);
         
-        TInfoAtomo id = lookahead;
-        parse_id();
+        TInfoAtomo id = ctx->lookahead;
+        parse_id(ctx);
         
         // Inserir variável na tabela de símbolos
-        int endereco = obter_proximo_endereco();
-        ts_inserir(id.lexema, CAT_VARIAVEL, tipo, endereco);
+        int endereco = obter_proximo_endereco(&ctx->ts);
+        declarar(ctx, id.lexema, CAT_VARIAVEL, tipo, endereco);
         
-        count = 1 + parse_mais_var(tipo);
+        count++;
     }
     
     return count;
 }
 
+// { <cmd> ; } até 'fim' (end ou until). Cada comando é um ponto de
+// recuperação: um erro sintático descarta o resto dele e a análise segue
+// no próximo
+static void parse_lista_cmd(ContextoCompilacao *ctx, TAtomo fim) {
+    jmp_buf ponto;
+    jmp_buf *anterior = ctx->recuperar;
+    int aninhamento = ctx->aninhamento;
+    
+    ctx->recuperar = &ponto;
+    while (ctx->lookahead.atomo != fim && ctx->lookahead.atomo != sEOF) {
+        if (setjmp(ponto) == 0) {
+            parse_cmd(ctx);
+            verifica(ctx, sPONTO_VIRG);
+        } else {
+            ctx->aninhamento = aninhamento;
+            sincronizar(ctx, fim);
+        }
+    }
+    ctx->recuperar = anterior;
+}
+
 // <bco> ::= sBEGIN { <cmd> ; } sEND
-void parse_bco() {
-    verifica(sBEGIN);
+void parse_bco(ContextoCompilacao *ctx) {
+    verifica(ctx, sBEGIN);
     
-    while (lookahead.atomo != sEND && lookahead.atomo != sEOF) {
-        parse_cmd();
-        verifica(sPONTO_VIRG);
-    }
+    parse_lista_cmd(ctx, sEND);
     
-    verifica(sEND);
+    verifica(ctx, sEND);
 }
 
-// <cmd> ::= <atrib> | <leitura> | <escrita> | <selecao> | <repeticao> | <ret> | <bco>
-void parse_cmd() {
-    switch (lookahead.atomo) {
+// <cmd> ::= <atrib> | <chamada> | <leitura> | <escrita> | <selecao> | <repeticao> | <ret> | <bco>
+// Comandos aninhados ainda recursam em C; o limite de aninhamento troca o
+// estouro da pilha por um erro
+void parse_cmd(ContextoCompilacao *ctx) {
+    int max = ctx->limites.max_aninhamento;
+    
+    // Relatado uma vez: os demais comandos fundos demais são só descartados
+    if (max > 0 && ctx->aninhamento >= max) {
+        if (!ctx->aninhamento_excedido) {
+            fprintf(ctx->diag, "Erro (%d): comandos aninhados demais (limite %d)\n",
+                    ctx->linha_atual, max);
+            ctx->aninhamento_excedido = 1;
+            registrar_erro(ctx);
+        }
+        recuperar(ctx);
+    }
+    ctx->aninhamento++;
+    
+    switch (ctx->lookahead.atomo) {
         case sIDENT:
-            parse_atrib();
+            parse_cmd_id(ctx);
             break;
         case sREAD:
-            parse_leitura();
+            parse_leitura(ctx);
             break;
         case sWRITE:
-            parse_escrita();
+            parse_escrita(ctx);
             break;
         case sIF:
-            parse_selecao();
+            parse_selecao(ctx);
             break;
         case sWHILE:
         case sREPEAT:
         case sFOR:
-            parse_repeticao();
+            parse_repeticao(ctx);
             break;
         case sRETURN:
-            parse_ret();
+            parse_ret(ctx);
             break;
         case sBEGIN:
-            parse_bco();
+            parse_bco(ctx);
             break;
         default:
-            erro_sintatico_msg("comando", lookahead.atomo);
-            exit(1);
+            erro_sintatico_msg(ctx, "comando", ctx->lookahead.atomo);
+            recuperar(ctx);
+    }
+    
+    ctx->aninhamento--;
+}
+
+// Comando que começa com identificador: <atrib> ou <chamada>, decidido
+// pelo átomo seguinte
+static void parse_cmd_id(ContextoCompilacao *ctx) {
+    TInfoAtomo id = ctx->lookahead;
+    verifica(ctx, sIDENT);
+    
+    if (ctx->lookahead.atomo == sABRE_PARENT) {
+        parse_chamada(ctx, id.lexema);
+    } else {
+        parse_atrib_resto(ctx, &id);
     }
 }
 
 // <atrib> ::= <id> <- <exp>
-void parse_atrib() {
-    TInfoAtomo id = lookahead;
-    verifica(sIDENT);
-    
+void parse_atrib(ContextoCompilacao *ctx) {
+    TInfoAtomo id = ctx->lookahead;
+    verifica(ctx, sIDENT);
+    parse_atrib_resto(ctx, &id);
+}
+
+// <atrib> depois do identificador (já consumido)
+static void parse_atrib_resto(ContextoCompilacao *ctx, const TInfoAtomo *id) {
     // Validação semântica: verificar se variável foi declarada
-    RegistroTS *registro = ts_buscar(id.lexema);
-    if (registro == NULL) {
-        printf("Erro semântico (%d): variável '%s' não declarada\n", 
-               linha_atual, id.lexema);
-        exit(1);
-    }
+    RegistroTS *registro = buscar_variavel(ctx, id->lexema, ctx->linha_atual);
     
-    verifica(sATRIB);
+    verifica(ctx, sATRIB);
     
     // Avaliar expressão E obter seu tipo
-    TipoDado tipo_exp = parse_exp();
+    TipoDado tipo_exp = parse_exp(ctx);
+    if (registro == NULL) return;
     
     // TYPE CHECKING: Validar compatibilidade de tipos
     if (!tipos_compativeis(tipo_exp, registro->tipo)) {
-        printf("Erro semântico (%d): incompatibilidade de tipos na atribuição - "
+        fprintf(ctx->diag, "Erro semântico (%d): incompatibilidade de tipos na atribuição - "
                "tentando atribuir '%s' a variável '%s' do tipo '%s'\n",
-               linha_atual,
+               ctx->linha_atual,
                nome_tipo(tipo_exp),
-               id.lexema,
+               id->lexema,
                nome_tipo(registro->tipo));
-        exit(1);
+        registrar_erro(ctx);
+        return;
     }
     
     // Gerar instrução de armazenamento
     char nivel[20], endereco[20];
-    snprintf(nivel, sizeof(nivel), "0");
+    snprintf(nivel, sizeof(nivel), "%d", registro->nivel);
     snprintf(endereco, sizeof(endereco), "%d", registro->endereco);
-    gera_instr_mepa(NULL, "ARMZ", nivel, endereco);
+    gera_instr_mepa(&ctx->ger, NULL, "ARMZ", nivel, endereco);
 }
 
 // <leitura> ::= sREAD ( <id> )
-void parse_leitura() {
-    verifica(sREAD);
-    verifica(sABRE_PARENT);
+void parse_leitura(ContextoCompilacao *ctx) {
+    verifica(ctx, sREAD);
+    verifica(ctx, sABRE_PARENT);
     
-    TInfoAtomo id = lookahead;
-    verifica(sIDENT);
+    TInfoAtomo id = ctx->lookahead;
+    verifica(ctx, sIDENT);
     
     // Validação semântica: verificar se variável foi declarada
-    RegistroTS *registro = ts_buscar(id.lexema);
-    if (registro == NULL) {
-        printf("Erro semântico (%d): variável '%s' não declarada\n", 
-               linha_atual, id.lexema);
-        exit(1);
-    }
+    RegistroTS *registro = buscar_variavel(ctx, id.lexema, ctx->linha_atual);
     
-    verifica(sFECHA_PARENT);
+    verifica(ctx, sFECHA_PARENT);
+    if (registro == NULL) return;
     
     // Gerar instruções: ler e armazenar
-    gera_instr_mepa(NULL, "LEIT", NULL, NULL);
+    gera_instr_mepa(&ctx->ger, NULL, "LEIT", NULL, NULL);
     
     char nivel[20], endereco[20];
-    snprintf(nivel, sizeof(nivel), "0");
+    snprintf(nivel, sizeof(nivel), "%d", registro->nivel);
     snprintf(endereco, sizeof(endereco), "%d", registro->endereco);
-    gera_instr_mepa(NULL, "ARMZ", nivel, endereco);
+    gera_instr_mepa(&ctx->ger, NULL, "ARMZ", nivel, endereco);
 }
 
-// <escrita> ::= sWRITE ( <exp> )
-void parse_escrita() {
-    verifica(sWRITE);
-    verifica(sABRE_PARENT);
-    
+// Texto de uma constante cadeia ou caractere, sem as aspas se o léxico as
+// mantiver no lexema
+void texto_literal(const TInfoAtomo *atomo, char destino[100]) {
+    const char *s = atomo->lexema;
+    size_t tam = strlen(s);
+
+    if (tam >= 2 && (s[0] == '"' || s[0] == '\'') && s[tam - 1] == s[0]) {
+        s++;
+        tam -= 2;
+    }
+    memcpy(destino, s, tam);
+    destino[tam] = '\0';
+}
+
+// <escrita> ::= sWRITE ( <exp> ) | sWRITE ( <cadeia> ) | sWRITE ( <caractere> )
+void parse_escrita(ContextoCompilacao *ctx) {
+    verifica(ctx, sWRITE);
+    verifica(ctx, sABRE_PARENT);
+    
+    // Constante cadeia ou caractere: entrada da tabela de cadeias
+    if (ctx->lookahead.atomo == sSTRING || ctx->lookahead.atomo == sCHAR_CONST) {
+        char texto[100];
+        texto_literal(&ctx->lookahead, texto);
+        verifica(ctx, ctx->lookahead.atomo);
+        verifica(ctx, sFECHA_PARENT);
+        gera_impressao_cadeia(&ctx->ger, texto);
+        return;
+    }
+
     // Avaliar expressão (resultado fica no topo da pilha)
-    parse_exp();
+    parse_exp(ctx);
     
-    verifica(sFECHA_PARENT);
+    verifica(ctx, sFECHA_PARENT);
     
     // Gerar instrução de impressão
-    gera_instr_mepa(NULL, "IMPR", NULL, NULL);
+    gera_instr_mepa(&ctx->ger, NULL, "IMPR", NULL, NULL);
 }
 
-// <ret> ::= sRETURN <exp>
-void parse_ret() {
-    verifica(sRETURN);
-    parse_exp();
-    // Instrução de retorno será implementada com sub-rotinas
+// Átomos que podem seguir um comando: 'return' sem valor
+int fim_de_comando(TAtomo a) {
+    return a == sPONTO_VIRG || a == sEND || a == sELSE || a == sUNTIL;
+}
+
+// Checa um 'return' na sub-rotina sub (também usada pela semântica do -O1)
+void checar_retorno(ContextoCompilacao *ctx, RegistroTS *sub, int com_valor,
+                    TipoDado tipo, int linha) {
+    if (sub->tipo == TIPO_VOID) {
+        if (com_valor) {
+            fprintf(ctx->diag, "Erro semântico (%d): 'return' com valor na sub-rotina void '%s'\n",
+                    linha, sub->lexema);
+            registrar_erro(ctx);
+        }
+    } else if (!com_valor) {
+        fprintf(ctx->diag, "Erro semântico (%d): 'return' sem valor na função '%s'\n",
+                linha, sub->lexema);
+        registrar_erro(ctx);
+    } else if (!tipos_compativeis(tipo, sub->tipo)) {
+        fprintf(ctx->diag, "Erro semântico (%d): tipo de retorno incompatível em '%s' - "
+                "esperado '%s', encontrado '%s'\n",
+                linha, sub->lexema, nome_tipo(sub->tipo), nome_tipo(tipo));
+        registrar_erro(ctx);
+    }
+}
+
+// <ret> ::= sRETURN [<exp>]
+// Numa função, guarda o valor na célula do resultado e desvia para o fim da
+// sub-rotina. No programa principal a expressão só é avaliada, como antes
+void parse_ret(ContextoCompilacao *ctx) {
+    RegistroTS *sub = ctx->sub_atual;
+    TipoDado tipo = TIPO_VOID;
+    
+    verifica(ctx, sRETURN);
+    int com_valor = !fim_de_comando(ctx->lookahead.atomo);
+    if (com_valor) tipo = parse_exp(ctx);
+    if (sub == NULL) return;
+    
+    checar_retorno(ctx, sub, com_valor, tipo, ctx->linha_atual);
+    
+    if (com_valor && sub->tipo != TIPO_VOID) {
+        char endereco[20];
+        snprintf(endereco, sizeof(endereco), "%d", -(sub->n_param + 3));
+        gera_instr_mepa(&ctx->ger, NULL, "ARMZ", "1", endereco);
+    }
+    gera_instr_mepa(&ctx->ger, NULL, "DSVS", ctx->rotulo_retorno, NULL);
 }
 
 // <selecao> ::= sIF <exp> sTHEN <cmd> [sELSE <cmd>]
-void parse_selecao() {
-    verifica(sIF);
+void parse_selecao(ContextoCompilacao *ctx) {
+    verifica(ctx, sIF);
     
     // Avaliar condição e obter tipo
-    TipoDado tipo_cond = parse_exp();
+    TipoDado tipo_cond = parse_exp(ctx);
     
     // TYPE CHECKING: Condição deve ser booleana (ou numérica para comparação)
     // Em LPD, aceitamos qualquer tipo que possa ser avaliado como verdadeiro/falso
     
-    verifica(sTHEN);
+    verifica(ctx, sTHEN);
     
     // Gerar rótulo para desvio falso
-    char *rotulo_falso = novo_rotulo();
+    char *rotulo_falso = novo_rotulo(&ctx->ger);
     char rotulo_falso_str[20];
     strcpy(rotulo_falso_str, rotulo_falso);
     
-    gera_instr_mepa(NULL, "DSVF", rotulo_falso_str, NULL);
+    gera_instr_mepa(&ctx->ger, NULL, "DSVF", rotulo_falso_str, NULL);
     
     // Comando do THEN
-    parse_cmd();
+    parse_cmd(ctx);
     
-    if (lookahead.atomo == sELSE) {
+    if (ctx->lookahead.atomo == sELSE) {
         // Gerar rótulo para fim do IF
-        char *rotulo_fim = novo_rotulo();
+        char *rotulo_fim = novo_rotulo(&ctx->ger);
         char rotulo_fim_str[20];
         strcpy(rotulo_fim_str, rotulo_fim);
         
-        gera_instr_mepa(NULL, "DSVS", rotulo_fim_str, NULL);
-        gera_instr_mepa(rotulo_falso_str, "NADA", NULL, NULL);
+        gera_instr_mepa(&ctx->ger, NULL, "DSVS", rotulo_fim_str, NULL);
+        gera_instr_mepa(&ctx->ger, rotulo_falso_str, "NADA", NULL, NULL);
         
-        verifica(sELSE);
-        parse_cmd();
+        verifica(ctx, sELSE);
+        parse_cmd(ctx);
         
-        gera_instr_mepa(rotulo_fim_str, "NADA", NULL, NULL);
+        gera_instr_mepa(&ctx->ger, rotulo_fim_str, "NADA", NULL, NULL);
     } else {
         // Sem ELSE
-        gera_instr_mepa(rotulo_falso_str, "NADA", NULL, NULL);
+        gera_instr_mepa(&ctx->ger, rotulo_falso_str, "NADA", NULL, NULL);
     }
 }
 
 // <repeticao> ::= <while> | <repeat> | <for>
-void parse_repeticao() {
-    if (lookahead.atomo == sWHILE) {
-        parse_while();
-    } else if (lookahead.atomo == sREPEAT) {
-        parse_repeat();
-    } else if (lookahead.atomo == sFOR) {
-        parse_for();
+void parse_repeticao(ContextoCompilacao *ctx) {
+    if (ctx->lookahead.atomo == sWHILE) {
+        parse_while(ctx);
+    } else if (ctx->lookahead.atomo == sREPEAT) {
+        parse_repeat(ctx);
+    } else if (ctx->lookahead.atomo == sFOR) {
+        parse_for(ctx);
     }
 }
 
 // <while> ::= sWHILE <exp> sDO <cmd>
-void parse_while() {
-    verifica(sWHILE);
+void parse_while(ContextoCompilacao *ctx) {
+    verifica(ctx, sWHILE);
     
     // Rótulo de início do loop
-    char *rotulo_inicio = novo_rotulo();
+    char *rotulo_inicio = novo_rotulo(&ctx->ger);
     char rotulo_inicio_str[20];
     strcpy(rotulo_inicio_str, rotulo_inicio);
     
-    gera_instr_mepa(rotulo_inicio_str, "NADA", NULL, NULL);
+    gera_instr_mepa(&ctx->ger, rotulo_inicio_str, "NADA", NULL, NULL);
     
     // Avaliar condição
-    parse_exp();
+    parse_exp(ctx);
     
-    verifica(sDO);
+    verifica(ctx, sDO);
     
     // Rótulo de saída
-    char *rotulo_fim = novo_rotulo();
+    char *rotulo_fim = novo_rotulo(&ctx->ger);
     char rotulo_fim_str[20];
     strcpy(rotulo_fim_str, rotulo_fim);
     
-    gera_instr_mepa(NULL, "DSVF", rotulo_fim_str, NULL);
+    gera_instr_mepa(&ctx->ger, NULL, "DSVF", rotulo_fim_str, NULL);
     
     // Corpo do loop
-    parse_cmd();
+    parse_cmd(ctx);
     
     // Voltar ao início
-    gera_instr_mepa(NULL, "DSVS", rotulo_inicio_str, NULL);
-    gera_instr_mepa(rotulo_fim_str, "NADA", NULL, NULL);
+    gera_instr_mepa(&ctx->ger, NULL, "DSVS", rotulo_inicio_str, NULL);
+    gera_instr_mepa(&ctx->ger, rotulo_fim_str, "NADA", NULL, NULL);
 }
 
 // <repeat> ::= sREPEAT { <cmd> ; } sUNTIL <exp>
-void parse_repeat() {
-    verifica(sREPEAT);
+void parse_repeat(ContextoCompilacao *ctx) {
+    verifica(ctx, sREPEAT);
     
     // Rótulo de início
-    char *rotulo_inicio = novo_rotulo();
+    char *rotulo_inicio = novo_rotulo(&ctx->ger);
     char rotulo_inicio_str[20];
     strcpy(rotulo_inicio_str, rotulo_inicio);
     
-    gera_instr_mepa(rotulo_inicio_str, "NADA", NULL, NULL);
+    gera_instr_mepa(&ctx->ger, rotulo_inicio_str, "NADA", NULL, NULL);
     
     // Comandos do corpo
-    while (lookahead.atomo != sUNTIL && lookahead.atomo != sEOF) {
-        parse_cmd();
-        verifica(sPONTO_VIRG);
-    }
+    parse_lista_cmd(ctx, sUNTIL);
     
-    verifica(sUNTIL);
+    verifica(ctx, sUNTIL);
     
     // Avaliar condição
-    parse_exp();
+    parse_exp(ctx);
     
     // Se falso, volta ao início
-    gera_instr_mepa(NULL, "DSVF", rotulo_inicio_str, NULL);
+    gera_instr_mepa(&ctx->ger, NULL, "DSVF", rotulo_inicio_str, NULL);
 }
 
 // <for> ::= sFOR ( <atrib> ; <exp> ; <atrib> ) <cmd>
-void parse_for() {
-    verifica(sFOR);
-    verifica(sABRE_PARENT);
+void parse_for(ContextoCompilacao *ctx) {
+    verifica(ctx, sFOR);
+    verifica(ctx, sABRE_PARENT);
     
     // Inicialização
-    parse_atrib();
-    verifica(sPONTO_VIRG);
+    parse_atrib(ctx);
+    verifica(ctx, sPONTO_VIRG);
     
     // Rótulo de início
-    char *rotulo_inicio = novo_rotulo();
+    char *rotulo_inicio = novo_rotulo(&ctx->ger);
     char rotulo_inicio_str[20];
     strcpy(rotulo_inicio_str, rotulo_inicio);
     
-    gera_instr_mepa(rotulo_inicio_str, "NADA", NULL, NULL);
+    gera_instr_mepa(&ctx->ger, rotulo_inicio_str, "NADA", NULL, NULL);
     
     // Condição
-    parse_exp();
+    parse_exp(ctx);
     
-    verifica(sPONTO_VIRG);
+    verifica(ctx, sPONTO_VIRG);
     
     // Rótulo de saída e corpo
-    char *rotulo_fim = novo_rotulo();
+    char *rotulo_fim = novo_rotulo(&ctx->ger);
     char rotulo_fim_str[20];
     strcpy(rotulo_fim_str, rotulo_fim);
     
-    gera_instr_mepa(NULL, "DSVF", rotulo_fim_str, NULL);
+    gera_instr_mepa(&ctx->ger, NULL, "DSVF", rotulo_fim_str, NULL);
     
     // Pular para o corpo (evitar incremento na primeira iteração)
-    char *rotulo_corpo = novo_rotulo();
+    char *rotulo_corpo = novo_rotulo(&ctx->ger);
     char rotulo_corpo_str[20];
     strcpy(rotulo_corpo_str, rotulo_corpo);
     
-    gera_instr_mepa(NULL, "DSVS", rotulo_corpo_str, NULL);
+    gera_instr_mepa(&ctx->ger, NULL, "DSVS", rotulo_corpo_str, NULL);
     
     // Rótulo do incremento
-    char *rotulo_incr = novo_rotulo();
+    char *rotulo_incr = novo_rotulo(&ctx->ger);
     char rotulo_incr_str[20];
     strcpy(rotulo_incr_str, rotulo_incr);
     
-    gera_instr_mepa(rotulo_incr_str, "NADA", NULL, NULL);
+    gera_instr_mepa(&ctx->ger, rotulo_incr_str, "NADA", NULL, NULL);
     
     // Incremento
-    parse_atrib();
+    parse_atrib(ctx);
     
-    verifica(sFECHA_PARENT);
+    verifica(ctx, sFECHA_PARENT);
     
     // Voltar para testar condição
-    gera_instr_mepa(NULL, "DSVS", rotulo_inicio_str, NULL);
+    gera_instr_mepa(&ctx->ger, NULL, "DSVS", rotulo_inicio_str, NULL);
     
     // Corpo do loop
-    gera_instr_mepa(rotulo_corpo_str, "NADA", NULL, NULL);
-    parse_cmd();
+    gera_instr_mepa(&ctx->ger, rotulo_corpo_str, "NADA", NULL, NULL);
+    parse_cmd(ctx);
     
     // Após corpo, executar incremento
-    gera_instr_mepa(NULL, "DSVS", rotulo_incr_str, NULL);
+    gera_instr_mepa(&ctx->ger, NULL, "DSVS", rotulo_incr_str, NULL);
     
     // Fim do for
-    gera_instr_mepa(rotulo_fim_str, "NADA", NULL, NULL);
+    gera_instr_mepa(&ctx->ger, rotulo_fim_str, "NADA", NULL, NULL);
+}
+
+/*
+ * Expressões
+ *
+ * A gramática de expressões é analisada com uma pilha explícita em vez de
+ * recursão: cada quadro é um não-terminal em análise e o ponto onde ele
+ * parou (estado). Cada nível de parênteses custa quatro quadros de 12 bytes
+ * (um por não-terminal) na memória do contexto, e não quatro chamadas na
+ * pilha de C; a profundidade é limitada por ctx->limites.max_expressao.
+ *
+ * Cada passo_* executa um trecho de um não-terminal até concluí-lo (e
+ * desempilhá-lo, deixando o tipo em *res) ou até precisar de um
+ * não-terminal interno (empilhado; o resultado dele chega em *res no
+ * próximo passo). O código gerado e as mensagens são os da versão recursiva.
+ */
+
+// Empilha um não-terminal de expressão
+void empilhar_exp(ContextoCompilacao *ctx, NaoTerminalExp nt) {
+    if (ctx->n_exp == ctx->cap_exp) {
+        int cap = ctx->cap_exp ? ctx->cap_exp * 2 : 64;
+        QuadroExp *maior = realloc(ctx->pilha_exp, sizeof(QuadroExp) * cap);
+        if (maior == NULL) {
+            fprintf(ctx->diag, "Erro: falha ao alocar memória para a análise de expressões\n");
+            ctx->erros++;
+            abortar(ctx);
+        }
+        ctx->pilha_exp = maior;
+        ctx->cap_exp = cap;
+    }
+    QuadroExp *q = &ctx->pilha_exp[ctx->n_exp++];
+    q->nt = nt;
+    q->estado = 0;
+    q->negativo = 0;
+    q->op = sEOF;
+    q->esq.no = 0;
+}
+
+// Entra num nível de parênteses ou 'nao', respeitando o limite
+void aprofundar_exp(ContextoCompilacao *ctx) {
+    int max = ctx->limites.max_expressao;
+    
+    if (max > 0 && ++ctx->prof_exp > max) {
+        fprintf(ctx->diag, "Erro (%d): expressão aninhada demais (limite %d)\n",
+                ctx->linha_atual, max);
+        registrar_erro(ctx);
+        recuperar(ctx);
+    }
+}
+
+int eh_op_relacional(TAtomo a) {
+    return a == sMENOR || a == sMENOR_IG || a == sIGUAL ||
+           a == sDIFERENTE || a == sMAIOR || a == sMAIOR_IG;
 }
 
 // <exp> ::= <exp_simples> [<op_rel> <exp_simples>]
-TipoDado parse_exp() {
-    TipoDado tipo1 = parse_exp_simples();
+static void passo_exp(ContextoCompilacao *ctx, QuadroExp *q, TipoDado *res) {
+    switch (q->estado) {
+        case 0:
+            q->estado = 1;
+            empilhar_exp(ctx, NT_EXP_SIMPLES);
+            return;
+            
+        case 1:
+            q->esq.tipo = *res;
+            
+            // Operadores relacionais
+            if (eh_op_relacional(ctx->lookahead.atomo)) {
+                q->op = ctx->lookahead.atomo;
+                avancar(ctx);
+                q->estado = 2;
+                empilhar_exp(ctx, NT_EXP_SIMPLES);
+                return;
+            }
+            ctx->n_exp--;
+            return;
+    }
     
-    // Operadores relacionais
-    if (lookahead.atomo == sMENOR || lookahead.atomo == sMENOR_IG ||
-        lookahead.atomo == sIGUAL || lookahead.atomo == sDIFERENTE ||
-        lookahead.atomo == sMAIOR || lookahead.atomo == sMAIOR_IG) {
-        
-        TAtomo op = lookahead.atomo;
-        lookahead = obter_atomo();
-        linha_atual = lookahead.linha;
-        
-        TipoDado tipo2 = parse_exp_simples();
-        
-        // TYPE CHECKING: Operandos devem ser compatíveis
-        if (!tipos_compativeis(tipo1, tipo2)) {
-            printf("Erro semântico (%d): operandos incompatíveis na comparação - "
-                   "'%s' e '%s'\n",
-                   linha_atual,
-                   nome_tipo(tipo1),
-                   nome_tipo(tipo2));
-            exit(1);
-        }
-        
-        // Gerar instrução de comparação
-        switch(op) {
-            case sMENOR:
-                gera_instr_mepa(NULL, "CMME", NULL, NULL);
-                break;
-            case sMENOR_IG:
-                gera_instr_mepa(NULL, "CMEG", NULL, NULL);
-                break;
-            case sIGUAL:
-                gera_instr_mepa(NULL, "CMIG", NULL, NULL);
-                break;
-            case sDIFERENTE:
-                gera_instr_mepa(NULL, "CMDG", NULL, NULL);
-                break;
-            case sMAIOR:
-                gera_instr_mepa(NULL, "CMMA", NULL, NULL);
-                break;
-            case sMAIOR_IG:
-                gera_instr_mepa(NULL, "CMAG", NULL, NULL);
-                break;
-            default:
-                break;
-        }
-        
-        // Comparações retornam tipo BOOL
-        return TIPO_BOOL;
+    // Operando direito da comparação em *res
+    TipoDado tipo1 = q->esq.tipo, tipo2 = *res;
+    
+    // TYPE CHECKING: Operandos devem ser compatíveis
+    if (!tipos_compativeis(tipo1, tipo2)) {
+        fprintf(ctx->diag, "Erro semântico (%d): operandos incompatíveis na comparação - "
+               "'%s' e '%s'\n",
+               ctx->linha_atual,
+               nome_tipo(tipo1),
+               nome_tipo(tipo2));
+        registrar_erro(ctx);
+    }
+    
+    // Gerar instrução de comparação
+    switch (q->op) {
+        case sMENOR:
+            gera_instr_mepa(&ctx->ger, NULL, "CMME", NULL, NULL);
+            break;
+        case sMENOR_IG:
+            gera_instr_mepa(&ctx->ger, NULL, "CMEG", NULL, NULL);
+            break;
+        case sIGUAL:
+            gera_instr_mepa(&ctx->ger, NULL, "CMIG", NULL, NULL);
+            break;
+        case sDIFERENTE:
+            gera_instr_mepa(&ctx->ger, NULL, "CMDG", NULL, NULL);
+            break;
+        case sMAIOR:
+            gera_instr_mepa(&ctx->ger, NULL, "CMMA", NULL, NULL);
+            break;
+        case sMAIOR_IG:
+            gera_instr_mepa(&ctx->ger, NULL, "CMAG", NULL, NULL);
+            break;
+        default:
+            break;
     }
     
-    return tipo1;
+    // Comparações retornam tipo BOOL
+    *res = TIPO_BOOL;
+    ctx->n_exp--;
 }
 
 // <exp_simples> ::= [+|-] <termo> { (+|-|ou) <termo> }
-TipoDado parse_exp_simples() {
-    int sinal_negativo = 0;
-    
-    // Sinal unário opcional
-    if (lookahead.atomo == sSOMA) {
-        verifica(sSOMA);
-    } else if (lookahead.atomo == sSUBT) {
-        verifica(sSUBT);
-        sinal_negativo = 1;
-    }
-    
-    TipoDado tipo_resultado = parse_termo();
-    
-    // Aplicar sinal negativo se necessário
-    if (sinal_negativo) {
-        // TYPE CHECKING: Sinal negativo só faz sentido em numéricos
-        if (tipo_resultado != TIPO_INT && tipo_resultado != TIPO_FLOAT) {
-            printf("Erro semântico (%d): operador unário '-' aplicado a tipo não-numérico '%s'\n",
-                   linha_atual,
-                   nome_tipo(tipo_resultado));
-            exit(1);
-        }
-        gera_instr_mepa(NULL, "INVR", NULL, NULL);
-    }
-    
-    // Operadores aditivos
-    while (lookahead.atomo == sSOMA || lookahead.atomo == sSUBT || 
-           lookahead.atomo == sOU) {
-        TAtomo op = lookahead.atomo;
-        lookahead = obter_atomo();
-        linha_atual = lookahead.linha;
-        
-        TipoDado tipo_termo = parse_termo();
-        
-        // TYPE CHECKING: Validar compatibilidade de operandos
-        if (op == sOU) {
-            // Operador lógico 'ou' requer booleanos
-            if (tipo_resultado != TIPO_BOOL || tipo_termo != TIPO_BOOL) {
-                printf("Erro semântico (%d): operador 'ou' requer operandos booleanos\n",
-                       linha_atual);
-                exit(1);
-            }
-            gera_instr_mepa(NULL, "DISJ", NULL, NULL);
-            tipo_resultado = TIPO_BOOL;
-        } else {
-            // Operadores aritméticos requerem tipos compatíveis
-            if (!tipos_compativeis(tipo_resultado, tipo_termo)) {
-                printf("Erro semântico (%d): operandos incompatíveis em operação aritmética - "
-                       "'%s' e '%s'\n",
-                       linha_atual,
-                       nome_tipo(tipo_resultado),
-                       nome_tipo(tipo_termo));
-                exit(1);
+static void passo_exp_simples(ContextoCompilacao *ctx, QuadroExp *q, TipoDado *res) {
+    switch (q->estado) {
+        case 0:
+            // Sinal unário opcional
+            if (ctx->lookahead.atomo == sSOMA) {
+                verifica(ctx, sSOMA);
+            } else if (ctx->lookahead.atomo == sSUBT) {
+                verifica(ctx, sSUBT);
+                q->negativo = 1;
             }
+            q->estado = 1;
+            empilhar_exp(ctx, NT_TERMO);
+            return;
+            
+        case 1:
+            q->esq.tipo = *res;
             
-            // Gerar instrução de operação
-            if (op == sSOMA) {
-                gera_instr_mepa(NULL, "SOMA", NULL, NULL);
-            } else { // sSUBT
-                gera_instr_mepa(NULL, "SUBT", NULL, NULL);
+            // Aplicar sinal negativo se necessário
+            if (q->negativo) {
+                // TYPE CHECKING: Sinal negativo só faz sentido em numéricos
+                if (!eh_numerico(q->esq.tipo)) {
+                    fprintf(ctx->diag, "Erro semântico (%d): operador unário '-' aplicado a tipo não-numérico '%s'\n",
+                           ctx->linha_atual,
+                           nome_tipo(q->esq.tipo));
+                    registrar_erro(ctx);
+                    q->esq.tipo = TIPO_ERRO;
+                }
+                gera_instr_mepa(&ctx->ger, NULL, "INVR", NULL, NULL);
             }
+            break;
+            
+        case 2: {
+            // Termo à direita do operador em *res
+            TipoDado tipo_resultado = q->esq.tipo, tipo_termo = *res;
             
-            // Tipo do resultado: se um é float, resultado é float
-            if (tipo_resultado == TIPO_FLOAT || tipo_termo == TIPO_FLOAT) {
-                tipo_resultado = TIPO_FLOAT;
+            // TYPE CHECKING: Validar compatibilidade de operandos
+            if (q->op == sOU) {
+                // Operador lógico 'ou' requer booleanos
+                if (!eh_bool(tipo_resultado) || !eh_bool(tipo_termo)) {
+                    fprintf(ctx->diag, "Erro semântico (%d): operador 'ou' requer operandos booleanos\n",
+                           ctx->linha_atual);
+                    registrar_erro(ctx);
+                }
+                gera_instr_mepa(&ctx->ger, NULL, "DISJ", NULL, NULL);
+                tipo_resultado = TIPO_BOOL;
+            } else {
+                // Operadores aritméticos requerem tipos compatíveis
+                if (!tipos_compativeis(tipo_resultado, tipo_termo)) {
+                    fprintf(ctx->diag, "Erro semântico (%d): operandos incompatíveis em operação aritmética - "
+                           "'%s' e '%s'\n",
+                           ctx->linha_atual,
+                           nome_tipo(tipo_resultado),
+                           nome_tipo(tipo_termo));
+                    registrar_erro(ctx);
+                    tipo_resultado = tipo_termo = TIPO_ERRO;
+                }
+                
+                // Gerar instrução de operação
+                if (q->op == sSOMA) {
+                    gera_instr_mepa(&ctx->ger, NULL, "SOMA", NULL, NULL);
+                } else { // sSUBT
+                    gera_instr_mepa(&ctx->ger, NULL, "SUBT", NULL, NULL);
+                }
+                
+                // Tipo do resultado: se um é float, resultado é float
+                if (tipo_resultado == TIPO_FLOAT || tipo_termo == TIPO_FLOAT) {
+                    tipo_resultado = TIPO_FLOAT;
+                }
             }
+            q->esq.tipo = tipo_resultado;
+            break;
         }
     }
     
-    return tipo_resultado;
+    // Operadores aditivos
+    if (ctx->lookahead.atomo == sSOMA || ctx->lookahead.atomo == sSUBT || 
+        ctx->lookahead.atomo == sOU) {
+        q->op = ctx->lookahead.atomo;
+        avancar(ctx);
+        q->estado = 2;
+        empilhar_exp(ctx, NT_TERMO);
+        return;
+    }
+    *res = q->esq.tipo;
+    ctx->n_exp--;
 }
 
 // <termo> ::= <fator> { (*|/|e) <fator> }
-TipoDado parse_termo() {
-    TipoDado tipo_resultado = parse_fator();
-    
-    // Operadores multiplicativos
-    while (lookahead.atomo == sMULT || lookahead.atomo == sDIV || 
-           lookahead.atomo == sE) {
-        TAtomo op = lookahead.atomo;
-        lookahead = obter_atomo();
-        linha_atual = lookahead.linha;
-        
-        TipoDado tipo_fator = parse_fator();
-        
-        // TYPE CHECKING: Validar compatibilidade de operandos
-        if (op == sE) {
-            // Operador lógico 'e' requer booleanos
-            if (tipo_resultado != TIPO_BOOL || tipo_fator != TIPO_BOOL) {
-                printf("Erro semântico (%d): operador 'e' requer operandos booleanos\n",
-                       linha_atual);
-                exit(1);
-            }
-            gera_instr_mepa(NULL, "CONJ", NULL, NULL);
-            tipo_resultado = TIPO_BOOL;
-        } else {
-            // Operadores aritméticos requerem tipos compatíveis
-            if (!tipos_compativeis(tipo_resultado, tipo_fator)) {
-                printf("Erro semântico (%d): operandos incompatíveis em operação aritmética - "
-                       "'%s' e '%s'\n",
-                       linha_atual,
-                       nome_tipo(tipo_resultado),
-                       nome_tipo(tipo_fator));
-                exit(1);
-            }
+static void passo_termo(ContextoCompilacao *ctx, QuadroExp *q, TipoDado *res) {
+    switch (q->estado) {
+        case 0:
+            q->estado = 1;
+            empilhar_exp(ctx, NT_FATOR);
+            return;
             
-            // Gerar instrução de operação
-            if (op == sMULT) {
-                gera_instr_mepa(NULL, "MULT", NULL, NULL);
-            } else { // sDIV
-                gera_instr_mepa(NULL, "DIVI", NULL, NULL);
-            }
+        case 1:
+            q->esq.tipo = *res;
+            break;
             
-            // Tipo do resultado: se um é float, resultado é float
-            if (tipo_resultado == TIPO_FLOAT || tipo_fator == TIPO_FLOAT) {
-                tipo_resultado = TIPO_FLOAT;
+        case 2: {
+            // Fator à direita do operador em *res
+            TipoDado tipo_resultado = q->esq.tipo, tipo_fator = *res;
+            
+            // TYPE CHECKING: Validar compatibilidade de operandos
+            if (q->op == sE) {
+                // Operador lógico 'e' requer booleanos
+                if (!eh_bool(tipo_resultado) || !eh_bool(tipo_fator)) {
+                    fprintf(ctx->diag, "Erro semântico (%d): operador 'e' requer operandos booleanos\n",
+                           ctx->linha_atual);
+                    registrar_erro(ctx);
+                }
+                gera_instr_mepa(&ctx->ger, NULL, "CONJ", NULL, NULL);
+                tipo_resultado = TIPO_BOOL;
+            } else {
+                // Operadores aritméticos requerem tipos compatíveis
+                if (!tipos_compativeis(tipo_resultado, tipo_fator)) {
+                    fprintf(ctx->diag, "Erro semântico (%d): operandos incompatíveis em operação aritmética - "
+                           "'%s' e '%s'\n",
+                           ctx->linha_atual,
+                           nome_tipo(tipo_resultado),
+                           nome_tipo(tipo_fator));
+                    registrar_erro(ctx);
+                    tipo_resultado = tipo_fator = TIPO_ERRO;
+                }
+                
+                // Gerar instrução de operação
+                if (q->op == sMULT) {
+                    gera_instr_mepa(&ctx->ger, NULL, "MULT", NULL, NULL);
+                } else { // sDIV
+                    gera_instr_mepa(&ctx->ger, NULL, "DIVI", NULL, NULL);
+                }
+                
+                // Tipo do resultado: se um é float, resultado é float
+                if (tipo_resultado == TIPO_FLOAT || tipo_fator == TIPO_FLOAT) {
+                    tipo_resultado = TIPO_FLOAT;
+                }
             }
+            q->esq.tipo = tipo_resultado;
+            break;
         }
     }
     
-    return tipo_resultado;
+    // Operadores multiplicativos
+    if (ctx->lookahead.atomo == sMULT || ctx->lookahead.atomo == sDIV || 
+        ctx->lookahead.atomo == sE) {
+        q->op = ctx->lookahead.atomo;
+        avancar(ctx);
+        q->estado = 2;
+        empilhar_exp(ctx, NT_FATOR);
+        return;
+    }
+    *res = q->esq.tipo;
+    ctx->n_exp--;
 }
 
-// <fator> ::= <id> | <num> | ( <exp> ) | nao <fator>
-TipoDado parse_fator() {
-    if (lookahead.atomo == sIDENT) {
-        TInfoAtomo id = lookahead;
-        verifica(sIDENT);
+/*
+ * Chamadas de sub-rotina
+ *
+ * <chamada> ::= <id> ( [<exp> {, <exp>}] )
+ * O quadro de <fator> da chamada fica na pilha enquanto os argumentos são
+ * analisados (estados 3 e 4) e os dados dela numa pilha paralela
+ * (ctx->chamadas), de modo que chamadas dentro de argumentos também não
+ * recursam em C. Cada chamada conta como um nível de aninhamento da
+ * expressão.
+ */
+
+// Checa o argumento de posição i (a partir de 1) de uma chamada a sub
+// (NULL: não declarada, sem checagem); também usada pela semântica do -O1
+void checar_argumento(ContextoCompilacao *ctx, RegistroTS *sub, int i,
+                      TipoDado tipo, int linha) {
+    if (sub == NULL || i > sub->n_param) return;
+    if (!tipos_compativeis(tipo, sub->tipos_param[i - 1])) {
+        fprintf(ctx->diag, "Erro semântico (%d): argumento %d de '%s' incompatível - "
+                "esperado '%s', encontrado '%s'\n",
+                linha, i, sub->lexema, nome_tipo(sub->tipos_param[i - 1]), nome_tipo(tipo));
+        registrar_erro(ctx);
+    }
+}
+
+// Resolve o nome de uma chamada (NULL se não é uma sub-rotina declarada)
+RegistroTS* buscar_subrotina(ContextoCompilacao *ctx, const char *nome,
+                             int em_expressao, int linha) {
+    RegistroTS *sub = ts_buscar(&ctx->ts, nome);
+    
+    if (sub == NULL || sub->categoria != CAT_FUNCAO) {
+        fprintf(ctx->diag, "Erro semântico (%d): sub-rotina '%s' não declarada\n",
+                linha, nome);
+        registrar_erro(ctx);
+        return NULL;
+    }
+    if (em_expressao && sub->tipo == TIPO_VOID) {
+        fprintf(ctx->diag, "Erro semântico (%d): sub-rotina '%s' não retorna valor\n",
+                linha, nome);
+        registrar_erro(ctx);
+    }
+    return sub;
+}
+
+// Checa o número de argumentos no fim de uma chamada
+void checar_n_argumentos(ContextoCompilacao *ctx, RegistroTS *sub, int n, int linha) {
+    if (sub != NULL && n != sub->n_param) {
+        fprintf(ctx->diag, "Erro semântico (%d): sub-rotina '%s' espera %d argumento(s), "
+                "recebeu %d\n", linha, sub->lexema, sub->n_param, n);
+        registrar_erro(ctx);
+    }
+}
+
+// Tipo de uma chamada: o de retorno, ou TIPO_ERRO se já houve erro
+TipoDado tipo_chamada(RegistroTS *sub, int em_expressao) {
+    if (sub == NULL || (em_expressao && sub->tipo == TIPO_VOID)) return TIPO_ERRO;
+    return sub->tipo;
+}
+
+// Identificador já consumido e '(' à frente: resolve a sub-rotina, reserva
+// a célula do resultado e passa o quadro q para os argumentos
+static void iniciar_chamada(ContextoCompilacao *ctx, QuadroExp *q, const char *nome,
+                            int em_expressao) {
+    RegistroTS *sub = buscar_subrotina(ctx, nome, em_expressao, ctx->linha_atual);
+    
+    if (sub != NULL && sub->tipo != TIPO_VOID) {
+        gera_instr_mepa(&ctx->ger, NULL, "AMEM", "1", NULL);
+    }
+    
+    if (ctx->n_cham == ctx->cap_cham) {
+        int cap = ctx->cap_cham ? ctx->cap_cham * 2 : 16;
+        ChamadaExp *maior = realloc(ctx->chamadas, sizeof(ChamadaExp) * cap);
+        if (maior == NULL) {
+            fprintf(ctx->diag, "Erro: falha ao alocar memória para a análise de expressões\n");
+            ctx->erros++;
+            abortar(ctx);
+        }
+        ctx->chamadas = maior;
+        ctx->cap_cham = cap;
+    }
+    ChamadaExp *c = &ctx->chamadas[ctx->n_cham++];
+    c->sub = sub;
+    c->n_args = 0;
+    c->em_expressao = em_expressao;
+    
+    aprofundar_exp(ctx);
+    verifica(ctx, sABRE_PARENT);
+    q->estado = 3;
+}
+
+// ')' de uma chamada: checa o número de argumentos e gera o desvio
+static void concluir_chamada(ContextoCompilacao *ctx, TipoDado *res) {
+    ChamadaExp c = ctx->chamadas[--ctx->n_cham];
+    
+    verifica(ctx, sFECHA_PARENT);
+    checar_n_argumentos(ctx, c.sub, c.n_args, ctx->linha_atual);
+    
+    if (c.sub != NULL) {
+        char entrada[20], nivel[20];
+        snprintf(entrada, sizeof(entrada), "R%d", c.sub->endereco);
+        snprintf(nivel, sizeof(nivel), "%d", ctx->ts.nivel);
+        gera_instr_mepa(&ctx->ger, NULL, "CHPR", entrada, nivel);
+    }
+    
+    *res = tipo_chamada(c.sub, c.em_expressao);
+    ctx->prof_exp--;
+    ctx->n_exp--;
+}
+
+// <fator> ::= <id> | <chamada> | <num> | ( <exp> ) | nao <fator>
+static void passo_fator(ContextoCompilacao *ctx, QuadroExp *q, TipoDado *res) {
+    if (q->estado == 1) {
+        // Fim de ( <exp> ): o tipo é o da expressão interna
+        verifica(ctx, sFECHA_PARENT);
+        ctx->prof_exp--;
+        ctx->n_exp--;
+        return;
+    }
+    
+    if (q->estado == 2) {
+        // Fim de nao <fator>
+        TipoDado tipo = *res;
+        
+        // TYPE CHECKING: Operador 'nao' requer operando booleano
+        if (!eh_bool(tipo)) {
+            fprintf(ctx->diag, "Erro semântico (%d): operador 'nao' requer operando booleano, "
+                   "encontrado '%s'\n",
+                   ctx->linha_atual,
+                   nome_tipo(tipo));
+            registrar_erro(ctx);
+        }
+        
+        gera_instr_mepa(&ctx->ger, NULL, "NEGA", NULL, NULL);
+        
+        *res = TIPO_BOOL;
+        ctx->prof_exp--;
+        ctx->n_exp--;
+        return;
+    }
+    
+    if (q->estado == 3) {
+        // Logo depois do '(' de uma chamada
+        if (ctx->lookahead.atomo == sFECHA_PARENT) {
+            concluir_chamada(ctx, res);
+        } else {
+            q->estado = 4;
+            empilhar_exp(ctx, NT_EXP);
+        }
+        return;
+    }
+    
+    if (q->estado == 4) {
+        // Argumento em *res: checado contra o parâmetro na mesma posição
+        ChamadaExp *c = &ctx->chamadas[ctx->n_cham - 1];
+        checar_argumento(ctx, c->sub, ++c->n_args, *res, ctx->linha_atual);
+        if (ctx->lookahead.atomo == sVIRG) {
+            verifica(ctx, sVIRG);
+            empilhar_exp(ctx, NT_EXP);
+        } else {
+            concluir_chamada(ctx, res);
+        }
+        return;
+    }
+    
+    if (ctx->lookahead.atomo == sIDENT) {
+        TInfoAtomo id = ctx->lookahead;
+        verifica(ctx, sIDENT);
+        
+        if (ctx->lookahead.atomo == sABRE_PARENT) {
+            iniciar_chamada(ctx, q, id.lexema, 1);
+            return;
+        }
+        ctx->n_exp--;
         
         // Validação semântica: verificar se variável foi declarada
-        RegistroTS *registro = ts_buscar(id.lexema);
+        RegistroTS *registro = buscar_variavel(ctx, id.lexema, ctx->linha_atual);
         if (registro == NULL) {
-            printf("Erro semântico (%d): variável '%s' não declarada\n", 
-                   linha_atual, id.lexema);
-            exit(1);
+            *res = TIPO_ERRO;
+            return;
         }
         
         // Gerar instrução para carregar valor
         char nivel[20], endereco[20];
-        snprintf(nivel, sizeof(nivel), "0");
+        snprintf(nivel, sizeof(nivel), "%d", registro->nivel);
         snprintf(endereco, sizeof(endereco), "%d", registro->endereco);
-        gera_instr_mepa(NULL, "CRVL", nivel, endereco);
+        gera_instr_mepa(&ctx->ger, NULL, "CRVL", nivel, endereco);
         
         // Retornar tipo da variável
-        return registro->tipo;
+        *res = registro->tipo;
         
-    } else if (lookahead.atomo == sNUM_INT) {
-        TInfoAtomo num = lookahead;
-        verifica(sNUM_INT);
+    } else if (ctx->lookahead.atomo == sNUM_INT) {
+        TInfoAtomo num = ctx->lookahead;
+        verifica(ctx, sNUM_INT);
+        ctx->n_exp--;
         
         // Gerar instrução para carregar constante
-        gera_instr_mepa(NULL, "CRCT", num.lexema, NULL);
+        gera_instr_mepa(&ctx->ger, NULL, "CRCT", num.lexema, NULL);
         
-        return TIPO_INT;
+        *res = TIPO_INT;
         
-    } else if (lookahead.atomo == sNUM_FLOAT) {
-        TInfoAtomo num = lookahead;
-        verifica(sNUM_FLOAT);
+    } else if (ctx->lookahead.atomo == sNUM_FLOAT) {
+        TInfoAtomo num = ctx->lookahead;
+        verifica(ctx, sNUM_FLOAT);
+        ctx->n_exp--;
         
         // Gerar instrução para carregar constante
-        gera_instr_mepa(NULL, "CRCT", num.lexema, NULL);
-        
-        return TIPO_FLOAT;
-        
-    } else if (lookahead.atomo == sABRE_PARENT) {
-        verifica(sABRE_PARENT);
-        TipoDado tipo = parse_exp();
-        verifica(sFECHA_PARENT);
-        
-        return tipo;
+        gera_instr_mepa(&ctx->ger, NULL, "CRCT", num.lexema, NULL);
         
-    } else if (lookahead.atomo == sNAO) {
-        verifica(sNAO);
-        TipoDado tipo = parse_fator();
+        *res = TIPO_FLOAT;
         
-        // TYPE CHECKING: Operador 'nao' requer operando booleano
-        if (tipo != TIPO_BOOL) {
-            printf("Erro semântico (%d): operador 'nao' requer operando booleano, "
-                   "encontrado '%s'\n",
-                   linha_atual,
-                   nome_tipo(tipo));
-            exit(1);
-        }
+    } else if (ctx->lookahead.atomo == sABRE_PARENT) {
+        verifica(ctx, sABRE_PARENT);
+        aprofundar_exp(ctx);
+        q->estado = 1;
+        empilhar_exp(ctx, NT_EXP);
         
-        gera_instr_mepa(NULL, "NEGA", NULL, NULL);
-        
-        return TIPO_BOOL;
+    } else if (ctx->lookahead.atomo == sNAO) {
+        verifica(ctx, sNAO);
+        aprofundar_exp(ctx);
+        q->estado = 2;
+        empilhar_exp(ctx, NT_FATOR);
         
     } else {
-        erro_sintatico_msg("fator (identificador, número ou expressão)", 
-                          lookahead.atomo);
-        exit(1);
+        erro_sintatico_msg(ctx, "fator (identificador, número ou expressão)", 
+                          ctx->lookahead.atomo);
+        recuperar(ctx);
     }
 }
+
+// Expressões não se aninham em C: a pilha de uma expressão abandonada
+// por um erro é simplesmente descartada aqui
+static void reiniciar_exp(ContextoCompilacao *ctx) {
+    ctx->n_exp = 0;
+    ctx->prof_exp = 0;
+    ctx->n_cham = 0;
+}
+
+// Executa os quadros empilhados até esvaziar a pilha
+static TipoDado executar_exp(ContextoCompilacao *ctx) {
+    TipoDado res = TIPO_VOID;
+    
+    while (ctx->n_exp > 0) {
+        // O quadro pode mudar de endereço quando a pilha cresce: cada passo
+        // usa q só antes de empilhar
+        QuadroExp *q = &ctx->pilha_exp[ctx->n_exp - 1];
+        switch (q->nt) {
+            case NT_EXP:         passo_exp(ctx, q, &res); break;
+            case NT_EXP_SIMPLES: passo_exp_simples(ctx, q, &res); break;
+            case NT_TERMO:       passo_termo(ctx, q, &res); break;
+            case NT_FATOR:       passo_fator(ctx, q, &res); break;
+        }
+    }
+    return res;
+}
+
+// Analisa uma expressão completa e retorna seu tipo
+TipoDado parse_exp(ContextoCompilacao *ctx) {
+    reiniciar_exp(ctx);
+    empilhar_exp(ctx, NT_EXP);
+    return executar_exp(ctx);
+}
+
+// <chamada> como comando (identificador já consumido): o resultado de uma
+// função é descartado
+static void parse_chamada(ContextoCompilacao *ctx, const char *nome) {
+    reiniciar_exp(ctx);
+    empilhar_exp(ctx, NT_FATOR);
+    iniciar_chamada(ctx, &ctx->pilha_exp[0], nome, 0);
+    
+    TipoDado tipo = executar_exp(ctx);
+    if (tipo != TIPO_VOID) gera_instr_mepa(&ctx->ger, NULL, "DMEM", "1", NULL);
+}
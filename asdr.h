@@ -8,50 +8,85 @@
 
 #include "analex.h"
 #include "tabsimb.h"
+#include "contexto.h"
 
-// Variáveis globais do parser
-extern TInfoAtomo lookahead;
-extern int linha_atual;
-extern int erro_sintatico;
+// Função de controle principal (retorna 0 se houve erro)
+int parse_programa(ContextoCompilacao *ctx);
 
-// Função de controle principal
-int parse_programa();
+// Modo -O1: só constrói a árvore em ctx->ast (asdr_ast.c); retorna 0 se a
+// compilação foi interrompida
+int parse_programa_ast(ContextoCompilacao *ctx);
+
+// Analisador dirigido pela tabela LL(1) (asdr_ll1.c): mesma saída de
+// parse_programa
+int parse_programa_ll1(ContextoCompilacao *ctx);
 
 // Função auxiliar de verificação de tokens
-void verifica(TAtomo token_esperado);
+void verifica(ContextoCompilacao *ctx, TAtomo token_esperado);
 
 // Funções do ASDR (uma para cada não-terminal da gramática)
-void parse_ini();
-void parse_id();
-int parse_dcl();
-int parse_dcl_var();
-TAtomo parse_tipo();
-int parse_mais_var(TAtomo tipo);
-void parse_bco();
-void parse_cmd();
-void parse_atrib();
-void parse_leitura();
-void parse_escrita();
-void parse_ret();
-void parse_selecao();
-void parse_repeticao();
-void parse_while();
-void parse_repeat();
-void parse_for();
+void parse_ini(ContextoCompilacao *ctx);
+void parse_id(ContextoCompilacao *ctx);
+void parse_sub(ContextoCompilacao *ctx);
+void parse_dcl_sub(ContextoCompilacao *ctx);
+int parse_dcl(ContextoCompilacao *ctx);
+int parse_dcl_var(ContextoCompilacao *ctx);
+TAtomo parse_tipo(ContextoCompilacao *ctx);
+int parse_mais_var(ContextoCompilacao *ctx, TAtomo tipo);
+void parse_bco(ContextoCompilacao *ctx);
+void parse_cmd(ContextoCompilacao *ctx);
+void parse_atrib(ContextoCompilacao *ctx);
+void parse_leitura(ContextoCompilacao *ctx);
+void parse_escrita(ContextoCompilacao *ctx);
+void parse_ret(ContextoCompilacao *ctx);
+void parse_selecao(ContextoCompilacao *ctx);
+void parse_repeticao(ContextoCompilacao *ctx);
+void parse_while(ContextoCompilacao *ctx);
+void parse_repeat(ContextoCompilacao *ctx);
+void parse_for(ContextoCompilacao *ctx);
 
 // Funções de expressão COM retorno de tipo
-TipoDado parse_exp();
-TipoDado parse_exp_simples();
-TipoDado parse_termo();
-TipoDado parse_fator();
+// (<exp_simples>, <termo> e <fator> são passos internos de parse_exp)
+TipoDado parse_exp(ContextoCompilacao *ctx);
+
+// Erros, recuperação e declarações (usadas também pelo modo -O1: asdr_ast.c
+// e semantica.c)
+void avancar(ContextoCompilacao *ctx);
+void abortar(ContextoCompilacao *ctx);
+void registrar_erro(ContextoCompilacao *ctx);
+void recuperar(ContextoCompilacao *ctx);
+void sincronizar(ContextoCompilacao *ctx, TAtomo fim);
+void sincronizar_dcl(ContextoCompilacao *ctx);
+void sem_memoria_ts(ContextoCompilacao *ctx);
+RegistroTS* declarar(ContextoCompilacao *ctx, const char *lexema, Categoria cat,
+                     TAtomo tipo, int endereco);
+RegistroTS* buscar_variavel(ContextoCompilacao *ctx, const char *lexema, int linha);
+void empilhar_exp(ContextoCompilacao *ctx, NaoTerminalExp nt);
+void aprofundar_exp(ContextoCompilacao *ctx);
+int eh_op_relacional(TAtomo a);
+int fim_de_comando(TAtomo a);
+void texto_literal(const TInfoAtomo *atomo, char destino[100]);
+
+// Checagens de sub-rotinas, com as mensagens na linha dada (sub NULL: não
+// declarada, erro já relatado)
+RegistroTS* buscar_subrotina(ContextoCompilacao *ctx, const char *nome,
+                             int em_expressao, int linha);
+void checar_argumento(ContextoCompilacao *ctx, RegistroTS *sub, int i,
+                      TipoDado tipo, int linha);
+void checar_n_argumentos(ContextoCompilacao *ctx, RegistroTS *sub, int n, int linha);
+void checar_retorno(ContextoCompilacao *ctx, RegistroTS *sub, int com_valor,
+                    TipoDado tipo, int linha);
+TipoDado tipo_chamada(RegistroTS *sub, int em_expressao);
 
 // Funções auxiliares
 const char* nome_token(TAtomo token);
-void erro_sintatico_msg(const char *esperado, TAtomo encontrado);
+void erro_sintatico_msg(ContextoCompilacao *ctx, const char *esperado, TAtomo encontrado);
 
 // Funções auxiliares para type checking
 TipoDado atomo_para_tipodado(TAtomo tipo);
 int tipos_compativeis(TipoDado tipo1, TipoDado tipo2);
+int eh_bool(TipoDado tipo);
+int eh_numerico(TipoDado tipo);
 const char* nome_tipo(TipoDado tipo);
 
 #endif
@@ -0,0 +1,675 @@
+/*
+ * asdr_ast.c - Analisador sintático que constrói a árvore (modo -O1)
+ *
+ * Mesma gramática, mesmas mensagens sintáticas e mesma recuperação de erros
+ * do analisador de uma passada (asdr.c), mas sem checagem de tipos nem
+ * geração de código: cada construção vira um nó da arena (ast.h), criado
+ * quando ela termina. A tabela de símbolos só é preenchida depois, pela
+ * análise semântica (semantica.c).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include "asdr.h"
+#include "ast.h"
+
+// Lista de nós encadeada por prox
+typedef struct {
+    NoId primeiro, ultimo;
+} ListaNos;
+
+static NoId ast_cmd(ContextoCompilacao *ctx);
+static NoId ast_exp(ContextoCompilacao *ctx);
+static NoId ast_chamada(ContextoCompilacao *ctx, const char *nome);
+
+static void sem_memoria(ContextoCompilacao *ctx) {
+    fprintf(ctx->diag, "Erro: falha ao alocar memória para a árvore sintática\n");
+    ctx->erros++;
+    abortar(ctx);
+}
+
+// Cria um nó na linha atual
+static NoId novo_no(ContextoCompilacao *ctx, TipoNo tipo) {
+    NoId id = ast_novo(ctx->ast, tipo, ctx->linha_atual);
+    if (id == 0) sem_memoria(ctx);
+    return id;
+}
+
+// Cria um nó com um lexema
+static NoId novo_no_texto(ContextoCompilacao *ctx, TipoNo tipo, const char *lexema) {
+    uint32_t texto = ast_texto(ctx->ast, lexema);
+    if (texto == UINT32_MAX) sem_memoria(ctx);
+
+    NoId id = novo_no(ctx, tipo);
+    ast_no(ctx->ast, id)->texto = texto;
+    return id;
+}
+
+// Cria um operador com seus operandos (b = 0 nos unários)
+static NoId novo_operador(ContextoCompilacao *ctx, TipoNo tipo, TAtomo op, NoId a, NoId b) {
+    NoId id = novo_no(ctx, tipo);
+    NoAST *no = ast_no(ctx->ast, id);
+    no->op = (uint8_t)op;
+    no->a = a;
+    no->b = b;
+    return id;
+}
+
+static void anexar(ContextoCompilacao *ctx, ListaNos *lista, NoId id) {
+    if (lista->ultimo != 0) ast_no(ctx->ast, lista->ultimo)->prox = id;
+    else lista->primeiro = id;
+    lista->ultimo = id;
+}
+
+// <dcl_var> ::= <tipo> <id> <mais_var>, uma declaração por identificador
+static void ast_dcl_var(ContextoCompilacao *ctx, ListaNos *lista) {
+    TAtomo tipo = parse_tipo(ctx);
+
+    for (;;) {
+        TInfoAtomo id = ctx->lookahead;
+        parse_id(ctx);
+
+        NoId dcl = novo_no_texto(ctx, AST_DECL, id.lexema);
+        ast_no(ctx->ast, dcl)->op = (uint8_t)tipo;
+        ast_no(ctx->ast, dcl)->dado = CAT_VARIAVEL;
+        anexar(ctx, lista, dcl);
+
+        if (ctx->lookahead.atomo != sVIRG) break;
+        verifica(ctx, sVIRG);
+    }
+}
+
+// <dcl_var> ; com recuperação (ver parse_dcl_var_recuperavel)
+static void ast_dcl_var_recuperavel(ContextoCompilacao *ctx, ListaNos *lista) {
+    jmp_buf ponto;
+    jmp_buf *anterior = ctx->recuperar;
+
+    ctx->recuperar = &ponto;
+    if (setjmp(ponto) == 0) {
+        ast_dcl_var(ctx, lista);
+        verifica(ctx, sPONTO_VIRG);
+    } else {
+        sincronizar_dcl(ctx);
+    }
+    ctx->recuperar = anterior;
+}
+
+// <dcl> ::= sVAR <dcl_var> ; { <dcl_var> ; }
+static NoId ast_dcl(ContextoCompilacao *ctx) {
+    ListaNos lista = { 0, 0 };
+
+    verifica(ctx, sVAR);
+    do {
+        ast_dcl_var_recuperavel(ctx, &lista);
+    } while (ctx->lookahead.atomo != sBEGIN && ctx->lookahead.atomo != sSUBROT &&
+             ctx->lookahead.atomo != sEND && ctx->lookahead.atomo != sEOF);
+    return lista.primeiro;
+}
+
+// { <cmd> ; } até 'fim', com recuperação (ver parse_lista_cmd). Comandos
+// descartados deixam nós soltos na arena, fora de qualquer lista
+static NoId ast_lista_cmd(ContextoCompilacao *ctx, TAtomo fim) {
+    jmp_buf ponto;
+    jmp_buf *anterior = ctx->recuperar;
+    int aninhamento = ctx->aninhamento;
+    ListaNos lista = { 0, 0 };
+
+    ctx->recuperar = &ponto;
+    while (ctx->lookahead.atomo != fim && ctx->lookahead.atomo != sEOF) {
+        if (setjmp(ponto) == 0) {
+            NoId cmd = ast_cmd(ctx);
+            verifica(ctx, sPONTO_VIRG);
+            anexar(ctx, &lista, cmd);
+        } else {
+            ctx->aninhamento = aninhamento;
+            sincronizar(ctx, fim);
+        }
+    }
+    ctx->recuperar = anterior;
+    return lista.primeiro;
+}
+
+// <bco> ::= sBEGIN { <cmd> ; } sEND
+static NoId ast_bco(ContextoCompilacao *ctx) {
+    verifica(ctx, sBEGIN);
+    NoId cmds = ast_lista_cmd(ctx, sEND);
+    verifica(ctx, sEND);
+
+    NoId bco = novo_no(ctx, AST_BLOCO);
+    ast_no(ctx->ast, bco)->a = cmds;
+    return bco;
+}
+
+// <dcl_sub> ::= (<tipo> | sVOID) <id> ( [<tipo> <id> {, <tipo> <id>}] ) ; [<dcl>] <bco>
+// A declaração da sub-rotina vem antes dos parâmetros na arena, para que a
+// semântica abra o escopo dela antes de declará-los
+static NoId ast_dcl_sub(ContextoCompilacao *ctx) {
+    TAtomo tipo;
+
+    if (ctx->lookahead.atomo == sVOID) {
+        verifica(ctx, sVOID);
+        tipo = sVOID;
+    } else {
+        tipo = parse_tipo(ctx);
+    }
+
+    TInfoAtomo id = ctx->lookahead;
+    parse_id(ctx);
+    NoId dcl = novo_no_texto(ctx, AST_DECL, id.lexema);
+    ast_no(ctx->ast, dcl)->op = (uint8_t)tipo;
+    ast_no(ctx->ast, dcl)->dado = CAT_FUNCAO;
+
+    ListaNos params = { 0, 0 };
+    int n_param = 0;
+    verifica(ctx, sABRE_PARENT);
+    if (ctx->lookahead.atomo != sFECHA_PARENT) {
+        for (;;) {
+            TAtomo tipo_param = parse_tipo(ctx);
+            TInfoAtomo param = ctx->lookahead;
+            parse_id(ctx);
+
+            NoId p = novo_no_texto(ctx, AST_DECL, param.lexema);
+            ast_no(ctx->ast, p)->op = (uint8_t)tipo_param;
+            ast_no(ctx->ast, p)->dado = CAT_PARAMETRO;
+            ast_no(ctx->ast, p)->u.endereco = ++n_param;
+            anexar(ctx, &params, p);
+
+            if (ctx->lookahead.atomo != sVIRG) break;
+            verifica(ctx, sVIRG);
+        }
+    }
+    verifica(ctx, sFECHA_PARENT);
+
+    // Deslocamentos definitivos, como em parse_dcl_sub
+    for (NoId p = params.primeiro; p != 0; p = ast_no(ctx->ast, p)->prox) {
+        ast_no(ctx->ast, p)->u.endereco -= n_param + 3;
+    }
+    ast_no(ctx->ast, dcl)->a = params.primeiro;
+    verifica(ctx, sPONTO_VIRG);
+
+    NoId locais = 0;
+    if (ctx->lookahead.atomo == sVAR) locais = ast_dcl(ctx);
+    NoId corpo = ast_bco(ctx);
+
+    NoId sub = novo_operador(ctx, AST_SUBROT, tipo, dcl, locais);
+    ast_no(ctx->ast, sub)->c = corpo;
+    return sub;
+}
+
+// <sub> ::= sSUBROT <dcl_sub> ; { <dcl_sub> ; }
+static NoId ast_sub(ContextoCompilacao *ctx) {
+    ListaNos lista = { 0, 0 };
+
+    verifica(ctx, sSUBROT);
+    do {
+        NoId sub = ast_dcl_sub(ctx);
+        verifica(ctx, sPONTO_VIRG);
+        anexar(ctx, &lista, sub);
+    } while (ctx->lookahead.atomo == sVOID || ctx->lookahead.atomo == sINT ||
+             ctx->lookahead.atomo == sFLOAT || ctx->lookahead.atomo == sBOOL ||
+             ctx->lookahead.atomo == sCHAR);
+    return lista.primeiro;
+}
+
+// <ini> ::= sPRG <id> ; [<dcl>] [<sub>] <bco> .
+static NoId ast_ini(ContextoCompilacao *ctx) {
+    verifica(ctx, sPRG);
+
+    TInfoAtomo id = ctx->lookahead;
+    parse_id(ctx);
+    NoId nome = novo_no_texto(ctx, AST_DECL, id.lexema);
+    ast_no(ctx->ast, nome)->op = sVOID;
+    ast_no(ctx->ast, nome)->dado = CAT_PROGRAMA;
+
+    verifica(ctx, sPONTO_VIRG);
+
+    NoId dcl = 0;
+    if (ctx->lookahead.atomo == sVAR) dcl = ast_dcl(ctx);
+
+    NoId subs = 0;
+    if (ctx->lookahead.atomo == sSUBROT) subs = ast_sub(ctx);
+
+    NoId bco = ast_bco(ctx);
+    verifica(ctx, sPONTO);
+
+    NoId prg = novo_no(ctx, AST_PROGRAMA);
+    NoAST *no = ast_no(ctx->ast, prg);
+    no->a = nome;
+    no->b = dcl;
+    no->c = bco;
+    no->u.d = subs;
+    return prg;
+}
+
+// Identificador já conferido como sIDENT: consome e cria o nó
+static NoId ast_var(ContextoCompilacao *ctx) {
+    TInfoAtomo id = ctx->lookahead;
+    verifica(ctx, sIDENT);
+    return novo_no_texto(ctx, AST_VAR, id.lexema);
+}
+
+// <atrib> depois do nó da variável
+static NoId ast_atrib_resto(ContextoCompilacao *ctx, NoId var) {
+    verifica(ctx, sATRIB);
+    NoId exp = ast_exp(ctx);
+    return novo_operador(ctx, AST_ATRIB, sATRIB, var, exp);
+}
+
+// <atrib> ::= <id> <- <exp>
+static NoId ast_atrib(ContextoCompilacao *ctx) {
+    return ast_atrib_resto(ctx, ast_var(ctx));
+}
+
+// Comando que começa com identificador: <atrib> ou <chamada>
+static NoId ast_cmd_id(ContextoCompilacao *ctx) {
+    TInfoAtomo id = ctx->lookahead;
+    verifica(ctx, sIDENT);
+
+    if (ctx->lookahead.atomo == sABRE_PARENT) return ast_chamada(ctx, id.lexema);
+    return ast_atrib_resto(ctx, novo_no_texto(ctx, AST_VAR, id.lexema));
+}
+
+// <leitura> ::= sREAD ( <id> )
+static NoId ast_leitura(ContextoCompilacao *ctx) {
+    verifica(ctx, sREAD);
+    verifica(ctx, sABRE_PARENT);
+    NoId var = ast_var(ctx);
+    verifica(ctx, sFECHA_PARENT);
+    return novo_operador(ctx, AST_LEITURA, sREAD, var, 0);
+}
+
+// <escrita> ::= sWRITE ( <exp> ) | sWRITE ( <cadeia> ) | sWRITE ( <caractere> )
+static NoId ast_escrita(ContextoCompilacao *ctx) {
+    verifica(ctx, sWRITE);
+    verifica(ctx, sABRE_PARENT);
+    TAtomo atomo = ctx->lookahead.atomo;
+    if (atomo == sSTRING || atomo == sCHAR_CONST) {
+        char texto[100];
+        texto_literal(&ctx->lookahead, texto);
+        verifica(ctx, atomo);
+        verifica(ctx, sFECHA_PARENT);
+        NoId id = novo_no_texto(ctx, AST_TEXTO, texto);
+        ast_no(ctx->ast, id)->op = (uint8_t)atomo;
+        return id;
+    }
+    NoId exp = ast_exp(ctx);
+    verifica(ctx, sFECHA_PARENT);
+    return novo_operador(ctx, AST_ESCRITA, sWRITE, exp, 0);
+}
+
+// <ret> ::= sRETURN [<exp>]
+static NoId ast_ret(ContextoCompilacao *ctx) {
+    verifica(ctx, sRETURN);
+    NoId exp = fim_de_comando(ctx->lookahead.atomo) ? 0 : ast_exp(ctx);
+    return novo_operador(ctx, AST_RETORNO, sRETURN, exp, 0);
+}
+
+// <selecao> ::= sIF <exp> sTHEN <cmd> [sELSE <cmd>]
+static NoId ast_selecao(ContextoCompilacao *ctx) {
+    verifica(ctx, sIF);
+    NoId cond = ast_exp(ctx);
+    verifica(ctx, sTHEN);
+    NoId entao = ast_cmd(ctx);
+
+    NoId senao = 0;
+    if (ctx->lookahead.atomo == sELSE) {
+        verifica(ctx, sELSE);
+        senao = ast_cmd(ctx);
+    }
+
+    NoId se = novo_operador(ctx, AST_SE, sIF, cond, entao);
+    ast_no(ctx->ast, se)->c = senao;
+    return se;
+}
+
+// <while> ::= sWHILE <exp> sDO <cmd>
+static NoId ast_while(ContextoCompilacao *ctx) {
+    verifica(ctx, sWHILE);
+    NoId cond = ast_exp(ctx);
+    verifica(ctx, sDO);
+    NoId corpo = ast_cmd(ctx);
+    return novo_operador(ctx, AST_ENQUANTO, sWHILE, cond, corpo);
+}
+
+// <repeat> ::= sREPEAT { <cmd> ; } sUNTIL <exp>
+static NoId ast_repeat(ContextoCompilacao *ctx) {
+    verifica(ctx, sREPEAT);
+    NoId corpo = ast_lista_cmd(ctx, sUNTIL);
+    verifica(ctx, sUNTIL);
+    NoId cond = ast_exp(ctx);
+    return novo_operador(ctx, AST_REPITA, sREPEAT, corpo, cond);
+}
+
+// <for> ::= sFOR ( <atrib> ; <exp> ; <atrib> ) <cmd>
+static NoId ast_for(ContextoCompilacao *ctx) {
+    verifica(ctx, sFOR);
+    verifica(ctx, sABRE_PARENT);
+    NoId inicio = ast_atrib(ctx);
+    verifica(ctx, sPONTO_VIRG);
+    NoId cond = ast_exp(ctx);
+    verifica(ctx, sPONTO_VIRG);
+    NoId incr = ast_atrib(ctx);
+    verifica(ctx, sFECHA_PARENT);
+    NoId corpo = ast_cmd(ctx);
+
+    NoId para = novo_operador(ctx, AST_PARA, sFOR, inicio, cond);
+    NoAST *no = ast_no(ctx->ast, para);
+    no->c = incr;
+    no->u.d = corpo;
+    return para;
+}
+
+// <cmd> ::= <atrib> | <chamada> | <leitura> | <escrita> | <selecao> | <repeticao> | <ret> | <bco>
+// (limite de aninhamento como em parse_cmd)
+static NoId ast_cmd(ContextoCompilacao *ctx) {
+    int max = ctx->limites.max_aninhamento;
+    NoId cmd = 0;
+
+    if (max > 0 && ctx->aninhamento >= max) {
+        if (!ctx->aninhamento_excedido) {
+            fprintf(ctx->diag, "Erro (%d): comandos aninhados demais (limite %d)\n",
+                    ctx->linha_atual, max);
+            ctx->aninhamento_excedido = 1;
+            registrar_erro(ctx);
+        }
+        recuperar(ctx);
+    }
+    ctx->aninhamento++;
+
+    switch (ctx->lookahead.atomo) {
+        case sIDENT:  cmd = ast_cmd_id(ctx); break;
+        case sREAD:   cmd = ast_leitura(ctx); break;
+        case sWRITE:  cmd = ast_escrita(ctx); break;
+        case sIF:     cmd = ast_selecao(ctx); break;
+        case sWHILE:  cmd = ast_while(ctx); break;
+        case sREPEAT: cmd = ast_repeat(ctx); break;
+        case sFOR:    cmd = ast_for(ctx); break;
+        case sRETURN: cmd = ast_ret(ctx); break;
+        case sBEGIN:  cmd = ast_bco(ctx); break;
+        default:
+            erro_sintatico_msg(ctx, "comando", ctx->lookahead.atomo);
+            recuperar(ctx);
+    }
+
+    ctx->aninhamento--;
+    return cmd;
+}
+
+// Constrói a árvore em ctx->ast. Retorna 0 se a compilação foi interrompida
+// (limite de erros, falta de memória); os erros relatados estão em
+// ctx->erros. Um erro sintático fora de comandos e declarações só encerra a
+// análise: os nós já criados ainda passam pela semântica
+int parse_programa_ast(ContextoCompilacao *ctx) {
+    char base;
+
+    ctx->erros = 0;
+    ctx->recuperar = NULL;
+    ctx->base_pilha = (uintptr_t)&base;
+    switch (setjmp(ctx->fuga)) {
+        case 0: break;
+        case 2: return 1;
+        default: return 0;
+    }
+
+    avancar(ctx);
+    ctx->ast->raiz = ast_ini(ctx);
+    return 1;
+}
+
+/*
+ * Expressões: mesma pilha explícita de parse_exp (asdr.c). Aqui cada passo
+ * deixa em *res o nó do não-terminal concluído, e o quadro guarda o nó do
+ * operando esquerdo.
+ */
+
+// <exp> ::= <exp_simples> [<op_rel> <exp_simples>]
+static void passo_exp(ContextoCompilacao *ctx, QuadroExp *q, NoId *res) {
+    switch (q->estado) {
+        case 0:
+            q->estado = 1;
+            empilhar_exp(ctx, NT_EXP_SIMPLES);
+            return;
+
+        case 1:
+            if (eh_op_relacional(ctx->lookahead.atomo)) {
+                q->esq.no = *res;
+                q->op = ctx->lookahead.atomo;
+                avancar(ctx);
+                q->estado = 2;
+                empilhar_exp(ctx, NT_EXP_SIMPLES);
+                return;
+            }
+            ctx->n_exp--;
+            return;
+    }
+
+    *res = novo_operador(ctx, AST_BINARIO, q->op, q->esq.no, *res);
+    ctx->n_exp--;
+}
+
+// <exp_simples> ::= [+|-] <termo> { (+|-|ou) <termo> }
+static void passo_exp_simples(ContextoCompilacao *ctx, QuadroExp *q, NoId *res) {
+    switch (q->estado) {
+        case 0:
+            if (ctx->lookahead.atomo == sSOMA) {
+                verifica(ctx, sSOMA);
+            } else if (ctx->lookahead.atomo == sSUBT) {
+                verifica(ctx, sSUBT);
+                q->negativo = 1;
+            }
+            q->estado = 1;
+            empilhar_exp(ctx, NT_TERMO);
+            return;
+
+        case 1:
+            q->esq.no = q->negativo ? novo_operador(ctx, AST_UNARIO, sSUBT, *res, 0) : *res;
+            break;
+
+        case 2:
+            q->esq.no = novo_operador(ctx, AST_BINARIO, q->op, q->esq.no, *res);
+            break;
+    }
+
+    if (ctx->lookahead.atomo == sSOMA || ctx->lookahead.atomo == sSUBT ||
+        ctx->lookahead.atomo == sOU) {
+        q->op = ctx->lookahead.atomo;
+        avancar(ctx);
+        q->estado = 2;
+        empilhar_exp(ctx, NT_TERMO);
+        return;
+    }
+    *res = q->esq.no;
+    ctx->n_exp--;
+}
+
+// <termo> ::= <fator> { (*|/|e) <fator> }
+static void passo_termo(ContextoCompilacao *ctx, QuadroExp *q, NoId *res) {
+    switch (q->estado) {
+        case 0:
+            q->estado = 1;
+            empilhar_exp(ctx, NT_FATOR);
+            return;
+
+        case 1:
+            q->esq.no = *res;
+            break;
+
+        case 2:
+            q->esq.no = novo_operador(ctx, AST_BINARIO, q->op, q->esq.no, *res);
+            break;
+    }
+
+    if (ctx->lookahead.atomo == sMULT || ctx->lookahead.atomo == sDIV ||
+        ctx->lookahead.atomo == sE) {
+        q->op = ctx->lookahead.atomo;
+        avancar(ctx);
+        q->estado = 2;
+        empilhar_exp(ctx, NT_FATOR);
+        return;
+    }
+    *res = q->esq.no;
+    ctx->n_exp--;
+}
+
+/*
+ * Chamadas: o quadro de <fator> guarda o AST_RESULTADO, criado no '(' (onde
+ * a uma passada resolve o nome); cada argumento ganha um AST_ARG ao
+ * terminar e a AST_CHAMADA é criada depois do ')', nas linhas das checagens
+ * correspondentes.
+ */
+
+// Identificador já consumido e '(' à frente
+static void iniciar_chamada(ContextoCompilacao *ctx, QuadroExp *q, const char *nome,
+                            int em_expressao) {
+    NoId resultado = novo_no_texto(ctx, AST_RESULTADO, nome);
+    ast_no(ctx->ast, resultado)->op = (uint8_t)em_expressao;
+    q->esq.no = resultado;
+
+    aprofundar_exp(ctx);
+    verifica(ctx, sABRE_PARENT);
+    q->estado = 3;
+}
+
+// Argumento concluído (expressão exp); o último fica em b do resultado
+// enquanto a chamada é analisada
+static void anexar_argumento(ContextoCompilacao *ctx, NoId resultado, NoId exp) {
+    NoId anterior = ast_no(ctx->ast, resultado)->b;
+    NoId arg = novo_operador(ctx, AST_ARG, 0, exp, resultado);
+
+    ast_no(ctx->ast, arg)->c = anterior != 0 ? ast_no(ctx->ast, anterior)->c + 1 : 1;
+    if (anterior != 0) ast_no(ctx->ast, anterior)->prox = arg;
+    else ast_no(ctx->ast, resultado)->a = arg;
+    ast_no(ctx->ast, resultado)->b = arg;
+}
+
+static void concluir_chamada(ContextoCompilacao *ctx, NoId resultado, NoId *res) {
+    verifica(ctx, sFECHA_PARENT);
+
+    NoId ultimo = ast_no(ctx->ast, resultado)->b;
+    NoId chamada = novo_operador(ctx, AST_CHAMADA, 0, resultado, 0);
+    ast_no(ctx->ast, chamada)->c = ultimo != 0 ? ast_no(ctx->ast, ultimo)->c : 0;
+    ast_no(ctx->ast, resultado)->b = 0;
+
+    *res = chamada;
+    ctx->prof_exp--;
+    ctx->n_exp--;
+}
+
+// <fator> ::= <id> | <chamada> | <num> | ( <exp> ) | nao <fator>
+static void passo_fator(ContextoCompilacao *ctx, QuadroExp *q, NoId *res) {
+    if (q->estado == 1) {
+        // Fim de ( <exp> ): parênteses não geram nó
+        verifica(ctx, sFECHA_PARENT);
+        ctx->prof_exp--;
+        ctx->n_exp--;
+        return;
+    }
+
+    if (q->estado == 2) {
+        // Fim de nao <fator>
+        *res = novo_operador(ctx, AST_UNARIO, sNAO, *res, 0);
+        ctx->prof_exp--;
+        ctx->n_exp--;
+        return;
+    }
+
+    if (q->estado == 3) {
+        // Logo depois do '(' de uma chamada
+        if (ctx->lookahead.atomo == sFECHA_PARENT) {
+            concluir_chamada(ctx, q->esq.no, res);
+        } else {
+            q->estado = 4;
+            empilhar_exp(ctx, NT_EXP);
+        }
+        return;
+    }
+
+    if (q->estado == 4) {
+        NoId resultado = q->esq.no;
+        anexar_argumento(ctx, resultado, *res);
+        if (ctx->lookahead.atomo == sVIRG) {
+            verifica(ctx, sVIRG);
+            empilhar_exp(ctx, NT_EXP);
+        } else {
+            concluir_chamada(ctx, resultado, res);
+        }
+        return;
+    }
+
+    switch (ctx->lookahead.atomo) {
+        case sIDENT: {
+            TInfoAtomo id = ctx->lookahead;
+            verifica(ctx, sIDENT);
+            if (ctx->lookahead.atomo == sABRE_PARENT) {
+                iniciar_chamada(ctx, q, id.lexema, 1);
+                break;
+            }
+            ctx->n_exp--;
+            *res = novo_no_texto(ctx, AST_VAR, id.lexema);
+            break;
+        }
+
+        case sNUM_INT:
+        case sNUM_FLOAT: {
+            TInfoAtomo num = ctx->lookahead;
+            avancar(ctx);
+            ctx->n_exp--;
+            *res = novo_no_texto(ctx, num.atomo == sNUM_INT ? AST_INT : AST_FLOAT, num.lexema);
+            break;
+        }
+
+        case sABRE_PARENT:
+            verifica(ctx, sABRE_PARENT);
+            aprofundar_exp(ctx);
+            q->estado = 1;
+            empilhar_exp(ctx, NT_EXP);
+            break;
+
+        case sNAO:
+            verifica(ctx, sNAO);
+            aprofundar_exp(ctx);
+            q->estado = 2;
+            empilhar_exp(ctx, NT_FATOR);
+            break;
+
+        default:
+            erro_sintatico_msg(ctx, "fator (identificador, número ou expressão)",
+                               ctx->lookahead.atomo);
+            recuperar(ctx);
+    }
+}
+
+// Executa os quadros empilhados até esvaziar a pilha
+static NoId executar_exp(ContextoCompilacao *ctx) {
+    NoId res = 0;
+
+    while (ctx->n_exp > 0) {
+        QuadroExp *q = &ctx->pilha_exp[ctx->n_exp - 1];
+        switch (q->nt) {
+            case NT_EXP:         passo_exp(ctx, q, &res); break;
+            case NT_EXP_SIMPLES: passo_exp_simples(ctx, q, &res); break;
+            case NT_TERMO:       passo_termo(ctx, q, &res); break;
+            case NT_FATOR:       passo_fator(ctx, q, &res); break;
+        }
+    }
+    return res;
+}
+
+// Analisa uma expressão completa e retorna sua raiz
+static NoId ast_exp(ContextoCompilacao *ctx) {
+    ctx->n_exp = 0;
+    ctx->prof_exp = 0;
+    empilhar_exp(ctx, NT_EXP);
+    return executar_exp(ctx);
+}
+
+// <chamada> como comando (identificador já consumido)
+static NoId ast_chamada(ContextoCompilacao *ctx, const char *nome) {
+    ctx->n_exp = 0;
+    ctx->prof_exp = 0;
+    empilhar_exp(ctx, NT_FATOR);
+    iniciar_chamada(ctx, &ctx->pilha_exp[0], nome, 0);
+    return executar_exp(ctx);
+}
@@ -0,0 +1,668 @@
+/*
+ * asdr_ll1.c - Analisador sintático LL(1) dirigido por tabela
+ *
+ * Alternativa ao descendente recursivo de asdr.c (lpdc --analisador ll1),
+ * com a mesma saída: o código MEPA, a tabela de símbolos e as mensagens de
+ * programas corretos são idênticos. A gramática está em lpd.ll1, e as
+ * tabelas (tabela_ll1.c) são geradas dela pelo gerall1 na compilação.
+ *
+ * Um só laço analisa o programa inteiro: o topo da pilha de símbolos é um
+ * átomo (comparado com o lookahead), um não-terminal (trocado pelo lado
+ * direito da produção que a tabela indica para o lookahead) ou uma ação
+ * semântica. Nada recursa em C, nem comandos aninhados: a pilha de C fica
+ * constante, e o aninhamento só consome as pilhas explícitas.
+ *
+ * As ações se comunicam por uma pilha de valores (tipos, operadores,
+ * contagens, rótulos e registros da tabela de símbolos), na ordem em que
+ * asdr.c os guarda em variáveis locais. Cada uma corresponde a um trecho de
+ * asdr.c entre dois átomos, indicado nos comentários.
+ *
+ * Erros: cada <cmd> ; e cada <dcl_var> ; abre um ponto de recuperação, que
+ * guarda a altura das pilhas. Um erro sintático volta por longjmp ao laço
+ * (ctx->recuperar), que descarta o resto do comando ou da declaração nas
+ * pilhas e na entrada (sincronizar) e continua na lista, como parse_lista_cmd
+ * e parse_dcl. Fora dos pontos, a análise termina (fuga).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include "asdr.h"
+#include "gerador.h"
+#include "tabela_ll1.h"
+
+// Valor de uma ação; o significado depende de quem o empilhou
+typedef struct {
+    int n;                      // tipo (TipoDado), átomo, contagem ou sinal
+    char rotulo[12];            // rótulo MEPA ("L<n>")
+    RegistroTS *reg;            // variável ou sub-rotina (NULL: erro já relatado)
+} ValorLL1;
+
+// Ponto de recuperação: um <cmd> ; ou <dcl_var> ; em análise
+typedef struct {
+    int n_pilha;                // altura da pilha sem o resto dele (a lista no topo)
+    int n_valores;
+    int aninhamento;
+    TAtomo fim;                 // átomo que fecha a lista (sEOF: declaração)
+} PontoLL1;
+
+typedef struct {
+    short *pilha;               // símbolos (ver tabela_ll1.h)
+    int n_pilha, cap_pilha;
+    ValorLL1 *valores;
+    int n_valores, cap_valores;
+    PontoLL1 *pontos;
+    int n_pontos, cap_pontos;
+    TInfoAtomo id;              // identificador guardado (#guardar_id)
+    jmp_buf *retomar;           // volta ao laço depois de um erro
+} AnalisadorLL1;
+
+// Garante espaço para mais n elementos de tam bytes num vetor
+static void reservar(ContextoCompilacao *ctx, void **vetor, int *cap, int usados, int n,
+                     size_t tam) {
+    if (usados + n <= *cap) return;
+
+    int novo = *cap ? *cap * 2 : 256;
+    while (novo < usados + n) novo *= 2;
+    void *maior = realloc(*vetor, tam * novo);
+    if (maior == NULL) {
+        fprintf(ctx->diag, "Erro: falha ao alocar memória para a análise sintática\n");
+        ctx->erros++;
+        abortar(ctx);
+    }
+    *vetor = maior;
+    *cap = novo;
+}
+
+static ValorLL1* empilhar_valor(ContextoCompilacao *ctx, AnalisadorLL1 *a) {
+    reservar(ctx, (void **)&a->valores, &a->cap_valores, a->n_valores, 1, sizeof(ValorLL1));
+    ValorLL1 *v = &a->valores[a->n_valores++];
+    v->n = 0;
+    v->reg = NULL;
+    return v;
+}
+
+static ValorLL1* topo(AnalisadorLL1 *a, int k) {
+    return &a->valores[a->n_valores - 1 - k];
+}
+
+static void empilhar_rotulo(ContextoCompilacao *ctx, AnalisadorLL1 *a) {
+    strcpy(empilhar_valor(ctx, a)->rotulo, novo_rotulo(&ctx->ger));
+}
+
+// Instrução com um operando numérico
+static void gerar_n(ContextoCompilacao *ctx, const char *mnemonico, int n) {
+    char buffer[20];
+    snprintf(buffer, sizeof(buffer), "%d", n);
+    gera_instr_mepa(&ctx->ger, NULL, mnemonico, buffer, NULL);
+}
+
+// ARMZ ou CRVL de uma variável
+static void gerar_var(ContextoCompilacao *ctx, const char *mnemonico, const RegistroTS *r) {
+    char nivel[20], endereco[20];
+    snprintf(nivel, sizeof(nivel), "%d", r->nivel);
+    snprintf(endereco, sizeof(endereco), "%d", r->endereco);
+    gera_instr_mepa(&ctx->ger, NULL, mnemonico, nivel, endereco);
+}
+
+/*
+ * Pontos de recuperação
+ */
+
+static void abrir_ponto(ContextoCompilacao *ctx, AnalisadorLL1 *a, TAtomo fim) {
+    reservar(ctx, (void **)&a->pontos, &a->cap_pontos, a->n_pontos, 1, sizeof(PontoLL1));
+    PontoLL1 *p = &a->pontos[a->n_pontos++];
+
+    // Acima da lista estão o <cmd> (ou <dcl_var>), o ';' e #fim_ponto
+    p->n_pilha = a->n_pilha - 3;
+    p->n_valores = a->n_valores;
+    p->aninhamento = ctx->aninhamento;
+    p->fim = fim;
+    ctx->recuperar = a->retomar;
+}
+
+static void fechar_ponto(ContextoCompilacao *ctx, AnalisadorLL1 *a) {
+    a->n_pontos--;
+    ctx->recuperar = a->n_pontos > 0 ? a->retomar : NULL;
+}
+
+// Depois de um erro sintático: descarta o resto do comando ou declaração
+static void retomar(ContextoCompilacao *ctx, AnalisadorLL1 *a) {
+    PontoLL1 p = a->pontos[a->n_pontos - 1];
+
+    fechar_ponto(ctx, a);
+    a->n_pilha = p.n_pilha;
+    a->n_valores = p.n_valores;
+    ctx->aninhamento = p.aninhamento;
+    ctx->prof_exp = 0;
+    if (p.fim == sEOF) sincronizar_dcl(ctx);
+    else sincronizar(ctx, p.fim);
+}
+
+/*
+ * Ações semânticas
+ */
+
+// Limite de aninhamento, no início de parse_cmd
+static void entrar_cmd(ContextoCompilacao *ctx) {
+    int max = ctx->limites.max_aninhamento;
+
+    if (max > 0 && ctx->aninhamento >= max) {
+        if (!ctx->aninhamento_excedido) {
+            fprintf(ctx->diag, "Erro (%d): comandos aninhados demais (limite %d)\n",
+                    ctx->linha_atual, max);
+            ctx->aninhamento_excedido = 1;
+            registrar_erro(ctx);
+        }
+        recuperar(ctx);
+    }
+    ctx->aninhamento++;
+}
+
+// Declaração da sub-rotina (parse_dcl_sub, até o '(')
+static void declarar_sub(ContextoCompilacao *ctx, AnalisadorLL1 *a) {
+    ValorLL1 *v = topo(a, 0);
+
+    v->reg = declarar(ctx, a->id.lexema, CAT_FUNCAO, (TAtomo)v->n, ctx->ts.n_subrotinas + 1);
+    v->n = 0;
+    ts_abrir_escopo(&ctx->ts);
+}
+
+static void declarar_parametro(ContextoCompilacao *ctx, AnalisadorLL1 *a) {
+    ValorLL1 *sub = topo(a, 1);
+    TAtomo tipo = (TAtomo)topo(a, 0)->n;
+
+    declarar(ctx, a->id.lexema, CAT_PARAMETRO, tipo, ++sub->n);
+    if (sub->reg != NULL && !ts_adicionar_parametro(sub->reg, tipo)) sem_memoria_ts(ctx);
+    a->n_valores--;
+}
+
+// Entrada da sub-rotina, depois do ';' do cabeçalho
+static void entrar_sub(ContextoCompilacao *ctx, AnalisadorLL1 *a) {
+    RegistroTS *sub = topo(a, 0)->reg;
+    char entrada[20];
+
+    snprintf(entrada, sizeof(entrada), "R%d", sub != NULL ? sub->endereco : 0);
+    gera_instr_mepa(&ctx->ger, entrada, "ENPR", "1", NULL);
+    strcpy(ctx->rotulo_retorno, novo_rotulo(&ctx->ger));
+    ctx->sub_atual = sub;
+    empilhar_valor(ctx, a);         // locais
+}
+
+static void sair_sub(ContextoCompilacao *ctx, AnalisadorLL1 *a) {
+    int locais = topo(a, 0)->n, n_param = topo(a, 1)->n;
+
+    gera_instr_mepa(&ctx->ger, ctx->rotulo_retorno, "NADA", NULL, NULL);
+    if (locais > 0) gerar_n(ctx, "DMEM", locais);
+    char buffer[20];
+    snprintf(buffer, sizeof(buffer), "%d", n_param);
+    gera_instr_mepa(&ctx->ger, NULL, "RTPR", "1", buffer);
+
+    ts_fechar_escopo(&ctx->ts);
+    ctx->sub_atual = NULL;
+    a->n_valores -= 2;
+}
+
+// Fim de <atrib> (parse_atrib_resto depois de parse_exp)
+static void armazenar(ContextoCompilacao *ctx, AnalisadorLL1 *a) {
+    RegistroTS *registro = topo(a, 1)->reg;
+    TipoDado tipo_exp = (TipoDado)topo(a, 0)->n;
+
+    a->n_valores -= 2;
+    if (registro == NULL) return;
+
+    if (!tipos_compativeis(tipo_exp, registro->tipo)) {
+        fprintf(ctx->diag, "Erro semântico (%d): incompatibilidade de tipos na atribuição - "
+                "tentando atribuir '%s' a variável '%s' do tipo '%s'\n",
+                ctx->linha_atual, nome_tipo(tipo_exp), registro->lexema,
+                nome_tipo(registro->tipo));
+        registrar_erro(ctx);
+        return;
+    }
+    gerar_var(ctx, "ARMZ", registro);
+}
+
+static void retornar(ContextoCompilacao *ctx, AnalisadorLL1 *a) {
+    RegistroTS *sub = ctx->sub_atual;
+    int com_valor = topo(a, 0)->n;
+    TipoDado tipo = (TipoDado)topo(a, 1)->n;
+
+    a->n_valores -= 2;
+    if (sub == NULL) return;
+
+    checar_retorno(ctx, sub, com_valor, tipo, ctx->linha_atual);
+    if (com_valor && sub->tipo != TIPO_VOID) {
+        char endereco[20];
+        snprintf(endereco, sizeof(endereco), "%d", -(sub->n_param + 3));
+        gera_instr_mepa(&ctx->ger, NULL, "ARMZ", "1", endereco);
+    }
+    gera_instr_mepa(&ctx->ger, NULL, "DSVS", ctx->rotulo_retorno, NULL);
+}
+
+// Identificador guardado e '(' à frente (iniciar_chamada)
+static void iniciar_chamada(ContextoCompilacao *ctx, AnalisadorLL1 *a, int em_expressao) {
+    RegistroTS *sub = buscar_subrotina(ctx, a->id.lexema, em_expressao, ctx->linha_atual);
+
+    if (sub != NULL && sub->tipo != TIPO_VOID) {
+        gera_instr_mepa(&ctx->ger, NULL, "AMEM", "1", NULL);
+    }
+    empilhar_valor(ctx, a)->reg = sub;
+    aprofundar_exp(ctx);
+}
+
+// Depois do ')' (concluir_chamada): o valor da chamada vira o seu tipo
+static void concluir_chamada(ContextoCompilacao *ctx, AnalisadorLL1 *a, int em_expressao) {
+    ValorLL1 *c = topo(a, 0);
+
+    checar_n_argumentos(ctx, c->reg, c->n, ctx->linha_atual);
+    if (c->reg != NULL) {
+        char entrada[20], nivel[20];
+        snprintf(entrada, sizeof(entrada), "R%d", c->reg->endereco);
+        snprintf(nivel, sizeof(nivel), "%d", ctx->ts.nivel);
+        gera_instr_mepa(&ctx->ger, NULL, "CHPR", entrada, nivel);
+    }
+    c->n = tipo_chamada(c->reg, em_expressao);
+    ctx->prof_exp--;
+}
+
+// <fator> identificador que não é chamada
+static void carregar_var(ContextoCompilacao *ctx, AnalisadorLL1 *a) {
+    RegistroTS *registro = buscar_variavel(ctx, a->id.lexema, ctx->linha_atual);
+
+    if (registro == NULL) {
+        empilhar_valor(ctx, a)->n = TIPO_ERRO;
+        return;
+    }
+    gerar_var(ctx, "CRVL", registro);
+    empilhar_valor(ctx, a)->n = registro->tipo;
+}
+
+// Operador binário com os dois operandos analisados: checa, gera e deixa o
+// tipo do resultado no lugar do operando esquerdo (passo_exp, passo_exp_simples
+// e passo_termo)
+static void operar(ContextoCompilacao *ctx, AnalisadorLL1 *a) {
+    TipoDado esq = (TipoDado)topo(a, 2)->n, dir = (TipoDado)topo(a, 0)->n;
+    TAtomo op = (TAtomo)topo(a, 1)->n;
+    const char *mnemonico;
+    TipoDado tipo;
+
+    if (eh_op_relacional(op)) {
+        if (!tipos_compativeis(esq, dir)) {
+            fprintf(ctx->diag, "Erro semântico (%d): operandos incompatíveis na comparação - "
+                    "'%s' e '%s'\n", ctx->linha_atual, nome_tipo(esq), nome_tipo(dir));
+            registrar_erro(ctx);
+        }
+        switch (op) {
+            case sMENOR:     mnemonico = "CMME"; break;
+            case sMENOR_IG:  mnemonico = "CMEG"; break;
+            case sIGUAL:     mnemonico = "CMIG"; break;
+            case sDIFERENTE: mnemonico = "CMDG"; break;
+            case sMAIOR:     mnemonico = "CMMA"; break;
+            default:         mnemonico = "CMAG"; break;
+        }
+        tipo = TIPO_BOOL;
+    } else if (op == sOU || op == sE) {
+        if (!eh_bool(esq) || !eh_bool(dir)) {
+            fprintf(ctx->diag, "Erro semântico (%d): operador '%s' requer operandos booleanos\n",
+                    ctx->linha_atual, nome_token(op));
+            registrar_erro(ctx);
+        }
+        mnemonico = op == sOU ? "DISJ" : "CONJ";
+        tipo = TIPO_BOOL;
+    } else {
+        if (!tipos_compativeis(esq, dir)) {
+            fprintf(ctx->diag, "Erro semântico (%d): operandos incompatíveis em operação aritmética - "
+                    "'%s' e '%s'\n", ctx->linha_atual, nome_tipo(esq), nome_tipo(dir));
+            registrar_erro(ctx);
+            esq = dir = TIPO_ERRO;
+        }
+        switch (op) {
+            case sSOMA: mnemonico = "SOMA"; break;
+            case sSUBT: mnemonico = "SUBT"; break;
+            case sMULT: mnemonico = "MULT"; break;
+            default:    mnemonico = "DIVI"; break;
+        }
+        tipo = (esq == TIPO_FLOAT || dir == TIPO_FLOAT) ? TIPO_FLOAT : esq;
+    }
+    gera_instr_mepa(&ctx->ger, NULL, mnemonico, NULL, NULL);
+
+    a->n_valores -= 2;
+    topo(a, 0)->n = tipo;
+}
+
+// Sinal de <exp_simples> aplicado ao primeiro termo
+static void aplicar_sinal(ContextoCompilacao *ctx, AnalisadorLL1 *a) {
+    TipoDado tipo = (TipoDado)topo(a, 0)->n;
+
+    if (topo(a, 1)->n) {
+        if (!eh_numerico(tipo)) {
+            fprintf(ctx->diag, "Erro semântico (%d): operador unário '-' aplicado a tipo não-numérico '%s'\n",
+                    ctx->linha_atual, nome_tipo(tipo));
+            registrar_erro(ctx);
+            tipo = TIPO_ERRO;
+        }
+        gera_instr_mepa(&ctx->ger, NULL, "INVR", NULL, NULL);
+    }
+    a->n_valores--;
+    topo(a, 0)->n = tipo;
+}
+
+static void negar(ContextoCompilacao *ctx, AnalisadorLL1 *a) {
+    TipoDado tipo = (TipoDado)topo(a, 0)->n;
+
+    if (!eh_bool(tipo)) {
+        fprintf(ctx->diag, "Erro semântico (%d): operador 'nao' requer operando booleano, "
+                "encontrado '%s'\n", ctx->linha_atual, nome_tipo(tipo));
+        registrar_erro(ctx);
+    }
+    gera_instr_mepa(&ctx->ger, NULL, "NEGA", NULL, NULL);
+    topo(a, 0)->n = TIPO_BOOL;
+    ctx->prof_exp--;
+}
+
+static void executar_acao(ContextoCompilacao *ctx, AnalisadorLL1 *a, int acao) {
+    ValorLL1 *v;
+    char rotulo[12];
+
+    switch (acao) {
+        // Programa e declarações (parse_ini, parse_dcl, parse_dcl_var)
+        case ACAO_GUARDAR_ID:
+            a->id = ctx->lookahead;
+            break;
+        case ACAO_PROGRAMA:
+            declarar(ctx, a->id.lexema, CAT_PROGRAMA, sVOID, -1);
+            break;
+        case ACAO_INPP:
+            gera_instr_mepa(&ctx->ger, NULL, "INPP", NULL, NULL);
+            // Variáveis globais, a partir das de um módulo importado
+            empilhar_valor(ctx, a)->n = obter_proximo_endereco(&ctx->ts);
+            break;
+        case ACAO_AMEM:
+            if (topo(a, 0)->n > 0) gerar_n(ctx, "AMEM", topo(a, 0)->n);
+            break;
+        case ACAO_FIM_PROGRAMA:
+            if (topo(a, 0)->n > 0) gerar_n(ctx, "DMEM", topo(a, 0)->n);
+            gera_instr_mepa(&ctx->ger, NULL, "PARA", NULL, NULL);
+            a->n_valores--;
+            break;
+        case ACAO_PONTO_DCL:
+            abrir_ponto(ctx, a, sEOF);
+            break;
+        case ACAO_PONTO_CMD:
+            abrir_ponto(ctx, a, (TAtomo)topo(a, 0)->n);
+            break;
+        case ACAO_FIM_PONTO:
+            fechar_ponto(ctx, a);
+            break;
+        case ACAO_TIPO:
+            empilhar_valor(ctx, a)->n = ctx->lookahead.atomo;
+            break;
+        case ACAO_DECLARAR_VAR:
+            declarar(ctx, a->id.lexema, CAT_VARIAVEL, (TAtomo)topo(a, 0)->n,
+                     obter_proximo_endereco(&ctx->ts));
+            topo(a, 1)->n++;
+            break;
+        case ACAO_DESCARTAR:
+            a->n_valores--;
+            break;
+
+        // Sub-rotinas (parse_ini, parse_dcl_sub)
+        case ACAO_DESVIAR_PRINCIPAL:
+            empilhar_rotulo(ctx, a);
+            gera_instr_mepa(&ctx->ger, NULL, "DSVS", topo(a, 0)->rotulo, NULL);
+            break;
+        case ACAO_PRINCIPAL:
+            gera_instr_mepa(&ctx->ger, topo(a, 0)->rotulo, "NADA", NULL, NULL);
+            a->n_valores--;
+            break;
+        case ACAO_DECLARAR_SUB:
+            declarar_sub(ctx, a);
+            break;
+        case ACAO_DECLARAR_PARAMETRO:
+            declarar_parametro(ctx, a);
+            break;
+        case ACAO_FIXAR_PARAMETROS:
+            // O parâmetro i fica em -(n + 3) + i
+            for (RegistroTS *r = ctx->ts.cabeca; r != ctx->ts.base_escopo; r = r->proximo) {
+                r->endereco -= topo(a, 0)->n + 3;
+            }
+            break;
+        case ACAO_ENTRADA:
+            entrar_sub(ctx, a);
+            break;
+        case ACAO_SAIDA:
+            sair_sub(ctx, a);
+            break;
+
+        // Comandos
+        case ACAO_LISTA_END:
+            empilhar_valor(ctx, a)->n = sEND;
+            break;
+        case ACAO_LISTA_UNTIL:
+            empilhar_valor(ctx, a)->n = sUNTIL;
+            break;
+        case ACAO_FIM_LISTA:
+            a->n_valores--;
+            break;
+        case ACAO_ENTRAR_CMD:
+            entrar_cmd(ctx);
+            break;
+        case ACAO_SAIR_CMD:
+            ctx->aninhamento--;
+            break;
+        case ACAO_BUSCAR_VAR:
+            empilhar_valor(ctx, a)->reg = buscar_variavel(ctx, a->id.lexema, ctx->linha_atual);
+            break;
+        case ACAO_ARMAZENAR:
+            armazenar(ctx, a);
+            break;
+        case ACAO_LER:
+            v = topo(a, 0);
+            a->n_valores--;
+            if (v->reg == NULL) break;
+            gera_instr_mepa(&ctx->ger, NULL, "LEIT", NULL, NULL);
+            gerar_var(ctx, "ARMZ", v->reg);
+            break;
+        case ACAO_ESCREVER:
+            a->n_valores--;
+            gera_instr_mepa(&ctx->ger, NULL, "IMPR", NULL, NULL);
+            break;
+        case ACAO_ESCREVER_CADEIA: {
+            char texto[100];
+            texto_literal(&ctx->lookahead, texto);
+            gera_impressao_cadeia(&ctx->ger, texto);
+            break;
+        }
+        case ACAO_COM_VALOR:
+            empilhar_valor(ctx, a)->n = 1;
+            break;
+        case ACAO_SEM_VALOR:
+            empilhar_valor(ctx, a)->n = TIPO_VOID;
+            empilhar_valor(ctx, a)->n = 0;
+            break;
+        case ACAO_RETORNAR:
+            retornar(ctx, a);
+            break;
+
+        // Desvios de if, while, repeat e for, na ordem de asdr.c
+        case ACAO_DESVIAR_FALSO:
+            v = topo(a, 0);             // a condição dá lugar ao rótulo
+            strcpy(v->rotulo, novo_rotulo(&ctx->ger));
+            gera_instr_mepa(&ctx->ger, NULL, "DSVF", v->rotulo, NULL);
+            break;
+        case ACAO_SENAO:
+            v = topo(a, 0);
+            strcpy(rotulo, novo_rotulo(&ctx->ger));
+            gera_instr_mepa(&ctx->ger, NULL, "DSVS", rotulo, NULL);
+            gera_instr_mepa(&ctx->ger, v->rotulo, "NADA", NULL, NULL);
+            strcpy(v->rotulo, rotulo);
+            break;
+        case ACAO_FIM_SE:
+            gera_instr_mepa(&ctx->ger, topo(a, 0)->rotulo, "NADA", NULL, NULL);
+            a->n_valores--;
+            break;
+        case ACAO_INICIO_LACO:
+            empilhar_rotulo(ctx, a);
+            gera_instr_mepa(&ctx->ger, topo(a, 0)->rotulo, "NADA", NULL, NULL);
+            break;
+        case ACAO_FIM_ENQUANTO:
+            gera_instr_mepa(&ctx->ger, NULL, "DSVS", topo(a, 1)->rotulo, NULL);
+            gera_instr_mepa(&ctx->ger, topo(a, 0)->rotulo, "NADA", NULL, NULL);
+            a->n_valores -= 2;
+            break;
+        case ACAO_ATE:
+            gera_instr_mepa(&ctx->ger, NULL, "DSVF", topo(a, 1)->rotulo, NULL);
+            a->n_valores -= 2;
+            break;
+        case ACAO_PARA_TESTE:
+            // Pilha: início, condição -> início, fim, corpo, incremento
+            v = topo(a, 0);
+            strcpy(v->rotulo, novo_rotulo(&ctx->ger));
+            gera_instr_mepa(&ctx->ger, NULL, "DSVF", v->rotulo, NULL);
+            empilhar_rotulo(ctx, a);
+            gera_instr_mepa(&ctx->ger, NULL, "DSVS", topo(a, 0)->rotulo, NULL);
+            empilhar_rotulo(ctx, a);
+            gera_instr_mepa(&ctx->ger, topo(a, 0)->rotulo, "NADA", NULL, NULL);
+            break;
+        case ACAO_PARA_CORPO:
+            gera_instr_mepa(&ctx->ger, NULL, "DSVS", topo(a, 3)->rotulo, NULL);
+            gera_instr_mepa(&ctx->ger, topo(a, 1)->rotulo, "NADA", NULL, NULL);
+            break;
+        case ACAO_PARA_FIM:
+            gera_instr_mepa(&ctx->ger, NULL, "DSVS", topo(a, 0)->rotulo, NULL);
+            gera_instr_mepa(&ctx->ger, topo(a, 2)->rotulo, "NADA", NULL, NULL);
+            a->n_valores -= 4;
+            break;
+
+        // Chamadas
+        case ACAO_INICIAR_CHAMADA_CMD:
+            iniciar_chamada(ctx, a, 0);
+            break;
+        case ACAO_INICIAR_CHAMADA:
+            iniciar_chamada(ctx, a, 1);
+            break;
+        case ACAO_ARGUMENTO:
+            v = topo(a, 1);
+            checar_argumento(ctx, v->reg, ++v->n, (TipoDado)topo(a, 0)->n, ctx->linha_atual);
+            a->n_valores--;
+            break;
+        case ACAO_CONCLUIR_CHAMADA:
+            concluir_chamada(ctx, a, 1);
+            break;
+        case ACAO_CONCLUIR_CHAMADA_CMD:
+            // O resultado de uma função chamada como comando é descartado
+            concluir_chamada(ctx, a, 0);
+            if (topo(a, 0)->n != TIPO_VOID) gera_instr_mepa(&ctx->ger, NULL, "DMEM", "1", NULL);
+            a->n_valores--;
+            break;
+
+        // Expressões
+        case ACAO_OPERADOR:
+            empilhar_valor(ctx, a)->n = ctx->lookahead.atomo;
+            break;
+        case ACAO_COMPARAR:
+        case ACAO_SOMAR:
+        case ACAO_MULTIPLICAR:
+            operar(ctx, a);
+            break;
+        case ACAO_POSITIVO:
+            empilhar_valor(ctx, a)->n = 0;
+            break;
+        case ACAO_NEGATIVO:
+            empilhar_valor(ctx, a)->n = 1;
+            break;
+        case ACAO_APLICAR_SINAL:
+            aplicar_sinal(ctx, a);
+            break;
+        case ACAO_CONSTANTE:
+            gera_instr_mepa(&ctx->ger, NULL, "CRCT", ctx->lookahead.lexema, NULL);
+            empilhar_valor(ctx, a)->n = ctx->lookahead.atomo == sNUM_INT ? TIPO_INT : TIPO_FLOAT;
+            break;
+        case ACAO_APROFUNDAR:
+            aprofundar_exp(ctx);
+            break;
+        case ACAO_VOLTAR:
+            ctx->prof_exp--;
+            break;
+        case ACAO_NEGAR:
+            negar(ctx, a);
+            break;
+        case ACAO_CARREGAR_VAR:
+            carregar_var(ctx, a);
+            break;
+    }
+}
+
+/*
+ * Laço do analisador
+ */
+
+// Troca o não-terminal pelo lado direito da produção escolhida pelo lookahead
+static void expandir(ContextoCompilacao *ctx, AnalisadorLL1 *a, int nt) {
+    int p = tabela_ll1[nt - LL1_N_ATOMOS][ctx->lookahead.atomo];
+
+    if (p == 0) {
+        p = padrao_ll1[nt - LL1_N_ATOMOS];
+        if (p == 0) {
+            erro_sintatico_msg(ctx, descricao_ll1[nt - LL1_N_ATOMOS], ctx->lookahead.atomo);
+            recuperar(ctx);
+        }
+    }
+
+    int inicio = producao_ll1[p], n = producao_ll1[p + 1] - inicio;
+    reservar(ctx, (void **)&a->pilha, &a->cap_pilha, a->n_pilha, n, sizeof(short));
+    memcpy(&a->pilha[a->n_pilha], &direito_ll1[inicio], n * sizeof(short));
+    a->n_pilha += n;
+}
+
+static void analisar(ContextoCompilacao *ctx, AnalisadorLL1 *a) {
+    while (a->n_pilha > 0) {
+        int s = a->pilha[--a->n_pilha];
+
+        if (s < LL1_N_ATOMOS) verifica(ctx, (TAtomo)s);
+        else if (s < LL1_PRIMEIRO_ACAO) expandir(ctx, a, s);
+        else executar_acao(ctx, a, s);
+    }
+}
+
+int parse_programa_ll1(ContextoCompilacao *ctx) {
+    char base;
+    jmp_buf ponto;
+    int ok = 0;
+    AnalisadorLL1 *a = calloc(1, sizeof(AnalisadorLL1));
+
+    if (a == NULL) {
+        fprintf(ctx->diag, "Erro: falha ao alocar memória para a análise sintática\n");
+        ctx->erros++;
+        return 0;
+    }
+    a->retomar = &ponto;
+    ctx->erros = 0;
+    ctx->recuperar = NULL;
+    ctx->base_pilha = (uintptr_t)&base;
+
+    if (setjmp(ctx->fuga) == 0) {
+        avancar(ctx);
+        reservar(ctx, (void **)&a->pilha, &a->cap_pilha, 0, 1, sizeof(short));
+        a->pilha[a->n_pilha++] = LL1_INICIO;
+
+        // Um erro sintático num ponto de recuperação volta aqui
+        if (setjmp(ponto) != 0) retomar(ctx, a);
+        analisar(ctx, a);
+        ok = ctx->erros == 0;
+    }
+
+    if (EST_ATIVO(ctx->est)) {
+        long bytes = (long)a->cap_pilha * sizeof(short) +
+                     (long)a->cap_valores * sizeof(ValorLL1) +
+                     (long)a->cap_pontos * sizeof(PontoLL1);
+        if (bytes > ctx->est->pilha_analise) ctx->est->pilha_analise = bytes;
+    }
+    ctx->recuperar = NULL;
+    free(a->pilha);
+    free(a->valores);
+    free(a->pontos);
+    free(a);
+    return ok;
+}
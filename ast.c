@@ -0,0 +1,183 @@
+/*
+ * ast.c - Implementação da arena de nós e do vetor de textos
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "ast.h"
+
+void ast_inicializar(ArvoreAST *t) {
+    memset(t, 0, sizeof(*t));
+}
+
+void ast_liberar(ArvoreAST *t) {
+    free(t->nos);
+    free(t->textos);
+    memset(t, 0, sizeof(*t));
+}
+
+NoId ast_novo(ArvoreAST *t, TipoNo tipo, int linha) {
+    if (t->n == t->cap) {
+        // O índice 0 fica reservado para "nenhum"
+        uint32_t cap = t->cap ? t->cap * 2 : 1024;
+        if (cap <= t->cap) return 0;
+        NoAST *maior = realloc(t->nos, sizeof(NoAST) * cap);
+        if (maior == NULL) return 0;
+        if (t->cap == 0) {
+            memset(&maior[0], 0, sizeof(NoAST));
+            t->n = 1;
+        }
+        t->nos = maior;
+        t->cap = cap;
+    }
+
+    NoId id = t->n++;
+    NoAST *no = &t->nos[id];
+    memset(no, 0, sizeof(*no));
+    no->tipo = (uint8_t)tipo;
+    no->linha = linha;
+    return id;
+}
+
+uint32_t ast_texto(ArvoreAST *t, const char *s) {
+    uint32_t n = (uint32_t)strlen(s) + 1;
+
+    // O deslocamento 0 é o texto vazio
+    uint32_t usado = t->n_textos ? t->n_textos : 1;
+
+    if (t->cap_textos - usado < n || t->cap_textos == 0) {
+        uint32_t cap = t->cap_textos ? t->cap_textos : 4096;
+        while (cap - usado < n) {
+            if (cap > UINT32_MAX / 2) return UINT32_MAX;
+            cap *= 2;
+        }
+        char *maior = realloc(t->textos, cap);
+        if (maior == NULL) return UINT32_MAX;
+        if (t->cap_textos == 0) {
+            maior[0] = '\0';
+            t->n_textos = 1;
+        }
+        t->textos = maior;
+        t->cap_textos = cap;
+    }
+
+    uint32_t desloc = t->n_textos;
+    memcpy(t->textos + desloc, s, n);
+    t->n_textos += n;
+    return desloc;
+}
+
+NoId ast_inicio(const ArvoreAST *t, NoId expr) {
+    // O primeiro nó criado de uma expressão é a folha mais à esquerda (numa
+    // chamada, o AST_RESULTADO)
+    for (;;) {
+        const NoAST *no = &t->nos[expr];
+        if ((no->tipo != AST_UNARIO && no->tipo != AST_BINARIO &&
+             no->tipo != AST_CHAMADA) || no->a == 0) return expr;
+        expr = no->a;
+    }
+}
+
+NoId ast_copiar(ArvoreAST *t, NoId expr) {
+    NoId inicio = ast_inicio(t, expr);
+    NoId *novo = malloc(sizeof(NoId) * (expr - inicio + 1));
+    NoId copia = 0;
+
+    if (novo == NULL) return 0;
+    for (NoId id = inicio; id <= expr; id++) {
+        if (t->nos[id].flags & AST_MORTO) continue;
+        copia = ast_novo(t, AST_NENHUM, 0);
+        if (copia == 0) break;
+        t->nos[copia] = t->nos[id];
+        novo[id - inicio] = copia;
+    }
+
+    // Filhos, chamada e lista de argumentos apontam para dentro do intervalo
+    // (às vezes para a frente): refeitos com o mapa pronto
+    if (copia != 0) {
+        for (NoId id = inicio; id <= expr; id++) {
+            if (t->nos[id].flags & AST_MORTO) continue;
+            NoAST *no = &t->nos[novo[id - inicio]];
+            if (no->a >= inicio && no->a <= expr) no->a = novo[no->a - inicio];
+            if (no->b >= inicio && no->b <= expr) no->b = novo[no->b - inicio];
+            if (no->prox >= inicio && no->prox <= expr) no->prox = novo[no->prox - inicio];
+        }
+    }
+    free(novo);
+    return copia;
+}
+
+static NoId copiar_lista(ArvoreAST *t, NoId id, int *ok) {
+    NoId primeiro = 0, ultimo = 0;
+
+    for (; id != 0 && *ok; id = t->nos[id].prox) {
+        NoId copia = ast_copiar_cmd(t, id);
+        if (copia == 0) *ok = 0;
+        else if (ultimo == 0) primeiro = copia;
+        else t->nos[ultimo].prox = copia;
+        ultimo = copia;
+    }
+    return primeiro;
+}
+
+NoId ast_copiar_cmd(ArvoreAST *t, NoId cmd) {
+    NoAST no = t->nos[cmd];
+    int ok = 1;
+
+    // Uma chamada usada como comando é a própria expressão
+    if (no.tipo == AST_CHAMADA) {
+        NoId copia = ast_copiar(t, cmd);
+        if (copia != 0) t->nos[copia].prox = 0;
+        return copia;
+    }
+
+    switch (no.tipo) {
+        case AST_ATRIB:
+            no.a = ast_copiar(t, no.a);
+            no.b = no.a != 0 ? ast_copiar(t, no.b) : 0;
+            ok = no.b != 0;
+            break;
+        case AST_LEITURA:
+        case AST_ESCRITA:
+            no.a = ast_copiar(t, no.a);
+            ok = no.a != 0;
+            break;
+        case AST_RETORNO:
+            if (no.a != 0) ok = (no.a = ast_copiar(t, no.a)) != 0;
+            break;
+        case AST_SE:
+            no.a = ast_copiar(t, no.a);
+            no.b = no.a != 0 ? ast_copiar_cmd(t, no.b) : 0;
+            ok = no.b != 0;
+            if (ok && no.c != 0) ok = (no.c = ast_copiar_cmd(t, no.c)) != 0;
+            break;
+        case AST_ENQUANTO:
+            no.a = ast_copiar(t, no.a);
+            no.b = no.a != 0 ? ast_copiar_cmd(t, no.b) : 0;
+            ok = no.b != 0;
+            break;
+        case AST_REPITA:
+            no.a = copiar_lista(t, no.a, &ok);
+            if (ok) ok = (no.b = ast_copiar(t, no.b)) != 0;
+            break;
+        case AST_PARA:
+            if (no.a != 0) ok = (no.a = ast_copiar_cmd(t, no.a)) != 0;
+            if (ok) ok = (no.b = ast_copiar(t, no.b)) != 0;
+            if (ok) ok = (no.c = ast_copiar_cmd(t, no.c)) != 0;
+            if (ok) ok = (no.u.d = ast_copiar_cmd(t, no.u.d)) != 0;
+            break;
+        case AST_BLOCO:
+            no.a = copiar_lista(t, no.a, &ok);
+            break;
+        default:
+            break;
+    }
+    if (!ok) return 0;
+
+    NoId copia = ast_novo(t, no.tipo, no.linha);
+    if (copia != 0) {
+        no.prox = 0;
+        t->nos[copia] = no;
+    }
+    return copia;
+}
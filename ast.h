@@ -0,0 +1,153 @@
+/*
+ * ast.h - Árvore sintática em arena (modo -O1)
+ *
+ * Os nós ficam num vetor contíguo e se referem uns aos outros por índices
+ * de 32 bits (0 = nenhum), não por ponteiros: 32 bytes por nó, sem uma
+ * alocação por nó, e a arena inteira é liberada de uma vez.
+ *
+ * O parser (asdr_ast.c) cria cada nó ao concluí-lo, depois dos filhos. A
+ * ordem da arena é, portanto, uma pós-ordem do programa: a análise
+ * semântica é uma varredura linear dos índices, e o código de uma expressão
+ * é gerado percorrendo o intervalo contíguo que ela ocupa (ver ast_inicio).
+ *
+ * Uso dos campos por tipo de nó:
+ *   AST_PROGRAMA  a = declaração do nome, b = 1ª declaração de variável,
+ *                 c = bloco principal, u.d = 1ª sub-rotina
+ *   AST_DECL      texto = nome, op = tipo (sINT...), dado = categoria;
+ *                 parâmetro: u.endereco = deslocamento no registro de
+ *                 ativação; sub-rotina: a = 1º parâmetro e, após a
+ *                 semântica, u.endereco = número (0 se redeclarada);
+ *                 programa: após a semântica, u.endereco = posições da
+ *                 área de dados (AMEM; ver abaixo)
+ *   AST_SUBROT    a = declaração (CAT_FUNCAO), b = 1ª declaração local,
+ *                 c = corpo; após a semântica, u.endereco = posições locais
+ *   AST_VAR       texto = nome; após a semântica, u.endereco (-1 se não
+ *                 declarada), op = nível e dado = tipo da variável; a
+ *                 alocação (alocador.c) pode trocar o endereço
+ *   AST_RESULTADO texto = nome da sub-rotina chamada, op = 1 numa
+ *                 expressão (0 num comando), a = 1º argumento (b = último,
+ *                 só durante a análise sintática); após a
+ *                 semântica, u.endereco = número da sub-rotina (0 se não
+ *                 declarada) e dado = tipo de retorno (AMEM do resultado)
+ *   AST_ARG       a = expressão, b = AST_RESULTADO da chamada, c = posição
+ *   AST_CHAMADA   a = AST_RESULTADO, c = número de argumentos (CHPR)
+ *   AST_INT/FLOAT texto = lexema da constante
+ *   AST_UNARIO    op = sSUBT (INVR) ou sNAO (NEGA), a = operando
+ *   AST_BINARIO   op = operador, a = esquerdo, b = direito
+ *   AST_ATRIB     a = AST_VAR, b = expressão
+ *   AST_LEITURA   a = AST_VAR
+ *   AST_ESCRITA   a = expressão
+ *   AST_TEXTO     texto = cadeia escrita (write de constante cadeia ou
+ *                 caractere), op = sSTRING ou sCHAR_CONST
+ *   AST_RETORNO   a = expressão (0 se ausente)
+ *   AST_SE        a = condição, b = então, c = senão (0 se ausente)
+ *   AST_ENQUANTO  a = condição, b = corpo
+ *   AST_REPITA    a = 1º comando do corpo, b = condição
+ *   AST_PARA      a = inicialização (0 se movida para antes do laço; ver
+ *                 invariantes.c), b = condição, c = incremento, u.d = corpo
+ *   AST_BLOCO     a = 1º comando
+ * Listas (comandos de um bloco, declarações, sub-rotinas, argumentos) são
+ * encadeadas por prox. Uma chamada ocupa, como as outras expressões, um
+ * intervalo contíguo: AST_RESULTADO, os argumentos (cada um seguido do seu
+ * AST_ARG) e AST_CHAMADA.
+ * linha é a linha em que o modo de uma passada faria a checagem do nó,
+ * para que as mensagens sejam as mesmas nos dois modos.
+ *
+ * Uma área de dados começa com uma posição por variável declarada; as
+ * otimizações que criam temporárias acrescentam posições (a temporária tem
+ * o endereço seguinte) e a alocação (alocador.c) as reduz. Depois das
+ * otimizações, a ordem da arena não é mais a do programa: nós novos ficam
+ * no fim, e só uma expressão continua num intervalo contíguo.
+ */
+
+#ifndef AST_H
+#define AST_H
+
+#include <stdint.h>
+#include "analex.h"
+#include "tabsimb.h"
+
+typedef uint32_t NoId;
+
+typedef enum {
+    AST_NENHUM,
+    AST_PROGRAMA,
+    AST_DECL,
+    AST_VAR,
+    AST_INT,
+    AST_FLOAT,
+    AST_UNARIO,
+    AST_BINARIO,
+    AST_ATRIB,
+    AST_LEITURA,
+    AST_ESCRITA,
+    AST_RETORNO,
+    AST_SE,
+    AST_ENQUANTO,
+    AST_REPITA,
+    AST_PARA,
+    AST_BLOCO,
+    AST_SUBROT,
+    AST_RESULTADO,
+    AST_ARG,
+    AST_CHAMADA,
+    AST_TEXTO
+} TipoNo;
+
+// Marcas (campo flags)
+#define AST_MORTO 0x01          // removido por uma otimização
+#define AST_ALVO  0x02          // AST_VAR que recebe valor (atribuição ou leitura)
+
+typedef struct {
+    uint8_t tipo;               // TipoNo
+    uint8_t op;                 // TAtomo (operador ou tipo declarado)
+    uint8_t dado;               // TipoDado calculado pela semântica
+    uint8_t flags;
+    int32_t linha;
+    NoId a, b, c;               // filhos (ver a tabela acima)
+    union {
+        NoId d;                 // 4º filho (AST_PARA)
+        int32_t endereco;       // AST_VAR resolvida, parâmetro, sub-rotina
+    } u;
+    NoId prox;                  // próximo da lista
+    uint32_t texto;             // deslocamento no vetor de textos
+} NoAST;
+
+typedef struct {
+    NoAST *nos;
+    uint32_t n, cap;
+    char *textos;               // lexemas, terminados em '\0'
+    uint32_t n_textos, cap_textos;
+    NoId raiz;
+} ArvoreAST;
+
+void ast_inicializar(ArvoreAST *t);
+void ast_liberar(ArvoreAST *t);
+
+// Cria um nó (0 se faltar memória); os ponteiros para nós anteriores
+// deixam de valer, pois a arena pode mudar de lugar
+NoId ast_novo(ArvoreAST *t, TipoNo tipo, int linha);
+
+// Guarda um texto e devolve seu deslocamento (UINT32_MAX se faltar memória)
+uint32_t ast_texto(ArvoreAST *t, const char *s);
+
+static inline NoAST* ast_no(const ArvoreAST *t, NoId id) {
+    return &t->nos[id];
+}
+
+static inline const char* ast_lexema(const ArvoreAST *t, const NoAST *no) {
+    return t->textos + no->texto;
+}
+
+// Primeiro índice do intervalo contíguo ocupado por uma expressão
+NoId ast_inicio(const ArvoreAST *t, NoId expr);
+
+// Copia os nós vivos de uma expressão para o fim da arena, num intervalo
+// contíguo novo; retorna a raiz da cópia (0 se faltar memória)
+NoId ast_copiar(ArvoreAST *t, NoId expr);
+
+// Copia um comando, com os comandos e expressões dentro dele; a cópia tem
+// prox = 0 (0 se faltar memória; o que já foi copiado fica solto na arena)
+NoId ast_copiar_cmd(ArvoreAST *t, NoId cmd);
+
+#endif
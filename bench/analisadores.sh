@@ -0,0 +1,67 @@
+#!/bin/sh
+# analisadores.sh - Descida recursiva contra o analisador LL(1)
+#
+# Gera com o lpdgen um programa por forma de entrada (comandos simples,
+# expressões profundas, aninhamento e sub-rotinas), compila cada um com
+# --analisador rd e --analisador ll1 (-O0, --stats=json) e mostra átomos por
+# segundo (pelo tempo total de parede, o melhor de ANALISADORES_REPETICOES)
+# e o pico de pilha do analisador: bytes da pilha de C e das pilhas
+# explícitas. Termina com código 1 se o código MEPA dos dois for diferente.
+#
+# Uso: bench/analisadores.sh   (executar na raiz, após make)
+#   ANALISADORES_TAMANHO      tamanho de cada programa (padrão 16M)
+#   ANALISADORES_REPETICOES   execuções por medida (padrão 3)
+
+LPDC=${LPDC:-./lpdc}
+LPDGEN=${LPDGEN:-./lpdgen}
+TAMANHO=${ANALISADORES_TAMANHO:-16M}
+REPETICOES=${ANALISADORES_REPETICOES:-3}
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+diferente=0
+
+# medir <analisador> <fonte>: "átomos/s c_bytes explicita_bytes"
+medir() {
+    melhor=""
+    k=0
+    while [ "$k" -lt "$REPETICOES" ]; do
+        json=$("$LPDC" --analisador "$1" --stats=json - < "$2" 2>&1 > "$DIR/$1.mepa" | tail -n 1)
+        ms=$(echo "$json" | sed -n 's/.*"total":{"parede_ms":\([0-9.]*\).*/\1/p')
+        if [ -n "$ms" ] && { [ -z "$melhor" ] || awk -v a="$ms" -v b="$melhor" 'BEGIN { exit !(a < b) }'; }; then
+            melhor=$ms
+        fi
+        k=$((k + 1))
+    done
+    atomos=$(echo "$json" | sed -n 's/.*"atomos":\([0-9]*\).*/\1/p')
+    c=$(echo "$json" | sed -n 's/.*"pilha_parser":{"c_bytes":\([0-9]*\).*/\1/p')
+    expl=$(echo "$json" | sed -n 's/.*"pilha_parser":{[^}]*"explicita_bytes":\([0-9]*\).*/\1/p')
+    if [ -z "$melhor" ]; then
+        echo "falhou - -"
+    else
+        awk -v n="$atomos" -v ms="$melhor" -v c="$c" -v e="$expl" \
+            'BEGIN { printf "%.0f %s %s\n", (ms > 0 ? n / (ms / 1000) : 0), c, e }'
+    fi
+}
+
+# comparar <nome> <opções do lpdgen...>
+comparar() {
+    nome=$1; shift
+    "$LPDGEN" -t "$TAMANHO" "$@" -o "$DIR/fonte.lpd" || exit 1
+    set -- $(medir rd "$DIR/fonte.lpd") $(medir ll1 "$DIR/fonte.lpd")
+    printf "%-12s %14s %8s %10s   %14s %8s %10s" "$nome" "$1" "$2" "$3" "$4" "$5" "$6"
+    if cmp -s "$DIR/rd.mepa" "$DIR/ll1.mepa"; then
+        printf "\n"
+    else
+        printf "  [MEPA DIFERENTE]\n"
+        diferente=1
+    fi
+}
+
+printf "%-12s %14s %8s %10s   %14s %8s %10s\n" "" "rd átomos/s" "pilha C" "explícita" \
+       "ll1 átomos/s" "pilha C" "explícita"
+comparar simples
+comparar expressoes -p 24
+comparar aninhado -n 24 -p 3
+comparar subrotinas -r 32 -p 3
+
+exit $diferente
@@ -0,0 +1,110 @@
+#!/bin/sh
+# escala.sh - Tempo de compilação e memória em função do tamanho da entrada
+#
+# Para cada dimensão do lpdgen (variáveis, comandos, profundidade das
+# expressões, aninhamento e tamanho do arquivo), dobra o parâmetro a cada
+# ponto, compila com lpdc --stats=json e grava <dir>/<dimensao>.csv com
+# tempo de parede, CPU e pico de RSS. Entre pontos consecutivos calcula o
+# expoente de crescimento do tempo de CPU contra o tamanho da fonte
+# (log t2/t1 / log b2/b1): perto de 1, o custo por byte é constante; acima
+# de ESCALA_LIMITE (padrão 1.5), ou se o lpdc falhar, a dimensão é marcada e
+# o script termina com código 1. Com gnuplot instalado, gera também os PNGs
+# (tempo e memória contra o parâmetro).
+#
+# Uso: bench/escala.sh [dir]   (executar na raiz, após make)
+#   ESCALA_MAX_MB  tamanho máximo do arquivo na dimensão "tamanho" (padrão 64)
+
+LPDC=${LPDC:-./lpdc}
+LPDGEN=${LPDGEN:-./lpdgen}
+DIR=${1:-escala}
+LIMITE=${ESCALA_LIMITE:-1.5}
+MAX_MB=${ESCALA_MAX_MB:-64}
+
+mkdir -p "$DIR" || exit 1
+# Caminhos absolutos: o lpdc roda dentro de $DIR, onde grava .mepa e .ts
+LPDC=$(cd "$(dirname "$LPDC")" && pwd)/$(basename "$LPDC")
+superlinear=0
+
+# medir <dimensao> <valor> <opções do lpdgen...>: uma linha do CSV
+medir() {
+    dim=$1; valor=$2; shift 2
+    fonte="$DIR/$dim-$valor.lpd"
+
+    "$LPDGEN" "$@" -o "$fonte" || return 1
+    bytes=$(wc -c < "$fonte")
+    json=$( (cd "$DIR" && "$LPDC" --stats=json "$dim-$valor.lpd") 2>&1 >/dev/null | tail -n 1)
+    parede=$(echo "$json" | sed -n 's/.*"total":{"parede_ms":\([0-9.]*\).*/\1/p')
+    cpu=$(echo "$json" | sed -n 's/.*"total":{[^}]*"cpu_ms":\([0-9.]*\).*/\1/p')
+    rss=$(echo "$json" | sed -n 's/.*"pico_rss_kb":\([0-9]*\).*/\1/p')
+
+    # Sem JSON: o compilador falhou (pilha estourada, por exemplo)
+    if [ -z "$parede" ]; then
+        echo "$valor,$bytes,falhou,falhou,falhou" >> "$DIR/$dim.csv"
+        echo "  $dim=$valor: lpdc falhou"
+    else
+        echo "$valor,$bytes,$parede,$cpu,$rss" >> "$DIR/$dim.csv"
+        printf "  %s=%-10s %12s bytes %10s ms %10s KiB\n" "$dim" "$valor" "$bytes" "$parede" "$rss"
+    fi
+    rm -f "$fonte" "$DIR/$dim-$valor.mepa" "$DIR/$dim-$valor.ts"
+}
+
+# varrer <dimensao> <opção> <inicio> <fim> <opções fixas...>
+varrer() {
+    dim=$1; opcao=$2; v=$3; fim=$4; shift 4
+    echo "$dim:"
+    echo "valor,bytes,parede_ms,cpu_ms,pico_rss_kb" > "$DIR/$dim.csv"
+    while [ "$v" -le "$fim" ]; do
+        medir "$dim" "$v" "$@" "$opcao" "$v"
+        v=$((v * 2))
+    done
+    avaliar "$dim"
+}
+
+# Expoente de crescimento do tempo de CPU contra os bytes da fonte
+avaliar() {
+    awk -F, -v limite="$LIMITE" -v dim="$1" '
+        NR > 1 && $4 != "falhou" {
+            if (b0 > 0 && $2 > b0 && $4 > 1 && t0 > 1) {
+                e = log($4 / t0) / log($2 / b0)
+                if (e > pior) pior = e
+            }
+            b0 = $2; t0 = $4
+        }
+        NR > 1 && $4 == "falhou" { falhou = 1 }
+        END {
+            printf "  expoente máximo (cpu): %.2f", pior
+            if (falhou) printf "  [FALHOU em algum ponto]"
+            if (pior > limite) printf "  [SUPERLINEAR]"
+            printf "\n"
+            exit (pior > limite || falhou)
+        }' "$DIR/$1.csv" || superlinear=1
+}
+
+varrer variaveis  -v 1024 131072 -c 2000
+varrer comandos   -c 8192 524288 -v 64
+varrer profundidade -p 16 4096 -c 200
+varrer aninhamento -n 4 1024 -c 50
+varrer tamanho    -t $((4 * 1048576)) $((MAX_MB * 1048576)) -v 64 -n 2
+
+if command -v gnuplot >/dev/null 2>&1; then
+    for csv in "$DIR"/*.csv; do
+        base=${csv%.csv}
+        gnuplot <<EOF
+set datafile separator ","
+set terminal png size 900,500
+set output "$base.png"
+set title "$(basename "$base")"
+set logscale xy
+set xlabel "$(basename "$base")"
+set ylabel "ms"
+set y2label "KiB"
+set y2tics
+set key left top
+plot "$csv" every ::1 using 1:4 with linespoints title "cpu (ms)", \
+     "$csv" every ::1 using 1:5 axes x1y2 with linespoints title "pico RSS (KiB)"
+EOF
+    done
+    echo "gráficos em $DIR/*.png"
+fi
+
+exit $superlinear
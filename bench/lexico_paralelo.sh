@@ -0,0 +1,67 @@
+#!/bin/sh
+# lexico_paralelo.sh - Leitura dos átomos em 1 a N threads
+#
+# Gera com o lpdgen um programa grande e o compila com --lexico-paralelo k
+# (--stats=json), dobrando k de 1 até LEXICO_THREADS. Mostra o tempo de
+# parede da fase léxica (o melhor de LEXICO_REPETICOES), átomos por segundo
+# e a aceleração sobre k = 1, em que todos os átomos são lidos antes do
+# parser numa thread só. Termina com código 1 se o código MEPA de algum k
+# for diferente do de k = 1.
+#
+# Uso: bench/lexico_paralelo.sh   (executar na raiz, após make)
+#   LEXICO_TAMANHO      tamanho do programa (padrão 256M)
+#   LEXICO_THREADS      maior k (padrão: núcleos da máquina)
+#   LEXICO_REPETICOES   execuções por medida (padrão 3)
+
+LPDC=${LPDC:-./lpdc}
+LPDGEN=${LPDGEN:-./lpdgen}
+TAMANHO=${LEXICO_TAMANHO:-256M}
+MAXIMO=${LEXICO_THREADS:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)}
+REPETICOES=${LEXICO_REPETICOES:-3}
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+diferente=0
+
+# Caminhos absolutos: o lpdc roda dentro de $DIR/<k>, onde grava .mepa e .ts
+LPDC=$(cd "$(dirname "$LPDC")" && pwd)/$(basename "$LPDC")
+"$LPDGEN" -t "$TAMANHO" -r 16 -o "$DIR/fonte.lpd" || exit 1
+
+# medir <k>: "ms átomos"
+medir() {
+    mkdir -p "$DIR/$1"
+    melhor=""
+    r=0
+    while [ "$r" -lt "$REPETICOES" ]; do
+        json=$( (cd "$DIR/$1" && "$LPDC" --lexico-paralelo "$1" --stats=json ../fonte.lpd) 2>&1 >/dev/null | tail -n 1)
+        ms=$(echo "$json" | sed -n 's/.*"lexico":{"parede_ms":\([0-9.]*\).*/\1/p')
+        if [ -n "$ms" ] && { [ -z "$melhor" ] || awk -v a="$ms" -v b="$melhor" 'BEGIN { exit !(a < b) }'; }; then
+            melhor=$ms
+        fi
+        r=$((r + 1))
+    done
+    atomos=$(echo "$json" | sed -n 's/.*"atomos":\([0-9]*\).*/\1/p')
+    echo "${melhor:-falhou} ${atomos:-0}"
+}
+
+printf "%10s %14s %16s %12s\n" "threads" "léxico (ms)" "átomos/s" "aceleração"
+base=""
+k=1
+while [ "$k" -le "$MAXIMO" ]; do
+    set -- $(medir "$k")
+    [ -z "$base" ] && base=$1
+    awk -v k="$k" -v ms="$1" -v n="$2" -v b="$base" 'BEGIN {
+        if (ms == "falhou") { printf "%10d %14s\n", k, ms; exit }
+        printf "%10d %14.1f %16.0f %11.2fx\n", k, ms, (ms > 0 ? n / (ms / 1000) : 0), (ms > 0 ? b / ms : 0)
+    }'
+    if [ "$k" -gt 1 ] && ! cmp -s "$DIR/1/fonte.mepa" "$DIR/$k/fonte.mepa"; then
+        echo "           [MEPA DIFERENTE de k = 1]"
+        diferente=1
+    fi
+    if [ "$k" -lt "$MAXIMO" ] && [ $((k * 2)) -gt "$MAXIMO" ]; then
+        k=$MAXIMO
+    else
+        k=$((k * 2))
+    fi
+done
+
+exit $diferente
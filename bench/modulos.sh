@@ -0,0 +1,75 @@
+#!/bin/sh
+# modulos.sh - Declarações globais compartilhadas: no texto contra importadas
+#
+# Para cada tamanho N, gera um módulo com N variáveis globais e grava a
+# interface dele (--interface). Um programa pequeno que usa algumas delas
+# é compilado de dois jeitos: com as N declarações no próprio texto e com
+# --importar. Mostra o tempo de parede do processo lpdc (o melhor de
+# MODULOS_REPETICOES) nos dois casos e o tamanho da interface. Termina com
+# código 1 se a execução dos dois programas no mvm for diferente.
+#
+# Uso: bench/modulos.sh   (executar na raiz, após make)
+#   MODULOS_TAMANHOS     globais por módulo (padrão "1000 4000 16000")
+#   MODULOS_REPETICOES   execuções por medida (padrão 5)
+
+LPDC=${LPDC:-./lpdc}
+MVM=${MVM:-./mvm}
+TAMANHOS=${MODULOS_TAMANHOS:-"1000 4000 16000"}
+REPETICOES=${MODULOS_REPETICOES:-5}
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+diferente=0
+
+# Caminhos absolutos: o lpdc roda dentro de $DIR, onde grava .mepa e .ts
+LPDC=$(cd "$(dirname "$LPDC")" && pwd)/$(basename "$LPDC")
+MVM=$(cd "$(dirname "$MVM")" && pwd)/$(basename "$MVM")
+
+# declaracoes <n>: "int g1, g2, ..., gn;"
+declaracoes() {
+    awk -v n="$1" 'BEGIN {
+        printf "    int g1";
+        for (i = 2; i <= n; i++) printf ", g%d", i;
+        printf ";\n"
+    }'
+}
+
+# corpo <n>: o bloco principal, que usa a primeira e a última global
+corpo() {
+    printf 'begin\n    g1 <- 3;\n    g%d <- 4;\n' "$1"
+    printf '    for (i <- 0; i < 10; i <- i + 1) g1 <- g1 + g%d;\n' "$1"
+    printf '    write(g1);\nend.\n'
+}
+
+# medir <opções e fonte...>: menor tempo de parede em ms
+medir() {
+    melhor=""
+    k=0
+    while [ "$k" -lt "$REPETICOES" ]; do
+        inicio=$(date +%s%N)
+        (cd "$DIR" && "$LPDC" "$@" >/dev/null 2>&1) || { echo "falhou"; return; }
+        ms=$(( ($(date +%s%N) - inicio) / 1000 ))
+        if [ -z "$melhor" ] || [ "$ms" -lt "$melhor" ]; then melhor=$ms; fi
+        k=$((k + 1))
+    done
+    awk -v us="$melhor" 'BEGIN { printf "%.2f\n", us / 1000 }'
+}
+
+printf "%10s %14s %14s %14s\n" "globais" "no texto (ms)" "importadas" "interface (B)"
+for n in $TAMANHOS; do
+    { echo "prg comum;"; echo "var"; declaracoes "$n"; echo "begin"; echo "    g1 <- 0;"; echo "end."; } > "$DIR/comum.lpd"
+    { echo "prg texto;"; echo "var"; declaracoes "$n"; echo "    int i;"; corpo "$n"; } > "$DIR/texto.lpd"
+    { echo "prg importa;"; echo "var"; echo "    int i;"; corpo "$n"; } > "$DIR/importa.lpd"
+    (cd "$DIR" && "$LPDC" --interface comum.lpd >/dev/null) || exit 1
+
+    t=$(medir texto.lpd)
+    m=$(medir --importar comum.lpdi importa.lpd)
+    printf "%10d %14s %14s %14d\n" "$n" "$t" "$m" "$(wc -c < "$DIR/comum.lpdi")"
+    if ! "$MVM" "$DIR/texto.mepa" > "$DIR/texto.saida" 2>&1 ||
+       ! "$MVM" "$DIR/importa.mepa" > "$DIR/importa.saida" 2>&1 ||
+       ! cmp -s "$DIR/texto.saida" "$DIR/importa.saida"; then
+        echo "           [EXECUÇÃO DIFERENTE]"
+        diferente=1
+    fi
+done
+
+exit $diferente
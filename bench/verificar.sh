@@ -0,0 +1,105 @@
+#!/bin/sh
+# verificar.sh - A mesma execução em todas as configurações do compilador
+#
+# Compila os programas de ETAPA1 e de bench/ com -O0 (descida recursiva e
+# LL(1), com e sem --desvios-diretos) e com -O1 em várias combinações de
+# opções, inclusive com o perfil gravado pelo mvm -P. Cada código roda no
+# mvm na forma de pilha e na de registradores (-r), com a mesma entrada, e
+# a saída e o código de saída são comparados com os da referência (-O0,
+# pilha). Um programa que não compila na referência (os testes de erro de
+# ETAPA1) tem de ser recusado em todas as configurações. Termina com
+# código 1 se alguma execução diferir.
+#
+# Uso: bench/verificar.sh   (executar na raiz, após make; é o make check)
+
+LPDC=${LPDC:-./lpdc}
+MVM=${MVM:-./mvm}
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+falhas=0
+execucoes=0
+
+# Caminhos absolutos: o lpdc roda dentro de $DIR, onde grava .mepa e .ts
+LPDC=$(cd "$(dirname "$LPDC")" && pwd)/$(basename "$LPDC")
+MVM=$(cd "$(dirname "$MVM")" && pwd)/$(basename "$MVM")
+
+# Configurações comparadas com a referência; "perfil" é o -O1 com o perfil
+# dos desvios do próprio programa
+CONFIGURACOES="-O0
+-O0 --analisador ll1
+-O0 --desvios-diretos
+-O1
+-O1 --desenrolar 0 --expandir 0
+-O1 --desenrolar 8 --expandir 1000
+-O1 --threads-geracao 3
+-O1 --desvios-diretos
+perfil"
+
+# Entrada de todos os programas (os que lêem pegam os primeiros valores)
+seq 1 20 > "$DIR/entrada"
+
+# Os nomes de ETAPA1 têm espaços: cada fonte vira $DIR/p<k>.lpd
+k=0
+for f in ETAPA1/*.lpd* bench/*.lpd; do
+    k=$((k + 1))
+    cp "$f" "$DIR/p$k.lpd"
+    echo "$f" > "$DIR/p$k.nome"
+done
+
+# compilar <programa> <opções...>: código de saída do lpdc
+compilar() {
+    p=$1
+    shift
+    (cd "$DIR" && "$LPDC" "$@" "$p.lpd" > /dev/null 2>&1)
+}
+
+# executar <programa> <saída> [-r]: saída padrão e código de saída do mvm
+executar() {
+    "$MVM" $3 "$DIR/$1.mepa" "$DIR/entrada" > "$2" 2> /dev/null
+    echo "código $?" >> "$2"
+}
+
+i=1
+while [ "$i" -le "$k" ]; do
+    p=p$i
+    nome=$(cat "$DIR/$p.nome")
+    i=$((i + 1))
+
+    compilar "$p" -O0
+    esperado=$?
+    [ "$esperado" -eq 0 ] && executar "$p" "$DIR/referencia"
+
+    antigo_ifs=$IFS
+    IFS='
+'
+    for config in $CONFIGURACOES; do
+        IFS=$antigo_ifs
+        if [ "$config" = perfil ]; then
+            compilar "$p" -O1 && [ "$esperado" -eq 0 ] &&
+                "$MVM" -P "$DIR/$p.perfil" "$DIR/$p.mepa" "$DIR/entrada" > /dev/null 2>&1
+            compilar "$p" -O1 --perfil "$DIR/$p.perfil"
+        else
+            compilar "$p" $config
+        fi
+        situacao=$?
+        if [ "$situacao" -ne "$esperado" ]; then
+            echo "$nome ($config): lpdc terminou com $situacao, -O0 com $esperado"
+            falhas=$((falhas + 1))
+        elif [ "$esperado" -eq 0 ]; then
+            for forma in "" -r; do
+                executar "$p" "$DIR/saida" $forma
+                execucoes=$((execucoes + 1))
+                if ! cmp -s "$DIR/referencia" "$DIR/saida"; then
+                    echo "$nome ($config${forma:+, mvm $forma}): execução diferente da de -O0"
+                    falhas=$((falhas + 1))
+                fi
+            done
+        fi
+        IFS='
+'
+    done
+    IFS=$antigo_ifs
+done
+
+echo "$k programas, $execucoes execuções comparadas, $falhas diferença(s)"
+[ "$falhas" -eq 0 ]
@@ -0,0 +1,424 @@
+/*
+ * cache.c - Implementação do cache de compilação
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+#include "cache.h"
+
+#define ARQ_ESTATISTICAS "estatisticas"
+
+// ---------------------------------------------------------------------------
+// Hash de 128 bits (duas faixas de 64 bits, 8 bytes por passo)
+// ---------------------------------------------------------------------------
+
+static uint64_t misturar(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static void hash_bytes(uint64_t h[2], const void *dados, size_t n) {
+    const unsigned char *p = dados;
+    uint64_t a = h[0], b = h[1];
+
+    for (; n >= 8; n -= 8, p += 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        a = rotl(a ^ (w * 0x87c37b91114253d5ULL), 31) * 0x4cf5ad432745937fULL;
+        b = rotl(b + w, 27) * 0x9e3779b97f4a7c15ULL + a;
+    }
+    if (n > 0) {
+        uint64_t w = 0;
+        memcpy(&w, p, n);
+        a = rotl(a ^ (w * 0x87c37b91114253d5ULL), 31) * 0x4cf5ad432745937fULL;
+        b = rotl(b + w, 27) * 0x9e3779b97f4a7c15ULL + a;
+    }
+    h[0] = a;
+    h[1] = b;
+}
+
+void cache_chave(const char *dados, size_t n, const char *opcoes,
+                 char chave[CACHE_TAM_CHAVE]) {
+    uint64_t h[2] = { 0x243f6a8885a308d3ULL, 0x13198a2e03707344ULL };
+    uint64_t tam = n;
+
+    // Os campos são separados pelos seus tamanhos, sem ambiguidade
+    hash_bytes(h, CACHE_VERSAO, sizeof(CACHE_VERSAO));
+    hash_bytes(h, opcoes, strlen(opcoes) + 1);
+    hash_bytes(h, &tam, sizeof(tam));
+    hash_bytes(h, dados, n);
+
+    uint64_t a = misturar(h[0] ^ tam), b = misturar(h[1] + h[0]);
+    snprintf(chave, CACHE_TAM_CHAVE, "%016llx%016llx",
+             (unsigned long long)a, (unsigned long long)b);
+}
+
+// ---------------------------------------------------------------------------
+// Arquivos
+// ---------------------------------------------------------------------------
+
+static void caminho_entrada(const Cache *c, const char *chave, const char *ext,
+                            char *buf, size_t tam) {
+    snprintf(buf, tam, "%s/%.2s/%s.%s", c->dir, chave, chave, ext);
+}
+
+// Copia o conteúdo de origem para destino (clonagem, se houver suporte)
+static int copiar(int origem, int destino) {
+    char buf[65536];
+    ssize_t k;
+
+#ifdef FICLONE
+    if (ioctl(destino, FICLONE, origem) == 0) return 1;
+#endif
+    while ((k = read(origem, buf, sizeof(buf))) != 0) {
+        if (k < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        for (ssize_t feito = 0; feito < k; ) {
+            ssize_t w = write(destino, buf + feito, k - feito);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                return 0;
+            }
+            feito += w;
+        }
+    }
+    return 1;
+}
+
+static int copiar_para(int origem, const char *destino) {
+    int fd = open(destino, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return 0;
+    int ok = copiar(origem, fd);
+    return close(fd) == 0 && ok;
+}
+
+// ---------------------------------------------------------------------------
+// Estatísticas persistentes e remoção LRU
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    long long acertos;
+    long long falhas;
+    long long insercoes;
+    long long remocoes;
+    long long bytes;
+} Estatisticas;
+
+static void ler_estatisticas(int fd, Estatisticas *e) {
+    char buf[512];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+
+    memset(e, 0, sizeof(*e));
+    if (n <= 0) return;
+    buf[n] = '\0';
+    sscanf(buf, "acertos %lld falhas %lld insercoes %lld remocoes %lld bytes %lld",
+           &e->acertos, &e->falhas, &e->insercoes, &e->remocoes, &e->bytes);
+}
+
+static void escrever_estatisticas(int fd, const Estatisticas *e) {
+    char buf[512];
+    int n = snprintf(buf, sizeof(buf),
+                     "acertos %lld\nfalhas %lld\ninsercoes %lld\nremocoes %lld\nbytes %lld\n",
+                     e->acertos, e->falhas, e->insercoes, e->remocoes, e->bytes);
+    if (ftruncate(fd, 0) == 0 && pwrite(fd, buf, n, 0) != n) {
+        // Contadores perdidos não afetam a corretude do cache
+    }
+}
+
+static int travar(int fd, short tipo) {
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = tipo;
+    fl.l_whence = SEEK_SET;
+    while (fcntl(fd, F_SETLKW, &fl) < 0) {
+        if (errno != EINTR) return 0;
+    }
+    return 1;
+}
+
+typedef struct {
+    char nome[48];              // "xx/<chave>.<ext>"
+    struct timespec uso;
+    long long tam;
+} Arquivo;
+
+static int comparar_uso(const void *a, const void *b) {
+    const Arquivo *x = a, *y = b;
+    if (x->uso.tv_sec != y->uso.tv_sec) return x->uso.tv_sec < y->uso.tv_sec ? -1 : 1;
+    if (x->uso.tv_nsec != y->uso.tv_nsec) return x->uso.tv_nsec < y->uso.tv_nsec ? -1 : 1;
+    return 0;
+}
+
+// Lista as entradas do cache. Retorna o número de arquivos (-1 se faltou memória).
+static int listar(const char *dir, Arquivo **lista, long long *total) {
+    int n = 0, cap = 256;
+    char caminho[PATH_MAX];
+
+    *total = 0;
+    *lista = malloc(sizeof(Arquivo) * cap);
+    if (*lista == NULL) return -1;
+
+    for (int k = 0; k < 256; k++) {
+        char sub[3];
+        snprintf(sub, sizeof(sub), "%02x", k);
+        snprintf(caminho, sizeof(caminho), "%s/%s", dir, sub);
+        DIR *d = opendir(caminho);
+        if (d == NULL) continue;
+
+        struct dirent *ent;
+        while ((ent = readdir(d)) != NULL) {
+            struct stat st;
+            // Arquivos começados por '.' são temporários de uma gravação
+            if (ent->d_name[0] == '.' || strlen(ent->d_name) >= sizeof((*lista)->nome) - 3) continue;
+            snprintf(caminho, sizeof(caminho), "%s/%s/%s", dir, sub, ent->d_name);
+            if (stat(caminho, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+            if (n == cap) {
+                Arquivo *v = realloc(*lista, sizeof(Arquivo) * cap * 2);
+                if (v == NULL) {
+                    closedir(d);
+                    return -1;
+                }
+                *lista = v;
+                cap *= 2;
+            }
+            char *nome = (*lista)[n].nome;
+            memcpy(nome, sub, 2);
+            nome[2] = '/';
+            strcpy(nome + 3, ent->d_name);
+            (*lista)[n].uso = st.st_mtim;
+            (*lista)[n].tam = st.st_size;
+            *total += st.st_size;
+            n++;
+        }
+        closedir(d);
+    }
+    return n;
+}
+
+// Remove as entradas menos usadas até o cache ocupar no máximo alvo bytes.
+// Retorna o novo total.
+static long long despejar(const Cache *c, long long alvo, long *removidos) {
+    Arquivo *lista;
+    long long total;
+    char caminho[PATH_MAX];
+    int n = listar(c->dir, &lista, &total);
+
+    if (n < 0) {
+        free(lista);
+        return total;
+    }
+    qsort(lista, n, sizeof(Arquivo), comparar_uso);
+    for (int k = 0; k < n && total > alvo; k++) {
+        snprintf(caminho, sizeof(caminho), "%s/%s", c->dir, lista[k].nome);
+        // Outra invocação pode ter removido antes: ENOENT não é erro
+        if (unlink(caminho) == 0 || errno == ENOENT) {
+            total -= lista[k].tam;
+            (*removidos)++;
+        }
+    }
+    free(lista);
+    return total;
+}
+
+// Soma os contadores desta execução ao arquivo de estatísticas e, se o
+// limite foi ultrapassado, remove entradas. Chamar com c->trava obtida.
+static void sincronizar(Cache *c) {
+    char caminho[PATH_MAX];
+    Estatisticas e;
+
+    snprintf(caminho, sizeof(caminho), "%s/%s", c->dir, ARQ_ESTATISTICAS);
+    int fd = open(caminho, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return;
+    if (!travar(fd, F_WRLCK)) {
+        close(fd);
+        return;
+    }
+
+    ler_estatisticas(fd, &e);
+    e.acertos += c->acertos;
+    e.falhas += c->falhas;
+    e.insercoes += c->insercoes;
+    e.remocoes += c->remocoes;
+    e.bytes += c->bytes_inseridos;
+
+    if (e.bytes > c->max_bytes) {
+        long removidos = 0;
+        e.bytes = despejar(c, c->max_bytes / 10 * 9, &removidos);
+        e.remocoes += removidos;
+    }
+    escrever_estatisticas(fd, &e);
+    close(fd);              // libera a trava
+
+    c->acertos = c->falhas = c->insercoes = c->remocoes = 0;
+    c->bytes_inseridos = 0;
+    c->bytes_base = e.bytes;
+}
+
+// ---------------------------------------------------------------------------
+// Interface
+// ---------------------------------------------------------------------------
+
+int cache_abrir(Cache *c, const char *dir, long long max_bytes) {
+    char caminho[PATH_MAX];
+    Estatisticas e;
+
+    memset(c, 0, sizeof(*c));
+    if (strlen(dir) >= sizeof(c->dir)) return 0;
+    strcpy(c->dir, dir);
+    c->max_bytes = max_bytes;
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) return 0;
+
+    snprintf(caminho, sizeof(caminho), "%s/%s", dir, ARQ_ESTATISTICAS);
+    int fd = open(caminho, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return 0;
+    if (travar(fd, F_RDLCK)) {
+        ler_estatisticas(fd, &e);
+        c->bytes_base = e.bytes;
+    }
+    close(fd);
+
+    pthread_mutex_init(&c->trava, NULL);
+    return 1;
+}
+
+void cache_fechar(Cache *c) {
+    pthread_mutex_lock(&c->trava);
+    sincronizar(c);
+    pthread_mutex_unlock(&c->trava);
+    pthread_mutex_destroy(&c->trava);
+}
+
+int cache_buscar(Cache *c, const char *chave, const char *nome_base) {
+    char origem[PATH_MAX], destino[PATH_MAX];
+    int fd_ts, fd_mepa, ok = 0;
+
+    caminho_entrada(c, chave, "mepa", origem, sizeof(origem));
+    fd_mepa = open(origem, O_RDONLY);
+    caminho_entrada(c, chave, "ts", origem, sizeof(origem));
+    fd_ts = open(origem, O_RDONLY);
+
+    if (fd_mepa >= 0 && fd_ts >= 0) {
+        snprintf(destino, sizeof(destino), "%s.mepa", nome_base);
+        ok = copiar_para(fd_mepa, destino);
+        snprintf(destino, sizeof(destino), "%s.ts", nome_base);
+        ok = ok && copiar_para(fd_ts, destino);
+
+        // Marca o uso das duas metades da entrada (LRU)
+        futimens(fd_mepa, NULL);
+        futimens(fd_ts, NULL);
+    }
+    if (fd_mepa >= 0) close(fd_mepa);
+    if (fd_ts >= 0) close(fd_ts);
+
+    pthread_mutex_lock(&c->trava);
+    if (ok) c->acertos++;
+    else c->falhas++;
+    pthread_mutex_unlock(&c->trava);
+    return ok;
+}
+
+// Copia um arquivo para dentro do cache (temporário + rename)
+static long long guardar_arquivo(Cache *c, const char *chave, const char *ext,
+                                 const char *nome_base) {
+    char origem[PATH_MAX], final[PATH_MAX], temp[PATH_MAX];
+    struct stat st;
+    long long tam = -1;
+
+    snprintf(origem, sizeof(origem), "%s.%s", nome_base, ext);
+    int fd_origem = open(origem, O_RDONLY);
+    if (fd_origem < 0) return -1;
+
+    snprintf(temp, sizeof(temp), "%s/%.2s/.%sXXXXXX", c->dir, chave, ext);
+    int fd = mkstemp(temp);
+    if (fd >= 0) {
+        if (copiar(fd_origem, fd) && fchmod(fd, 0644) == 0 && fstat(fd, &st) == 0) {
+            tam = st.st_size;
+        }
+        if (close(fd) != 0) tam = -1;
+
+        caminho_entrada(c, chave, ext, final, sizeof(final));
+        if (tam < 0 || rename(temp, final) != 0) {
+            unlink(temp);
+            tam = -1;
+        }
+    }
+    close(fd_origem);
+    return tam;
+}
+
+int cache_guardar(Cache *c, const char *chave, const char *nome_base) {
+    char sub[PATH_MAX];
+    long long tam_ts, tam_mepa;
+
+    snprintf(sub, sizeof(sub), "%s/%.2s", c->dir, chave);
+    if (mkdir(sub, 0755) != 0 && errno != EEXIST) return 0;
+
+    // O .mepa por último: a entrada só fica visível quando completa
+    tam_ts = guardar_arquivo(c, chave, "ts", nome_base);
+    if (tam_ts < 0) return 0;
+    tam_mepa = guardar_arquivo(c, chave, "mepa", nome_base);
+    if (tam_mepa < 0) return 0;
+
+    pthread_mutex_lock(&c->trava);
+    c->insercoes++;
+    c->bytes_inseridos += tam_ts + tam_mepa;
+    if (c->bytes_base + c->bytes_inseridos > c->max_bytes) sincronizar(c);
+    pthread_mutex_unlock(&c->trava);
+    return 1;
+}
+
+int cache_relatorio(const char *dir, FILE *saida) {
+    char caminho[PATH_MAX];
+    Estatisticas e;
+    Arquivo *lista;
+    long long total;
+
+    snprintf(caminho, sizeof(caminho), "%s/%s", dir, ARQ_ESTATISTICAS);
+    int fd = open(caminho, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Erro: cache vazio ou inexistente em '%s'\n", dir);
+        return 0;
+    }
+    if (travar(fd, F_RDLCK)) ler_estatisticas(fd, &e);
+    else memset(&e, 0, sizeof(e));
+    close(fd);
+
+    int n = listar(dir, &lista, &total);
+    free(lista);
+
+    long long consultas = e.acertos + e.falhas;
+    fprintf(saida, "Cache de compilação em '%s':\n", dir);
+    fprintf(saida, "  acertos:   %lld\n", e.acertos);
+    fprintf(saida, "  falhas:    %lld\n", e.falhas);
+    fprintf(saida, "  taxa:      %.1f%%\n", consultas ? 100.0 * e.acertos / consultas : 0.0);
+    fprintf(saida, "  inserções: %lld\n", e.insercoes);
+    fprintf(saida, "  remoções:  %lld\n", e.remocoes);
+    fprintf(saida, "  entradas:  %d\n", n > 0 ? n / 2 : 0);
+    fprintf(saida, "  tamanho:   %.1f KiB\n", total / 1024.0);
+    return 1;
+}
@@ -0,0 +1,72 @@
+/*
+ * cache.h - Cache de compilação endereçado por conteúdo
+ *
+ * A chave de uma compilação é um hash de 128 bits dos bytes da fonte, da
+ * versão do compilador e das opções que afetam a saída. Cada entrada são
+ * dois arquivos, <dir>/<xx>/<chave>.mepa e .ts, gravados por rename atômico
+ * (o .ts antes do .mepa: só conta como acerto se os dois existirem).
+ *
+ * Num acerto, os arquivos são clonados (reflink) para <base>.mepa/.ts ou,
+ * se o sistema de arquivos não suportar, copiados de uma vez. Não se usa
+ * link físico: uma compilação posterior reabre <base>.mepa com "w" e
+ * truncaria a própria entrada do cache.
+ *
+ * O uso é marcado pela data de modificação das entradas (LRU). Quando o
+ * tamanho total passa do limite, as entradas mais antigas são removidas.
+ * Os contadores persistentes ficam em <dir>/estatisticas, protegidos por
+ * trava de arquivo (fcntl): várias invocações podem usar o mesmo cache.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <limits.h>
+#include <pthread.h>
+
+// Versão da saída do compilador: mudar invalida todas as entradas. O
+// Makefile a define com a soma das fontes do compilador (-DCACHE_VERSAO),
+// de modo que qualquer mudança no código descarta o que foi gravado antes;
+// o valor abaixo só vale para quem compila sem o Makefile
+#ifndef CACHE_VERSAO
+#define CACHE_VERSAO "lpdc-3"
+#endif
+
+// Variáveis de ambiente e limite padrão de tamanho (MiB)
+#define CACHE_VAR_DIR "LPDC_CACHE"
+#define CACHE_VAR_MAX "LPDC_CACHE_MAX"
+#define CACHE_MAX_PADRAO 256
+
+#define CACHE_TAM_CHAVE 33      // 32 dígitos hexadecimais + '\0'
+
+typedef struct {
+    char dir[PATH_MAX - 64];     // folga para "/xx/<chave>.mepa"
+    long long max_bytes;
+
+    // Contadores desta execução (somados ao arquivo de estatísticas no fim)
+    pthread_mutex_t trava;
+    long acertos;
+    long falhas;
+    long insercoes;
+    long remocoes;
+    long long bytes_inseridos;
+    long long bytes_base;       // total do cache ao abrir
+} Cache;
+
+int cache_abrir(Cache *c, const char *dir, long long max_bytes);
+void cache_fechar(Cache *c);
+
+void cache_chave(const char *dados, size_t n, const char *opcoes,
+                 char chave[CACHE_TAM_CHAVE]);
+
+// Materializa <nome_base>.mepa e .ts a partir do cache (1 se acertou)
+int cache_buscar(Cache *c, const char *chave, const char *nome_base);
+
+// Guarda <nome_base>.mepa e .ts recém-gerados sob a chave
+int cache_guardar(Cache *c, const char *chave, const char *nome_base);
+
+// Imprime os contadores persistentes do cache em dir
+int cache_relatorio(const char *dir, FILE *saida);
+
+#endif
@@ -0,0 +1,343 @@
+/*
+ * cliente.c - Cliente do servidor de compilação (lpdcc)
+ *
+ * Substitui o lpdc na linha de comando: recebe as mesmas opções e arquivos,
+ * pede a compilação ao servidor (lpdc -S) e grava <base>.mepa e <base>.ts
+ * no diretório atual, com as mesmas mensagens e o mesmo código de saída.
+ * As opções de compilação vão no pedido (ver proto_opcao); com "-", a fonte
+ * vem da entrada padrão e o código MEPA vai para a saída padrão, como no
+ * lpdc. Sem servidor no ar, com um servidor de outro usuário ou com uma
+ * opção que o servidor não aceita, executa o próprio lpdc.
+ *
+ * Uso: lpdcc [-s socket] [-B N] [opções do lpdc] <arquivo.lpd> [arquivo.lpd ...]
+ *      lpdcc [-s socket] [opções do lpdc] [--ts-fd N] -
+ *   -B N  mede a latência de N pedidos ao servidor contra N fork/exec do lpdc
+ */
+
+#define _GNU_SOURCE             // struct ucred (SO_PEERCRED)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "protocolo.h"
+
+static char caminho_lpdc[PATH_MAX];
+
+// Opções do lpdc da linha de comando, como vieram (para executar o lpdc) e
+// como vão no pedido (palavras terminadas por '\0', caminhos absolutos)
+static char **opcoes;
+static int n_opcoes;
+static char *bloco_opcoes;
+static uint32_t tam_opcoes;
+
+static double agora() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// O lpdc é procurado ao lado do lpdcc; senão, no PATH
+static void localizar_lpdc(const char *argv0) {
+    const char *barra = strrchr(argv0, '/');
+    if (barra == NULL) {
+        strcpy(caminho_lpdc, "lpdc");
+    } else {
+        snprintf(caminho_lpdc, sizeof(caminho_lpdc), "%.*s/lpdc",
+                 (int)(barra - argv0), argv0);
+    }
+}
+
+static int conectar(const char *caminho) {
+    struct sockaddr_un end;
+    int fd;
+
+    if (strlen(caminho) >= sizeof(end.sun_path)) return -1;
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    memset(&end, 0, sizeof(end));
+    end.sun_family = AF_UNIX;
+    strcpy(end.sun_path, caminho);
+    if (connect(fd, (struct sockaddr*)&end, sizeof(end)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    // Só um servidor do próprio usuário: os arquivos gerados vêm dele
+    struct ucred cred;
+    socklen_t tam = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &tam) != 0 || cred.uid != getuid()) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Acrescenta uma palavra ao bloco de opções do pedido
+static int acrescentar_opcao(const char *palavra) {
+    size_t n = strlen(palavra) + 1;
+    char *novo = realloc(bloco_opcoes, tam_opcoes + n);
+    if (novo == NULL) return 0;
+    memcpy(novo + tam_opcoes, palavra, n);
+    bloco_opcoes = novo;
+    tam_opcoes += (uint32_t)n;
+    return 1;
+}
+
+static int gravar_arquivo(const char *caminho, const Bloco *b) {
+    FILE *f = fopen(caminho, "w");
+    if (f == NULL) {
+        fprintf(stderr, "Erro: não foi possível criar arquivo %s\n", caminho);
+        return 0;
+    }
+    int ok = fwrite(b->dados, 1, b->tam, f) == b->tam;
+    return fclose(f) == 0 && ok;
+}
+
+// Envia um pedido e recebe a resposta. resp[] recebe saída, erros, .mepa e
+// .ts. Retorna a situação (PROTO_*) ou -1 se a conexão falhou.
+static int enviar(int fd, char tipo, const char *nome, const char *conteudo, uint32_t tam,
+                  Bloco resp[4]) {
+    unsigned char situacao;
+
+    if (!proto_escrever(fd, &tipo, 1)) return -1;
+    if (!proto_enviar_bloco(fd, bloco_opcoes, tam_opcoes)) return -1;
+    if (!proto_enviar_bloco(fd, nome, (uint32_t)strlen(nome))) return -1;
+    if (!proto_enviar_bloco(fd, conteudo, tam)) return -1;
+
+    if (proto_ler(fd, &situacao, 1) != 1) return -1;
+    for (int k = 0; k < 4; k++) {
+        if (!proto_receber_bloco(fd, &resp[k])) return -1;
+    }
+    return situacao;
+}
+
+static int pedir(int fd, const char *arquivo, Bloco resp[4]) {
+    char absoluto[PATH_MAX];
+    const char *caminho = realpath(arquivo, absoluto) ? absoluto : arquivo;
+    return enviar(fd, PROTO_CAMINHO, arquivo, caminho, (uint32_t)strlen(caminho), resp);
+}
+
+// Compila um arquivo pelo servidor, reproduzindo o comportamento do lpdc
+static int compilar(int fd, const char *arquivo, Bloco resp[4]) {
+    int situacao = pedir(fd, arquivo, resp);
+    if (situacao < 0) {
+        fprintf(stderr, "Erro: conexão com o servidor perdida\n");
+        return 0;
+    }
+
+    fwrite(resp[0].dados, 1, resp[0].tam, stdout);
+    fwrite(resp[1].dados, 1, resp[1].tam, stderr);
+    if (situacao == PROTO_FALHA) return 0;
+
+    // Mesmo nome base que o lpdc usaria
+    char base[256], caminho[300];
+    const char *barra = strrchr(arquivo, '/');
+    snprintf(base, sizeof(base), "%s", barra ? barra + 1 : arquivo);
+    char *ponto = strrchr(base, '.');
+    if (ponto) *ponto = '\0';
+
+    snprintf(caminho, sizeof(caminho), "%s.mepa", base);
+    if (!gravar_arquivo(caminho, &resp[2])) return 0;
+    snprintf(caminho, sizeof(caminho), "%s.ts", base);
+    if (!gravar_arquivo(caminho, &resp[3])) return 0;
+
+    return situacao == PROTO_OK;
+}
+
+// Modo fluxo pelo servidor: a fonte toda da entrada padrão vai no pedido
+static int compilar_entrada(int fd, int fd_ts, Bloco resp[4]) {
+    size_t cap = 65536, tam = 0;
+    char *texto = malloc(cap);
+
+    while (texto != NULL) {
+        tam += fread(texto + tam, 1, cap - tam, stdin);
+        if (tam < cap || cap > PROTO_MAX_BLOCO) break;
+        char *maior = realloc(texto, cap * 2);
+        if (maior == NULL) free(texto);
+        texto = maior;
+        cap *= 2;
+    }
+    if (texto == NULL || ferror(stdin) || tam > PROTO_MAX_BLOCO) {
+        fprintf(stderr, "Erro: não foi possível ler a entrada padrão\n");
+        free(texto);
+        return 0;
+    }
+
+    int situacao = enviar(fd, PROTO_TEXTO, "<stdin>", texto, (uint32_t)tam, resp);
+    free(texto);
+    if (situacao < 0) {
+        fprintf(stderr, "Erro: conexão com o servidor perdida\n");
+        return 0;
+    }
+
+    // Como no lpdc -: mensagens na saída de erros
+    fwrite(resp[0].dados, 1, resp[0].tam, stderr);
+    fwrite(resp[1].dados, 1, resp[1].tam, stderr);
+    if (situacao == PROTO_FALHA) return 0;
+
+    int ok = fwrite(resp[2].dados, 1, resp[2].tam, stdout) == resp[2].tam;
+    if (fflush(stdout) != 0) ok = 0;
+    if (fd_ts >= 0 && !proto_escrever(fd_ts, resp[3].dados, resp[3].tam)) ok = 0;
+    return ok && situacao == PROTO_OK;
+}
+
+// Sem servidor: o próprio lpdc faz o trabalho, com as opções dele e os
+// argumentos que restam
+static int executar_lpdc(char **resto, int n) {
+    char **args = malloc(sizeof(char*) * (n_opcoes + n + 2));
+    if (args == NULL) return 1;
+    args[0] = caminho_lpdc;
+    for (int k = 0; k < n_opcoes; k++) args[k + 1] = opcoes[k];
+    for (int k = 0; k < n; k++) args[n_opcoes + k + 1] = resto[k];
+    args[n_opcoes + n + 1] = NULL;
+    execvp(caminho_lpdc, args);
+    fprintf(stderr, "Erro: servidor indisponível e não foi possível executar '%s'\n",
+            caminho_lpdc);
+    free(args);
+    return 1;
+}
+
+// Um fork/exec do lpdc com a saída descartada (linha de base da medição)
+static int fork_exec_lpdc(char *arquivo) {
+    pid_t pid = fork();
+    if (pid < 0) return 0;
+    if (pid == 0) {
+        int nulo = open("/dev/null", O_WRONLY);
+        if (nulo >= 0) {
+            dup2(nulo, STDOUT_FILENO);
+            dup2(nulo, STDERR_FILENO);
+        }
+        executar_lpdc(&arquivo, 1);
+        _exit(127);
+    }
+    int status;
+    if (waitpid(pid, &status, 0) < 0) return 0;
+    return WIFEXITED(status) && WEXITSTATUS(status) != 127;
+}
+
+static void medir(const char *sock, char *arquivo, int n) {
+    Bloco resp[4];
+    double t0, t_con, t_nova, t_exec;
+    int fd;
+
+    memset(resp, 0, sizeof(resp));
+    fd = conectar(sock);
+    if (fd < 0) {
+        fprintf(stderr, "Erro: servidor indisponível em '%s'\n", sock);
+        return;
+    }
+
+    // Aquecimento (cache de páginas, tabelas do servidor)
+    pedir(fd, arquivo, resp);
+
+    t0 = agora();
+    for (int k = 0; k < n; k++) pedir(fd, arquivo, resp);
+    t_con = (agora() - t0) / n;
+    close(fd);
+
+    t0 = agora();
+    for (int k = 0; k < n; k++) {
+        fd = conectar(sock);
+        if (fd < 0) break;
+        pedir(fd, arquivo, resp);
+        close(fd);
+    }
+    t_nova = (agora() - t0) / n;
+
+    t0 = agora();
+    for (int k = 0; k < n; k++) {
+        if (!fork_exec_lpdc(arquivo)) {
+            fprintf(stderr, "Erro: não foi possível executar '%s'\n", caminho_lpdc);
+            break;
+        }
+    }
+    t_exec = (agora() - t0) / n;
+
+    printf("Latência por pedido (%d pedidos, '%s'):\n", n, arquivo);
+    printf("  fork/exec lpdc         %10.1f us\n", t_exec * 1e6);
+    printf("  servidor, nova conexão %10.1f us  (%.1fx)\n", t_nova * 1e6, t_exec / t_nova);
+    printf("  servidor, mesma conexão%10.1f us  (%.1fx)\n", t_con * 1e6, t_exec / t_con);
+
+    for (int k = 0; k < 4; k++) proto_liberar_bloco(&resp[k]);
+}
+
+int main(int argc, char *argv[]) {
+    const char *sock = NULL;
+    int medicoes = 0;
+    int fd_ts = -1;
+    int outra = 0;                  // opção que só o lpdc aceita
+    int i = 1;
+
+    localizar_lpdc(argv[0]);
+    opcoes = malloc(sizeof(char*) * argc);
+    if (opcoes == NULL) return 1;
+
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        int caminho, argumentos = proto_opcao(argv[i], &caminho);
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            sock = argv[++i];
+        } else if (strcmp(argv[i], "-B") == 0 && i + 1 < argc) {
+            medicoes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--ts-fd") == 0 && i + 1 < argc) {
+            opcoes[n_opcoes++] = argv[i];
+            opcoes[n_opcoes++] = argv[i + 1];
+            fd_ts = atoi(argv[++i]);
+        } else if (argumentos >= 0 && i + argumentos < argc) {
+            char absoluto[PATH_MAX];
+            opcoes[n_opcoes++] = argv[i];
+            if (!acrescentar_opcao(argv[i])) return 1;
+            if (argumentos > 0) {
+                const char *arg = argv[++i];
+                if (caminho && realpath(arg, absoluto) != NULL) arg = absoluto;
+                opcoes[n_opcoes++] = argv[i];
+                if (!acrescentar_opcao(arg)) return 1;
+            }
+        } else {
+            outra = 1;
+            break;
+        }
+    }
+    int fluxo = !outra && i + 1 == argc && strcmp(argv[i], "-") == 0;
+    int invalido = outra ? medicoes > 0
+                         : i >= argc || (argv[i][0] == '-' && !fluxo) ||
+                           (medicoes > 0 && fluxo) || (fd_ts >= 0 && !fluxo);
+    if (invalido) {
+        fprintf(stderr, "Uso: %s [-s socket] [-B N] [opções do lpdc] <arquivo.lpd> [arquivo.lpd ...]\n"
+                        "     %s [-s socket] [opções do lpdc] [--ts-fd N] -\n", argv[0], argv[0]);
+        return 1;
+    }
+    sock = proto_caminho_socket(sock);
+
+    if (medicoes > 0) {
+        medir(sock, argv[i], medicoes);
+        return 0;
+    }
+
+    int fd = outra ? -1 : conectar(sock);
+    if (fd < 0) return executar_lpdc(&argv[i], argc - i);
+
+    Bloco resp[4];
+    int falhas = 0;
+    memset(resp, 0, sizeof(resp));
+    if (fluxo) {
+        if (!compilar_entrada(fd, fd_ts, resp)) falhas++;
+    } else {
+        int n = argc - i;
+        for (; i < argc; i++) {
+            if (!compilar(fd, argv[i], resp)) falhas++;
+        }
+        if (n > 1 && falhas > 0) fprintf(stderr, "%d de %d arquivo(s) com erros.\n", falhas, n);
+    }
+    for (int k = 0; k < 4; k++) proto_liberar_bloco(&resp[k]);
+    close(fd);
+    free(bloco_opcoes);
+    free(opcoes);
+    return falhas > 0 ? 1 : 0;
+}
@@ -0,0 +1,486 @@
+/*
+ * compilador.c - Implementação da orquestração das compilações
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "compilador.h"
+#include "asdr.h"
+#include "tabsimb.h"
+#include "gerador.h"
+#include "contexto.h"
+#include "ast.h"
+#include "semantica.h"
+#include "otimizador.h"
+#include "expansao.h"
+#include "propagacao.h"
+#include "desenrolar.h"
+#include "invariantes.h"
+#include "alocador.h"
+#include "gerador_ast.h"
+#include "modulo.h"
+
+static OpcoesCompilacao opcoes_processo = { LIMITES_PADRAO, 0, ANALISADOR_RD, 1,
+                                             DESENROLAR_PADRAO, EXPANDIR_PADRAO, 0, 0,
+                                             NULL, NULL, NULL, NULL };
+
+int compilador_nucleos(void) {
+    long nucleos = sysconf(_SC_NPROCESSORS_ONLN);
+    return nucleos > 0 ? (int)nucleos : 1;
+}
+
+// Argumento inteiro de uma opção (0 se não é um número)
+static int ler_inteiro(const char *texto, int *valor) {
+    char *fim;
+    long v = strtol(texto, &fim, 10);
+    if (fim == texto || *fim != '\0' || v < INT_MIN || v > INT_MAX) return 0;
+    *valor = (int)v;
+    return 1;
+}
+
+int compilador_ler_opcao(OpcoesCompilacao *op, int argc, char **argv, int i) {
+    const char *o = argv[i];
+    const char *arg = i + 1 < argc ? argv[i + 1] : NULL;
+    int n;
+
+    if (strcmp(o, "-O0") == 0 || strcmp(o, "-O1") == 0) {
+        op->otimizacao = o[2] - '0';
+        return 1;
+    }
+    if (strcmp(o, "--desvios-diretos") == 0) {
+        op->desvios_diretos = 1;
+        return 1;
+    }
+    if (strcmp(o, "--interface") == 0) {
+        op->interface = 1;
+        return 1;
+    }
+    if (arg == NULL) return 0;
+
+    if (strcmp(o, "--analisador") == 0) {
+        if (strcmp(arg, "rd") != 0 && strcmp(arg, "ll1") != 0) return 0;
+        op->analisador = strcmp(arg, "ll1") == 0 ? ANALISADOR_LL1 : ANALISADOR_RD;
+    } else if (strcmp(o, "--perfil") == 0) {
+        op->arquivo_perfil = arg;
+        op->perfil = NULL;
+    } else if (strcmp(o, "--importar") == 0) {
+        // Um módulo só
+        if (op->arquivo_modulo != NULL) return 0;
+        op->arquivo_modulo = arg;
+        op->modulo = NULL;
+    } else if (!ler_inteiro(arg, &n)) {
+        return 0;
+    } else if (strcmp(o, "--threads-geracao") == 0) {
+        op->threads_geracao = n > 0 ? n : compilador_nucleos();
+    } else if (strcmp(o, "--desenrolar") == 0) {
+        op->fator_desenrolar = n > 0 ? n : 0;
+    } else if (strcmp(o, "--expandir") == 0) {
+        op->limite_expansao = n > 0 ? n : 0;
+    } else if (strcmp(o, "--max-erros") == 0) {
+        op->limites.max_erros = n;
+    } else if (strcmp(o, "--max-expressao") == 0) {
+        op->limites.max_expressao = n;
+    } else if (strcmp(o, "--max-aninhamento") == 0) {
+        op->limites.max_aninhamento = n;
+    } else {
+        return 0;
+    }
+    return 2;
+}
+
+int compilador_carregar_opcoes(OpcoesCompilacao *op, PerfilDesvios *perfil, ModuloTS *modulo,
+                               char *erro, int tam_erro) {
+    if (op->arquivo_modulo != NULL && op->modulo == NULL) {
+        if (!modulo_abrir(op->arquivo_modulo, modulo, erro, tam_erro)) return 0;
+        op->modulo = modulo;
+    }
+    if (op->arquivo_perfil != NULL && op->perfil == NULL) {
+        if (!perfil_carregar(op->arquivo_perfil, perfil, erro, tam_erro)) {
+            compilador_liberar_opcoes(op, perfil, modulo);
+            return 0;
+        }
+        op->perfil = perfil;
+    }
+    return 1;
+}
+
+void compilador_liberar_opcoes(OpcoesCompilacao *op, PerfilDesvios *perfil, ModuloTS *modulo) {
+    if (op->perfil == perfil) {
+        perfil_liberar(perfil);
+        op->perfil = NULL;
+    }
+    if (op->modulo == modulo) {
+        modulo_fechar(modulo);
+        op->modulo = NULL;
+    }
+}
+
+void compilador_opcoes(const OpcoesCompilacao *op) {
+    opcoes_processo = *op;
+    if (opcoes_processo.threads_geracao < 1) opcoes_processo.threads_geracao = 1;
+}
+
+// Chave do cache: todos os campos de OpcoesCompilacao, menos os que não
+// mudam a saída (threads_geracao) e os caminhos, que entram pelo conteúdo
+// (somas do perfil e do módulo). Os limites decidem se a compilação passa
+static void descrever_opcoes(const OpcoesCompilacao *op, char *opcoes, size_t tam) {
+    snprintf(opcoes, tam, "O%d analisador=%d erros=%d expressao=%d aninhamento=%d "
+             "desenrolar=%d expandir=%d diretos=%d interface=%d perfil=%016llx modulo=%016llx",
+             op->otimizacao, (int)op->analisador, op->limites.max_erros,
+             op->limites.max_expressao, op->limites.max_aninhamento,
+             op->fator_desenrolar, op->limite_expansao, op->desvios_diretos, op->interface,
+             op->perfil != NULL ? (unsigned long long)op->perfil->soma : 0ULL,
+             op->modulo != NULL ? (unsigned long long)op->modulo->cab->soma : 0ULL);
+}
+
+// Modo -O1: árvore, semântica, otimizações (dobra de constantes, expansão
+// de chamadas, propagação de constantes, desenrolamento, invariantes de
+// laço), alocação de endereços e geração em passadas separadas (com o
+// layout do perfil dos desvios, se houver). Com
+// --stats, a expansão e o desenrolamento relatam cada chamada e cada laço
+// nos diagnósticos
+static int compilar_ast(ContextoCompilacao *ctx, const OpcoesCompilacao *op) {
+    ArvoreAST arvore;
+    int ok;
+
+    ast_inicializar(&arvore);
+    ctx->ast = &arvore;
+
+    // Com erros sintáticos a semântica roda assim mesmo, para relatar os
+    // seus; só uma interrupção (limite de erros, memória) a impede
+    ok = parse_programa_ast(ctx) && analisar_ast(ctx);
+    if (ok) {
+        FILE *relatorio = EST_ATIVO(ctx->est) ? ctx->diag : NULL;
+        otimizar_ast(&arvore);
+        expandir_chamadas(&arvore, op->limite_expansao, relatorio);
+        propagar_constantes(&arvore);
+        if (desenrolar_lacos(&arvore, op->fator_desenrolar, relatorio) > 0) {
+            propagar_constantes(&arvore);
+        }
+        mover_invariantes(&arvore);
+        alocar_enderecos(ctx, op->interface || ctx->ts.modulo != NULL);
+        ok = gerar_ast(ctx, op->threads_geracao > 0 ? op->threads_geracao : 1, op->perfil);
+    }
+
+    if (EST_ATIVO(ctx->est)) {
+        ctx->est->nos_ast += arvore.n > 0 ? arvore.n - 1 : 0;
+        ctx->est->bytes_ast += (long long)arvore.cap * sizeof(NoAST) + arvore.cap_textos;
+    }
+    ast_liberar(&arvore);
+    ctx->ast = NULL;
+    return ok;
+}
+
+// Função auxiliar para extrair nome base do arquivo
+void extrair_nome_base(const char *caminho, char *base, size_t tam) {
+    const char *ultimo_barra = strrchr(caminho, '/');
+    const char *nome = ultimo_barra ? ultimo_barra + 1 : caminho;
+
+    snprintf(base, tam, "%s", nome);
+    char *ponto = strrchr(base, '.');
+    if (ponto) *ponto = '\0';
+}
+
+// Função para criar arquivos de saída
+int criar_arquivos_saida(const char *nome_base, FILE **arquivo_mepa, FILE **arquivo_ts) {
+    char caminho[300];
+
+    // Criar arquivo .mepa
+    snprintf(caminho, sizeof(caminho), "%s.mepa", nome_base);
+    *arquivo_mepa = fopen(caminho, "w+");   // os desvios diretos releem o arquivo
+    if (!*arquivo_mepa) {
+        fprintf(stderr, "Erro: não foi possível criar arquivo %s\n", caminho);
+        return 0;
+    }
+
+    // Criar arquivo .ts
+    snprintf(caminho, sizeof(caminho), "%s.ts", nome_base);
+    *arquivo_ts = fopen(caminho, "w");
+    if (!*arquivo_ts) {
+        fprintf(stderr, "Erro: não foi possível criar arquivo %s\n", caminho);
+        fclose(*arquivo_mepa);
+        return 0;
+    }
+
+    return 1;
+}
+
+// compilar_fluxos, gravando também a interface do módulo em interface
+// (NULL: sem interface)
+static int compilar(FILE *fonte_lpd, const char *nome, int pre_ler,
+                    FILE *arquivo_mepa, FILE *arquivo_ts, FILE *diag,
+                    const OpcoesCompilacao *op, EstatisticasCompilacao *est,
+                    const char *interface) {
+    ContextoCompilacao ctx;
+    MarcaTempo m;
+    int ok;
+
+    // Inicializar módulos
+    inicializar_contexto(&ctx, arquivo_mepa, diag, est);
+    ctx.limites = op->limites;
+    if (op->modulo != NULL) ts_importar(&ctx.ts, op->modulo);
+    if (op->desvios_diretos) gerador_desvios_diretos(&ctx.ger);
+    if (!lexico_abrir(&ctx.fonte, fonte_lpd, pre_ler, est)) {
+        fprintf(diag, "Erro: falha ao ler átomos de '%s'\n", nome);
+        liberar_contexto(&ctx);
+        return 0;
+    }
+
+    fprintf(diag, "Compilando '%s'...\n", nome);
+
+    // Executar análise sintática (as fases internas são descontadas
+    // em est_finalizar)
+    if (EST_ATIVO(est)) {
+        est->compilacoes++;
+        est_marcar(&m);
+    }
+    if (op->otimizacao > 0) ok = compilar_ast(&ctx, op);
+    else if (op->analisador == ANALISADOR_LL1) ok = parse_programa_ll1(&ctx);
+    else ok = parse_programa(&ctx);
+    if (EST_ATIVO(est)) {
+        est_acumular(est, FASE_SINTATICO, &m);
+
+        // Pilhas de expressões e chamadas da descida recursiva (as do LL(1)
+        // são medidas por ele)
+        long bytes = (long)ctx.cap_exp * sizeof(QuadroExp) +
+                     (long)ctx.cap_cham * sizeof(ChamadaExp);
+        if (bytes > est->pilha_analise) est->pilha_analise = bytes;
+        est_marcar(&m);
+    }
+
+    // Finalizar geração de código. Uma junção com pilhas diferentes é erro
+    // do próprio compilador: o código não vale, mesmo sem erro no programa
+    if (ok && ctx.ger.juncao_divergente >= 0) {
+        fprintf(diag, "Erro interno: caminhos chegam ao rótulo L%d com pilhas de tamanhos diferentes\n",
+                ctx.ger.juncao_divergente);
+        ctx.erros++;
+        ok = 0;
+    }
+    if (ok && !finalizar_gerador(&ctx.ger)) {
+        fprintf(diag, "Erro: falha ao gravar o código MEPA\n");
+        ctx.erros++;
+        ok = 0;
+    }
+    if (ok && interface != NULL && !modulo_gravar(&ctx.ts, interface)) {
+        fprintf(diag, "Erro: falha ao gravar a interface '%s'\n", interface);
+        ctx.erros++;
+        ok = 0;
+    }
+
+    if (ok) {
+        // Sucesso na compilação
+        fprintf(diag, "\nCódigo compilado com sucesso!\n");
+
+        // Salvar tabela de símbolos
+        salvar_tabela_simbolos(&ctx.ts, arquivo_ts);
+    } else {
+        // Erro na compilação (todos os erros já foram relatados)
+        fprintf(diag, "\nCompilação finalizada com %d erro(s).\n", ctx.erros);
+    }
+    if (EST_ATIVO(est)) est_acumular(est, FASE_SAIDA, &m);
+
+    liberar_contexto(&ctx);
+    return ok;
+}
+
+int compilar_fluxos(FILE *fonte_lpd, const char *nome, int pre_ler,
+                    FILE *arquivo_mepa, FILE *arquivo_ts, FILE *diag,
+                    const OpcoesCompilacao *op, EstatisticasCompilacao *est) {
+    return compilar(fonte_lpd, nome, pre_ler, arquivo_mepa, arquivo_ts, diag,
+                    op != NULL ? op : &opcoes_processo, est, NULL);
+}
+
+// Lê o arquivo inteiro para a memória (com '\0' no fim)
+static char* ler_tudo(FILE *f, size_t *n) {
+    size_t cap = 65536;
+    char *buf = malloc(cap);
+
+    *n = 0;
+    while (buf != NULL) {
+        *n += fread(buf + *n, 1, cap - *n - 1, f);
+        if (*n < cap - 1) break;
+        char *maior = realloc(buf, cap * 2);
+        if (maior == NULL) free(buf);
+        buf = maior;
+        cap *= 2;
+    }
+    if (buf != NULL) buf[*n] = '\0';
+    return buf;
+}
+
+int compilar_arquivo(const char *caminho, int pre_ler, FILE *diag, Cache *cache,
+                     EstatisticasCompilacao *est) {
+    FILE *fonte_lpd, *arquivo_mepa, *arquivo_ts;
+    char nome_arquivo[256];
+    char chave[CACHE_TAM_CHAVE];
+    char *texto = NULL;
+    size_t tam = 0;
+    int ok;
+
+    // Abrir arquivo fonte
+    fonte_lpd = fopen(caminho, "r");
+    if (!fonte_lpd) {
+        fprintf(stderr, "Erro: não foi possível abrir arquivo '%s'\n", caminho);
+        return 0;
+    }
+
+    // Extrair nome base para arquivos de saída
+    extrair_nome_base(caminho, nome_arquivo, sizeof(nome_arquivo));
+
+    // Com cache, a fonte é lida de uma vez para calcular a chave (o cache
+    // não guarda interfaces de módulo: com --interface, compila sempre)
+    if (cache != NULL && !opcoes_processo.interface) {
+        texto = ler_tudo(fonte_lpd, &tam);
+        if (texto != NULL) {
+            char opcoes[256];
+            descrever_opcoes(&opcoes_processo, opcoes, sizeof(opcoes));
+            cache_chave(texto, tam, opcoes, chave);
+            if (cache_buscar(cache, chave, nome_arquivo)) {
+                fprintf(diag, "Compilando '%s'...\n", caminho);
+                fprintf(diag, "\nCódigo compilado com sucesso!\n");
+                free(texto);
+                fclose(fonte_lpd);
+                return 1;
+            }
+            // Falha: compila a partir do texto já lido
+            FILE *memoria = tam > 0 ? fmemopen(texto, tam, "r") : NULL;
+            if (memoria != NULL) {
+                fclose(fonte_lpd);
+                fonte_lpd = memoria;
+            } else {
+                rewind(fonte_lpd);
+            }
+        }
+    }
+
+    // Criar arquivos de saída
+    if (!criar_arquivos_saida(nome_arquivo, &arquivo_mepa, &arquivo_ts)) {
+        fclose(fonte_lpd);
+        free(texto);
+        return 0;
+    }
+
+    char interface[300];
+    snprintf(interface, sizeof(interface), "%s.lpdi", nome_arquivo);
+    ok = compilar(fonte_lpd, caminho, pre_ler, arquivo_mepa, arquivo_ts, diag,
+                  &opcoes_processo, est, opcoes_processo.interface ? interface : NULL);
+
+    // Descarga dos arquivos de saída
+    MarcaTempo m;
+    if (EST_ATIVO(est)) est_marcar(&m);
+    fclose(fonte_lpd);
+    fclose(arquivo_mepa);
+    fclose(arquivo_ts);
+    if (EST_ATIVO(est)) est_acumular(est, FASE_SAIDA, &m);
+
+    // Só compilações bem-sucedidas entram no cache
+    if (ok && texto != NULL) cache_guardar(cache, chave, nome_arquivo);
+    free(texto);
+    return ok;
+}
+
+int compilar_padrao(int fd_ts, EstatisticasCompilacao *est) {
+    FILE *arquivo_ts = NULL;
+    int ok;
+
+    // Leitura e escrita em blocos grandes. No -O0 o léxico lê sob demanda e
+    // o gerador escreve à medida que avança (o cabeçalho vai antes do FIM),
+    // então a memória não cresce com o tamanho do programa: só a tabela de
+    // símbolos fica em memória. O -O1 guarda a árvore inteira
+    setvbuf(stdin, NULL, _IOFBF, BLOCO_FLUXO);
+    setvbuf(stdout, NULL, _IOFBF, BLOCO_FLUXO);
+
+    if (fd_ts >= 0) {
+        arquivo_ts = fdopen(fd_ts, "w");
+        if (arquivo_ts == NULL) {
+            fprintf(stderr, "Erro: descritor %d inválido para a tabela de símbolos\n", fd_ts);
+            return 0;
+        }
+    }
+
+    ok = compilar_fluxos(stdin, "<stdin>", 0, stdout, arquivo_ts, stderr, NULL, est);
+
+    MarcaTempo m;
+    if (EST_ATIVO(est)) est_marcar(&m);
+    if (fflush(stdout) != 0) ok = 0;
+    if (arquivo_ts != NULL && fclose(arquivo_ts) != 0) ok = 0;
+    if (EST_ATIVO(est)) est_acumular(est, FASE_SAIDA, &m);
+    return ok;
+}
+
+// Estado compartilhado da compilação em lote
+typedef struct {
+    char **arquivos;
+    int n_arquivos;
+    int proximo;                // próximo arquivo a compilar
+    int falhas;
+    Cache *cache;
+    EstatisticasCompilacao *est;    // total do lote (NULL: sem medição)
+    pthread_mutex_t trava;      // protege proximo, falhas, est e a saída padrão
+} Lote;
+
+static void* trabalhar(void *arg) {
+    Lote *lote = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&lote->trava);
+        int idx = lote->proximo < lote->n_arquivos ? lote->proximo++ : -1;
+        pthread_mutex_unlock(&lote->trava);
+        if (idx < 0) break;
+
+        // Mensagens acumuladas em memória e impressas de uma vez,
+        // para não se misturarem com as de outras compilações
+        char *texto = NULL;
+        size_t tam = 0;
+        FILE *diag = open_memstream(&texto, &tam);
+        EstatisticasCompilacao parcial;
+        memset(&parcial, 0, sizeof(parcial));
+        int ok = compilar_arquivo(lote->arquivos[idx], 1, diag ? diag : stdout,
+                                  lote->cache, EST_ATIVO(lote->est) ? &parcial : NULL);
+        if (diag) fclose(diag);
+
+        pthread_mutex_lock(&lote->trava);
+        if (!ok) lote->falhas++;
+        if (EST_ATIVO(lote->est)) est_somar(lote->est, &parcial);
+        if (texto) fputs(texto, stdout);
+        pthread_mutex_unlock(&lote->trava);
+        free(texto);
+    }
+    return NULL;
+}
+
+int compilar_lote(char **arquivos, int n_arquivos, int n_threads, Cache *cache,
+                  EstatisticasCompilacao *est) {
+    Lote lote;
+    pthread_t *threads;
+    int criadas = 0;
+
+    if (n_threads > n_arquivos) n_threads = n_arquivos;
+    lote.arquivos = arquivos;
+    lote.n_arquivos = n_arquivos;
+    lote.proximo = 0;
+    lote.falhas = 0;
+    lote.cache = cache;
+    lote.est = est;
+    pthread_mutex_init(&lote.trava, NULL);
+
+    threads = malloc(sizeof(pthread_t) * n_threads);
+    if (threads != NULL) {
+        for (; criadas < n_threads; criadas++) {
+            if (pthread_create(&threads[criadas], NULL, trabalhar, &lote) != 0) break;
+        }
+    }
+    // Sem threads disponíveis, a thread atual compila o que restar
+    if (criadas == 0) trabalhar(&lote);
+    for (int k = 0; k < criadas; k++) pthread_join(threads[k], NULL);
+
+    free(threads);
+    pthread_mutex_destroy(&lote.trava);
+    return lote.falhas;
+}
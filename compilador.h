@@ -0,0 +1,133 @@
+/*
+ * compilador.h - Orquestração de uma compilação (arquivo, fluxos ou lote)
+ */
+
+#ifndef COMPILADOR_H
+#define COMPILADOR_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "cache.h"
+#include "estatisticas.h"
+#include "contexto.h"
+#include "perfil.h"
+#include "tabsimb.h"
+#include "modulo.h"
+#include "desenrolar.h"
+#include "expansao.h"
+
+// Tamanho dos buffers de entrada e saída do modo fluxo
+#define BLOCO_FLUXO (1 << 20)
+
+// Analisador sintático do -O0: descida recursiva (asdr.c, padrão) ou
+// dirigido pela tabela LL(1) (asdr_ll1.c); a saída é a mesma. O -O1 sempre
+// constrói a árvore por descida recursiva
+typedef enum {
+    ANALISADOR_RD,
+    ANALISADOR_LL1
+} AnalisadorSintatico;
+
+// Opções de uma compilação, lidas da linha de comando do lpdc ou do pedido
+// do lpdcc (compilador_ler_opcao). Um campo novo que muda a saída também
+// entra na chave do cache (descrever_opcoes, em compilador.c)
+typedef struct {
+    // Limites (erros, profundidade de expressões e aninhamento de comandos)
+    LimitesCompilacao limites;
+
+    // Nível de otimização: 0 analisa e gera numa passada só; 1 constrói a
+    // árvore e a percorre em passadas separadas (semântica, dobra e
+    // propagação de constantes, desenrolamento de for, invariantes para
+    // fora dos laços, reuso de endereços de variáveis e geração)
+    int otimizacao;
+    AnalisadorSintatico analisador;
+
+    // Threads da geração de código do -O1, que gera os corpos das
+    // sub-rotinas em paralelo (-1: não informado; quem compila decide)
+    int threads_geracao;
+
+    // Fator do desenrolamento parcial de laços for no -O1; 1 desenrola só
+    // os pequenos, por completo, e 0 desliga
+    int fator_desenrolar;
+
+    // Tamanho máximo (em nós) das sub-rotinas expandidas no lugar das
+    // chamadas dentro de laços no -O1, um quarto dele fora; 0 desliga
+    int limite_expansao;
+
+    // Desvios DSVS/DSVF com o número da instrução de destino, corrigidos no
+    // arquivo quando o rótulo é definido (ver gerador.h); só para saída num
+    // arquivo comum, senão os rótulos continuam simbólicos
+    int desvios_diretos;
+
+    // Grava <base>.lpdi com as globais de cada arquivo compilado (não vale
+    // para o modo fluxo nem para o servidor). Com módulo importado ou
+    // interface, a área do programa do -O1 não tem endereços reusados: o de
+    // cada global é o da declaração
+    int interface;
+
+    // Perfil dos desvios (mvm -P) usado no layout dos blocos do -O1: o braço
+    // mais executado de cada if/else fica no lugar e o outro vai para o fim
+    // da rotina, e os laços executados testam no fim do corpo. O perfil vale
+    // para o programa compilado com as mesmas opções e sem ele
+    const char *arquivo_perfil;
+    const PerfilDesvios *perfil;
+
+    // Interface de módulo (modulo.h) cujas globais o programa enxerga, no
+    // início da área do programa
+    const char *arquivo_modulo;
+    const ModuloTS *modulo;
+} OpcoesCompilacao;
+
+#define OPCOES_PADRAO ((OpcoesCompilacao){ LIMITES_PADRAO, 0, ANALISADOR_RD, -1, \
+                       DESENROLAR_PADRAO, EXPANDIR_PADRAO, 0, 0, NULL, NULL, NULL, NULL })
+
+// Lê a opção de compilação em argv[i] (e o argumento dela) para op.
+// Retorna quantas palavras usou: 0 se argv[i] não é uma opção de
+// compilação, ou se falta ou é inválido o argumento
+int compilador_ler_opcao(OpcoesCompilacao *op, int argc, char **argv, int i);
+
+// Carrega o perfil e o módulo de op cujo arquivo foi informado e que ainda
+// não estão carregados, em perfil e modulo. Retorna 0 (com a mensagem em
+// erro) se um deles não pôde ser lido; compilador_liberar_opcoes libera os
+// que foram carregados ali
+int compilador_carregar_opcoes(OpcoesCompilacao *op, PerfilDesvios *perfil, ModuloTS *modulo,
+                               char *erro, int tam_erro);
+void compilador_liberar_opcoes(OpcoesCompilacao *op, PerfilDesvios *perfil, ModuloTS *modulo);
+
+// Opções das compilações seguintes do processo que não recebem as suas
+// (compilar_arquivo, compilar_padrao e compilar_lote). Padrão:
+// OPCOES_PADRAO, com uma thread na geração. op, com o perfil e o módulo,
+// deve durar até a última compilação
+void compilador_opcoes(const OpcoesCompilacao *op);
+
+// Compila a fonte já aberta, escrevendo o código MEPA e a tabela de símbolos
+// nos fluxos dados. nome aparece nas mensagens; pre_ler escolhe o modo do
+// léxico (ver lexico.h); op são as opções (NULL: as do processo, ver
+// compilador_opcoes); est (pode ser NULL) acumula a medição das fases.
+// Retorna 1 em caso de sucesso.
+int compilar_fluxos(FILE *fonte_lpd, const char *nome, int pre_ler,
+                    FILE *arquivo_mepa, FILE *arquivo_ts, FILE *diag,
+                    const OpcoesCompilacao *op, EstatisticasCompilacao *est);
+
+// Compila um arquivo .lpd, gerando <base>.mepa e <base>.ts (e <base>.lpdi,
+// com a opção interface) no diretório atual.
+// Com cache (não NULL), uma fonte já compilada não é analisada de novo.
+int compilar_arquivo(const char *caminho, int pre_ler, FILE *diag, Cache *cache,
+                     EstatisticasCompilacao *est);
+
+// Modo fluxo: fonte na entrada padrão, código MEPA na saída padrão e
+// mensagens na saída de erros. A tabela de símbolos vai para fd_ts
+// (-1 para descartar).
+int compilar_padrao(int fd_ts, EstatisticasCompilacao *est);
+
+// Compila vários arquivos em n_threads threads. Retorna o número de falhas.
+int compilar_lote(char **arquivos, int n_arquivos, int n_threads, Cache *cache,
+                  EstatisticasCompilacao *est);
+
+// Núcleos disponíveis (-j 0, --threads-geracao 0)
+int compilador_nucleos(void);
+
+// Funções auxiliares
+void extrair_nome_base(const char *caminho, char *base, size_t tam);
+int criar_arquivos_saida(const char *nome_base, FILE **arquivo_mepa, FILE **arquivo_ts);
+
+#endif
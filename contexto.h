@@ -0,0 +1,111 @@
+/*
+ * contexto.h - Estado de uma compilação
+ *
+ * Todo o estado que antes era global (parser, tabela de símbolos, gerador e
+ * fonte) fica aqui, de modo que várias compilações possam rodar ao mesmo
+ * tempo em threads diferentes. Erros não encerram o processo: um erro
+ * sintático volta por longjmp ao comando ou declaração em análise, que é
+ * descartado (modo pânico), e a análise continua para relatar os demais
+ * erros na mesma passada. Ao primeiro erro a geração de código é desligada;
+ * ao atingir max_erros, volta-se a parse_programa e a compilação termina.
+ */
+
+#ifndef CONTEXTO_H
+#define CONTEXTO_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include "analex.h"
+#include "lexico.h"
+#include "tabsimb.h"
+#include "gerador.h"
+#include "estatisticas.h"
+#include "ast.h"
+
+// Limites de uma compilação (0 = sem limite)
+typedef struct {
+    int max_erros;              // erros relatados antes de interromper
+    int max_expressao;          // parênteses, 'nao' e chamadas aninhados numa expressão
+    int max_aninhamento;        // comandos aninhados (if, while, begin...)
+} LimitesCompilacao;
+
+// Expressões usam pilha própria (no heap), então o limite só protege a
+// memória. Comandos aninhados recursam em C: o padrão cabe com folga em
+// 8 MiB de pilha, o tamanho padrão das threads
+#define MAX_ERROS_PADRAO 100
+#define MAX_EXPRESSAO_PADRAO 1000000
+#define MAX_ANINHAMENTO_PADRAO 4096
+#define LIMITES_PADRAO ((LimitesCompilacao){ MAX_ERROS_PADRAO, \
+                        MAX_EXPRESSAO_PADRAO, MAX_ANINHAMENTO_PADRAO })
+
+// Não-terminais de expressão e quadro da pilha explícita (ver parse_exp)
+typedef enum {
+    NT_EXP,
+    NT_EXP_SIMPLES,
+    NT_TERMO,
+    NT_FATOR
+} NaoTerminalExp;
+
+typedef struct {
+    unsigned char nt;           // NaoTerminalExp
+    unsigned char estado;       // onde o não-terminal parou
+    unsigned char negativo;     // <exp_simples> com '-' unário
+    TAtomo op;                  // operador à espera do operando direito
+    union {
+        TipoDado tipo;          // tipo do operando esquerdo (uma passada)
+        NoId no;                // nó do operando esquerdo (-O1, asdr_ast.c)
+    } esq;
+} QuadroExp;
+
+// Chamada de sub-rotina aberta numa expressão (uma passada); as chamadas
+// se aninham como os quadros de <fator> que as analisam
+typedef struct {
+    RegistroTS *sub;            // NULL: não declarada (já relatado)
+    int n_args;                 // argumentos já analisados
+    int em_expressao;           // 0: chamada como comando
+} ChamadaExp;
+
+typedef struct {
+    // Entrada
+    FonteAtomos fonte;
+
+    // Estado do parser
+    TInfoAtomo lookahead;
+    int linha_atual;
+    int erros;                  // erros relatados até agora
+    LimitesCompilacao limites;
+    int aninhamento;            // comandos abertos (parse_cmd)
+    int aninhamento_excedido;   // limite já relatado
+
+    // Pilha explícita de expressões
+    QuadroExp *pilha_exp;
+    int n_exp, cap_exp;
+    int prof_exp;               // parênteses, 'nao' e chamadas abertos
+    ChamadaExp *chamadas;
+    int n_cham, cap_cham;
+
+    // Sub-rotina em análise (NULL no programa principal ou se a declaração
+    // falhou) e o rótulo do seu retorno
+    RegistroTS *sub_atual;
+    char rotulo_retorno[20];
+
+    // Módulos
+    TabelaSimbolos ts;
+    GeradorMEPA ger;
+    ArvoreAST *ast;             // árvore em construção (-O1; NULL: uma passada)
+
+    // Diagnósticos e retorno em caso de erro
+    FILE *diag;
+    jmp_buf fuga;               // fim da compilação (parse_programa)
+    jmp_buf *recuperar;         // comando/declaração em análise (NULL: fuga)
+
+    EstatisticasCompilacao *est;    // NULL: sem medição
+    uintptr_t base_pilha;       // pilha de C no início da análise (0: não medir)
+} ContextoCompilacao;
+
+void inicializar_contexto(ContextoCompilacao *ctx, FILE *arquivo_mepa, FILE *diag,
+                          EstatisticasCompilacao *est);
+void liberar_contexto(ContextoCompilacao *ctx);
+
+#endif
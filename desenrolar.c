@@ -0,0 +1,503 @@
+/*
+ * desenrolar.c - Desenrolamento de laços for de contagem conhecida
+ *
+ * Um for tem contagem conhecida quando a inicialização atribui uma
+ * constante inteira à variável de controle, a condição compara a variável
+ * com uma constante (<, <=, > ou >=), o incremento soma ou subtrai uma
+ * constante dela e o corpo não a atribui (nem chama sub-rotinas, se ela é
+ * uma global que alguma sub-rotina atribui). O número de iterações N sai da
+ * inicialização, do limite e do passo.
+ *
+ * Se o laço desenrolado por completo fica pequeno (LIMITE_COMPLETO
+ * instruções), ele vira um bloco com N cópias do corpo, cada uma precedida
+ * da atribuição do valor da variável naquela iteração, e uma atribuição
+ * final com o valor de saída: não sobra teste nem desvio, e a propagação de
+ * constantes, que roda de novo depois, troca as leituras da variável nas
+ * cópias pelo valor.
+ *
+ * Senão, com corpo de até LIMITE_CORPO instruções, o corpo passa a ter
+ * fator cópias separadas pelo incremento, e o limite muda para que o laço
+ * dê N / fator voltas. Como N é conhecido, as N % fator iterações que
+ * sobram não precisam de outro laço: vêm depois, desenroladas como no caso
+ * completo.
+ *
+ * Os tamanhos são estimados como gerador_ast.c emitiria, e os passos da
+ * MEPA, pelo custo de cada volta do esquema de parse_for (três NADA, teste,
+ * DSVF, três DSVS e incremento) contra o das atribuições que ficam no
+ * lugar; o corpo executa as mesmas vezes e não entra na conta.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "desenrolar.h"
+
+// Instruções estimadas do laço desenrolado por completo
+#define LIMITE_COMPLETO 256
+
+// Instruções estimadas do corpo, para o desenrolamento parcial
+#define LIMITE_CORPO 64
+
+// Sem estouro nas contas de N e dos valores da variável
+#define LIMITE_VALOR (1L << 40)
+#define LIMITE_PASSO (1L << 20)
+
+typedef struct {
+    ArvoreAST *t;
+    int fator;
+    FILE *relatorio;
+    uint8_t *globais_atribuidas;    // por alguma sub-rotina
+    int n_globais;
+    int em_subrotina;
+    long desenrolados;
+} Desenrolamento;
+
+// Laço for de contagem conhecida
+typedef struct {
+    NoId var;                   // alvo da inicialização
+    long inicio, passo;
+    long n;                     // iterações
+    int crescente;              // a condição é var < limite (senão, >)
+} Contagem;
+
+static int constante(const ArvoreAST *t, NoId id, long *valor) {
+    const NoAST *no = ast_no(t, id);
+
+    if (no->tipo != AST_INT || (no->flags & AST_MORTO)) return 0;
+    *valor = strtol(ast_lexema(t, no), NULL, 10);
+    return 1;
+}
+
+static int mesma_var(const ArvoreAST *t, NoId id, NoId var) {
+    const NoAST *no = ast_no(t, id), *v = ast_no(t, var);
+    return no->tipo == AST_VAR && !(no->flags & AST_MORTO) &&
+           no->op == v->op && no->u.endereco == v->u.endereco;
+}
+
+static int chama(const ArvoreAST *t, NoId raiz) {
+    for (NoId id = ast_inicio(t, raiz); id <= raiz; id++) {
+        const NoAST *no = ast_no(t, id);
+        if (no->tipo == AST_CHAMADA && !(no->flags & AST_MORTO)) return 1;
+    }
+    return 0;
+}
+
+// O comando atribui a variável? Com chamadas_mudam, uma chamada conta
+// como atribuição
+static int atribui(const ArvoreAST *t, NoId id, NoId var, int chamadas_mudam) {
+    const NoAST no = *ast_no(t, id);
+
+    switch (no.tipo) {
+        case AST_ATRIB:
+            return mesma_var(t, no.a, var) || (chamadas_mudam && chama(t, no.b));
+        case AST_LEITURA:
+            return mesma_var(t, no.a, var);
+        case AST_ESCRITA:
+            return chamadas_mudam && chama(t, no.a);
+        case AST_CHAMADA:
+            return chamadas_mudam;
+        case AST_RETORNO:
+            return no.a != 0 && chamadas_mudam && chama(t, no.a);
+        case AST_SE:
+            return (chamadas_mudam && chama(t, no.a)) || atribui(t, no.b, var, chamadas_mudam) ||
+                   (no.c != 0 && atribui(t, no.c, var, chamadas_mudam));
+        case AST_ENQUANTO:
+            return (chamadas_mudam && chama(t, no.a)) || atribui(t, no.b, var, chamadas_mudam);
+        case AST_REPITA:
+            for (NoId c = no.a; c != 0; c = ast_no(t, c)->prox) {
+                if (atribui(t, c, var, chamadas_mudam)) return 1;
+            }
+            return chamadas_mudam && chama(t, no.b);
+        case AST_PARA:
+            return (no.a != 0 && atribui(t, no.a, var, chamadas_mudam)) ||
+                   (chamadas_mudam && chama(t, no.b)) || atribui(t, no.c, var, chamadas_mudam) ||
+                   atribui(t, no.u.d, var, chamadas_mudam);
+        case AST_BLOCO:
+            for (NoId c = no.a; c != 0; c = ast_no(t, c)->prox) {
+                if (atribui(t, c, var, chamadas_mudam)) return 1;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+// Globais atribuídas num comando de sub-rotina
+static void marcar_globais(Desenrolamento *d, NoId id) {
+    const ArvoreAST *t = d->t;
+    const NoAST no = *ast_no(t, id);
+
+    switch (no.tipo) {
+        case AST_ATRIB:
+        case AST_LEITURA: {
+            const NoAST *var = ast_no(t, no.a);
+            int e = var->u.endereco;
+            if (var->op == 0 && e >= 0 && e < d->n_globais) d->globais_atribuidas[e] = 1;
+            break;
+        }
+        case AST_SE:
+            marcar_globais(d, no.b);
+            if (no.c != 0) marcar_globais(d, no.c);
+            break;
+        case AST_ENQUANTO:
+            marcar_globais(d, no.b);
+            break;
+        case AST_PARA:
+            if (no.a != 0) marcar_globais(d, no.a);
+            marcar_globais(d, no.c);
+            marcar_globais(d, no.u.d);
+            break;
+        case AST_REPITA:
+        case AST_BLOCO:
+            for (NoId c = no.a; c != 0; c = ast_no(t, c)->prox) marcar_globais(d, c);
+            break;
+        default:
+            break;
+    }
+}
+
+static int reconhecer(const Desenrolamento *d, const NoAST *laco, Contagem *c) {
+    const ArvoreAST *t = d->t;
+    long limite, passo;
+
+    if (laco->a == 0) return 0;
+    const NoAST *inicio = ast_no(t, laco->a);
+    if (inicio->tipo != AST_ATRIB || !constante(t, inicio->b, &c->inicio)) return 0;
+    c->var = inicio->a;
+
+    // Condição: var op constante ou constante op var
+    const NoAST *cond = ast_no(t, laco->b);
+    int op;
+    if (cond->tipo != AST_BINARIO) return 0;
+    if (mesma_var(t, cond->a, c->var) && constante(t, cond->b, &limite)) {
+        op = cond->op;
+    } else if (mesma_var(t, cond->b, c->var) && constante(t, cond->a, &limite)) {
+        switch (cond->op) {
+            case sMENOR:    op = sMAIOR; break;
+            case sMENOR_IG: op = sMAIOR_IG; break;
+            case sMAIOR:    op = sMENOR; break;
+            case sMAIOR_IG: op = sMENOR_IG; break;
+            default:        return 0;
+        }
+    } else {
+        return 0;
+    }
+
+    // Incremento: var <- var + k, var <- k + var ou var <- var - k
+    const NoAST *incr = ast_no(t, laco->c);
+    if (incr->tipo != AST_ATRIB || !mesma_var(t, incr->a, c->var)) return 0;
+    const NoAST *soma = ast_no(t, incr->b);
+    if (soma->tipo != AST_BINARIO) return 0;
+    if (soma->op == sSOMA && mesma_var(t, soma->a, c->var) && constante(t, soma->b, &passo)) {
+        c->passo = passo;
+    } else if (soma->op == sSOMA && mesma_var(t, soma->b, c->var) && constante(t, soma->a, &passo)) {
+        c->passo = passo;
+    } else if (soma->op == sSUBT && mesma_var(t, soma->a, c->var) && constante(t, soma->b, &passo)) {
+        c->passo = -passo;
+    } else {
+        return 0;
+    }
+
+    if (labs(c->inicio) > LIMITE_VALOR || labs(limite) > LIMITE_VALOR ||
+        c->passo == 0 || labs(c->passo) > LIMITE_PASSO) {
+        return 0;
+    }
+
+    // Limite exclusivo: var < limite ou var > limite
+    switch (op) {
+        case sMENOR:    c->crescente = 1; break;
+        case sMENOR_IG: c->crescente = 1; limite++; break;
+        case sMAIOR:    c->crescente = 0; break;
+        case sMAIOR_IG: c->crescente = 0; limite--; break;
+        default:        return 0;
+    }
+    if (c->crescente ? c->inicio >= limite : c->inicio <= limite) {
+        c->n = 0;
+    } else if (c->crescente != (c->passo > 0)) {
+        return 0;               // só terminaria estourando
+    } else if (c->crescente) {
+        c->n = (limite - c->inicio + c->passo - 1) / c->passo;
+    } else {
+        c->n = (c->inicio - limite - c->passo - 1) / -c->passo;
+    }
+
+    // A variável de controle não pode mudar no corpo
+    const NoAST *var = ast_no(t, c->var);
+    int e = var->u.endereco;
+    int chamadas_mudam = var->op == 0 && e >= 0 && e < d->n_globais && d->globais_atribuidas[e];
+    return !atribui(t, laco->u.d, c->var, chamadas_mudam);
+}
+
+// Instruções que gerador_ast.c emite
+static long instrucoes_exp(const ArvoreAST *t, NoId raiz) {
+    long n = 0;
+
+    for (NoId id = ast_inicio(t, raiz); id <= raiz; id++) {
+        const NoAST *no = ast_no(t, id);
+        if (no->flags & AST_MORTO) continue;
+        switch (no->tipo) {
+            case AST_RESULTADO: n += no->dado != TIPO_VOID; break;
+            case AST_ARG:       break;
+            default:            n++; break;
+        }
+    }
+    return n;
+}
+
+static long instrucoes_cmd(const Desenrolamento *d, NoId id) {
+    const ArvoreAST *t = d->t;
+    const NoAST no = *ast_no(t, id);
+    long n = 0;
+
+    switch (no.tipo) {
+        case AST_ATRIB:    return instrucoes_exp(t, no.b) + 1;
+        case AST_LEITURA:  return 2;
+        case AST_ESCRITA:  return instrucoes_exp(t, no.a) + 1;
+        case AST_TEXTO:    return 1;
+        case AST_CHAMADA:  return instrucoes_exp(t, id) + (no.dado != TIPO_VOID);
+        case AST_RETORNO:
+            if (no.a != 0) n = instrucoes_exp(t, no.a);
+            return d->em_subrotina ? n + (no.a != 0) + 1 : n;
+        case AST_SE:
+            n = instrucoes_exp(t, no.a) + 2 + instrucoes_cmd(d, no.b);
+            return no.c != 0 ? n + 2 + instrucoes_cmd(d, no.c) : n;
+        case AST_ENQUANTO:
+            return instrucoes_exp(t, no.a) + 4 + instrucoes_cmd(d, no.b);
+        case AST_REPITA:
+            n = instrucoes_exp(t, no.b) + 2;
+            for (NoId c = no.a; c != 0; c = ast_no(t, c)->prox) n += instrucoes_cmd(d, c);
+            return n;
+        case AST_PARA:
+            n = no.a != 0 ? instrucoes_cmd(d, no.a) : 0;
+            return n + instrucoes_exp(t, no.b) + 8 + instrucoes_cmd(d, no.c) + instrucoes_cmd(d, no.u.d);
+        case AST_BLOCO:
+            for (NoId c = no.a; c != 0; c = ast_no(t, c)->prox) n += instrucoes_cmd(d, c);
+            return n;
+        default:
+            return 0;
+    }
+}
+
+// var <- valor (0 se faltar memória)
+static NoId atribuicao(ArvoreAST *t, NoId var, long valor) {
+    char texto[32];
+
+    snprintf(texto, sizeof(texto), "%ld", valor);
+    uint32_t desloc = ast_texto(t, texto);
+    if (desloc == UINT32_MAX) return 0;
+
+    NoAST alvo = *ast_no(t, var);
+    NoId k = ast_novo(t, AST_INT, alvo.linha);
+    NoId v = k != 0 ? ast_novo(t, AST_VAR, alvo.linha) : 0;
+    NoId atrib = v != 0 ? ast_novo(t, AST_ATRIB, alvo.linha) : 0;
+    if (atrib == 0) return 0;
+
+    NoAST *no = ast_no(t, k);
+    no->dado = TIPO_INT;
+    no->texto = desloc;
+    alvo.prox = 0;
+    *ast_no(t, v) = alvo;
+    no = ast_no(t, atrib);
+    no->op = sATRIB;
+    no->a = v;
+    no->b = k;
+    return atrib;
+}
+
+// Acrescenta no fim de uma lista em construção (0 se o comando faltou)
+static int encadear(ArvoreAST *t, NoId *ultimo, NoId id) {
+    if (id == 0) return 0;
+    ast_no(t, *ultimo)->prox = id;
+    *ultimo = id;
+    return 1;
+}
+
+// Iterações [de, c->n) desenroladas depois de *ultimo: o valor da variável
+// antes de cada cópia do corpo (menos da primeira, se primeira_pronta) e o
+// de saída no fim. A primeira cópia pode ser o próprio corpo
+static int desenrolar_iteracoes(ArvoreAST *t, NoId *ultimo, const Contagem *c, NoId corpo,
+                                long de, int primeira_pronta, int usar_corpo) {
+    for (long k = de; k < c->n; k++) {
+        if (k > de || !primeira_pronta) {
+            if (!encadear(t, ultimo, atribuicao(t, c->var, c->inicio + k * c->passo))) return 0;
+        }
+        NoId copia = k == de && usar_corpo ? corpo : ast_copiar_cmd(t, corpo);
+        if (!encadear(t, ultimo, copia)) return 0;
+    }
+    if (c->n > de) return encadear(t, ultimo, atribuicao(t, c->var, c->inicio + c->n * c->passo));
+    return 1;
+}
+
+static void relatar(Desenrolamento *d, int linha, const Contagem *c, long voltas,
+                    long codigo, long passos) {
+    if (d->relatorio == NULL) return;
+    if (voltas < 0) {
+        fprintf(d->relatorio, "for da linha %d: %ld iterações, desenrolado por completo: "
+                "código %+ld instruções, execução %+ld passos (estimativa)\n",
+                linha, c->n, codigo, passos);
+    } else {
+        fprintf(d->relatorio, "for da linha %d: %ld iterações, desenrolado %d vezes (%ld voltas "
+                "e %ld à parte): código %+ld instruções, execução %+ld passos (estimativa)\n",
+                linha, c->n, d->fator, voltas, c->n - voltas * d->fator, codigo, passos);
+    }
+}
+
+// O laço vira um bloco: inicialização e as N iterações
+static void completo(Desenrolamento *d, NoId id, const Contagem *c, long corpo, long teste, long incr) {
+    ArvoreAST *t = d->t;
+    const NoAST no = *ast_no(t, id);
+    NoId ultimo = no.a;
+
+    if (!desenrolar_iteracoes(t, &ultimo, c, no.u.d, 0, 1, 1)) {
+        ast_no(t, no.a)->prox = 0;
+        ast_no(t, no.u.d)->prox = 0;
+        return;
+    }
+    ast_no(t, ultimo)->prox = 0;
+
+    NoAST *bloco = ast_no(t, id);
+    bloco->tipo = AST_BLOCO;
+    bloco->op = 0;
+    bloco->b = bloco->c = 0;
+    bloco->u.d = 0;
+    d->desenrolados++;
+
+    long codigo = c->n * (corpo + 2) - (corpo + teste + incr + 8);
+    long passos = 2 * c->n - c->n * (teste + incr + 6) - (teste + 3);
+    relatar(d, ast_no(t, no.a)->linha, c, -1, codigo, passos);
+}
+
+// Corpo com fator cópias, limite para N / fator voltas e o resto depois
+static void parcial(Desenrolamento *d, NoId id, const Contagem *c, long corpo, long teste, long incr) {
+    ArvoreAST *t = d->t;
+    const NoAST no = *ast_no(t, id);
+    long voltas = c->n / d->fator;
+    Contagem resto = *c;
+    char texto[32];
+
+    // Nós novos antes de mudar o laço
+    NoId bloco = ast_novo(t, AST_BLOCO, no.linha);
+    NoId laco = bloco != 0 ? ast_novo(t, AST_NENHUM, 0) : 0;
+    snprintf(texto, sizeof(texto), "%ld", c->inicio + voltas * d->fator * c->passo);
+    uint32_t limite = ast_texto(t, texto);
+    if (laco == 0 || limite == UINT32_MAX) return;
+
+    NoId ultimo = no.u.d;
+    int ok = 1;
+    for (int k = 1; k < d->fator && ok; k++) {
+        ok = encadear(t, &ultimo, ast_copiar_cmd(t, no.c)) &&
+             encadear(t, &ultimo, ast_copiar_cmd(t, no.u.d));
+    }
+    NoId fim = laco;
+    if (ok) ok = desenrolar_iteracoes(t, &fim, &resto, no.u.d, voltas * d->fator, 0, 0);
+    if (!ok) {
+        ast_no(t, no.u.d)->prox = 0;
+        return;
+    }
+    ast_no(t, ultimo)->prox = 0;
+    ast_no(t, fim)->prox = 0;
+
+    ast_no(t, bloco)->a = no.u.d;
+    NoAST *cond = ast_no(t, no.b);
+    NoId constante;
+    if (mesma_var(t, cond->a, c->var)) {
+        cond->op = c->crescente ? sMENOR : sMAIOR;
+        constante = cond->b;
+    } else {
+        cond->op = c->crescente ? sMAIOR : sMENOR;
+        constante = cond->a;
+    }
+    ast_no(t, constante)->texto = limite;
+
+    // O laço vai para o começo de um bloco, seguido do resto
+    NoAST *novo = ast_no(t, laco);
+    NoId primeiro_resto = novo->prox;
+    *novo = no;
+    novo->u.d = bloco;
+    novo->prox = primeiro_resto;
+    NoAST *externo = ast_no(t, id);
+    externo->tipo = AST_BLOCO;
+    externo->op = 0;
+    externo->a = laco;
+    externo->b = externo->c = 0;
+    externo->u.d = 0;
+    d->desenrolados++;
+
+    long r = c->n - voltas * d->fator;
+    long codigo = (d->fator - 1) * (corpo + incr) + (r > 0 ? r * corpo + 2 * (r + 1) : 0);
+    long passos = voltas * (teste + incr + 6 + (d->fator - 1) * incr) + (r > 0 ? 2 * (r + 1) : 0) -
+                  c->n * (teste + incr + 6);
+    relatar(d, ast_no(t, no.a)->linha, c, voltas, codigo, passos);
+}
+
+static void tratar_para(Desenrolamento *d, NoId id) {
+    const NoAST no = *ast_no(d->t, id);
+    Contagem c;
+
+    if (!reconhecer(d, &no, &c)) return;
+    long corpo = instrucoes_cmd(d, no.u.d);
+    long teste = instrucoes_exp(d->t, no.b);
+    long incr = instrucoes_cmd(d, no.c);
+
+    if (c.n * (corpo + 2) <= LIMITE_COMPLETO) {
+        completo(d, id, &c, corpo, teste, incr);
+    } else if (d->fator >= 2 && corpo <= LIMITE_CORPO && c.n >= d->fator) {
+        parcial(d, id, &c, corpo, teste, incr);
+    }
+}
+
+static void tratar_cmd(Desenrolamento *d, NoId id);
+
+static void tratar_lista(Desenrolamento *d, NoId id) {
+    for (; id != 0; id = ast_no(d->t, id)->prox) tratar_cmd(d, id);
+}
+
+// De dentro para fora: um laço interno desenrolado entra no tamanho do
+// corpo do externo
+static void tratar_cmd(Desenrolamento *d, NoId id) {
+    const NoAST no = *ast_no(d->t, id);
+
+    switch (no.tipo) {
+        case AST_SE:
+            tratar_cmd(d, no.b);
+            if (no.c != 0) tratar_cmd(d, no.c);
+            break;
+        case AST_ENQUANTO:
+            tratar_cmd(d, no.b);
+            break;
+        case AST_REPITA:
+        case AST_BLOCO:
+            tratar_lista(d, no.a);
+            break;
+        case AST_PARA:
+            tratar_cmd(d, no.u.d);
+            tratar_para(d, id);
+            break;
+        default:
+            break;
+    }
+}
+
+long desenrolar_lacos(ArvoreAST *t, int fator, FILE *relatorio) {
+    const NoAST *prg = ast_no(t, t->raiz);
+    NoId corpo_prg = prg->c, subs = prg->u.d;
+    Desenrolamento d;
+
+    if (fator < 1) return 0;
+    memset(&d, 0, sizeof(d));
+    d.t = t;
+    d.fator = fator;
+    d.relatorio = relatorio;
+    d.n_globais = ast_no(t, prg->a)->u.endereco;
+    d.globais_atribuidas = calloc((size_t)d.n_globais + 1, 1);
+    if (d.globais_atribuidas == NULL) return 0;
+
+    for (NoId sub = subs; sub != 0; sub = ast_no(t, sub)->prox) marcar_globais(&d, ast_no(t, sub)->c);
+
+    d.em_subrotina = 1;
+    for (NoId sub = subs; sub != 0; sub = ast_no(t, sub)->prox) tratar_cmd(&d, ast_no(t, sub)->c);
+    d.em_subrotina = 0;
+    tratar_cmd(&d, corpo_prg);
+
+    free(d.globais_atribuidas);
+    return d.desenrolados;
+}
@@ -0,0 +1,21 @@
+/*
+ * desenrolar.h - Desenrolamento de laços for de contagem conhecida (modo -O1)
+ */
+
+#ifndef DESENROLAR_H
+#define DESENROLAR_H
+
+#include <stdio.h>
+#include "ast.h"
+
+// Fator padrão do desenrolamento parcial
+#define DESENROLAR_PADRAO 4
+
+// Desenrola os for de contagem conhecida numa árvore já checada pela
+// semântica e com as constantes propagadas: por completo os pequenos e,
+// com fator >= 2, os demais em grupos de fator iterações. Com relatorio,
+// escreve nele uma linha por laço com a variação estimada do código e dos
+// passos da MEPA. Retorna o número de laços desenrolados.
+long desenrolar_lacos(ArvoreAST *t, int fator, FILE *relatorio);
+
+#endif
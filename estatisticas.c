@@ -0,0 +1,189 @@
+/*
+ * estatisticas.c - Implementação da medição da compilação
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "estatisticas.h"
+
+static const char *nomes_fase[FASE_TOTAL] = {
+    "lexico", "sintatico", "tabela_simbolos", "emissao", "saida"
+};
+
+static const char *titulos_fase[FASE_TOTAL] = {
+    "léxico", "sintático", "tabela de símbolos", "emissão", "saída"
+};
+
+// Custo da própria medição de uma chamada fina (est_entrar seguido de
+// est_sair), que pesa em chamadas curtas; descontado de cada uma
+static double custo_parede = 0;
+static double custo_cpu = 0;
+
+static double segundos(clockid_t relogio) {
+    struct timespec t;
+    clock_gettime(relogio, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static int comparar_custos(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+void est_calibrar() {
+    enum { N = 4001 };
+    static double parede[N], cpu[N];
+
+    // Na mesma ordem de est_entrar e est_sair com a CPU sorteada. Fica a
+    // mediana: o mínimo subestima o custo, e uma preempção durante a
+    // calibração puxaria a média para longe dele
+    for (int k = 0; k < N; k++) {
+        double c = segundos(CLOCK_THREAD_CPUTIME_ID);
+        double p = segundos(CLOCK_MONOTONIC);
+        parede[k] = segundos(CLOCK_MONOTONIC) - p;
+        cpu[k] = segundos(CLOCK_THREAD_CPUTIME_ID) - c;
+    }
+    qsort(parede, N, sizeof(double), comparar_custos);
+    qsort(cpu, N, sizeof(double), comparar_custos);
+    custo_parede = parede[N / 2];
+    custo_cpu = cpu[N / 2];
+}
+
+void est_marcar(MarcaTempo *m) {
+    m->parede = segundos(CLOCK_MONOTONIC);
+    m->cpu = segundos(CLOCK_THREAD_CPUTIME_ID);
+}
+
+void est_acumular(EstatisticasCompilacao *e, FaseCompilacao fase, const MarcaTempo *m) {
+    e->parede[fase] += segundos(CLOCK_MONOTONIC) - m->parede;
+    e->cpu[fase] += segundos(CLOCK_THREAD_CPUTIME_ID) - m->cpu;
+}
+
+void est_entrar(EstatisticasCompilacao *e, FaseCompilacao fase, MarcaTempo *m) {
+    e->chamadas[fase]++;
+    e->sorteio = e->sorteio * 1103515245u + 12345u;
+    m->cpu = ((e->sorteio >> 16) % EST_PERIODO) == 0 ? segundos(CLOCK_THREAD_CPUTIME_ID) : -1;
+    m->parede = segundos(CLOCK_MONOTONIC);
+}
+
+void est_sair(EstatisticasCompilacao *e, FaseCompilacao fase, const MarcaTempo *m) {
+    e->chamadas_parede[fase] += segundos(CLOCK_MONOTONIC) - m->parede - custo_parede;
+    if (m->cpu >= 0) {
+        e->amostra_cpu[fase] += segundos(CLOCK_THREAD_CPUTIME_ID) - m->cpu - custo_cpu;
+        e->amostras[fase]++;
+    }
+}
+
+void est_somar(EstatisticasCompilacao *total, const EstatisticasCompilacao *parcial) {
+    for (int f = 0; f < FASE_TOTAL; f++) {
+        total->parede[f] += parcial->parede[f];
+        total->cpu[f] += parcial->cpu[f];
+        total->chamadas_parede[f] += parcial->chamadas_parede[f];
+        total->amostra_cpu[f] += parcial->amostra_cpu[f];
+        total->amostras[f] += parcial->amostras[f];
+        total->chamadas[f] += parcial->chamadas[f];
+    }
+    total->compilacoes += parcial->compilacoes;
+    total->atomos += parcial->atomos;
+    total->ts_insercoes += parcial->ts_insercoes;
+    total->ts_buscas += parcial->ts_buscas;
+    total->ts_sondagens += parcial->ts_sondagens;
+    total->instrucoes += parcial->instrucoes;
+    total->bytes_emitidos += parcial->bytes_emitidos;
+    total->alocacoes += parcial->alocacoes;
+    total->nos_ast += parcial->nos_ast;
+    total->bytes_ast += parcial->bytes_ast;
+    if (parcial->pilha_c > total->pilha_c) total->pilha_c = parcial->pilha_c;
+    if (parcial->pilha_analise > total->pilha_analise) total->pilha_analise = parcial->pilha_analise;
+}
+
+void est_finalizar(EstatisticasCompilacao *e, const MarcaTempo *inicio) {
+    struct rusage uso;
+
+    // As fases finas rodam dentro do parser. A parede delas foi somada
+    // chamada a chamada; a CPU é extrapolada das amostras, sem passar da
+    // parede da fase, e a soma fica limitada à CPU do parser (uma amostra
+    // longa, multiplicada pelo período, passaria dela)
+    double cpu[FASE_TOTAL] = {0}, soma_cpu = 0, fator = 1;
+    for (int f = 0; f < FASE_TOTAL; f++) {
+        double parede = e->chamadas_parede[f] > 0 ? e->chamadas_parede[f] : 0;
+        e->parede[f] += parede;
+        e->parede[FASE_SINTATICO] -= parede;
+        if (e->amostras[f] > 0 && e->amostra_cpu[f] > 0) {
+            cpu[f] = e->amostra_cpu[f] * ((double)e->chamadas[f] / e->amostras[f]);
+            if (cpu[f] > parede) cpu[f] = parede;
+            soma_cpu += cpu[f];
+        }
+        e->chamadas_parede[f] = e->amostra_cpu[f] = 0;
+        e->amostras[f] = 0;
+    }
+    if (soma_cpu > e->cpu[FASE_SINTATICO]) {
+        fator = e->cpu[FASE_SINTATICO] > 0 ? e->cpu[FASE_SINTATICO] / soma_cpu : 0;
+    }
+    for (int f = 0; f < FASE_TOTAL; f++) e->cpu[f] += cpu[f] * fator;
+    e->cpu[FASE_SINTATICO] -= soma_cpu * fator;
+    if (e->parede[FASE_SINTATICO] < 0) e->parede[FASE_SINTATICO] = 0;
+    if (e->cpu[FASE_SINTATICO] < 0) e->cpu[FASE_SINTATICO] = 0;
+
+    // inicio foi marcado antes de qualquer outra thread: a CPU da thread
+    // era a do processo, sem a partida nem a calibração
+    e->parede_total = segundos(CLOCK_MONOTONIC) - inicio->parede;
+    e->cpu_total = segundos(CLOCK_PROCESS_CPUTIME_ID) - inicio->cpu;
+    if (getrusage(RUSAGE_SELF, &uso) == 0) e->pico_rss_kb = uso.ru_maxrss;
+}
+
+void est_relatorio(const EstatisticasCompilacao *e, FILE *saida, int json) {
+    long ops = e->ts_insercoes + e->ts_buscas;
+    double media = ops ? (double)e->ts_sondagens / ops : 0.0;
+
+    if (json) {
+        fprintf(saida, "{\"compilacoes\":%ld,\"fases\":{", e->compilacoes);
+        for (int f = 0; f < FASE_TOTAL; f++) {
+            fprintf(saida, "%s\"%s\":{\"parede_ms\":%.3f,\"cpu_ms\":%.3f}",
+                    f ? "," : "", nomes_fase[f], e->parede[f] * 1e3, e->cpu[f] * 1e3);
+        }
+        fprintf(saida, "},\"total\":{\"parede_ms\":%.3f,\"cpu_ms\":%.3f},",
+                e->parede_total * 1e3, e->cpu_total * 1e3);
+        fprintf(saida, "\"atomos\":%ld,", e->atomos);
+        fprintf(saida, "\"tabela_simbolos\":{\"insercoes\":%ld,\"buscas\":%ld,"
+                "\"sondagens\":%ld,\"sondagens_por_operacao\":%.2f},",
+                e->ts_insercoes, e->ts_buscas, e->ts_sondagens, media);
+        fprintf(saida, "\"emissao\":{\"instrucoes\":%ld,\"bytes\":%lld},",
+                e->instrucoes, e->bytes_emitidos);
+        fprintf(saida, "\"arvore\":{\"nos\":%ld,\"bytes\":%lld},",
+                e->nos_ast, e->bytes_ast);
+        fprintf(saida, "\"pilha_parser\":{\"c_bytes\":%ld,\"explicita_bytes\":%ld},",
+                e->pilha_c, e->pilha_analise);
+        fprintf(saida, "\"alocacoes\":%ld,\"pico_rss_kb\":%ld}\n",
+                e->alocacoes, e->pico_rss_kb);
+        return;
+    }
+
+    fprintf(saida, "\nEstatísticas de compilação (%ld arquivo(s)):\n", e->compilacoes);
+    fprintf(saida, "  %-20s %12s %12s\n", "fase", "parede (ms)", "cpu (ms)");
+    for (int f = 0; f < FASE_TOTAL; f++) {
+        fprintf(saida, "  %-20s %12.3f %12.3f\n", titulos_fase[f],
+                e->parede[f] * 1e3, e->cpu[f] * 1e3);
+    }
+    fprintf(saida, "  %-20s %12.3f %12.3f\n", "processo",
+            e->parede_total * 1e3, e->cpu_total * 1e3);
+    fprintf(saida, "  átomos:             %ld\n", e->atomos);
+    fprintf(saida, "  tabela de símbolos: %ld inserções, %ld buscas, %ld sondagens "
+            "(%.2f por operação)\n", e->ts_insercoes, e->ts_buscas, e->ts_sondagens, media);
+    fprintf(saida, "  emissão:            %ld instruções, %lld bytes\n",
+            e->instrucoes, e->bytes_emitidos);
+    if (e->nos_ast > 0) {
+        fprintf(saida, "  árvore:             %ld nós, %lld KiB\n",
+                e->nos_ast, e->bytes_ast >> 10);
+    }
+    fprintf(saida, "  pilha do parser:    %ld bytes de C, %ld bytes explícitos\n",
+            e->pilha_c, e->pilha_analise);
+    fprintf(saida, "  alocações:          %ld\n", e->alocacoes);
+    fprintf(saida, "  pico de RSS:        %ld KiB\n", e->pico_rss_kb);
+}
@@ -0,0 +1,94 @@
+/*
+ * estatisticas.h - Medição de tempo por fase e contadores da compilação
+ *
+ * Cada módulo guarda um ponteiro para EstatisticasCompilacao; NULL desliga a
+ * medição, e o custo fica num teste de ponteiro por chamada. Compilando com
+ * -DLPDC_SEM_ESTATISTICAS, os testes viram constantes e o compilador remove
+ * todo o código de medição.
+ *
+ * Léxico, tabela de símbolos e emissão são chamados milhões de vezes em
+ * programas grandes. O tempo de parede delas é somado chamada a chamada
+ * (CLOCK_MONOTONIC é lido sem entrar no núcleo), descontado o custo
+ * calibrado da leitura. O relógio de CPU da thread é uma chamada ao
+ * sistema que custaria mais que o trabalho medido: só uma chamada em
+ * EST_PERIODO (sorteada) o lê, e a CPU é extrapolada pelo total de
+ * chamadas, limitada pela parede da fase e pela CPU medida do parser. O
+ * tempo do parser é medido inteiro e dele se desconta o das fases chamadas
+ * por ele.
+ */
+
+#ifndef ESTATISTICAS_H
+#define ESTATISTICAS_H
+
+#include <stdio.h>
+
+#ifdef LPDC_SEM_ESTATISTICAS
+#define EST_ATIVO(e) 0
+#else
+#define EST_ATIVO(e) ((e) != NULL)
+#endif
+
+typedef enum {
+    FASE_LEXICO,                // obter_atomo
+    FASE_SINTATICO,             // asdr.c, sem as demais fases
+    FASE_TABELA,                // ts_inserir / ts_buscar
+    FASE_EMISSAO,               // gera_instr_mepa
+    FASE_SAIDA,                 // .ts, FIM e descarga dos arquivos
+    FASE_TOTAL
+} FaseCompilacao;
+
+// Uma em cada EST_PERIODO chamadas das fases finas lê o relógio de CPU
+#define EST_PERIODO 64
+
+typedef struct {
+    double parede[FASE_TOTAL];  // segundos (medição direta)
+    double cpu[FASE_TOTAL];
+
+    // Fases finas: parede de todas as chamadas, CPU das amostras e
+    // contagem de chamadas
+    double chamadas_parede[FASE_TOTAL];
+    double amostra_cpu[FASE_TOTAL];
+    long amostras[FASE_TOTAL];
+    long chamadas[FASE_TOTAL];
+    unsigned sorteio;
+
+    long compilacoes;
+    long atomos;
+    long ts_insercoes;
+    long ts_buscas;
+    long ts_sondagens;          // registros visitados nas buscas
+    long instrucoes;
+    long long bytes_emitidos;
+    long alocacoes;             // registros da TS e vetores de átomos
+    long nos_ast;               // nós da árvore (-O1)
+    long long bytes_ast;        // arena e textos da árvore
+    long pilha_c;               // pico da pilha de C do parser (bytes)
+    long pilha_analise;         // pilhas explícitas do parser (bytes reservados)
+
+    // Preenchidos por est_finalizar (extrapolação e processo inteiro)
+    double parede_total;
+    double cpu_total;
+    long pico_rss_kb;
+} EstatisticasCompilacao;
+
+// Instante de início de uma medição
+typedef struct {
+    double parede;
+    double cpu;
+} MarcaTempo;
+
+// Mede o custo de uma leitura dos relógios (chamar uma vez, antes de medir)
+void est_calibrar();
+
+void est_marcar(MarcaTempo *m);
+void est_acumular(EstatisticasCompilacao *e, FaseCompilacao fase, const MarcaTempo *m);
+
+// Início e fim de uma chamada de uma fase fina
+void est_entrar(EstatisticasCompilacao *e, FaseCompilacao fase, MarcaTempo *m);
+void est_sair(EstatisticasCompilacao *e, FaseCompilacao fase, const MarcaTempo *m);
+
+void est_somar(EstatisticasCompilacao *total, const EstatisticasCompilacao *parcial);
+void est_finalizar(EstatisticasCompilacao *e, const MarcaTempo *inicio);
+void est_relatorio(const EstatisticasCompilacao *e, FILE *saida, int json);
+
+#endif
@@ -0,0 +1,451 @@
+/*
+ * expansao.c - Expansão de sub-rotinas pequenas no lugar das chamadas
+ *
+ * Uma sub-rotina é expansível se é folha (não chama nenhuma, o que também
+ * exclui a recursão) e só tem return como último comando do corpo (ou do
+ * último bloco dele); uma função precisa terminar em return <expressão>.
+ * O tamanho dela é o número de nós vivos do corpo, e a frequência pesa no
+ * limite: numa chamada dentro de laço, que deve repetir, vale o limite
+ * dado; fora de laços, um quarto dele.
+ *
+ * O comando com a chamada vira um AST_BLOCO no mesmo lugar da lista:
+ *   - cada argumento, na ordem, é atribuído à temporária do parâmetro;
+ *   - seguem cópias dos comandos do corpo, com parâmetros e locais trocados
+ *     por temporárias da área de quem chama (o endereço seguinte; ver ast.h)
+ *     e o return final trocado pela atribuição à temporária do resultado;
+ *   - por fim, uma cópia do comando, em que a raiz da chamada vira a leitura
+ *     dessa temporária e o resto dela, AST_MORTO (uma chamada usada como
+ *     comando só deixa o corpo).
+ * Sem o CHPR, a MEPA não empilha resultado, endereço de retorno nem
+ * registro de ativação, e a propagação de constantes, que roda depois,
+ * alcança os argumentos constantes dentro do corpo. Como AMEM, as
+ * temporárias dos locais começam sem valor definido.
+ *
+ * Um comando tem as chamadas expandidas todas ou nenhuma: os corpos rodam
+ * antes do resto da expressão, o que só preserva a ordem das leituras e
+ * escritas se toda chamada sai dela e nenhuma das sub-rotinas atribui uma
+ * global que a expressão lê. As chamadas são tratadas em pós-ordem, então
+ * os argumentos de uma já lêem as temporárias das chamadas dentro deles.
+ * Ficam de fora as condições de laços e a inicialização e o incremento do
+ * for, que não estão numa lista de comandos.
+ *
+ * As sub-rotinas são tratadas na ordem da declaração, e o programa no fim:
+ * uma que só chamava sub-rotinas expandidas vira folha e pode ser expandida
+ * depois.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "expansao.h"
+
+// Sub-rotina, pelo número dado pela semântica
+typedef struct {
+    NoId no;                    // AST_SUBROT (0: não expansível)
+    int n_param, n_locais;
+    long tamanho;               // nós vivos do corpo
+    int valor;                  // termina em return <expressão>
+    size_t escritas, n_escritas; // globais que atribui, em Expansao.escritas
+} Rotina;
+
+// Comandos em construção, encadeados por prox
+typedef struct {
+    NoId primeiro, ultimo;
+} Lista;
+
+typedef struct {
+    ArvoreAST *t;
+    int limite;
+    FILE *relatorio;
+    Rotina *rotinas;
+    int n_rotinas;
+    int *escritas;
+    size_t n_escritas, cap_escritas;
+    int *marca;                 // por global: último comando que a marcou
+    int n_globais;
+    int comando;
+
+    // Área de dados em tratamento
+    int nivel;
+    NoId tamanho;               // nó com as posições da área (u.endereco)
+    int falhou;                 // faltou memória: não expande mais nada
+    long expandidas;
+} Expansao;
+
+static long mais(long a, long b) {
+    return a < 0 || b < 0 ? -1 : a + b;
+}
+
+static int anexar(ArvoreAST *t, Lista *l, NoId id) {
+    if (id == 0) return 0;
+    if (l->ultimo != 0) ast_no(t, l->ultimo)->prox = id;
+    else l->primeiro = id;
+    l->ultimo = id;
+    return 1;
+}
+
+static void juntar(ArvoreAST *t, Lista *l, const Lista *resto) {
+    if (resto->primeiro == 0) return;
+    anexar(t, l, resto->primeiro);
+    l->ultimo = resto->ultimo;
+}
+
+// Global atribuída pela sub-rotina em análise; 0 se faltar memória
+static int anotar_escrita(Expansao *x, Rotina *r, NoId var) {
+    const NoAST *no = ast_no(x->t, var);
+
+    if (no->op != 0) return 1;
+    if (x->n_escritas == x->cap_escritas) {
+        size_t cap = x->cap_escritas ? x->cap_escritas * 2 : 64;
+        int *maior = realloc(x->escritas, sizeof(int) * cap);
+        if (maior == NULL) return 0;
+        x->escritas = maior;
+        x->cap_escritas = cap;
+    }
+    x->escritas[x->n_escritas++] = no->u.endereco;
+    r->n_escritas++;
+    return 1;
+}
+
+// Nós vivos de uma expressão (-1 se ela chama sub-rotina)
+static long examinar_exp(const ArvoreAST *t, NoId raiz) {
+    long n = 0;
+
+    for (NoId id = ast_inicio(t, raiz); id <= raiz; id++) {
+        const NoAST *no = ast_no(t, id);
+        if (no->flags & AST_MORTO) continue;
+        if (no->tipo == AST_CHAMADA) return -1;
+        n++;
+    }
+    return n;
+}
+
+static long examinar_cmd(Expansao *x, Rotina *r, NoId id, int final);
+
+static long examinar_lista(Expansao *x, Rotina *r, NoId id, int final) {
+    long n = 0;
+
+    for (; id != 0 && n >= 0; id = ast_no(x->t, id)->prox) {
+        n = mais(n, examinar_cmd(x, r, id, final && ast_no(x->t, id)->prox == 0));
+    }
+    return n;
+}
+
+// Nós do comando (-1 se ele impede a expansão); final: é o último do corpo
+static long examinar_cmd(Expansao *x, Rotina *r, NoId id, int final) {
+    const ArvoreAST *t = x->t;
+    const NoAST no = *ast_no(t, id);
+    long n;
+
+    switch (no.tipo) {
+        case AST_ATRIB:
+            if (!anotar_escrita(x, r, no.a)) return -1;
+            return mais(examinar_exp(t, no.b), 2);
+        case AST_LEITURA:
+            return anotar_escrita(x, r, no.a) ? 2 : -1;
+        case AST_ESCRITA:
+            return mais(examinar_exp(t, no.a), 1);
+        case AST_TEXTO:
+            return 1;
+        case AST_RETORNO:
+            if (!final) return -1;
+            r->valor = no.a != 0;
+            return no.a != 0 ? mais(examinar_exp(t, no.a), 1) : 1;
+        case AST_SE:
+            n = mais(examinar_exp(t, no.a), examinar_cmd(x, r, no.b, 0));
+            if (no.c != 0) n = mais(n, examinar_cmd(x, r, no.c, 0));
+            return mais(n, 1);
+        case AST_ENQUANTO:
+            return mais(mais(examinar_exp(t, no.a), examinar_cmd(x, r, no.b, 0)), 1);
+        case AST_REPITA:
+            return mais(mais(examinar_lista(x, r, no.a, 0), examinar_exp(t, no.b)), 1);
+        case AST_PARA:
+            n = no.a != 0 ? examinar_cmd(x, r, no.a, 0) : 0;
+            n = mais(n, examinar_exp(t, no.b));
+            n = mais(n, examinar_cmd(x, r, no.c, 0));
+            return mais(mais(n, examinar_cmd(x, r, no.u.d, 0)), 1);
+        case AST_BLOCO:
+            return mais(examinar_lista(x, r, no.a, final), 1);
+        case AST_CHAMADA:
+            return -1;
+        default:
+            return 0;
+    }
+}
+
+// Registra se a sub-rotina, já com as chamadas dela expandidas, é expansível
+static void analisar_rotina(Expansao *x, NoId sub) {
+    const NoAST no = *ast_no(x->t, sub);
+    const NoAST *dcl = ast_no(x->t, no.a);
+    int numero = dcl->u.endereco;
+
+    if (numero <= 0 || numero > x->n_rotinas) return;
+    Rotina *r = &x->rotinas[numero];
+    memset(r, 0, sizeof(*r));
+    for (NoId p = dcl->a; p != 0; p = ast_no(x->t, p)->prox) r->n_param++;
+    r->n_locais = no.u.endereco;
+    r->escritas = x->n_escritas;
+
+    int funcao = dcl->op != sVOID;
+    long tamanho = examinar_cmd(x, r, no.c, 1);
+    if (tamanho < 0 || (funcao && !r->valor)) {
+        x->n_escritas = r->escritas;
+        r->n_escritas = 0;
+        return;
+    }
+    r->no = sub;
+    r->tamanho = tamanho;
+}
+
+// Copia os comandos do corpo para a lista, menos o return final (que pode
+// ser o último comando de blocos): a expressão dele vai em *valor
+static int copiar_corpo(ArvoreAST *t, Lista *lista, NoId id, NoId *valor) {
+    const NoAST no = *ast_no(t, id);
+
+    if (no.tipo == AST_RETORNO) return no.a == 0 || (*valor = ast_copiar(t, no.a)) != 0;
+    if (no.tipo != AST_BLOCO) return anexar(t, lista, ast_copiar_cmd(t, id));
+
+    for (NoId c = no.a; c != 0; c = ast_no(t, c)->prox) {
+        if (ast_no(t, c)->prox == 0) return copiar_corpo(t, lista, c, valor);
+        if (!anexar(t, lista, ast_copiar_cmd(t, c))) return 0;
+    }
+    return 1;
+}
+
+// temporária <- valor (0 se faltar memória ou o valor)
+static NoId atribuicao(Expansao *x, int endereco, uint8_t dado, NoId valor, int linha) {
+    ArvoreAST *t = x->t;
+
+    if (valor == 0) return 0;
+    NoId alvo = ast_novo(t, AST_VAR, linha);
+    NoId atrib = alvo != 0 ? ast_novo(t, AST_ATRIB, linha) : 0;
+    if (atrib == 0) return 0;
+
+    NoAST *no = ast_no(t, alvo);
+    no->op = (uint8_t)x->nivel;
+    no->dado = dado;
+    no->flags = AST_ALVO;
+    no->u.endereco = endereco;
+    no = ast_no(t, atrib);
+    no->op = sATRIB;
+    no->a = alvo;
+    no->b = valor;
+    return atrib;
+}
+
+// Acrescenta à lista os comandos que substituem a chamada e, se o valor é
+// usado, a troca pela temporária do resultado; 0 se faltar memória (a
+// chamada fica como estava)
+static int expandir_chamada(Expansao *x, NoId chamada, int usado, Lista *lista) {
+    ArvoreAST *t = x->t;
+    const NoAST resultado = *ast_no(t, ast_no(t, chamada)->a);
+    const Rotina *r = &x->rotinas[resultado.u.endereco];
+    const NoAST sub = *ast_no(t, r->no);
+    int linha = ast_no(t, chamada)->linha;
+    int funcao = resultado.dado != TIPO_VOID;
+    int base = ast_no(t, x->tamanho)->u.endereco;
+    int temp_resultado = base + r->n_param + r->n_locais;
+    Lista argumentos = { 0, 0 }, corpo = { 0, 0 };
+    NoId valor = 0;
+
+    // O corpo, com as variáveis da sub-rotina (nível 1) trocadas pelas
+    // temporárias: os parâmetros primeiro, depois os locais
+    NoId marca = t->n;
+    if (!copiar_corpo(t, &corpo, sub.c, &valor)) return 0;
+    for (NoId id = marca; id < t->n; id++) {
+        NoAST *no = ast_no(t, id);
+        if (no->tipo != AST_VAR || no->op != 1) continue;
+        int e = no->u.endereco;
+        no->u.endereco = e < 0 ? base + e + r->n_param + 2 : base + r->n_param + e;
+        no->op = (uint8_t)x->nivel;
+    }
+    if (funcao && !anexar(t, &corpo, atribuicao(x, temp_resultado, resultado.dado, valor, linha))) {
+        return 0;
+    }
+
+    NoId param = ast_no(t, sub.a)->a;
+    int endereco = base;
+    for (NoId arg = resultado.a; arg != 0; arg = ast_no(t, arg)->prox) {
+        uint8_t dado = ast_no(t, param)->op;
+        NoId copia = ast_copiar(t, ast_no(t, arg)->a);
+        if (!anexar(t, &argumentos, atribuicao(x, endereco++, dado, copia, linha))) return 0;
+        param = ast_no(t, param)->prox;
+    }
+
+    juntar(t, &argumentos, &corpo);
+    juntar(t, lista, &argumentos);
+    ast_no(t, x->tamanho)->u.endereco = temp_resultado + funcao;
+    x->expandidas++;
+    if (x->relatorio != NULL) {
+        fprintf(x->relatorio, "chamada de %s na linha %d: expandida (%ld nós)\n",
+                ast_lexema(t, &resultado), linha, r->tamanho);
+    }
+
+    if (usado) {
+        for (NoId id = ast_inicio(t, chamada); id < chamada; id++) ast_no(t, id)->flags |= AST_MORTO;
+        NoAST *no = ast_no(t, chamada);
+        no->tipo = AST_VAR;
+        no->op = (uint8_t)x->nivel;
+        no->dado = resultado.dado;
+        no->a = no->b = no->c = 0;
+        no->u.endereco = temp_resultado;
+        no->texto = 0;
+    }
+    return 1;
+}
+
+// Chamada expansível neste comando (dentro de laço ou não)?
+static const Rotina* expansivel(const Expansao *x, const NoAST *chamada, int laco) {
+    int numero = ast_no(x->t, chamada->a)->u.endereco;
+    long limite = laco > 0 ? x->limite : x->limite / 4;
+
+    if (numero <= 0 || numero > x->n_rotinas) return NULL;
+    const Rotina *r = &x->rotinas[numero];
+    return r->no != 0 && r->tamanho <= limite ? r : NULL;
+}
+
+// Expande as chamadas da expressão raiz do comando id (raiz = id numa
+// chamada usada como comando), todas ou nenhuma
+static void expandir_comando(Expansao *x, NoId id, NoId raiz, int laco) {
+    ArvoreAST *t = x->t;
+    NoId inicio = ast_inicio(t, raiz);
+    int n = 0;
+
+    if (x->falhou) return;
+    x->comando++;
+    for (NoId c = inicio; c <= raiz; c++) {
+        const NoAST *no = ast_no(t, c);
+        if (no->tipo != AST_CHAMADA || (no->flags & AST_MORTO)) continue;
+        const Rotina *r = expansivel(x, no, laco);
+        if (r == NULL) return;
+        for (size_t k = r->escritas; k < r->escritas + r->n_escritas; k++) {
+            int e = x->escritas[k];
+            if (e >= 0 && e < x->n_globais) x->marca[e] = x->comando;
+        }
+        n++;
+    }
+    if (n == 0) return;
+    for (NoId v = inicio; v <= raiz; v++) {
+        const NoAST *no = ast_no(t, v);
+        int e = no->u.endereco;
+        if (no->tipo != AST_VAR || (no->flags & AST_MORTO) || no->op != 0) continue;
+        if (e >= 0 && e < x->n_globais && x->marca[e] == x->comando) return;
+    }
+
+    // Uma chamada usada como comando é expandida numa cópia dela, que fica
+    // num intervalo novo; nos outros comandos, a cópia do nó vai no fim
+    int chamada = ast_no(t, id)->tipo == AST_CHAMADA;
+    NoId copia = chamada ? ast_copiar(t, id) : ast_novo(t, AST_NENHUM, 0);
+    if (copia == 0) {
+        x->falhou = 1;
+        return;
+    }
+    if (chamada) raiz = copia;
+
+    Lista lista = { 0, 0 };
+    int raiz_expandida = 0;
+    for (NoId c = ast_inicio(t, raiz); c <= raiz; c++) {
+        const NoAST *no = ast_no(t, c);
+        if (no->tipo != AST_CHAMADA || (no->flags & AST_MORTO)) continue;
+        int usado = !chamada || c != raiz;
+        if (!expandir_chamada(x, c, usado, &lista)) {
+            x->falhou = 1;
+            break;
+        }
+        raiz_expandida = !usado;
+    }
+    if (lista.primeiro == 0) return;
+
+    if (!raiz_expandida) {
+        if (!chamada) *ast_no(t, copia) = *ast_no(t, id);
+        ast_no(t, copia)->prox = 0;
+        anexar(t, &lista, copia);
+    }
+    if (chamada) {
+        for (NoId c = ast_inicio(t, id); c < id; c++) ast_no(t, c)->flags |= AST_MORTO;
+    }
+    NoAST *bloco = ast_no(t, id);
+    bloco->tipo = AST_BLOCO;
+    bloco->op = bloco->dado = bloco->flags = 0;
+    bloco->a = lista.primeiro;
+    bloco->b = bloco->c = 0;
+    bloco->u.d = 0;
+    bloco->texto = 0;
+}
+
+static void expandir_cmd(Expansao *x, NoId id, int laco);
+
+static void expandir_lista(Expansao *x, NoId id, int laco) {
+    for (; id != 0; id = ast_no(x->t, id)->prox) expandir_cmd(x, id, laco);
+}
+
+// laco: profundidade de laços em volta do comando
+static void expandir_cmd(Expansao *x, NoId id, int laco) {
+    const NoAST no = *ast_no(x->t, id);
+
+    switch (no.tipo) {
+        case AST_ATRIB:
+            expandir_comando(x, id, no.b, laco);
+            break;
+        case AST_ESCRITA:
+            expandir_comando(x, id, no.a, laco);
+            break;
+        case AST_RETORNO:
+            if (no.a != 0) expandir_comando(x, id, no.a, laco);
+            break;
+        case AST_CHAMADA:
+            expandir_comando(x, id, id, laco);
+            break;
+        case AST_SE:
+            expandir_comando(x, id, no.a, laco);
+            expandir_cmd(x, no.b, laco);
+            if (no.c != 0) expandir_cmd(x, no.c, laco);
+            break;
+        case AST_ENQUANTO:
+            expandir_cmd(x, no.b, laco + 1);
+            break;
+        case AST_REPITA:
+            expandir_lista(x, no.a, laco + 1);
+            break;
+        case AST_PARA:
+            expandir_cmd(x, no.u.d, laco + 1);
+            break;
+        case AST_BLOCO:
+            expandir_lista(x, no.a, laco);
+            break;
+        default:
+            break;
+    }
+}
+
+long expandir_chamadas(ArvoreAST *t, int limite, FILE *relatorio) {
+    const NoAST *prg = ast_no(t, t->raiz);
+    NoId dcl_prg = prg->a, corpo_prg = prg->c, subs = prg->u.d;
+    Expansao x;
+
+    if (limite <= 0) return 0;
+    memset(&x, 0, sizeof(x));
+    x.t = t;
+    x.limite = limite;
+    x.relatorio = relatorio;
+    for (NoId sub = subs; sub != 0; sub = ast_no(t, sub)->prox) x.n_rotinas++;
+    x.n_globais = ast_no(t, dcl_prg)->u.endereco;
+    x.rotinas = calloc((size_t)x.n_rotinas + 1, sizeof(Rotina));
+    x.marca = calloc((size_t)x.n_globais + 1, sizeof(int));
+
+    if (x.rotinas != NULL && x.marca != NULL) {
+        x.nivel = 1;
+        for (NoId sub = subs; sub != 0; sub = ast_no(t, sub)->prox) {
+            x.tamanho = sub;
+            expandir_cmd(&x, ast_no(t, sub)->c, 0);
+            analisar_rotina(&x, sub);
+        }
+        x.nivel = 0;
+        x.tamanho = dcl_prg;
+        expandir_cmd(&x, corpo_prg, 0);
+    }
+
+    free(x.rotinas);
+    free(x.marca);
+    free(x.escritas);
+    return x.expandidas;
+}
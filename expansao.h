@@ -0,0 +1,22 @@
+/*
+ * expansao.h - Expansão de sub-rotinas pequenas no lugar das chamadas (modo -O1)
+ */
+
+#ifndef EXPANSAO_H
+#define EXPANSAO_H
+
+#include <stdio.h>
+#include "ast.h"
+
+// Tamanho máximo padrão (em nós) de uma sub-rotina expandida numa chamada
+// dentro de laço; fora de laços, o limite é um quarto dele
+#define EXPANDIR_PADRAO 64
+
+// Troca as chamadas de sub-rotinas folha pequenas pelo corpo delas, com
+// parâmetros, locais e resultado em temporárias da área de quem chama,
+// numa árvore já checada pela semântica e com as constantes dobradas. Com
+// relatorio, escreve nele uma linha por chamada expandida. Retorna o
+// número de chamadas expandidas.
+long expandir_chamadas(ArvoreAST *t, int limite, FILE *relatorio);
+
+#endif
@@ -2,35 +2,546 @@
  * gerador.c - Implementação do Gerador de Código MEPA
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "gerador.h"
+#include "mepainstr.h"
 
-// Variáveis globais do gerador
-static FILE *arquivo_saida = NULL;
-static int contador_rotulo = 1;
-static char rotulo_buffer[20];
+// Espaço que sobra no bloco para a maior linha (rótulos e operandos têm
+// menos de 20 caracteres)
+#define MAIOR_LINHA 128
 
 // Inicializa o gerador de código
-void inicializar_gerador(FILE *arquivo) {
-    arquivo_saida = arquivo;
-    contador_rotulo = 1;
+void inicializar_gerador(GeradorMEPA *g, FILE *arquivo) {
+    g->arquivo_saida = arquivo;
+    g->contador_rotulo = 1;
+    g->rotulo_buffer[0] = '\0';
+    g->est = NULL;
+    g->abertos = NULL;
+    g->n_abertos = g->cap_abertos = 0;
+    g->direto = 0;
+    g->fd = -1;
+    g->bloco = NULL;
+    g->usado = 0;
+    g->inicio_bloco = 0;
+    g->instrucao = 0;
+    g->falhou = 0;
+    g->pos_cabecalho = -2;
+    g->prof = -1;
+    g->rotina = 0;
+    g->dados = 0;
+    g->max_principal = 0;
+    g->max_rotina = 0;
+    g->sem_limite = 0;
+    g->juncao_divergente = -1;
+    g->necessidade = NULL;
+    g->n_param = NULL;
+    g->cap_subs = 0;
+    g->cadeias = NULL;
+    g->n_cadeias = g->cap_cadeias = 0;
+    g->indice_cadeias = NULL;
+    g->cap_indice = 0;
 }
 
-// Finaliza o gerador (adiciona marcador de fim)
-void finalizar_gerador() {
-    if (arquivo_saida != NULL) {
-        fprintf(arquivo_saida, "FIM\n");
-        fflush(arquivo_saida);
+// Descritor de um arquivo comum em que se pode gravar fora do fim (sem
+// O_APPEND, que faz o pwrite gravar no fim); -1 para os demais fluxos
+static int descritor_posicionavel(FILE *arquivo) {
+    struct stat st;
+    int fd = fileno(arquivo);
+
+    if (fd < 0) return -1;
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || (flags & O_APPEND)) return -1;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) return -1;
+    return fd;
+}
+
+int gerador_desvios_diretos(GeradorMEPA *g) {
+    if (g->arquivo_saida == NULL || g->direto) return g->direto;
+
+    // Os campos provisórios são relidos com pread
+    int fd = descritor_posicionavel(g->arquivo_saida);
+    if (fd < 0 || fflush(g->arquivo_saida) != 0) return 0;
+    if ((fcntl(fd, F_GETFL) & O_ACCMODE) != O_RDWR) return 0;
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    if (pos < 0) return 0;
+
+    g->bloco = malloc(BLOCO_EMISSAO);
+    if (g->bloco == NULL) return 0;
+    g->fd = fd;
+    g->inicio_bloco = pos;
+    g->direto = 1;
+    return 1;
+}
+
+// Grava o bloco no arquivo e o esvazia
+static void gravar_bloco(GeradorMEPA *g) {
+    size_t feito = 0;
+
+    while (feito < g->usado) {
+        ssize_t n = write(g->fd, g->bloco + feito, g->usado - feito);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            g->falhou = 1;
+            break;
+        }
+        feito += (size_t)n;
     }
+    g->inicio_bloco += (long long)g->usado;
+    g->usado = 0;
 }
 
-// Gera uma instrução MEPA no arquivo de saída
-void gera_instr_mepa(const char *rotulo, const char *mnemonico, 
-                     const char *parametro1, const char *parametro2) {
-    if (arquivo_saida == NULL) return;
-    
+// Reescreve tam bytes na posição pos da saída: no bloco, se ainda não foi
+// gravado, senão direto no arquivo
+static void corrigir(GeradorMEPA *g, long long pos, const char *texto, int tam) {
+    if (g->direto && pos >= g->inicio_bloco) {
+        memcpy(g->bloco + (pos - g->inicio_bloco), texto, (size_t)tam);
+        return;
+    }
+    if (!g->direto && fileno(g->arquivo_saida) < 0) {
+        // Buffer em memória: volta ao fim depois de reescrever
+        FILE *f = g->arquivo_saida;
+        off_t fim = ftello(f);
+        if (fim < 0 || fseeko(f, (off_t)pos, SEEK_SET) != 0 ||
+            fwrite(texto, 1, (size_t)tam, f) != (size_t)tam || fseeko(f, fim, SEEK_SET) != 0) {
+            g->falhou = 1;
+        }
+        return;
+    }
+    if (!g->direto && fflush(g->arquivo_saida) != 0) {
+        g->falhou = 1;
+        return;
+    }
+    if (pwrite(fileno(g->arquivo_saida), texto, (size_t)tam, (off_t)pos) != tam) g->falhou = 1;
+}
+
+// Lê o campo de desvio na posição pos do arquivo (no bloco, se ainda não
+// foi gravado): a posição do campo anterior da cadeia
+static long long ler_campo(GeradorMEPA *g, long long pos) {
+    char campo[LARGURA_DESVIO + 1];
+
+    if (pos >= g->inicio_bloco) {
+        memcpy(campo, g->bloco + (pos - g->inicio_bloco), LARGURA_DESVIO);
+    } else if (pread(g->fd, campo, LARGURA_DESVIO, (off_t)pos) != LARGURA_DESVIO) {
+        g->falhou = 1;
+        return -1;
+    }
+    campo[LARGURA_DESVIO] = '\0';
+    return strtoll(campo, NULL, 10);
+}
+
+// Número n de um rótulo L<n> (ou R<n>, com prefixo 'R'); -1 para outros textos
+static int numero_rotulo(const char *s, char prefixo) {
+    if (s == NULL || s[0] != prefixo || s[1] < '0' || s[1] > '9') return -1;
+    return atoi(s + 1);
+}
+
+// Entrada do rótulo L<numero> na tabela, criada se preciso. Os mais
+// recentes (os mais internos) ficam no fim
+static RotuloAberto* abrir_rotulo(GeradorMEPA *g, int numero) {
+    for (int i = g->n_abertos - 1; i >= 0; i--) {
+        if (g->abertos[i].numero == numero) return &g->abertos[i];
+    }
+    if (g->n_abertos == g->cap_abertos) {
+        int nova = g->cap_abertos ? g->cap_abertos * 2 : 16;
+        RotuloAberto *v = realloc(g->abertos, sizeof(RotuloAberto) * nova);
+        if (v == NULL) {
+            g->falhou = 1;
+            return NULL;
+        }
+        g->abertos = v;
+        g->cap_abertos = nova;
+    }
+    RotuloAberto *r = &g->abertos[g->n_abertos++];
+    r->numero = numero;
+    r->endereco = -1;
+    r->cadeia = -1;
+    r->desvios = 0;
+    r->profundidade = -1;
+    r->rotina = 0;
+    return r;
+}
+
+static void fechar_rotulo(GeradorMEPA *g, RotuloAberto *r) {
+    *r = g->abertos[--g->n_abertos];
+}
+
+// Dois caminhos chegam ao rótulo L<numero> com pilhas de tamanhos
+// diferentes: o código gerado está errado (ver juncao_divergente)
+static void juntar(GeradorMEPA *g, int numero, int *prof, int outra) {
+    if (*prof >= 0 && outra >= 0 && *prof != outra) {
+        if (g->juncao_divergente < 0) g->juncao_divergente = numero;
+        g->sem_limite = 1;
+    }
+    if (*prof < 0) *prof = outra;
+}
+
+// Novo máximo da pilha da rotina atual. Num trecho de uma sub-rotina já
+// terminada (ver definir_rotulo), a necessidade guardada no RTPR também
+// aumenta: ninguém a chamou ainda, pois o trecho vem logo depois dela
+static void subir(GeradorMEPA *g, int pico) {
+    if (g->rotina == 0) {
+        if (pico > g->max_principal) g->max_principal = pico;
+        return;
+    }
+    if (pico <= g->max_rotina) return;
+    g->max_rotina = pico;
+    if (g->rotina < g->cap_subs && g->necessidade[g->rotina] >= 0) {
+        g->necessidade[g->rotina] = pico;
+    }
+}
+
+// Define L<numero> na próxima instrução: a pilha ali é a dos desvios que
+// chegam e, no modo direto, os campos deles recebem o endereço. Sem
+// nenhum desvio, o rótulo fica à espera do desvio de volta
+static void definir_rotulo(GeradorMEPA *g, int numero) {
+    RotuloAberto *r = abrir_rotulo(g, numero);
+    if (r == NULL) return;
+
+    // Num ponto inalcançável pelo texto, um rótulo com desvios começa um
+    // trecho da rotina deles fora de ordem, depois do RTPR ou do PARA
+    // (blocos frios do layout guiado por perfil, gerador_ast.c)
+    if (g->prof < 0 && r->profundidade >= 0 && r->rotina != g->rotina) {
+        g->rotina = r->rotina;
+        if (r->rotina > 0) {
+            g->max_rotina = r->rotina < g->cap_subs ? g->necessidade[r->rotina] : -1;
+        }
+    }
+    juntar(g, numero, &g->prof, r->profundidade);
+    r->profundidade = g->prof;
+    r->endereco = g->instrucao;
+    if (r->desvios == 0) return;
+    if (g->direto) {
+        char campo[LARGURA_DESVIO + 1];
+        snprintf(campo, sizeof(campo), "%*ld", LARGURA_DESVIO, r->endereco);
+        for (long long pos = r->cadeia; pos >= 0 && !g->falhou; ) {
+            long long anterior = ler_campo(g, pos);
+            corrigir(g, pos, campo, LARGURA_DESVIO);
+            pos = anterior;
+        }
+    }
+    fechar_rotulo(g, r);
+}
+
+// Desvio para L<numero> com a pilha atual. No modo direto, escreve em
+// campo o operando: o endereço (desvio de volta, o único para o rótulo) ou
+// o elo da cadeia (para frente; pos é a posição do campo no arquivo)
+static void desviar(GeradorMEPA *g, int numero, char campo[LARGURA_DESVIO + 1], long long pos) {
+    RotuloAberto *r = abrir_rotulo(g, numero);
+    if (r == NULL) return;
+
+    if (g->prof >= 0) r->rotina = g->rotina;
+    if (r->endereco >= 0) {
+        juntar(g, numero, &r->profundidade, g->prof);
+        if (campo != NULL) snprintf(campo, LARGURA_DESVIO + 1, "%*ld", LARGURA_DESVIO, r->endereco);
+        fechar_rotulo(g, r);
+        return;
+    }
+    juntar(g, numero, &r->profundidade, g->prof);
+    r->desvios++;
+    if (campo != NULL) {
+        snprintf(campo, LARGURA_DESVIO + 1, "%*lld", LARGURA_DESVIO, r->cadeia);
+        r->cadeia = pos;
+    }
+}
+
+// Guarda a pilha e os parâmetros da sub-rotina k, aumentando os vetores
+// se preciso
+static int guardar_sub(GeradorMEPA *g, int k, int necessidade, int n_param) {
+    if (k >= g->cap_subs) {
+        int nova = g->cap_subs ? g->cap_subs : 16;
+        while (nova <= k) nova *= 2;
+        int *v = realloc(g->necessidade, sizeof(int) * nova);
+        if (v == NULL) return 0;
+        g->necessidade = v;
+        v = realloc(g->n_param, sizeof(int) * nova);
+        if (v == NULL) return 0;
+        g->n_param = v;
+        for (int i = g->cap_subs; i < nova; i++) g->necessidade[i] = -1;
+        g->cap_subs = nova;
+    }
+    g->necessidade[k] = necessidade;
+    g->n_param[k] = n_param;
+    return 1;
+}
+
+// Efeito da instrução op sobre o número de células da pilha (mepainstr.h;
+// chamadas e retornos à parte)
+static int efeito_pilha(int op, const char *parametro1) {
+    const InstrucaoMEPA *in = &instrucoes_mepa[op];
+    if (in->por_parametro == 0) return in->efeito;
+    return in->efeito + in->por_parametro * (parametro1 != NULL ? atoi(parametro1) : 0);
+}
+
+// Acompanha a pilha ao longo da instrução (antes dos desvios). A pilha de
+// uma sub-rotina conta a partir da chamada: endereço de retorno e D[k] do
+// ENPR, locais, operandos e as chamadas que ela faz
+static void acompanhar_pilha(GeradorMEPA *g, const char *rotulo, int op,
+                             const char *parametro1, const char *parametro2) {
+    int k;
+
+    if (op == OP_INPP) {
+        g->rotina = 0;
+        g->prof = 0;
+        g->dados = -1;
+        return;
+    }
+    if (g->dados < 0) {
+        // Área de dados: o AMEM logo depois do INPP, se houver
+        g->dados = op == OP_AMEM ? atoi(parametro1) : 0;
+    }
+    if (op == OP_ENPR) {
+        k = numero_rotulo(rotulo, 'R');
+        g->rotina = k > 0 ? k : 0;
+        g->prof = 2;
+        g->max_rotina = 2;
+        if (k <= 0) g->sem_limite = 1;
+        return;
+    }
+    if (op == OP_RTPR) {
+        // Sem retorno alcançável, as chamadas a ela ficam sem limite
+        if (g->rotina > 0 && g->prof >= 0 &&
+            !guardar_sub(g, g->rotina, g->max_rotina, atoi(parametro2))) {
+            g->sem_limite = 1;
+        }
+        g->rotina = 0;      // o que vem depois é outra sub-rotina ou o principal
+        g->prof = -1;
+        return;
+    }
+    if (g->prof < 0) return;
+
+    if (op == OP_CHPR) {
+        k = numero_rotulo(parametro1, 'R');
+        if (k <= 0 || k >= g->cap_subs || g->necessidade[k] < 0) {
+            // Recursão (a sub-rotina ainda não terminou): sem limite
+            g->sem_limite = 1;
+            g->prof = -1;
+            return;
+        }
+        subir(g, g->prof + g->necessidade[k]);
+        g->prof -= g->n_param[k];
+        return;
+    }
+    if (op == OP_PARA) {
+        g->prof = -1;
+        return;
+    }
+    if (op < 0) {
+        // Instrução desconhecida: efeito sobre a pilha também
+        g->sem_limite = 1;
+        g->prof = -1;
+        return;
+    }
+
+    g->prof += efeito_pilha(op, parametro1);
+    if (g->prof < 0) {
+        g->sem_limite = 1;
+        g->prof = -1;
+    } else {
+        subir(g, g->prof);
+    }
+}
+
+// Acrescenta s na posição n da linha; retorna a nova posição
+static int acrescentar(char *linha, int n, const char *s) {
+    size_t tam = strlen(s);
+    memcpy(linha + n, s, tam);
+    return n + (int)tam;
+}
+
+// Escreve uma instrução no bloco, no modo de desvios diretos
+static void emitir_direto(GeradorMEPA *g, const char *rotulo, const char *mnemonico,
+                          const char *parametro1, const char *parametro2) {
+    int n = 0;
+
+    if (BLOCO_EMISSAO - g->usado < MAIOR_LINHA) gravar_bloco(g);
+    char *linha = g->bloco + g->usado;
+
+    if (rotulo != NULL && rotulo[0] != '\0') {
+        n = acrescentar(linha, n, rotulo);
+        n = acrescentar(linha, n, ": ");
+    }
+    n = acrescentar(linha, n, mnemonico);
+    if (parametro1 != NULL && parametro1[0] != '\0') {
+        linha[n++] = ' ';
+        n = acrescentar(linha, n, parametro1);
+        if (parametro2 != NULL && parametro2[0] != '\0') {
+            linha[n++] = ',';
+            n = acrescentar(linha, n, parametro2);
+        }
+    }
+    linha[n++] = '\n';
+    g->usado += (size_t)n;
+}
+
+// Escreve texto na saída (fora das instruções: tabela de cadeias,
+// cabeçalho e FIM)
+static void escrever_texto(GeradorMEPA *g, const char *texto) {
+    if (!g->direto) {
+        fputs(texto, g->arquivo_saida);
+        return;
+    }
+    for (size_t tam = strlen(texto); tam > 0; ) {
+        if (g->usado == BLOCO_EMISSAO) gravar_bloco(g);
+        size_t n = BLOCO_EMISSAO - g->usado;
+        if (n > tam) n = tam;
+        memcpy(g->bloco + g->usado, texto, n);
+        g->usado += n;
+        texto += n;
+        tam -= n;
+    }
+}
+
+// Posição atual da saída (-1 se ela não pode ser reescrita)
+static long long posicao(GeradorMEPA *g) {
+    if (g->direto) return g->inicio_bloco + (long long)g->usado;
+    if (fileno(g->arquivo_saida) >= 0 && descritor_posicionavel(g->arquivo_saida) < 0) return -1;
+    return (long long)ftello(g->arquivo_saida);
+}
+
+// Texto do cabeçalho com os valores atuais
+static void formatar_cabecalho(GeradorMEPA *g, char *texto, size_t tam) {
+    int dados = g->dados > 0 ? g->dados : 0;
+    int pilha = g->sem_limite ? -1 : g->max_principal - dados;
+    snprintf(texto, tam, "# MEPA dados=%*d pilha=%*d\n", LARGURA_CABECALHO, dados,
+             LARGURA_CABECALHO, pilha);
+}
+
+// Cabeçalho provisório na primeira linha, completado em finalizar_gerador.
+// Numa saída que não pode ser reescrita, nada é reservado: a linha vai no
+// fim, antes do FIM, e o código continua saindo à medida que é gerado
+static void reservar_cabecalho(GeradorMEPA *g) {
+    char cabecalho[64];
+
+    g->pos_cabecalho = posicao(g);
+    if (g->pos_cabecalho < 0) return;
+    formatar_cabecalho(g, cabecalho, sizeof(cabecalho));
+    escrever_texto(g, cabecalho);
+}
+
+static unsigned hash_cadeia(const char *s) {
+    unsigned h = 2166136261u;
+    while (*s) {
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    }
+    return h;
+}
+
+// Posição de texto na tabela de espalhamento (a dele ou a vazia onde entra)
+static int* vaga_cadeia(const GeradorMEPA *g, const char *texto) {
+    unsigned mascara = (unsigned)g->cap_indice - 1;
+    unsigned i = hash_cadeia(texto) & mascara;
+    while (g->indice_cadeias[i] != 0 &&
+           strcmp(g->cadeias[g->indice_cadeias[i] - 1], texto) != 0) {
+        i = (i + 1) & mascara;
+    }
+    return &g->indice_cadeias[i];
+}
+
+// Dobra a tabela de espalhamento, reinserindo as entradas
+static int crescer_indice(GeradorMEPA *g) {
+    int nova = g->cap_indice ? g->cap_indice * 2 : 64;
+    int *v = calloc((size_t)nova, sizeof(int));
+    if (v == NULL) return 0;
+    free(g->indice_cadeias);
+    g->indice_cadeias = v;
+    g->cap_indice = nova;
+    for (int k = 0; k < g->n_cadeias; k++) *vaga_cadeia(g, g->cadeias[k]) = k + 1;
+    return 1;
+}
+
+int gerador_cadeia(GeradorMEPA *g, const char *texto) {
+    if ((g->n_cadeias + 1) * 2 > g->cap_indice && !crescer_indice(g)) return -1;
+    int *vaga = vaga_cadeia(g, texto);
+    if (*vaga != 0) return *vaga - 1;
+
+    if (g->n_cadeias == g->cap_cadeias) {
+        int nova = g->cap_cadeias ? g->cap_cadeias * 2 : 16;
+        char **v = realloc(g->cadeias, sizeof(char*) * nova);
+        if (v == NULL) return -1;
+        g->cadeias = v;
+        g->cap_cadeias = nova;
+    }
+    char *copia = malloc(strlen(texto) + 1);
+    if (copia == NULL) return -1;
+    strcpy(copia, texto);
+    g->cadeias[g->n_cadeias++] = copia;
+    *vaga = g->n_cadeias;
+    return g->n_cadeias - 1;
+}
+
+const char* gerador_texto_cadeia(const GeradorMEPA *g, int k) {
+    return k >= 0 && k < g->n_cadeias ? g->cadeias[k] : NULL;
+}
+
+void gera_impressao_cadeia(GeradorMEPA *g, const char *texto) {
+    char indice[20];
+    int k = gerador_cadeia(g, texto);
+
+    if (k < 0) {
+        g->falhou = 1;
+        return;
+    }
+    snprintf(indice, sizeof(indice), "%d", k);
+    gera_instr_mepa(g, NULL, "IMPS", indice, NULL);
+}
+
+// Linha CADEIA k "texto" da entrada k
+static void escrever_cadeia(GeradorMEPA *g, int k) {
+    const char *s = g->cadeias[k];
+    char *linha = malloc(strlen(s) * 2 + 32);
+    int n;
+
+    if (linha == NULL) {
+        g->falhou = 1;
+        return;
+    }
+    n = snprintf(linha, 32, "CADEIA %d \"", k);
+    for (; *s; s++) {
+        switch (*s) {
+            case '\\': linha[n++] = '\\'; linha[n++] = '\\'; break;
+            case '"':  linha[n++] = '\\'; linha[n++] = '"'; break;
+            case '\n': linha[n++] = '\\'; linha[n++] = 'n'; break;
+            case '\t': linha[n++] = '\\'; linha[n++] = 't'; break;
+            default:   linha[n++] = *s; break;
+        }
+    }
+    linha[n++] = '"';
+    linha[n++] = '\n';
+    linha[n] = '\0';
+    escrever_texto(g, linha);
+    free(linha);
+}
+
+// Finaliza o gerador (adiciona a tabela de cadeias e o marcador de fim)
+int finalizar_gerador(GeradorMEPA *g) {
+    char cabecalho[64];
+
+    if (g->arquivo_saida == NULL) return 1;
+
+    if (g->pos_cabecalho == -2) reservar_cabecalho(g);
+    for (int k = 0; k < g->n_cadeias; k++) escrever_cadeia(g, k);
+    formatar_cabecalho(g, cabecalho, sizeof(cabecalho));
+    if (g->pos_cabecalho >= 0) corrigir(g, g->pos_cabecalho, cabecalho, (int)strlen(cabecalho));
+    else escrever_texto(g, cabecalho);
+    escrever_texto(g, "FIM\n");
+
+    if (g->direto) gravar_bloco(g);
+    else if (fflush(g->arquivo_saida) != 0) g->falhou = 1;
+    return !g->falhou;
+}
+
+// Escreve uma instrução MEPA no arquivo de saída
+static void emitir(FILE *arquivo_saida, const char *rotulo, const char *mnemonico,
+                   const char *parametro1, const char *parametro2) {
+
     // Escrever rótulo (se fornecido)
     if (rotulo != NULL && strlen(rotulo) > 0) {
         fprintf(arquivo_saida, "%s: ", rotulo);
@@ -55,21 +566,108 @@ void gera_instr_mepa(const char *rotulo, const char *mnemonico,
     fprintf(arquivo_saida, "\n");
 }
 
+// Tamanho em bytes da linha que emitir escreve. Calculado à parte: usar o
+// retorno de fprintf impediria o GCC de trocá-lo por fputs/fputc.
+static int tamanho_instr(const char *rotulo, const char *mnemonico,
+                         const char *parametro1, const char *parametro2) {
+    int bytes = (int)strlen(mnemonico) + 1;
+    
+    if (rotulo != NULL && strlen(rotulo) > 0) bytes += (int)strlen(rotulo) + 2;
+    if (parametro1 != NULL && strlen(parametro1) > 0) {
+        bytes += (int)strlen(parametro1) + 1;
+        if (parametro2 != NULL && strlen(parametro2) > 0) bytes += (int)strlen(parametro2) + 1;
+    }
+    return bytes;
+}
+
+static void escrever(GeradorMEPA *g, const char *rotulo, const char *mnemonico,
+                     const char *parametro1, const char *parametro2) {
+    if (g->direto) emitir_direto(g, rotulo, mnemonico, parametro1, parametro2);
+    else emitir(g->arquivo_saida, rotulo, mnemonico, parametro1, parametro2);
+}
+
+// Gera uma instrução MEPA no arquivo de saída
+void gera_instr_mepa(GeradorMEPA *g, const char *rotulo, const char *mnemonico, 
+                     const char *parametro1, const char *parametro2) {
+    char campo[LARGURA_DESVIO + 1];
+    int numero;
+    int op = mepa_op_por_nome(mnemonico);
+
+    if (g->arquivo_saida == NULL) return;
+    
+    // Antes da primeira instrução, o cabeçalho provisório
+    if (g->pos_cabecalho == -2) reservar_cabecalho(g);
+
+    // Rótulos L<n> e desvios para eles: pilha nas junções e, no modo
+    // direto, endereços no lugar dos rótulos
+    numero = numero_rotulo(rotulo, 'L');
+    if (numero >= 0) {
+        definir_rotulo(g, numero);
+        if (g->direto) rotulo = NULL;
+    }
+    acompanhar_pilha(g, rotulo, op, parametro1, parametro2);
+    numero = -1;
+    if (op == OP_DSVS || op == OP_DSVF) {
+        numero = numero_rotulo(parametro1, 'L');
+    }
+    if (numero >= 0) {
+        long long pos = 0;
+        if (g->direto) {
+            pos = g->inicio_bloco + (long long)g->usado + (long long)strlen(mnemonico) + 1;
+            if (rotulo != NULL && rotulo[0] != '\0') pos += (long long)strlen(rotulo) + 2;
+        }
+        desviar(g, numero, g->direto ? campo : NULL, pos);
+        if (g->direto) parametro1 = campo;
+    }
+    if (op == OP_DSVS) g->prof = -1;
+    g->instrucao++;
+    
+    if (!EST_ATIVO(g->est)) {
+        escrever(g, rotulo, mnemonico, parametro1, parametro2);
+        return;
+    }
+    
+    long long antes = g->inicio_bloco + (long long)g->usado;
+    MarcaTempo m;
+    est_entrar(g->est, FASE_EMISSAO, &m);
+    escrever(g, rotulo, mnemonico, parametro1, parametro2);
+    est_sair(g->est, FASE_EMISSAO, &m);
+    g->est->instrucoes++;
+    if (g->direto) g->est->bytes_emitidos += g->inicio_bloco + (long long)g->usado - antes;
+    else g->est->bytes_emitidos += tamanho_instr(rotulo, mnemonico, parametro1, parametro2);
+}
+
 // Gera um novo rótulo único
-char* novo_rotulo() {
-    snprintf(rotulo_buffer, sizeof(rotulo_buffer), "L%d", contador_rotulo);
-    contador_rotulo++;
-    return rotulo_buffer;
+char* novo_rotulo(GeradorMEPA *g) {
+    snprintf(g->rotulo_buffer, sizeof(g->rotulo_buffer), "L%d", g->contador_rotulo);
+    g->contador_rotulo++;
+    return g->rotulo_buffer;
 }
 
 // Obtém o rótulo atual (último gerado) sem incrementar
-char* obter_rotulo_atual() {
-    snprintf(rotulo_buffer, sizeof(rotulo_buffer), "L%d", contador_rotulo - 1);
-    return rotulo_buffer;
+char* obter_rotulo_atual(GeradorMEPA *g) {
+    snprintf(g->rotulo_buffer, sizeof(g->rotulo_buffer), "L%d", g->contador_rotulo - 1);
+    return g->rotulo_buffer;
 }
 
 // Libera recursos do gerador
-void liberar_gerador() {
-    arquivo_saida = NULL;
-    contador_rotulo = 1;
+void liberar_gerador(GeradorMEPA *g) {
+    g->arquivo_saida = NULL;
+    g->contador_rotulo = 1;
+    free(g->bloco);
+    g->bloco = NULL;
+    free(g->abertos);
+    g->abertos = NULL;
+    g->n_abertos = g->cap_abertos = 0;
+    g->direto = 0;
+    free(g->necessidade);
+    free(g->n_param);
+    g->necessidade = g->n_param = NULL;
+    g->cap_subs = 0;
+    for (int k = 0; k < g->n_cadeias; k++) free(g->cadeias[k]);
+    free(g->cadeias);
+    free(g->indice_cadeias);
+    g->cadeias = NULL;
+    g->indice_cadeias = NULL;
+    g->n_cadeias = g->cap_cadeias = g->cap_indice = 0;
 }
\ No newline at end of file
@@ -6,20 +6,119 @@
 #define GERADOR_H
 
 #include <stdio.h>
+#include "estatisticas.h"
 
-// Funções de inicialização e finalização
-void inicializar_gerador(FILE *arquivo);
-void finalizar_gerador();
+// Modo de desvios diretos: os operandos de DSVS e DSVF saem como o número
+// da instrução de destino, num campo de LARGURA_DESVIO colunas (alinhado à
+// direita), e as linhas rotuladas com L<n> perdem o rótulo. Um desvio para
+// frente sai com o campo provisório e é corrigido no lugar (pwrite) quando
+// o rótulo é definido; enquanto isso, o campo guarda a posição no arquivo
+// do desvio anterior para o mesmo rótulo, formando uma cadeia. As linhas
+// vão para o arquivo em blocos de BLOCO_EMISSAO bytes.
+//
+// A memória fica proporcional ao aninhamento, e não ao tamanho do programa,
+// porque os geradores usam cada rótulo L<n> de um jeito só: ou todos os
+// desvios vêm antes da definição (if, saída de laço, retorno), e o rótulo
+// sai da tabela ao ser definido, ou vem um único desvio depois dela (volta
+// de while, repeat e for), e o rótulo sai da tabela nesse desvio. Rótulos
+// R<n> das sub-rotinas (CHPR) continuam simbólicos.
+#define LARGURA_DESVIO 12
+#define BLOCO_EMISSAO (1 << 20)
+
+// Cabeçalho do código: primeira linha do arquivo, "# MEPA dados=D pilha=P",
+// com os números em campos de LARGURA_CABECALHO colunas, preenchidos no fim
+// (pwrite). D é a área de dados globais (AMEM do programa principal) e P o
+// máximo de células acima dela durante a execução (operandos, parâmetros e
+// registros de ativação das chamadas), calculado estaticamente enquanto as
+// instruções são geradas; -1 se o programa for recursivo. Num buffer em
+// memória (open_memstream) a linha é reescrita com fseeko. Numa saída que
+// não se pode reescrever (pipe, O_APPEND), a linha vai logo antes do FIM,
+// para que o código saia à medida que é gerado.
+#define LARGURA_CABECALHO 10
+
+// Tabela de cadeias: o texto de cada write com uma constante cadeia ou
+// caractere fica uma vez só na tabela, e a instrução IMPS k imprime a
+// entrada k (seguida de fim de linha). A tabela vai no fim do código, antes
+// do FIM, uma linha por entrada na ordem dos índices: CADEIA k "texto",
+// com \\, \", \n e \t escapados.
+
+// Rótulo L<n> ainda em uso (para a profundidade da pilha e, no modo de
+// desvios diretos, para os endereços)
+typedef struct {
+    int numero;
+    long endereco;              // instrução rotulada (-1: ainda não definido)
+    long long cadeia;           // posição do último campo provisório (-1: nenhum)
+    int desvios;                // desvios para ele antes da definição
+    int profundidade;           // células na pilha ao chegar nele (-1: nenhum desvio)
+    int rotina;                 // rotina dos desvios (ver GeradorMEPA.rotina)
+} RotuloAberto;
+
+// Estado do gerador de uma compilação
+typedef struct {
+    FILE *arquivo_saida;
+    int contador_rotulo;
+    char rotulo_buffer[20];
+    EstatisticasCompilacao *est; // NULL: sem medição
+    RotuloAberto *abertos;
+    int n_abertos, cap_abertos;
+
+    // Modo de desvios diretos (ver gerador_desvios_diretos)
+    int direto;
+    int fd;
+    char *bloco;                // linhas ainda não gravadas
+    size_t usado;
+    long long inicio_bloco;     // posição no arquivo do início do bloco
+    long instrucao;             // número da próxima instrução
+    int falhou;                 // erro de gravação
+
+    // Profundidade da pilha (ver LARGURA_CABECALHO)
+    long long pos_cabecalho;    // posição da linha (-1: vai no fim; -2: ainda não escrita)
+    int prof;                   // células acima da base da rotina atual (-1: inalcançável)
+    int rotina;                 // 0: programa principal; k: sub-rotina R<k>
+    int dados;                  // AMEM do início do programa principal
+    int max_principal;          // máximo do programa principal (dados inclusive)
+    int max_rotina;             // máximo da sub-rotina atual
+    int sem_limite;             // recursão ou chamada a sub-rotina desconhecida
+    int juncao_divergente;      // rótulo L<n> a que dois caminhos chegaram com
+                                // pilhas diferentes (-1: nenhum); erro interno
+    int *necessidade;           // por sub-rotina: máximo de células da chamada
+    int *n_param;               // por sub-rotina: parâmetros (desempilhados no RTPR)
+    int cap_subs;
+
+    // Tabela de cadeias (ver gerador_cadeia)
+    char **cadeias;
+    int n_cadeias, cap_cadeias;
+    int *indice_cadeias;        // espalhamento: entrada + 1 (0: vazio)
+    int cap_indice;
+} GeradorMEPA;
+
+// Funções de inicialização e finalização. finalizar_gerador escreve o FIM
+// e completa o cabeçalho; retorna 0 se a gravação falhou
+void inicializar_gerador(GeradorMEPA *g, FILE *arquivo);
+int finalizar_gerador(GeradorMEPA *g);
+
+// Liga o modo de desvios diretos, antes da primeira instrução. Só vale para
+// um arquivo comum, posicionável e sem O_APPEND; senão (pipe, buffer em
+// memória) o gerador continua com rótulos simbólicos. Retorna 1 se ligou.
+int gerador_desvios_diretos(GeradorMEPA *g);
 
 // Função principal de geração de instrução MEPA
-void gera_instr_mepa(const char *rotulo, const char *mnemonico, 
+void gera_instr_mepa(GeradorMEPA *g, const char *rotulo, const char *mnemonico, 
                      const char *parametro1, const char *parametro2);
 
+// Índice do texto na tabela de cadeias, acrescentado se ainda não estiver
+// lá (-1 se faltar memória), e o texto da entrada k
+int gerador_cadeia(GeradorMEPA *g, const char *texto);
+const char* gerador_texto_cadeia(const GeradorMEPA *g, int k);
+
+// Gera o IMPS que imprime texto (entrada da tabela de cadeias)
+void gera_impressao_cadeia(GeradorMEPA *g, const char *texto);
+
 // Funções para gerenciamento de rótulos
-char* novo_rotulo();
-char* obter_rotulo_atual();
+char* novo_rotulo(GeradorMEPA *g);
+char* obter_rotulo_atual(GeradorMEPA *g);
 
 // Funções auxiliares
-void liberar_gerador();
+void liberar_gerador(GeradorMEPA *g);
 
 #endif
\ No newline at end of file
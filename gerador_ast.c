@@ -0,0 +1,697 @@
+/*
+ * gerador_ast.c - Implementação da geração de código a partir da árvore
+ *
+ * Produz as mesmas instruções e os mesmos rótulos (na mesma ordem) que o
+ * analisador de uma passada: sem otimizações, a saída dos dois modos é
+ * idêntica. Uma expressão ocupa um intervalo contíguo da arena em pós-ordem,
+ * que já é a ordem das instruções de pilha, então é gerada por um laço sobre
+ * o intervalo, sem recursão. Comandos recursam, limitados pelo aninhamento
+ * máximo já imposto pelo parser.
+ *
+ * Sub-rotinas: depois da semântica, o corpo de cada uma só depende da
+ * árvore (endereços e números já resolvidos), então os corpos são gerados
+ * em paralelo, cada um num buffer em memória e com rótulos próprios a
+ * partir de L1. Em seguida são copiados na ordem do texto, somando a cada
+ * rótulo L<n> o total de rótulos dos trechos anteriores: o resultado é o da
+ * uma passada. As entradas R<k> não mudam (k é o número da sub-rotina).
+ *
+ * Com um perfil dos desvios (perfil.h), o layout deixa o texto onde o
+ * perfil mostra ganho em instruções despachadas (na MEPA, um desvio tomado
+ * custa o mesmo que um não tomado; o que se economiza são DSVS e NADA):
+ *   - if/else: o braço menos executado vai para um bloco frio, no fim da
+ *     rotina (depois do RTPR ou do PARA), que volta com um DSVS; o quente
+ *     fica no lugar, sem o DSVS para a saída. Se o frio for o então, a
+ *     condição é invertida (só quando isso não custa instruções);
+ *   - while e for executados: o teste vai também para o fim do corpo, com
+ *     a condição invertida e um DSVF de volta, em vez de DSVS e NADA do
+ *     início a cada volta (no for, também os do incremento).
+ * Os desvios são identificados pela ordem em que o gerador sem perfil os
+ * emitiria. Um bloco frio de sub-rotina não pode ter return: o DSVS para o
+ * rótulo de retorno, já definido, seria um segundo desvio de volta (ver
+ * gerador.h).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "gerador_ast.h"
+#include "gerador.h"
+#include "ast.h"
+#include "perfil.h"
+
+// Braço de if/else gerado no fim da rotina: entrada, comando e volta
+typedef struct {
+    char entrada[20];
+    NoId cmd;
+    char volta[20];
+} BlocoFrio;
+
+// Código de uma sub-rotina ou do bloco principal
+typedef struct {
+    const ArvoreAST *t;
+    GeradorMEPA *ger;           // &proprio, ou o gerador da compilação
+    GeradorMEPA proprio;
+    NoId no;                    // AST_SUBROT (0: bloco principal)
+    int nivel;                  // nível de quem chama, em CHPR
+    int n_param;
+    char retorno[20];           // rótulo do fim da sub-rotina
+    char *texto;                // código do trecho (open_memstream)
+    size_t tam;
+    int ok;
+    const PerfilDesvios *perfil; // NULL: layout do texto
+    const int *ordem;           // por nó: o DSVF dele no código sem perfil
+    BlocoFrio *frios;           // a gerar depois do RTPR ou do PARA
+    int n_frios, cap_frios;
+} Trecho;
+
+static const char* mnemonico(TAtomo op) {
+    switch (op) {
+        case sSOMA:      return "SOMA";
+        case sSUBT:      return "SUBT";
+        case sMULT:      return "MULT";
+        case sDIV:       return "DIVI";
+        case sOU:        return "DISJ";
+        case sE:         return "CONJ";
+        case sMENOR:     return "CMME";
+        case sMENOR_IG:  return "CMEG";
+        case sIGUAL:     return "CMIG";
+        case sDIFERENTE: return "CMDG";
+        case sMAIOR:     return "CMMA";
+        case sMAIOR_IG:  return "CMAG";
+        default:         return "NADA";
+    }
+}
+
+// Nós [inicio, fim] de uma expressão
+static void gerar_intervalo(Trecho *tr, NoId inicio, NoId fim) {
+    const ArvoreAST *t = tr->t;
+    char nivel[20], endereco[20];
+
+    for (NoId id = inicio; id <= fim; id++) {
+        const NoAST *no = ast_no(t, id);
+        if (no->flags & AST_MORTO) continue;
+
+        switch (no->tipo) {
+            case AST_VAR:
+                snprintf(nivel, sizeof(nivel), "%d", no->op);
+                snprintf(endereco, sizeof(endereco), "%d", no->u.endereco);
+                gera_instr_mepa(tr->ger, NULL, "CRVL", nivel, endereco);
+                break;
+            case AST_INT:
+            case AST_FLOAT:
+                gera_instr_mepa(tr->ger, NULL, "CRCT", ast_lexema(t, no), NULL);
+                break;
+            case AST_UNARIO:
+                gera_instr_mepa(tr->ger, NULL, no->op == sSUBT ? "INVR" : "NEGA", NULL, NULL);
+                break;
+            case AST_BINARIO:
+                gera_instr_mepa(tr->ger, NULL, mnemonico((TAtomo)no->op), NULL, NULL);
+                break;
+            case AST_RESULTADO:
+                // Célula do resultado, abaixo dos argumentos
+                if (no->dado != TIPO_VOID) gera_instr_mepa(tr->ger, NULL, "AMEM", "1", NULL);
+                break;
+            case AST_CHAMADA:
+                snprintf(endereco, sizeof(endereco), "R%d", ast_no(t, no->a)->u.endereco);
+                snprintf(nivel, sizeof(nivel), "%d", tr->nivel);
+                gera_instr_mepa(tr->ger, NULL, "CHPR", endereco, nivel);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void gerar_exp(Trecho *tr, NoId raiz) {
+    gerar_intervalo(tr, ast_inicio(tr->t, raiz), raiz);
+}
+
+// Comparação com o resultado oposto (0 se não houver)
+static const char* comparacao_inversa(TAtomo op) {
+    switch (op) {
+        case sMENOR:     return "CMAG";
+        case sMENOR_IG:  return "CMMA";
+        case sIGUAL:     return "CMDG";
+        case sDIFERENTE: return "CMIG";
+        case sMAIOR:     return "CMEG";
+        case sMAIOR_IG:  return "CMME";
+        default:         return NULL;
+    }
+}
+
+static int real(const ArvoreAST *t, NoId id) {
+    const NoAST *no = ast_no(t, id);
+    return no->dado == TIPO_FLOAT || no->tipo == AST_FLOAT;
+}
+
+// A condição pode ser invertida sem instruções a mais: 'nao x' (basta x)
+// ou comparação entre não reais (com reais, a oposta de x < y não é
+// x >= y quando há NaN)
+static int inversao_livre(const ArvoreAST *t, NoId raiz) {
+    const NoAST *no = ast_no(t, raiz);
+    if (no->tipo == AST_UNARIO) return no->op == sNAO;
+    return no->tipo == AST_BINARIO && comparacao_inversa((TAtomo)no->op) != NULL &&
+           !real(t, no->a) && !real(t, no->b);
+}
+
+// Valor da negação da condição (NEGA no fim, se a inversão não for livre)
+static void gerar_condicao_inversa(Trecho *tr, NoId raiz) {
+    const NoAST *no = ast_no(tr->t, raiz);
+
+    if (!inversao_livre(tr->t, raiz)) {
+        gerar_exp(tr, raiz);
+        gera_instr_mepa(tr->ger, NULL, "NEGA", NULL, NULL);
+        return;
+    }
+    gerar_intervalo(tr, ast_inicio(tr->t, raiz), raiz - 1);
+    if (no->tipo == AST_BINARIO) {
+        gera_instr_mepa(tr->ger, NULL, comparacao_inversa((TAtomo)no->op), NULL, NULL);
+    }
+}
+
+// ARMZ na variável de um nó AST_VAR
+static void armazenar(Trecho *tr, NoId var) {
+    const NoAST *no = ast_no(tr->t, var);
+    char nivel[20], endereco[20];
+
+    snprintf(nivel, sizeof(nivel), "%d", no->op);
+    snprintf(endereco, sizeof(endereco), "%d", no->u.endereco);
+    gera_instr_mepa(tr->ger, NULL, "ARMZ", nivel, endereco);
+}
+
+// Reserva um rótulo (copiado: novo_rotulo reusa o buffer)
+static void rotulo(Trecho *tr, char destino[20]) {
+    strcpy(destino, novo_rotulo(tr->ger));
+}
+
+static void gerar_cmd(Trecho *tr, NoId id);
+
+static void gerar_lista(Trecho *tr, NoId id) {
+    for (; id != 0; id = ast_no(tr->t, id)->prox) gerar_cmd(tr, id);
+}
+
+// Execuções do DSVF do comando e quantas desviaram; 0 sem perfil
+static int contagem(const Trecho *tr, NoId id, long *executados, long *tomados) {
+    if (tr->perfil == NULL || tr->ordem[id] < 0) return 0;
+    *executados = tr->perfil->executados[tr->ordem[id]];
+    *tomados = tr->perfil->tomados[tr->ordem[id]];
+    return *executados > 0;
+}
+
+static int tem_retorno(const ArvoreAST *t, NoId id) {
+    const NoAST *no = ast_no(t, id);
+
+    switch (no->tipo) {
+        case AST_RETORNO:  return 1;
+        case AST_SE:       return tem_retorno(t, no->b) || (no->c != 0 && tem_retorno(t, no->c));
+        case AST_ENQUANTO: return tem_retorno(t, no->b);
+        case AST_PARA:     return tem_retorno(t, no->u.d);
+        case AST_REPITA:
+        case AST_BLOCO:
+            for (NoId c = no->a; c != 0; c = ast_no(t, c)->prox) {
+                if (tem_retorno(t, c)) return 1;
+            }
+            return 0;
+        default:           return 0;
+    }
+}
+
+// Reserva um bloco frio para cmd (NULL se não couber: fica no lugar)
+static BlocoFrio* bloco_frio(Trecho *tr, NoId cmd) {
+    if (tr->no != 0 && tem_retorno(tr->t, cmd)) return NULL;
+    if (tr->n_frios == tr->cap_frios) {
+        int nova = tr->cap_frios ? tr->cap_frios * 2 : 8;
+        BlocoFrio *v = realloc(tr->frios, sizeof(BlocoFrio) * nova);
+        if (v == NULL) return NULL;
+        tr->frios = v;
+        tr->cap_frios = nova;
+    }
+    BlocoFrio *b = &tr->frios[tr->n_frios++];
+    b->cmd = cmd;
+    rotulo(tr, b->entrada);
+    rotulo(tr, b->volta);
+    return b;
+}
+
+// if/else com o braço frio fora do lugar; retorna 0 se o perfil não
+// recomenda (braços igualmente executados, ou o frio é o então e a
+// inversão da condição custaria uma instrução)
+static int gerar_se_perfil(Trecho *tr, const NoAST *no, long executados, long tomados) {
+    long entao = executados - tomados;
+    int inverter = entao < tomados;
+
+    if (entao == tomados || (inverter && !inversao_livre(tr->t, no->a))) return 0;
+    BlocoFrio *b = bloco_frio(tr, inverter ? no->b : no->c);
+    if (b == NULL) return 0;
+    char entrada[20], volta[20];
+    strcpy(entrada, b->entrada);
+    strcpy(volta, b->volta);
+
+    if (inverter) gerar_condicao_inversa(tr, no->a);
+    else gerar_exp(tr, no->a);
+    gera_instr_mepa(tr->ger, NULL, "DSVF", entrada, NULL);
+    gerar_cmd(tr, inverter ? no->c : no->b);
+    gera_instr_mepa(tr->ger, volta, "NADA", NULL, NULL);
+    return 1;
+}
+
+// Laço com o teste também no fim do corpo (while e for executados): o
+// primeiro teste sai do laço, o do fim volta ao corpo. corpo e incr são os
+// comandos de cada volta (incr 0 no while)
+static void gerar_laco_girado(Trecho *tr, NoId cond, NoId corpo, NoId incr) {
+    char inicio[20], fim[20];
+
+    gerar_exp(tr, cond);
+    rotulo(tr, fim);
+    gera_instr_mepa(tr->ger, NULL, "DSVF", fim, NULL);
+    rotulo(tr, inicio);
+    gera_instr_mepa(tr->ger, inicio, "NADA", NULL, NULL);
+    gerar_cmd(tr, corpo);
+    if (incr != 0) gerar_cmd(tr, incr);
+    gerar_condicao_inversa(tr, cond);
+    gera_instr_mepa(tr->ger, NULL, "DSVF", inicio, NULL);
+    gera_instr_mepa(tr->ger, fim, "NADA", NULL, NULL);
+}
+
+// Blocos frios da rotina, depois do RTPR ou do PARA (os braços frios deles
+// entram no fim da fila)
+static void gerar_frios(Trecho *tr) {
+    for (int k = 0; k < tr->n_frios; k++) {
+        BlocoFrio b = tr->frios[k];
+        gera_instr_mepa(tr->ger, b.entrada, "NADA", NULL, NULL);
+        gerar_cmd(tr, b.cmd);
+        gera_instr_mepa(tr->ger, NULL, "DSVS", b.volta, NULL);
+    }
+    free(tr->frios);
+    tr->frios = NULL;
+    tr->n_frios = tr->cap_frios = 0;
+}
+
+static void gerar_cmd(Trecho *tr, NoId id) {
+    const NoAST no = *ast_no(tr->t, id);
+    char inicio[20], fim[20], corpo[20], incr[20];
+    long executados, tomados;
+
+    switch (no.tipo) {
+        case AST_ATRIB:
+            gerar_exp(tr, no.b);
+            armazenar(tr, no.a);
+            break;
+
+        case AST_LEITURA:
+            gera_instr_mepa(tr->ger, NULL, "LEIT", NULL, NULL);
+            armazenar(tr, no.a);
+            break;
+
+        case AST_ESCRITA:
+            gerar_exp(tr, no.a);
+            gera_instr_mepa(tr->ger, NULL, "IMPR", NULL, NULL);
+            break;
+
+        case AST_TEXTO:
+            gera_impressao_cadeia(tr->ger, ast_lexema(tr->t, &no));
+            break;
+
+        case AST_CHAMADA:
+            // Como comando, o resultado de uma função é descartado
+            gerar_exp(tr, id);
+            if (no.dado != TIPO_VOID) gera_instr_mepa(tr->ger, NULL, "DMEM", "1", NULL);
+            break;
+
+        case AST_RETORNO:
+            // No programa principal a expressão só é avaliada (ver parse_ret)
+            if (no.a != 0) gerar_exp(tr, no.a);
+            if (tr->no == 0) break;
+            if (no.a != 0) {
+                snprintf(fim, sizeof(fim), "%d", -(tr->n_param + 3));
+                gera_instr_mepa(tr->ger, NULL, "ARMZ", "1", fim);
+            }
+            gera_instr_mepa(tr->ger, NULL, "DSVS", tr->retorno, NULL);
+            break;
+
+        case AST_SE:
+            if (no.c != 0 && contagem(tr, id, &executados, &tomados) &&
+                gerar_se_perfil(tr, &no, executados, tomados)) break;
+            gerar_exp(tr, no.a);
+            rotulo(tr, fim);
+            gera_instr_mepa(tr->ger, NULL, "DSVF", fim, NULL);
+            gerar_cmd(tr, no.b);
+            if (no.c != 0) {
+                char saida[20];
+                rotulo(tr, saida);
+                gera_instr_mepa(tr->ger, NULL, "DSVS", saida, NULL);
+                gera_instr_mepa(tr->ger, fim, "NADA", NULL, NULL);
+                gerar_cmd(tr, no.c);
+                gera_instr_mepa(tr->ger, saida, "NADA", NULL, NULL);
+            } else {
+                gera_instr_mepa(tr->ger, fim, "NADA", NULL, NULL);
+            }
+            break;
+
+        case AST_ENQUANTO:
+            if (contagem(tr, id, &executados, &tomados) && executados > tomados &&
+                inversao_livre(tr->t, no.a)) {
+                gerar_laco_girado(tr, no.a, no.b, 0);
+                break;
+            }
+            rotulo(tr, inicio);
+            gera_instr_mepa(tr->ger, inicio, "NADA", NULL, NULL);
+            gerar_exp(tr, no.a);
+            rotulo(tr, fim);
+            gera_instr_mepa(tr->ger, NULL, "DSVF", fim, NULL);
+            gerar_cmd(tr, no.b);
+            gera_instr_mepa(tr->ger, NULL, "DSVS", inicio, NULL);
+            gera_instr_mepa(tr->ger, fim, "NADA", NULL, NULL);
+            break;
+
+        case AST_REPITA:
+            rotulo(tr, inicio);
+            gera_instr_mepa(tr->ger, inicio, "NADA", NULL, NULL);
+            gerar_lista(tr, no.a);
+            gerar_exp(tr, no.b);
+            gera_instr_mepa(tr->ger, NULL, "DSVF", inicio, NULL);
+            break;
+
+        case AST_PARA:
+            // Mesmo esquema de parse_for: o incremento fica antes do corpo
+            if (no.a != 0) gerar_cmd(tr, no.a);
+            if (contagem(tr, id, &executados, &tomados) && executados > tomados) {
+                gerar_laco_girado(tr, no.b, no.u.d, no.c);
+                break;
+            }
+            rotulo(tr, inicio);
+            gera_instr_mepa(tr->ger, inicio, "NADA", NULL, NULL);
+            gerar_exp(tr, no.b);
+            rotulo(tr, fim);
+            gera_instr_mepa(tr->ger, NULL, "DSVF", fim, NULL);
+            rotulo(tr, corpo);
+            gera_instr_mepa(tr->ger, NULL, "DSVS", corpo, NULL);
+            rotulo(tr, incr);
+            gera_instr_mepa(tr->ger, incr, "NADA", NULL, NULL);
+            gerar_cmd(tr, no.c);
+            gera_instr_mepa(tr->ger, NULL, "DSVS", inicio, NULL);
+            gera_instr_mepa(tr->ger, corpo, "NADA", NULL, NULL);
+            gerar_cmd(tr, no.u.d);
+            gera_instr_mepa(tr->ger, NULL, "DSVS", incr, NULL);
+            gera_instr_mepa(tr->ger, fim, "NADA", NULL, NULL);
+            break;
+
+        case AST_BLOCO:
+            gerar_lista(tr, no.a);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static int contar(const ArvoreAST *t, NoId id) {
+    int n = 0;
+    for (; id != 0; id = ast_no(t, id)->prox) n++;
+    return n;
+}
+
+// Numera os comandos com DSVF na ordem em que gerar_cmd os emite sem perfil
+static void numerar(const ArvoreAST *t, NoId id, int *ordem, int *n) {
+    const NoAST *no = ast_no(t, id);
+
+    switch (no->tipo) {
+        case AST_SE:
+            ordem[id] = (*n)++;
+            numerar(t, no->b, ordem, n);
+            if (no->c != 0) numerar(t, no->c, ordem, n);
+            break;
+        case AST_ENQUANTO:
+            ordem[id] = (*n)++;
+            numerar(t, no->b, ordem, n);
+            break;
+        case AST_REPITA:
+            for (NoId c = no->a; c != 0; c = ast_no(t, c)->prox) numerar(t, c, ordem, n);
+            ordem[id] = (*n)++;
+            break;
+        case AST_PARA:
+            if (no->a != 0) numerar(t, no->a, ordem, n);
+            ordem[id] = (*n)++;
+            numerar(t, no->c, ordem, n);
+            numerar(t, no->u.d, ordem, n);
+            break;
+        case AST_BLOCO:
+            for (NoId c = no->a; c != 0; c = ast_no(t, c)->prox) numerar(t, c, ordem, n);
+            break;
+        default:
+            break;
+    }
+}
+
+// Ordem dos DSVF por nó (-1 nos demais), ou NULL se o perfil não é deste
+// programa (avisado em ctx->diag) ou faltou memória
+static int* ordenar_desvios(ContextoCompilacao *ctx, const PerfilDesvios *perfil) {
+    const ArvoreAST *t = ctx->ast;
+    const NoAST *prg = ast_no(t, t->raiz);
+    int *ordem = malloc(sizeof(int) * (size_t)t->n);
+    int n = 0;
+
+    if (ordem == NULL) return NULL;
+    for (uint32_t k = 0; k < t->n; k++) ordem[k] = -1;
+    for (NoId sub = prg->u.d; sub != 0; sub = ast_no(t, sub)->prox) {
+        numerar(t, ast_no(t, sub)->c, ordem, &n);
+    }
+    numerar(t, prg->c, ordem, &n);
+    if (n != perfil->n) {
+        fprintf(ctx->diag, "Aviso: o perfil tem %d desvios e o programa %d; "
+                "código gerado sem o perfil\n", perfil->n, n);
+        free(ordem);
+        return NULL;
+    }
+    return ordem;
+}
+
+// Corpo de uma sub-rotina, como em parse_dcl_sub
+static void gerar_subrotina(Trecho *tr) {
+    const NoAST *sub = ast_no(tr->t, tr->no);
+    const NoAST *dcl = ast_no(tr->t, sub->a);
+    char entrada[20], buffer[20];
+    int qtde_vars = sub->u.endereco;
+
+    tr->n_param = contar(tr->t, dcl->a);
+    snprintf(entrada, sizeof(entrada), "R%d", dcl->u.endereco);
+    gera_instr_mepa(tr->ger, entrada, "ENPR", "1", NULL);
+    rotulo(tr, tr->retorno);
+
+    snprintf(buffer, sizeof(buffer), "%d", qtde_vars);
+    if (qtde_vars > 0) gera_instr_mepa(tr->ger, NULL, "AMEM", buffer, NULL);
+    gerar_cmd(tr, sub->c);
+    gera_instr_mepa(tr->ger, tr->retorno, "NADA", NULL, NULL);
+    if (qtde_vars > 0) gera_instr_mepa(tr->ger, NULL, "DMEM", buffer, NULL);
+
+    snprintf(buffer, sizeof(buffer), "%d", tr->n_param);
+    gera_instr_mepa(tr->ger, NULL, "RTPR", "1", buffer);
+    gerar_frios(tr);
+}
+
+// Gera o trecho num buffer próprio (roda nas threads de trabalho: só lê a
+// árvore, que não muda mais)
+static void gerar_trecho(Trecho *tr) {
+    FILE *buffer = open_memstream(&tr->texto, &tr->tam);
+    if (buffer == NULL) return;
+
+    inicializar_gerador(&tr->proprio, buffer);
+    tr->proprio.pos_cabecalho = -1;     // o cabeçalho é o do gerador principal
+    tr->ger = &tr->proprio;
+    gerar_subrotina(tr);
+    tr->ok = !ferror(buffer);
+    if (fclose(buffer) != 0) tr->ok = 0;
+}
+
+// Fila dos trechos compartilhada pelas threads
+typedef struct {
+    Trecho *trechos;
+    int n;
+    int proximo;
+    pthread_mutex_t trava;      // protege proximo
+} Fila;
+
+static void* trabalhar(void *arg) {
+    Fila *fila = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&fila->trava);
+        int idx = fila->proximo < fila->n ? fila->proximo++ : -1;
+        pthread_mutex_unlock(&fila->trava);
+        if (idx < 0) break;
+        gerar_trecho(&fila->trechos[idx]);
+    }
+    return NULL;
+}
+
+// Gera os trechos em n_threads threads (a atual inclusive)
+static void gerar_em_paralelo(Trecho *trechos, int n, int n_threads) {
+    Fila fila;
+    pthread_t *threads = NULL;
+    int criadas = 0;
+
+    if (n_threads > n) n_threads = n;
+    fila.trechos = trechos;
+    fila.n = n;
+    fila.proximo = 0;
+    pthread_mutex_init(&fila.trava, NULL);
+
+    if (n_threads > 1) threads = malloc(sizeof(pthread_t) * (n_threads - 1));
+    if (threads != NULL) {
+        for (; criadas < n_threads - 1; criadas++) {
+            if (pthread_create(&threads[criadas], NULL, trabalhar, &fila) != 0) break;
+        }
+    }
+    trabalhar(&fila);
+    for (int k = 0; k < criadas; k++) pthread_join(threads[k], NULL);
+
+    free(threads);
+    pthread_mutex_destroy(&fila.trava);
+}
+
+// Soma base ao número de um rótulo L<n> (texto em s, com espaço para o
+// resultado em destino)
+static const char* relocar(const char *s, int base, char destino[20]) {
+    if (s == NULL || s[0] != 'L') return s;
+    snprintf(destino, 20, "L%d", atoi(s + 1) + base);
+    return destino;
+}
+
+// Copia o código de um trecho para a saída da compilação, com os rótulos
+// deslocados de base. As linhas têm o formato de gera_instr_mepa; o buffer
+// é reaproveitado para separar os campos
+static void copiar_trecho(GeradorMEPA *g, Trecho *tr, int base) {
+    char *p = tr->texto, *fim = tr->texto + tr->tam;
+    char r[20], d[20];
+
+    while (p < fim) {
+        char *linha = p;
+        char *nl = memchr(p, '\n', (size_t)(fim - p));
+        if (nl == NULL) nl = fim;
+        *nl = '\0';
+        p = nl + 1;
+
+        // Um rótulo é o primeiro campo terminado em ':'
+        char *rot = NULL, *mnem = linha, *p1 = NULL, *p2 = NULL;
+        char *sep = strchr(linha, ' ');
+        if (sep != NULL && sep > linha && sep[-1] == ':') {
+            sep[-1] = '\0';
+            rot = linha;
+            mnem = sep + 1;
+        }
+        char *espaco = strchr(mnem, ' ');
+        if (espaco != NULL) {
+            *espaco = '\0';
+            p1 = espaco + 1;
+            char *virgula = strchr(p1, ',');
+            if (virgula != NULL) {
+                *virgula = '\0';
+                p2 = virgula + 1;
+            }
+        }
+
+        // Só DSVS e DSVF têm um rótulo como operando; o de IMPS é uma
+        // entrada da tabela de cadeias do trecho, que passa para a da saída
+        const char *op1 = p1;
+        if (strcmp(mnem, "IMPS") == 0) {
+            gera_impressao_cadeia(g, gerador_texto_cadeia(&tr->proprio, atoi(p1)));
+            continue;
+        }
+        if (strcmp(mnem, "DSVS") == 0 || strcmp(mnem, "DSVF") == 0) op1 = relocar(p1, base, d);
+        gera_instr_mepa(g, relocar(rot, base, r), mnem, op1, p2);
+    }
+}
+
+// Corpos das sub-rotinas, na ordem do texto. Com uma thread vão direto
+// para a saída, já com os rótulos definitivos; senão, em paralelo para
+// buffers que depois são copiados e relocados
+static int gerar_subrotinas(ContextoCompilacao *ctx, NoId primeira, int n_subs,
+                            int n_threads, const PerfilDesvios *perfil,
+                            const int *ordem) {
+    const ArvoreAST *t = ctx->ast;
+    int ok = 1;
+
+    if (n_threads <= 1 || n_subs == 1) {
+        for (NoId sub = primeira; sub != 0; sub = ast_no(t, sub)->prox) {
+            Trecho tr;
+            memset(&tr, 0, sizeof(tr));
+            tr.t = t;
+            tr.ger = &ctx->ger;
+            tr.no = sub;
+            tr.nivel = 1;
+            tr.perfil = perfil;
+            tr.ordem = ordem;
+            gerar_subrotina(&tr);
+        }
+        return 1;
+    }
+
+    Trecho *trechos = calloc((size_t)n_subs, sizeof(Trecho));
+    if (trechos == NULL) return 0;
+    NoId sub = primeira;
+    for (int k = 0; k < n_subs; k++, sub = ast_no(t, sub)->prox) {
+        trechos[k].t = t;
+        trechos[k].no = sub;
+        trechos[k].nivel = 1;
+        trechos[k].perfil = perfil;
+        trechos[k].ordem = ordem;
+    }
+    gerar_em_paralelo(trechos, n_subs, n_threads);
+
+    for (int k = 0; k < n_subs; k++) {
+        if (!trechos[k].ok) ok = 0;
+        if (ok) {
+            copiar_trecho(&ctx->ger, &trechos[k], ctx->ger.contador_rotulo - 1);
+            ctx->ger.contador_rotulo += trechos[k].proprio.contador_rotulo - 1;
+        }
+        free(trechos[k].texto);
+        liberar_gerador(&trechos[k].proprio);
+    }
+    free(trechos);
+    return ok;
+}
+
+int gerar_ast(ContextoCompilacao *ctx, int n_threads, const PerfilDesvios *perfil) {
+    const ArvoreAST *t = ctx->ast;
+    const NoAST *prg = ast_no(t, t->raiz);
+    char buffer[20], principal[20];
+    int qtde_vars = ast_no(t, prg->a)->u.endereco;
+    int n_subs = contar(t, prg->u.d);
+    int *ordem = perfil != NULL ? ordenar_desvios(ctx, perfil) : NULL;
+
+    if (ordem == NULL) perfil = NULL;
+
+    snprintf(buffer, sizeof(buffer), "%d", qtde_vars);
+    gera_instr_mepa(&ctx->ger, NULL, "INPP", NULL, NULL);
+    if (qtde_vars > 0) gera_instr_mepa(&ctx->ger, NULL, "AMEM", buffer, NULL);
+
+    if (n_subs > 0) {
+        strcpy(principal, novo_rotulo(&ctx->ger));
+        gera_instr_mepa(&ctx->ger, NULL, "DSVS", principal, NULL);
+        if (!gerar_subrotinas(ctx, prg->u.d, n_subs, n_threads, perfil, ordem)) {
+            fprintf(ctx->diag, "Erro: falha ao alocar memória para a geração de código\n");
+            ctx->erros++;
+            free(ordem);
+            return 0;
+        }
+        gera_instr_mepa(&ctx->ger, principal, "NADA", NULL, NULL);
+    }
+
+    // O bloco principal vai direto para a saída
+    Trecho corpo;
+    memset(&corpo, 0, sizeof(corpo));
+    corpo.t = t;
+    corpo.ger = &ctx->ger;
+    corpo.perfil = perfil;
+    corpo.ordem = ordem;
+    gerar_cmd(&corpo, prg->c);
+
+    if (qtde_vars > 0) gera_instr_mepa(&ctx->ger, NULL, "DMEM", buffer, NULL);
+    gera_instr_mepa(&ctx->ger, NULL, "PARA", NULL, NULL);
+    gerar_frios(&corpo);
+    free(ordem);
+    return 1;
+}
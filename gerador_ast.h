@@ -0,0 +1,18 @@
+/*
+ * gerador_ast.h - Geração de código MEPA a partir da árvore (modo -O1)
+ */
+
+#ifndef GERADOR_AST_H
+#define GERADOR_AST_H
+
+#include "contexto.h"
+#include "perfil.h"
+
+// Gera o programa de ctx->ast (sem erros) em ctx->ger, com os corpos das
+// sub-rotinas gerados em até n_threads threads. Com perfil (pode ser NULL),
+// arruma os blocos pelos desvios mais executados; um perfil de outro
+// programa é avisado em ctx->diag e ignorado. Retorna 0 se faltou memória
+// (relatado em ctx->diag)
+int gerar_ast(ContextoCompilacao *ctx, int n_threads, const PerfilDesvios *perfil);
+
+#endif
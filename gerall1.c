@@ -0,0 +1,496 @@
+/*
+ * gerall1.c - Gerador das tabelas do analisador LL(1) (asdr_ll1.c)
+ *
+ * Lê a gramática de LPD (lpd.ll1, formato descrito no próprio arquivo),
+ * calcula os conjuntos FIRST e FOLLOW, o conjunto de previsão de cada
+ * produção e a tabela de análise [não-terminal][átomo], e grava <saida>.h e
+ * <saida>.c. Um conflito que a gramática não resolve com %prefere é
+ * relatado com as linhas das produções envolvidas, e nada é gravado.
+ *
+ * Roda na compilação (ver Makefile.txt), na máquina que compila: só usa a
+ * biblioteca padrão. Os átomos são escritos pelos nomes de analex.h, que o
+ * código gerado inclui, então o gerador não precisa dos valores deles.
+ *
+ * Uso: gerall1 gramatica.ll1 saida
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+#define MAX_SIMBOLOS 256
+#define MAX_PRODUCOES 255       // números de produção cabem num byte
+#define MAX_DIREITO 32
+#define MAX_EXTRAS 8
+#define MAX_TERMINAIS 64        // conjuntos de átomos são bits de um uint64_t
+#define TAM_NOME 48
+
+typedef enum {
+    TERMINAL,
+    NAO_TERMINAL,
+    ACAO
+} TipoSimbolo;
+
+typedef struct {
+    char nome[TAM_NOME];
+    TipoSimbolo tipo;
+    int indice;                 // entre os do mesmo tipo
+} Simbolo;
+
+typedef struct {
+    int esquerdo;               // não-terminal (índice)
+    int alternativa;            // posição entre as produções dele (a partir de 1)
+    int n;
+    int direito[MAX_DIREITO];   // símbolos (índices em simbolos)
+    int n_extras;
+    int extras[MAX_EXTRAS];     // terminais de %em
+    int linha;
+} Producao;
+
+typedef struct {
+    int simbolo;                // índice em simbolos
+    int n_producoes;
+    int padrao;                 // %padrao (alternativa; 0: nenhuma)
+    int prefere;                // %prefere (alternativa; 0: nenhuma)
+    char descricao[128];
+    int anulavel;
+    uint64_t first, follow;
+} NaoTerminal;
+
+static Simbolo simbolos[MAX_SIMBOLOS];
+static int n_simbolos;
+static int terminais[MAX_TERMINAIS];    // índice do terminal -> símbolo
+static int n_terminais;
+static int nao_terminais[MAX_SIMBOLOS]; // índice do não-terminal -> símbolo
+static NaoTerminal nt[MAX_SIMBOLOS];
+static int n_nt;
+static int n_acoes;
+static Producao producoes[MAX_PRODUCOES];
+static int n_producoes;
+static int inicio = -1;         // não-terminal inicial
+static int eof;                 // terminal sEOF
+
+static const char *arquivo;
+static int erros;
+
+static void erro(int linha, const char *formato, ...) {
+    va_list args;
+
+    va_start(args, formato);
+    fprintf(stderr, "%s:%d: ", arquivo, linha);
+    vfprintf(stderr, formato, args);
+    fputc('\n', stderr);
+    va_end(args);
+    erros++;
+}
+
+// Índice do símbolo com esse nome, criado na primeira ocorrência: sX é
+// átomo, #x é ação e o resto é não-terminal
+static int simbolo(const char *nome, int linha) {
+    for (int k = 0; k < n_simbolos; k++) {
+        if (strcmp(simbolos[k].nome, nome) == 0) return k;
+    }
+    if (n_simbolos == MAX_SIMBOLOS || strlen(nome) >= TAM_NOME) {
+        erro(linha, "símbolos demais ou nome longo demais: %s", nome);
+        exit(1);
+    }
+
+    Simbolo *s = &simbolos[n_simbolos];
+    strcpy(s->nome, nome);
+    if (nome[0] == '#') {
+        s->tipo = ACAO;
+        s->indice = n_acoes++;
+    } else if (nome[0] == 's' && isupper((unsigned char)nome[1])) {
+        if (n_terminais == MAX_TERMINAIS) {
+            erro(linha, "átomos demais (máximo %d)", MAX_TERMINAIS);
+            exit(1);
+        }
+        s->tipo = TERMINAL;
+        s->indice = n_terminais;
+        terminais[n_terminais++] = n_simbolos;
+    } else {
+        s->tipo = NAO_TERMINAL;
+        s->indice = n_nt;
+        memset(&nt[n_nt], 0, sizeof(NaoTerminal));
+        nt[n_nt].simbolo = n_simbolos;
+        nao_terminais[n_nt++] = n_simbolos;
+    }
+    return n_simbolos++;
+}
+
+static int nao_terminal(const char *nome, int linha) {
+    int s = simbolo(nome, linha);
+    if (simbolos[s].tipo != NAO_TERMINAL) {
+        erro(linha, "'%s' não é um não-terminal", nome);
+        return -1;
+    }
+    return simbolos[s].indice;
+}
+
+// Uma linha da gramática: diretiva, produção, comentário ou nada
+static void ler_linha(char *texto, int linha) {
+    char *comentario = strstr(texto, "//");
+    if (comentario) *comentario = '\0';
+
+    char *palavra = strtok(texto, " \t\r\n");
+    if (palavra == NULL) return;
+
+    if (palavra[0] == '%') {
+        char *nome = strtok(NULL, " \t\r\n");
+        if (nome == NULL) {
+            erro(linha, "diretiva %s sem não-terminal", palavra);
+            return;
+        }
+        int k = nao_terminal(nome, linha);
+        if (k < 0) return;
+
+        if (strcmp(palavra, "%inicio") == 0) {
+            inicio = k;
+        } else if (strcmp(palavra, "%padrao") == 0 || strcmp(palavra, "%prefere") == 0) {
+            char *valor = strtok(NULL, " \t\r\n");
+            int alt = valor ? atoi(valor) : 0;
+            if (alt <= 0) erro(linha, "%s %s sem alternativa", palavra, nome);
+            if (strcmp(palavra, "%padrao") == 0) nt[k].padrao = alt;
+            else nt[k].prefere = alt;
+        } else if (strcmp(palavra, "%descricao") == 0) {
+            char *resto = strtok(NULL, "\r\n");
+            while (resto && isspace((unsigned char)*resto)) resto++;
+            snprintf(nt[k].descricao, sizeof(nt[k].descricao), "%s", resto ? resto : "");
+        } else {
+            erro(linha, "diretiva desconhecida: %s", palavra);
+        }
+        return;
+    }
+
+    char *seta = strtok(NULL, " \t\r\n");
+    if (seta == NULL || strcmp(seta, "->") != 0) {
+        erro(linha, "esperado '->' depois de %s", palavra);
+        return;
+    }
+    int k = nao_terminal(palavra, linha);
+    if (k < 0) return;
+    if (n_producoes == MAX_PRODUCOES) {
+        erro(linha, "produções demais (máximo %d)", MAX_PRODUCOES);
+        exit(1);
+    }
+
+    Producao *p = &producoes[n_producoes++];
+    memset(p, 0, sizeof(*p));
+    p->esquerdo = k;
+    p->alternativa = ++nt[k].n_producoes;
+    p->linha = linha;
+
+    int extras = 0;
+    while ((palavra = strtok(NULL, " \t\r\n")) != NULL) {
+        if (strcmp(palavra, "%em") == 0) {
+            extras = 1;
+            continue;
+        }
+        int s = simbolo(palavra, linha);
+        if (extras) {
+            if (simbolos[s].tipo != TERMINAL || p->n_extras == MAX_EXTRAS) {
+                erro(linha, "%%em aceita até %d átomos: %s", MAX_EXTRAS, palavra);
+                continue;
+            }
+            p->extras[p->n_extras++] = simbolos[s].indice;
+        } else if (p->n == MAX_DIREITO) {
+            erro(linha, "produção longa demais");
+            return;
+        } else {
+            p->direito[p->n++] = s;
+        }
+    }
+}
+
+// FIRST de direito[de..] da produção p; *anulavel diz se ela pode ser vazia
+static uint64_t first_de(const Producao *p, int de, int *anulavel) {
+    uint64_t first = 0;
+
+    for (int i = de; i < p->n; i++) {
+        const Simbolo *s = &simbolos[p->direito[i]];
+        if (s->tipo == ACAO) continue;
+        if (s->tipo == TERMINAL) {
+            *anulavel = 0;
+            return first | (UINT64_C(1) << s->indice);
+        }
+        first |= nt[s->indice].first;
+        if (!nt[s->indice].anulavel) {
+            *anulavel = 0;
+            return first;
+        }
+    }
+    *anulavel = 1;
+    return first;
+}
+
+// Ponto fixo de FIRST, anulável e FOLLOW
+static void calcular_conjuntos() {
+    int mudou;
+
+    do {
+        mudou = 0;
+        for (int k = 0; k < n_producoes; k++) {
+            NaoTerminal *e = &nt[producoes[k].esquerdo];
+            int anulavel;
+            uint64_t first = e->first | first_de(&producoes[k], 0, &anulavel);
+            if (first != e->first || (anulavel && !e->anulavel)) mudou = 1;
+            e->first = first;
+            if (anulavel) e->anulavel = 1;
+        }
+    } while (mudou);
+
+    nt[inicio].follow |= UINT64_C(1) << eof;
+    do {
+        mudou = 0;
+        for (int k = 0; k < n_producoes; k++) {
+            const Producao *p = &producoes[k];
+            for (int i = 0; i < p->n; i++) {
+                const Simbolo *s = &simbolos[p->direito[i]];
+                if (s->tipo != NAO_TERMINAL) continue;
+                int anulavel;
+                uint64_t follow = nt[s->indice].follow | first_de(p, i + 1, &anulavel);
+                if (anulavel) follow |= nt[p->esquerdo].follow;
+                if (follow != nt[s->indice].follow) mudou = 1;
+                nt[s->indice].follow = follow;
+            }
+        }
+    } while (mudou);
+}
+
+// Produção (número a partir de 1) da alternativa alt do não-terminal k
+static int producao_de(int k, int alt) {
+    for (int p = 0; p < n_producoes; p++) {
+        if (producoes[p].esquerdo == k && producoes[p].alternativa == alt) return p + 1;
+    }
+    return 0;
+}
+
+static const char* nome_nt(int k) {
+    return simbolos[nao_terminais[k]].nome;
+}
+
+// Preenche a tabela com os conjuntos de previsão; 0 é erro
+static void construir_tabela(unsigned char tabela[][MAX_TERMINAIS], unsigned char *padrao) {
+    for (int k = 0; k < n_producoes; k++) {
+        const Producao *p = &producoes[k];
+        int anulavel;
+        uint64_t previsao = first_de(p, 0, &anulavel);
+        if (anulavel) previsao |= nt[p->esquerdo].follow;
+        for (int e = 0; e < p->n_extras; e++) previsao |= UINT64_C(1) << p->extras[e];
+
+        for (int t = 0; t < n_terminais; t++) {
+            if (!(previsao & (UINT64_C(1) << t))) continue;
+            unsigned char *celula = &tabela[p->esquerdo][t];
+            if (*celula == 0) {
+                *celula = k + 1;
+                continue;
+            }
+
+            // Conflito: vale a produção preferida, se for uma das duas
+            int preferida = producao_de(p->esquerdo, nt[p->esquerdo].prefere);
+            if (preferida == k + 1 || preferida == *celula) {
+                *celula = preferida;
+                continue;
+            }
+            char linhas[64];
+            snprintf(linhas, sizeof(linhas), "linhas %d e %d",
+                     producoes[*celula - 1].linha, p->linha);
+            fprintf(stderr, "%s:%d: conflito LL(1) em %s com o átomo %s (%s)\n", arquivo,
+                    p->linha, nome_nt(p->esquerdo), simbolos[terminais[t]].nome, linhas);
+            erros++;
+        }
+    }
+
+    // Padrão de cada não-terminal: %padrao, a única produção ou a produção ε
+    for (int k = 0; k < n_nt; k++) {
+        if (nt[k].n_producoes == 0) {
+            erro(0, "não-terminal sem produções: %s", nome_nt(k));
+            continue;
+        }
+        if (nt[k].padrao > 0) {
+            padrao[k] = producao_de(k, nt[k].padrao);
+            if (padrao[k] == 0) erro(0, "%%padrao fora das alternativas de %s", nome_nt(k));
+        } else if (nt[k].n_producoes == 1) {
+            padrao[k] = producao_de(k, 1);
+        } else {
+            for (int p = 0; p < n_producoes; p++) {
+                int so_acoes = 1;
+                for (int i = 0; i < producoes[p].n; i++) {
+                    if (simbolos[producoes[p].direito[i]].tipo != ACAO) so_acoes = 0;
+                }
+                if (producoes[p].esquerdo == k && so_acoes) padrao[k] = p + 1;
+            }
+        }
+        if (nt[k].prefere > 0 && producao_de(k, nt[k].prefere) == 0) {
+            erro(0, "%%prefere fora das alternativas de %s", nome_nt(k));
+        }
+    }
+}
+
+// Nome em maiúsculas, sem o '#' das ações
+static void escrever_maiusculo(FILE *f, const char *nome) {
+    if (*nome == '#') nome++;
+    for (; *nome; nome++) fputc(toupper((unsigned char)*nome), f);
+}
+
+static void escrever_simbolo(FILE *f, int s) {
+    if (simbolos[s].tipo == TERMINAL) {
+        fputs(simbolos[s].nome, f);
+    } else {
+        fputs(simbolos[s].tipo == ACAO ? "ACAO_" : "LL1_", f);
+        escrever_maiusculo(f, simbolos[s].nome);
+    }
+}
+
+static void escrever_producao(FILE *f, const Producao *p) {
+    fprintf(f, "%s ->", nome_nt(p->esquerdo));
+    for (int i = 0; i < p->n; i++) fprintf(f, " %s", simbolos[p->direito[i]].nome);
+    if (p->n == 0) fputs(" ε", f);
+}
+
+static int gravar_cabecalho(const char *saida, const char *base) {
+    char caminho[512];
+    snprintf(caminho, sizeof(caminho), "%s.h", saida);
+    FILE *f = fopen(caminho, "w");
+    if (f == NULL) {
+        perror(caminho);
+        return 0;
+    }
+
+    fprintf(f, "/*\n * %s.h - Tabelas do analisador LL(1)\n *\n"
+               " * Gerado por gerall1 a partir de %s; não editar.\n */\n\n", base, arquivo);
+    fprintf(f, "#ifndef TABELA_LL1_H\n#define TABELA_LL1_H\n\n#include \"analex.h\"\n\n");
+    fprintf(f, "// Símbolos da pilha: átomos (0 a sEOF), não-terminais e ações\n");
+    fprintf(f, "#define LL1_N_ATOMOS (sEOF + 1)\n");
+    fprintf(f, "#define LL1_N_NT %d\n", n_nt);
+    fprintf(f, "#define LL1_N_PRODUCOES %d\n", n_producoes);
+    fprintf(f, "#define LL1_PRIMEIRO_ACAO (LL1_N_ATOMOS + LL1_N_NT)\n");
+    fprintf(f, "#define LL1_INICIO ");
+    escrever_simbolo(f, nao_terminais[inicio]);
+    fprintf(f, "\n\nenum {\n");
+    for (int k = 0; k < n_nt; k++) {
+        fputs("    ", f);
+        escrever_simbolo(f, nao_terminais[k]);
+        fputs(k == 0 ? " = LL1_N_ATOMOS,\n" : ",\n", f);
+    }
+    fprintf(f, "};\n\nenum {\n");
+    for (int s = 0, primeira = 1; s < n_simbolos; s++) {
+        if (simbolos[s].tipo != ACAO) continue;
+        fputs("    ", f);
+        escrever_simbolo(f, s);
+        fputs(primeira ? " = LL1_PRIMEIRO_ACAO,\n" : ",\n", f);
+        primeira = 0;
+    }
+    fprintf(f, "};\n\n");
+    fprintf(f, "// Produção (a partir de 1) de cada não-terminal para cada átomo; 0 é erro,\n"
+               "// ou a produção padrão, se houver\n");
+    fprintf(f, "extern const unsigned char tabela_ll1[LL1_N_NT][LL1_N_ATOMOS];\n");
+    fprintf(f, "extern const unsigned char padrao_ll1[LL1_N_NT];\n\n");
+    fprintf(f, "// Lado direito da produção p: direito_ll1[producao_ll1[p]] até\n"
+               "// direito_ll1[producao_ll1[p + 1]], em ordem inversa (pronto para empilhar)\n");
+    fprintf(f, "extern const unsigned short producao_ll1[LL1_N_PRODUCOES + 2];\n");
+    fprintf(f, "extern const short direito_ll1[];\n\n");
+    fprintf(f, "// O que cada não-terminal espera, nas mensagens de erro\n");
+    fprintf(f, "extern const char *const descricao_ll1[LL1_N_NT];\n\n#endif\n");
+    return fclose(f) == 0;
+}
+
+static int gravar_tabelas(const char *saida, const char *base,
+                          unsigned char tabela[][MAX_TERMINAIS], const unsigned char *padrao) {
+    char caminho[512];
+    snprintf(caminho, sizeof(caminho), "%s.c", saida);
+    FILE *f = fopen(caminho, "w");
+    if (f == NULL) {
+        perror(caminho);
+        return 0;
+    }
+
+    fprintf(f, "/*\n * %s.c - Tabelas do analisador LL(1)\n *\n"
+               " * Gerado por gerall1 a partir de %s; não editar.\n */\n\n", base, arquivo);
+    fprintf(f, "#include \"%s.h\"\n\n", base);
+
+    fprintf(f, "const unsigned char tabela_ll1[LL1_N_NT][LL1_N_ATOMOS] = {\n");
+    for (int k = 0; k < n_nt; k++) {
+        fputs("    [", f);
+        escrever_simbolo(f, nao_terminais[k]);
+        fputs(" - LL1_N_ATOMOS] = {", f);
+        for (int t = 0, primeira = 1; t < n_terminais; t++) {
+            if (tabela[k][t] == 0) continue;
+            fprintf(f, "%s[%s] = %d", primeira ? " " : ", ",
+                    simbolos[terminais[t]].nome, tabela[k][t]);
+            primeira = 0;
+        }
+        fputs(" },\n", f);
+    }
+    fprintf(f, "};\n\nconst unsigned char padrao_ll1[LL1_N_NT] = {\n");
+    for (int k = 0; k < n_nt; k++) fprintf(f, "    %d,    // %s\n", padrao[k], nome_nt(k));
+
+    fprintf(f, "};\n\nconst unsigned short producao_ll1[LL1_N_PRODUCOES + 2] = {\n    0, 0,");
+    int total = 0;
+    for (int k = 0; k < n_producoes; k++) {
+        total += producoes[k].n;
+        fprintf(f, "%s%d,", k % 16 == 15 ? "\n    " : " ", total);
+    }
+    fprintf(f, "\n};\n\nconst short direito_ll1[] = {\n");
+    for (int k = 0; k < n_producoes; k++) {
+        const Producao *p = &producoes[k];
+        fprintf(f, "    // %d: ", k + 1);
+        escrever_producao(f, p);
+        fputs("\n   ", f);
+        for (int i = p->n - 1; i >= 0; i--) {
+            fputc(' ', f);
+            escrever_simbolo(f, p->direito[i]);
+            fputc(',', f);
+        }
+        fputc('\n', f);
+    }
+    fprintf(f, "    0\n};\n\nconst char *const descricao_ll1[LL1_N_NT] = {\n");
+    for (int k = 0; k < n_nt; k++) {
+        if (nt[k].descricao[0]) fprintf(f, "    \"%s\",\n", nt[k].descricao);
+        else fprintf(f, "    \"<%s>\",\n", nome_nt(k));
+    }
+    fprintf(f, "};\n");
+    return fclose(f) == 0;
+}
+
+int main(int argc, char *argv[]) {
+    static unsigned char tabela[MAX_SIMBOLOS][MAX_TERMINAIS];
+    static unsigned char padrao[MAX_SIMBOLOS];
+    char texto[1024];
+
+    if (argc != 3) {
+        fprintf(stderr, "Uso: %s gramatica.ll1 saida\n", argv[0]);
+        return 1;
+    }
+    arquivo = argv[1];
+    FILE *f = fopen(arquivo, "r");
+    if (f == NULL) {
+        perror(arquivo);
+        return 1;
+    }
+    for (int linha = 1; fgets(texto, sizeof(texto), f) != NULL; linha++) {
+        ler_linha(texto, linha);
+    }
+    fclose(f);
+
+    eof = simbolos[simbolo("sEOF", 0)].indice;
+    if (inicio < 0) erro(0, "falta %%inicio");
+    if (erros > 0) return 1;
+
+    calcular_conjuntos();
+    construir_tabela(tabela, padrao);
+    if (erros > 0) return 1;
+
+    // O nome do arquivo gerado, sem diretório, para o #include
+    const char *base = strrchr(argv[2], '/');
+    base = base ? base + 1 : argv[2];
+    if (!gravar_cabecalho(argv[2], base) || !gravar_tabelas(argv[2], base, tabela, padrao)) {
+        return 1;
+    }
+    printf("%s: %d não-terminais, %d produções, %d ações, %d átomos\n",
+           arquivo, n_nt, n_producoes, n_acoes, n_terminais);
+    return 0;
+}
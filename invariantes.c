@@ -0,0 +1,464 @@
+/*
+ * invariantes.c - Código invariante para fora dos laços
+ *
+ * Uma subexpressão dentro de um laço é invariante se não chama sub-rotinas
+ * e se nenhuma variável dela recebe valor no laço (atribuição ou leitura,
+ * também em laços internos). Uma global muda ainda se o laço chama alguma
+ * sub-rotina e alguma sub-rotina atribui a ela. A maior subexpressão
+ * invariante com ao menos um operador é calculada no pré-cabeçalho do laço,
+ * numa temporária (o endereço seguinte da área de dados; ver ast.h), e no
+ * laço vira uma leitura da temporária.
+ *
+ * O pré-cabeçalho roda mesmo quando o laço não repete nada (while e for com
+ * a condição falsa de início, ou um comando dentro de um if), então só se
+ * move o que não pode falhar: divisões só com divisor constante que não
+ * seja 0 nem -1 (a MEPA pára na divisão inteira por zero).
+ *
+ * Na árvore, o laço vira um AST_BLOCO no mesmo lugar da lista, com os
+ * comandos do pré-cabeçalho seguidos de uma cópia do nó do laço no fim da
+ * arena; num for, a inicialização vem antes do pré-cabeçalho, e a cópia
+ * fica sem ela. A subexpressão movida é copiada para a atribuição do
+ * pré-cabeçalho; no laço, a raiz dela vira AST_VAR e o resto, AST_MORTO.
+ *
+ * Os laços são tratados de fora para dentro: o que não muda no laço externo
+ * sai dele de uma vez, e o que só não muda no interno sai para o
+ * pré-cabeçalho do interno.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "invariantes.h"
+
+// Área de dados em análise
+typedef struct {
+    ArvoreAST *t;
+    int nivel;
+    NoId tamanho;               // nó com as posições da área (u.endereco)
+    int n_param;
+    const int *globais_escritas; // por alguma sub-rotina (NULL: ainda calculando)
+    int n_globais;
+
+    // Escritas do laço em análise, marcadas com o número dele
+    int laco;
+    int *locais;                // por endereço (cresce com as temporárias)
+    int cap_locais;
+    int *parametros;
+    int *globais;               // sub-rotina: globais, pelo endereço
+    int chamadas;               // o laço chama sub-rotinas
+
+    // Expressão em análise
+    uint8_t *invariante;        // por nó do intervalo
+    NoId *mover;                // raízes a mover
+    size_t cap_exp;
+
+    // Pré-cabeçalho do laço em análise
+    NoId no_laco;               // nó original (vira o bloco)
+    NoId copia;                 // laço, no fim do bloco (0: ainda não movido)
+    NoId anterior;              // último comando antes do laço (0: nenhum)
+    int falhou;                 // faltou memória: não move mais nada
+    long movidas;
+} Movimento;
+
+typedef enum {
+    FASE_ESCRITAS,              // marca o que o laço atribui e se chama
+    FASE_MOVER
+} Fase;
+
+static int contar(const ArvoreAST *t, NoId id) {
+    int n = 0;
+    for (; id != 0; id = ast_no(t, id)->prox) n++;
+    return n;
+}
+
+// Marca de escrita de uma variável (NULL se fora das marcas: conta como
+// escrita)
+static int* marca(Movimento *m, const NoAST *var) {
+    int e = var->u.endereco;
+
+    if (var->op != m->nivel) {
+        return m->globais != NULL && var->op == 0 && e >= 0 && e < m->n_globais ? &m->globais[e] : NULL;
+    }
+    if (e >= 0) return e < m->cap_locais ? &m->locais[e] : NULL;
+    // O parâmetro i (1, 2, ...) fica em -(n + 3) + i
+    e += m->n_param + 2;
+    return e >= 0 && e < m->n_param ? &m->parametros[e] : NULL;
+}
+
+static int invariante_var(Movimento *m, const NoAST *var) {
+    int *p = marca(m, var);
+    if (p == NULL || *p == m->laco) return 0;
+
+    // Globais podem mudar nas chamadas
+    int e = var->u.endereco;
+    return !(m->chamadas && var->op == 0 && e >= 0 && e < m->n_globais && m->globais_escritas[e]);
+}
+
+// Divisão que não pode parar a MEPA: divisor constante, sem 0 nem -1
+static int divisao_segura(const ArvoreAST *t, const NoAST *no) {
+    if (no->op != sDIV) return 1;
+    const NoAST *divisor = ast_no(t, no->b);
+    if (divisor->tipo == AST_FLOAT) return 1;
+    if (divisor->tipo != AST_INT) return 0;
+    long valor = strtol(ast_lexema(t, divisor), NULL, 10);
+    return valor != 0 && valor != -1;
+}
+
+static int reservar_exp(Movimento *m, size_t n) {
+    if (n <= m->cap_exp) return 1;
+    uint8_t *invariante = realloc(m->invariante, n);
+    if (invariante == NULL) return 0;
+    m->invariante = invariante;
+    NoId *mover = realloc(m->mover, sizeof(NoId) * n);
+    if (mover == NULL) return 0;
+    m->mover = mover;
+    m->cap_exp = n;
+    return 1;
+}
+
+static int reservar_locais(Movimento *m, int n) {
+    if (n <= m->cap_locais) return 1;
+    int cap = m->cap_locais * 2 > n ? m->cap_locais * 2 : n;
+    int *locais = realloc(m->locais, sizeof(int) * cap);
+    if (locais == NULL) return 0;
+    memset(locais + m->cap_locais, 0, sizeof(int) * (cap - m->cap_locais));
+    m->locais = locais;
+    m->cap_locais = cap;
+    return 1;
+}
+
+// Na primeira subexpressão movida, o laço vai para o fim de um bloco que
+// fica no lugar dele
+static void criar_bloco(Movimento *m, NoId novo) {
+    ArvoreAST *t = m->t;
+    NoAST laco = *ast_no(t, m->no_laco);
+    NoId inicio = laco.tipo == AST_PARA ? laco.a : 0;
+
+    laco.prox = 0;
+    if (inicio != 0) laco.a = 0;
+    *ast_no(t, novo) = laco;
+
+    NoAST *bloco = ast_no(t, m->no_laco);
+    bloco->tipo = AST_BLOCO;
+    bloco->op = 0;
+    bloco->a = inicio != 0 ? inicio : novo;
+    bloco->b = bloco->c = 0;
+    bloco->u.d = 0;
+    if (inicio != 0) ast_no(t, inicio)->prox = novo;
+
+    m->copia = novo;
+    m->anterior = inicio;
+}
+
+// Calcula a subexpressão raiz numa temporária antes do laço
+static void mover_raiz(Movimento *m, NoId raiz) {
+    ArvoreAST *t = m->t;
+    int endereco = ast_no(t, m->tamanho)->u.endereco;
+    int linha = ast_no(t, raiz)->linha;
+
+    if (m->falhou) return;
+    if (!reservar_locais(m, endereco + 1)) {
+        m->falhou = 1;
+        return;
+    }
+
+    // Todos os nós antes de mudar qualquer coisa: sem memória, os já
+    // criados ficam soltos no fim da arena
+    NoId laco = m->copia != 0 ? m->copia : ast_novo(t, AST_NENHUM, 0);
+    NoId copia = laco != 0 ? ast_copiar(t, raiz) : 0;
+    NoId alvo = copia != 0 ? ast_novo(t, AST_VAR, linha) : 0;
+    NoId atrib = alvo != 0 ? ast_novo(t, AST_ATRIB, linha) : 0;
+    if (atrib == 0) {
+        m->falhou = 1;
+        return;
+    }
+
+    NoAST *no = ast_no(t, raiz);
+    NoAST *var = ast_no(t, alvo);
+    var->op = (uint8_t)m->nivel;
+    var->dado = no->dado;
+    var->flags = AST_ALVO;
+    var->u.endereco = endereco;
+    no = ast_no(t, atrib);
+    no->op = sATRIB;
+    no->a = alvo;
+    no->b = copia;
+    ast_no(t, m->tamanho)->u.endereco++;
+
+    if (m->copia == 0) criar_bloco(m, laco);
+    ast_no(t, atrib)->prox = m->copia;
+    if (m->anterior != 0) ast_no(t, m->anterior)->prox = atrib;
+    else ast_no(t, m->no_laco)->a = atrib;
+    m->anterior = atrib;
+
+    // No laço, a raiz lê a temporária
+    for (NoId id = ast_inicio(t, raiz); id < raiz; id++) ast_no(t, id)->flags |= AST_MORTO;
+    no = ast_no(t, raiz);
+    no->tipo = AST_VAR;
+    no->op = (uint8_t)m->nivel;
+    no->a = no->b = 0;
+    no->u.endereco = endereco;
+    no->texto = 0;
+    m->movidas++;
+}
+
+// Candidata a mover: invariante e com algum operador
+static void candidata(Movimento *m, NoId inicio, NoId id, int *n) {
+    const NoAST *no = ast_no(m->t, id);
+    if (!m->invariante[id - inicio]) return;
+    if (no->tipo != AST_UNARIO && no->tipo != AST_BINARIO) return;
+    m->mover[(*n)++] = id;
+}
+
+// Move as maiores subexpressões invariantes de uma expressão do laço. Em
+// pós-ordem, os operandos vêm antes do operador
+static void mover_exp(Movimento *m, NoId raiz) {
+    ArvoreAST *t = m->t;
+    NoId inicio = ast_inicio(t, raiz);
+    int n = 0;
+
+    if (m->falhou) return;
+    if (!reservar_exp(m, raiz - inicio + 1)) {
+        m->falhou = 1;
+        return;
+    }
+
+    for (NoId id = inicio; id <= raiz; id++) {
+        const NoAST *no = ast_no(t, id);
+        uint8_t inv = 0;
+
+        if (no->flags & AST_MORTO) {
+            m->invariante[id - inicio] = 0;
+            continue;
+        }
+        switch (no->tipo) {
+            case AST_INT:
+            case AST_FLOAT:
+                inv = 1;
+                break;
+            case AST_VAR:
+                inv = (uint8_t)invariante_var(m, no);
+                break;
+            case AST_UNARIO:
+                inv = m->invariante[no->a - inicio];
+                if (!inv) candidata(m, inicio, no->a, &n);
+                break;
+            case AST_BINARIO:
+                inv = m->invariante[no->a - inicio] && m->invariante[no->b - inicio] &&
+                      divisao_segura(t, no);
+                if (!inv) {
+                    candidata(m, inicio, no->a, &n);
+                    candidata(m, inicio, no->b, &n);
+                }
+                break;
+            case AST_ARG:
+                candidata(m, inicio, no->a, &n);
+                break;
+            default:
+                break;
+        }
+        m->invariante[id - inicio] = inv;
+    }
+    candidata(m, inicio, raiz, &n);
+
+    for (int k = 0; k < n; k++) mover_raiz(m, m->mover[k]);
+}
+
+static void procurar_chamadas(Movimento *m, NoId raiz) {
+    for (NoId id = ast_inicio(m->t, raiz); id <= raiz; id++) {
+        const NoAST *no = ast_no(m->t, id);
+        if (no->tipo == AST_CHAMADA && !(no->flags & AST_MORTO)) m->chamadas = 1;
+    }
+}
+
+static void visitar_exp(Movimento *m, NoId raiz, Fase fase) {
+    if (fase == FASE_ESCRITAS) procurar_chamadas(m, raiz);
+    else mover_exp(m, raiz);
+}
+
+static void visitar_escrita(Movimento *m, NoId var, Fase fase) {
+    if (fase != FASE_ESCRITAS) return;
+    int *p = marca(m, ast_no(m->t, var));
+    if (p != NULL) *p = m->laco;
+}
+
+static void percorrer_cmd(Movimento *m, NoId id, Fase fase);
+
+static void percorrer_lista(Movimento *m, NoId id, Fase fase) {
+    for (; id != 0; id = ast_no(m->t, id)->prox) percorrer_cmd(m, id, fase);
+}
+
+// O que repete num laço (num for, tudo menos a inicialização)
+static void percorrer_repeticao(Movimento *m, const NoAST *no, Fase fase) {
+    switch (no->tipo) {
+        case AST_ENQUANTO:
+            visitar_exp(m, no->a, fase);
+            percorrer_cmd(m, no->b, fase);
+            break;
+        case AST_REPITA:
+            percorrer_lista(m, no->a, fase);
+            visitar_exp(m, no->b, fase);
+            break;
+        case AST_PARA:
+            visitar_exp(m, no->b, fase);
+            percorrer_cmd(m, no->c, fase);
+            percorrer_cmd(m, no->u.d, fase);
+            break;
+        default:
+            break;
+    }
+}
+
+static void percorrer_cmd(Movimento *m, NoId id, Fase fase) {
+    const NoAST no = *ast_no(m->t, id);
+
+    switch (no.tipo) {
+        case AST_ATRIB:
+            visitar_exp(m, no.b, fase);
+            visitar_escrita(m, no.a, fase);
+            break;
+        case AST_LEITURA:
+            visitar_escrita(m, no.a, fase);
+            break;
+        case AST_ESCRITA:
+            visitar_exp(m, no.a, fase);
+            break;
+        case AST_CHAMADA:
+            visitar_exp(m, id, fase);
+            break;
+        case AST_RETORNO:
+            if (no.a != 0) visitar_exp(m, no.a, fase);
+            break;
+        case AST_SE:
+            visitar_exp(m, no.a, fase);
+            percorrer_cmd(m, no.b, fase);
+            if (no.c != 0) percorrer_cmd(m, no.c, fase);
+            break;
+        case AST_PARA:
+            if (no.a != 0) percorrer_cmd(m, no.a, fase);
+            percorrer_repeticao(m, &no, fase);
+            break;
+        case AST_ENQUANTO:
+        case AST_REPITA:
+            percorrer_repeticao(m, &no, fase);
+            break;
+        case AST_BLOCO:
+            percorrer_lista(m, no.a, fase);
+            break;
+        default:
+            break;
+    }
+}
+
+static void tratar_cmd(Movimento *m, NoId id);
+
+static void tratar_lista(Movimento *m, NoId id) {
+    for (; id != 0; id = ast_no(m->t, id)->prox) tratar_cmd(m, id);
+}
+
+static void tratar_laco(Movimento *m, NoId id) {
+    const NoAST original = *ast_no(m->t, id);
+
+    m->laco++;
+    m->chamadas = 0;
+    m->no_laco = id;
+    m->copia = 0;
+    m->anterior = 0;
+    percorrer_repeticao(m, &original, FASE_ESCRITAS);
+    percorrer_repeticao(m, &original, FASE_MOVER);
+
+    // Depois, os laços internos
+    const NoAST no = *ast_no(m->t, m->copia != 0 ? m->copia : id);
+    switch (no.tipo) {
+        case AST_ENQUANTO: tratar_cmd(m, no.b); break;
+        case AST_REPITA:   tratar_lista(m, no.a); break;
+        case AST_PARA:     tratar_cmd(m, no.u.d); break;
+        default:           break;
+    }
+}
+
+static void tratar_cmd(Movimento *m, NoId id) {
+    const NoAST no = *ast_no(m->t, id);
+
+    switch (no.tipo) {
+        case AST_ENQUANTO:
+        case AST_REPITA:
+        case AST_PARA:
+            tratar_laco(m, id);
+            break;
+        case AST_SE:
+            tratar_cmd(m, no.b);
+            if (no.c != 0) tratar_cmd(m, no.c);
+            break;
+        case AST_BLOCO:
+            tratar_lista(m, no.a);
+            break;
+        default:
+            break;
+    }
+}
+
+// Move os invariantes dos laços de uma área; 0 se faltou memória
+static int tratar_area(Movimento *m, NoId corpo) {
+    int ok = reservar_locais(m, ast_no(m->t, m->tamanho)->u.endereco + 1);
+
+    m->parametros = calloc((size_t)m->n_param + 1, sizeof(int));
+    if (ok && m->parametros != NULL) tratar_cmd(m, corpo);
+    ok = ok && m->parametros != NULL && !m->falhou;
+
+    free(m->locais);
+    free(m->parametros);
+    free(m->invariante);
+    free(m->mover);
+    return ok;
+}
+
+long mover_invariantes(ArvoreAST *t) {
+    const NoAST *prg = ast_no(t, t->raiz);
+    NoId dcl_prg = prg->a, corpo_prg = prg->c, subs = prg->u.d;
+    int n_globais = ast_no(t, dcl_prg)->u.endereco;
+    long movidas = 0;
+    Movimento m;
+
+    // Globais atribuídas em alguma sub-rotina (marca 1)
+    int *globais_escritas = calloc((size_t)n_globais + 1, sizeof(int));
+    if (globais_escritas == NULL) return 0;
+    memset(&m, 0, sizeof(m));
+    m.t = t;
+    m.nivel = 1;
+    m.laco = 1;
+    m.globais = globais_escritas;
+    m.n_globais = n_globais;
+    for (NoId sub = subs; sub != 0; sub = ast_no(t, sub)->prox) {
+        percorrer_cmd(&m, ast_no(t, sub)->c, FASE_ESCRITAS);
+    }
+
+    int *globais = calloc((size_t)n_globais + 1, sizeof(int));
+    for (NoId sub = subs; globais != NULL && sub != 0; sub = ast_no(t, sub)->prox) {
+        memset(&m, 0, sizeof(m));
+        m.t = t;
+        m.nivel = 1;
+        m.tamanho = sub;
+        m.n_param = contar(t, ast_no(t, ast_no(t, sub)->a)->a);
+        m.globais_escritas = globais_escritas;
+        m.n_globais = n_globais;
+        m.globais = globais;
+        int ok = tratar_area(&m, ast_no(t, sub)->c);
+        movidas += m.movidas;
+        if (!ok) break;
+    }
+
+    if (globais != NULL) {
+        memset(&m, 0, sizeof(m));
+        m.t = t;
+        m.nivel = 0;
+        m.tamanho = dcl_prg;
+        m.globais_escritas = globais_escritas;
+        m.n_globais = n_globais;
+        tratar_area(&m, corpo_prg);
+        movidas += m.movidas;
+    }
+
+    free(globais);
+    free(globais_escritas);
+    return movidas;
+}
@@ -0,0 +1,15 @@
+/*
+ * invariantes.h - Código invariante para fora dos laços (modo -O1)
+ */
+
+#ifndef INVARIANTES_H
+#define INVARIANTES_H
+
+#include "ast.h"
+
+// Calcula uma vez, antes de cada while, repeat e for, as subexpressões que
+// não mudam entre as iterações, numa árvore já checada pela semântica e com
+// as constantes dobradas. Retorna o número de subexpressões movidas.
+long mover_invariantes(ArvoreAST *t);
+
+#endif
@@ -0,0 +1,258 @@
+/*
+ * lexico.c - Implementação da fonte de átomos sobre o analex.c
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "lexico.h"
+
+static void liberar_trechos(FonteAtomos *f) {
+    for (int k = 0; k < f->n_trechos; k++) free(f->trechos[k].atomos);
+    free(f->trechos);
+    f->trechos = NULL;
+    f->n_trechos = 0;
+}
+
+// Lê os átomos de e para *atomos (até sEOF, inclusive), que cresce conforme
+// preciso; *n é quantos ficaram. Retorna 0 se faltar memória
+static int ler_atomos(EstadoLexico *e, TInfoAtomo **atomos, int *n,
+                      EstatisticasCompilacao *est) {
+    int capacidade = 1024;
+
+    *atomos = malloc(sizeof(TInfoAtomo) * capacidade);
+    if (*atomos == NULL) return 0;
+    if (EST_ATIVO(est)) est->alocacoes++;
+
+    for (;;) {
+        if (*n == capacidade) {
+            capacidade *= 2;
+            TInfoAtomo *v = realloc(*atomos, sizeof(TInfoAtomo) * capacidade);
+            if (v == NULL) return 0;
+            *atomos = v;
+            if (EST_ATIVO(est)) est->alocacoes++;
+        }
+        (*atomos)[*n] = obter_atomo(e);
+        if ((*atomos)[(*n)++].atomo == sEOF) return 1;
+    }
+}
+
+// Lê todos os átomos do arquivo para um vetor (até sEOF, inclusive)
+static int pre_ler_atomos(FonteAtomos *f) {
+    EstadoLexico e;
+    MarcaTempo m;
+
+    if (EST_ATIVO(f->est)) est_marcar(&m);
+    analex_iniciar(&e, f->arquivo, 1);
+    if (!ler_atomos(&e, &f->atomos, &f->n, f->est)) return 0;
+    if (EST_ATIVO(f->est)) {
+        est_acumular(f->est, FASE_LEXICO, &m);
+        f->est->atomos += f->n;
+    }
+    return 1;
+}
+
+/*
+ * Modo paralelo. O arquivo é dividido em até n trechos de tamanhos parecidos,
+ * cada um terminando num '\n' fora de string, caractere e comentário (onde
+ * nenhum átomo começa antes e termina depois), com a linha em que começa. A
+ * varredura das fronteiras é sequencial, mas só olha bytes, sem montar
+ * átomos. Cada trecho vai para uma thread, que lê os átomos dele com
+ * obter_atomo (fmemopen sobre o mapeamento, linha já na absoluta) para o
+ * seu vetor; o primeiro trecho fica com a thread que chama. O sEOF de cada
+ * trecho só fica no último. Se obter_atomo devolve sEOF antes do fim de um
+ * trecho (caractere inválido), a leitura sequencial pararia ali: os trechos
+ * seguintes são descartados.
+ */
+
+// Tamanho mínimo de um trecho: abaixo disso, a thread não compensa
+#define TRECHO_MINIMO (1 << 20)
+
+// Como terminou a leitura de um trecho
+enum { TRECHO_LIDO, TRECHO_PAROU, TRECHO_FALHOU };
+
+typedef struct {
+    const char *texto;          // o mapeamento inteiro
+    size_t inicio, fim;         // bytes do trecho no mapeamento
+    int linha;                  // linha do primeiro byte
+    pthread_t thread;
+    int criada;                 // 0: lido pela thread que chama
+    TInfoAtomo *atomos;
+    int n;
+    int situacao;
+} Trecho;
+
+// Fronteiras dos trechos; retorna quantos saíram (1: não dá para dividir)
+static int dividir(const char *texto, size_t tam, Trecho *t, int n) {
+    enum { FORA, STRING, CARACTERE, COMENTARIO } estado = FORA;
+    int k = 1, linha = 1;
+
+    t[0].inicio = 0;
+    t[0].linha = 1;
+    for (size_t i = 0; i < tam && k < n; i++) {
+        char c = texto[i];
+        switch (estado) {
+            case FORA:
+                if (c == '"') estado = STRING;
+                else if (c == '\'') estado = CARACTERE;
+                else if (c == '{') estado = COMENTARIO;
+                break;
+            case STRING:     if (c == '"') estado = FORA; break;
+            case CARACTERE:  if (c == '\'') estado = FORA; break;
+            case COMENTARIO: if (c == '}') estado = FORA; break;
+        }
+        if (c != '\n') continue;
+        linha++;
+        if (estado == FORA && i + 1 >= tam / n * k && i + 1 < tam) {
+            t[k].inicio = i + 1;
+            t[k].linha = linha;
+            k++;
+        }
+    }
+    for (int j = 0; j < k; j++) {
+        t[j].texto = texto;
+        t[j].fim = j + 1 < k ? t[j + 1].inicio : tam;
+    }
+    return k;
+}
+
+// Lê os átomos de um trecho, terminando com o sEOF (corpo das threads)
+static void *ler_trecho(void *arg) {
+    Trecho *t = arg;
+    EstadoLexico e;
+    FILE *memoria = fmemopen((void*)(t->texto + t->inicio), t->fim - t->inicio, "r");
+
+    t->situacao = TRECHO_FALHOU;
+    if (memoria == NULL) return NULL;
+    analex_iniciar(&e, memoria, t->linha);
+    if (ler_atomos(&e, &t->atomos, &t->n, NULL)) {
+        t->situacao = feof(memoria) ? TRECHO_LIDO : TRECHO_PAROU;
+    }
+    fclose(memoria);
+    return NULL;
+}
+
+// 1 = lido, -1 = não dá (arquivo pequeno ou não regular, mapeamento ou
+// leitura de um trecho falhou...): fica para o modo pré-lido
+static int ler_em_paralelo(FonteAtomos *f, int n) {
+    struct stat st;
+    int fd = fileno(f->arquivo);
+    int resultado = -1;
+
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) return -1;
+    size_t tam = (size_t)st.st_size;
+    if (tam / TRECHO_MINIMO < (size_t)n) n = (int)(tam / TRECHO_MINIMO);
+    if (n < 2) return -1;
+
+    char *texto = mmap(NULL, tam, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (texto == MAP_FAILED) return -1;
+    Trecho *t = calloc((size_t)n, sizeof(Trecho));
+    if (t == NULL) {
+        munmap(texto, tam);
+        return -1;
+    }
+
+    n = dividir(texto, tam, t, n);
+    if (n > 1) {
+        // Sem thread (pthread_create falhou), o trecho é lido aqui mesmo
+        for (int k = 1; k < n; k++) {
+            t[k].criada = pthread_create(&t[k].thread, NULL, ler_trecho, &t[k]) == 0;
+        }
+        ler_trecho(&t[0]);
+        for (int k = 1; k < n; k++) {
+            if (t[k].criada) pthread_join(t[k].thread, NULL);
+            else ler_trecho(&t[k]);
+        }
+
+        // Valem os trechos até o primeiro que parou (inclusive)
+        int validos = 0;
+        resultado = 1;
+        while (validos < n && resultado == 1) {
+            if (t[validos].situacao == TRECHO_FALHOU) resultado = -1;
+            if (t[validos++].situacao == TRECHO_PAROU) break;
+        }
+        if (resultado == 1) {
+            f->trechos = calloc((size_t)validos, sizeof(TrechoAtomos));
+            if (f->trechos == NULL) resultado = -1;
+        }
+        for (int k = 0; k < n; k++) {
+            if (resultado == 1 && k < validos) {
+                f->trechos[k].atomos = t[k].atomos;
+                f->trechos[k].n = k + 1 < validos ? t[k].n - 1 : t[k].n;  // o sEOF do fim do trecho
+            } else {
+                free(t[k].atomos);
+            }
+        }
+        if (resultado == 1) f->n_trechos = validos;
+    }
+
+    if (resultado == 1) {
+        f->atomos = f->trechos[0].atomos;
+        f->n = f->trechos[0].n;
+        if (EST_ATIVO(f->est)) {
+            f->est->alocacoes += f->n_trechos;
+            for (int k = 0; k < f->n_trechos; k++) f->est->atomos += f->trechos[k].n;
+        }
+    }
+    free(t);
+    munmap(texto, tam);
+    return resultado;
+}
+
+int lexico_abrir(FonteAtomos *f, FILE *arquivo, int pre_ler, EstatisticasCompilacao *est) {
+    memset(f, 0, sizeof(*f));
+    f->arquivo = arquivo;
+    f->est = est;
+
+    if (pre_ler > 1) {
+        MarcaTempo m;
+        if (EST_ATIVO(est)) est_marcar(&m);
+        if (ler_em_paralelo(f, pre_ler) == 1) {
+            if (EST_ATIVO(est)) est_acumular(est, FASE_LEXICO, &m);
+            return 1;
+        }
+    }
+    if (pre_ler) return pre_ler_atomos(f);
+
+    analex_iniciar(&f->lexico, arquivo, 1);
+    return 1;
+}
+
+TInfoAtomo lexico_proximo(FonteAtomos *f) {
+    if (f->atomos == NULL) {
+        if (!EST_ATIVO(f->est)) return obter_atomo(&f->lexico);
+
+        MarcaTempo m;
+        f->est->atomos++;
+        est_entrar(f->est, FASE_LEXICO, &m);
+        TInfoAtomo atomo = obter_atomo(&f->lexico);
+        est_sair(f->est, FASE_LEXICO, &m);
+        return atomo;
+    }
+
+    // No modo paralelo, ao fim de um trecho, o seguinte
+    while (f->pos == f->n && f->trecho + 1 < f->n_trechos) {
+        f->trecho++;
+        f->atomos = f->trechos[f->trecho].atomos;
+        f->n = f->trechos[f->trecho].n;
+        f->pos = 0;
+    }
+
+    // Após o fim, continua devolvendo sEOF
+    if (f->pos < f->n - 1 || f->trecho + 1 < f->n_trechos) return f->atomos[f->pos++];
+    return f->atomos[f->n - 1];
+}
+
+void lexico_fechar(FonteAtomos *f) {
+    if (f->trechos != NULL) {
+        liberar_trechos(f);
+    } else {
+        free(f->atomos);
+    }
+    f->atomos = NULL;
+}
@@ -0,0 +1,46 @@
+/*
+ * lexico.h - Fonte de átomos de uma compilação
+ *
+ * Cada compilação tem a sua fonte de átomos, com o seu estado do
+ * analisador léxico (EstadoLexico, em analex.h): compilações em threads
+ * diferentes lêem ao mesmo tempo, sem trava. Modos:
+ *   - modo direto: lê do arquivo sob demanda;
+ *   - modo pré-lido: todos os átomos são lidos de uma vez, e o parser
+ *     consome o vetor. É o modo usado pelas compilações em paralelo;
+ *   - modo paralelo: o arquivo, mapeado na memória, é dividido em trechos
+ *     que threads (cada uma com o seu estado) lêem ao mesmo tempo, cada
+ *     uma para o seu vetor; o parser consome os vetores em ordem. Só para
+ *     arquivos regulares grandes; senão, vale o modo pré-lido.
+ */
+
+#ifndef LEXICO_H
+#define LEXICO_H
+
+#include <stdio.h>
+#include "analex.h"
+#include "estatisticas.h"
+
+// Átomos de um trecho do modo paralelo
+typedef struct {
+    TInfoAtomo *atomos;
+    int n;
+} TrechoAtomos;
+
+typedef struct {
+    FILE *arquivo;
+    EstadoLexico lexico;        // modo direto
+    TInfoAtomo *atomos;         // NULL no modo direto; no paralelo, o trecho atual
+    int n;
+    int pos;
+    TrechoAtomos *trechos;      // modo paralelo (sEOF só no último)
+    int n_trechos, trecho;
+    EstatisticasCompilacao *est; // NULL: sem medição
+} FonteAtomos;
+
+// pre_ler: 0 = modo direto, 1 = pré-lido, N > 1 = paralelo em até N
+// threads. Retorna 0 se faltar memória.
+int lexico_abrir(FonteAtomos *f, FILE *arquivo, int pre_ler, EstatisticasCompilacao *est);
+TInfoAtomo lexico_proximo(FonteAtomos *f);
+void lexico_fechar(FonteAtomos *f);
+
+#endif
@@ -0,0 +1,204 @@
+/*
+ * lote.c - Implementação da execução em lote com roubo de trabalho
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "lote.h"
+#include "mepaio.h"
+
+// Faixa [ini, fim) de índices de entradas pertencente a uma thread
+typedef struct {
+    pthread_mutex_t trava;
+    int ini;
+    int fim;
+} Faixa;
+
+typedef struct {
+    int id;
+    const ConfigLote *cfg;
+    Faixa *faixas;              // uma por thread (compartilhadas)
+    int concluidas;
+    int falhas;
+    long passos;
+    long roubos;
+} Trabalhador;
+
+// Retira a última entrada da própria faixa (-1 se vazia)
+static int retirar(Faixa *f) {
+    int idx = -1;
+    pthread_mutex_lock(&f->trava);
+    if (f->ini < f->fim) idx = --f->fim;
+    pthread_mutex_unlock(&f->trava);
+    return idx;
+}
+
+// Rouba a metade inicial da faixa de outra thread para a própria
+static int roubar(Trabalhador *t) {
+    int n = t->cfg->n_threads;
+
+    for (int k = 1; k < n; k++) {
+        Faixa *vitima = &t->faixas[(t->id + k) % n];
+        int ini = 0, fim = 0;
+
+        pthread_mutex_lock(&vitima->trava);
+        int restantes = vitima->fim - vitima->ini;
+        if (restantes > 0) {
+            int metade = (restantes + 1) / 2;
+            ini = vitima->ini;
+            fim = ini + metade;
+            vitima->ini = fim;
+        }
+        pthread_mutex_unlock(&vitima->trava);
+
+        if (fim > ini) {
+            Faixa *minha = &t->faixas[t->id];
+            pthread_mutex_lock(&minha->trava);
+            minha->ini = ini;
+            minha->fim = fim;
+            pthread_mutex_unlock(&minha->trava);
+            t->roubos++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int executar_entrada(Trabalhador *t, int idx, MaquinaMEPA *mq,
+                            EntradaMEPA *ent, SaidaMEPA *sai) {
+    const ConfigLote *cfg = t->cfg;
+    const char *nome = cfg->entradas[idx];
+    char caminho[4096];
+    int ok;
+
+    int fd_ent = open(nome, O_RDONLY);
+    if (fd_ent < 0) {
+        fprintf(stderr, "Erro: não foi possível abrir arquivo '%s'\n", nome);
+        return 0;
+    }
+    snprintf(caminho, sizeof(caminho), "%s%s", nome, cfg->sufixo_saida);
+    int fd_sai = open(caminho, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_sai < 0) {
+        fprintf(stderr, "Erro: não foi possível criar arquivo '%s'\n", caminho);
+        close(fd_ent);
+        return 0;
+    }
+
+    mepaio_trocar_entrada(ent, fd_ent);
+    mepaio_trocar_saida(sai, fd_sai);
+
+    // Área de dados zerada a cada execução: resultados independentes da ordem
+    // (com a memória do cabeçalho, a soma dos AMEM pode passar do tamanho dela)
+    int dados = cfg->prog->tam_dados < mq->tam ? cfg->prog->tam_dados : mq->tam;
+    memset(mq->M, 0, sizeof(ValorMEPA) * dados);
+    mq->passos = 0;
+
+    ok = cfg->reg ? mepareg_executar(cfg->reg, mq) : mepa_executar(cfg->prog, mq);
+    if (!mepaio_descarregar(sai)) ok = 0;
+    if (!ok) {
+        fprintf(stderr, "Erro de execução em '%s': %s\n", nome,
+                mq->erro[0] ? mq->erro : "falha ao escrever a saída");
+    }
+    t->passos += mq->passos;
+
+    close(fd_ent);
+    close(fd_sai);
+    return ok;
+}
+
+static void* trabalhar(void *arg) {
+    Trabalhador *t = arg;
+    const ConfigLote *cfg = t->cfg;
+    MaquinaMEPA mq;
+    EntradaMEPA ent;
+    SaidaMEPA sai;
+
+    // Pilha e dados privados, dimensionados pelo cabeçalho do compilador ou
+    // pela soma dos AMEM
+    int celulas = cfg->reg ? mepareg_celulas(cfg->reg) : mepa_celulas(cfg->prog);
+
+    if (!mepaio_abrir_entrada(&ent, -1, cfg->entrada_binaria)) return NULL;
+    if (!mepaio_abrir_saida(&sai, -1, cfg->saida_binaria)) {
+        mepaio_fechar_entrada(&ent);
+        return NULL;
+    }
+    if (!mepa_criar_maquina(&mq, celulas, &ent, &sai)) {
+        mepaio_fechar_entrada(&ent);
+        mepaio_fechar_saida(&sai);
+        return NULL;
+    }
+
+    for (;;) {
+        int idx = retirar(&t->faixas[t->id]);
+        if (idx < 0) {
+            if (!roubar(t)) break;
+            continue;
+        }
+        if (executar_entrada(t, idx, &mq, &ent, &sai)) t->concluidas++;
+        else t->falhas++;
+    }
+
+    mepa_liberar_maquina(&mq);
+    mepaio_fechar_entrada(&ent);
+    mepaio_fechar_saida(&sai);
+    return NULL;
+}
+
+int lote_executar(const ConfigLote *cfg, ResultadoLote *res) {
+    int n = cfg->n_threads > 0 ? cfg->n_threads : 1;
+    ConfigLote local = *cfg;
+    pthread_t *threads = malloc(sizeof(pthread_t) * n);
+    Trabalhador *trab = calloc(n, sizeof(Trabalhador));
+    Faixa *faixas = malloc(sizeof(Faixa) * n);
+    struct timespec t0, t1;
+
+    memset(res, 0, sizeof(*res));
+    if (threads == NULL || trab == NULL || faixas == NULL) {
+        free(threads);
+        free(trab);
+        free(faixas);
+        return 0;
+    }
+    local.n_threads = n;
+
+    // Divisão inicial em faixas contíguas de tamanho parecido
+    for (int k = 0; k < n; k++) {
+        pthread_mutex_init(&faixas[k].trava, NULL);
+        faixas[k].ini = (int)((long)cfg->n_entradas * k / n);
+        faixas[k].fim = (int)((long)cfg->n_entradas * (k + 1) / n);
+        trab[k].id = k;
+        trab[k].cfg = &local;
+        trab[k].faixas = faixas;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int criadas = 0;
+    for (; criadas < n; criadas++) {
+        if (pthread_create(&threads[criadas], NULL, trabalhar, &trab[criadas]) != 0) break;
+    }
+    // Se alguma thread não pôde ser criada, a thread atual assume a sua parte
+    for (int k = criadas; k < n; k++) trabalhar(&trab[k]);
+    for (int k = 0; k < criadas; k++) pthread_join(threads[k], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    for (int k = 0; k < n; k++) {
+        res->concluidas += trab[k].concluidas;
+        res->falhas += trab[k].falhas;
+        res->passos += trab[k].passos;
+        res->roubos += trab[k].roubos;
+        pthread_mutex_destroy(&faixas[k].trava);
+    }
+    res->tempo = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    free(threads);
+    free(trab);
+    free(faixas);
+    return res->falhas == 0 && res->concluidas == cfg->n_entradas;
+}
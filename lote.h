@@ -0,0 +1,38 @@
+/*
+ * lote.h - Execução em lote: um programa MEPA sobre muitas entradas
+ *
+ * O programa carregado (e sua tradução para registradores) é compartilhado,
+ * somente leitura, entre as threads. Cada thread tem pilha, área de dados e
+ * buffers de E/S próprios, reaproveitados de uma entrada para a outra. As
+ * entradas são divididas em faixas contíguas, uma por thread; quem esvazia a
+ * sua rouba metade da faixa de outra (roubo de trabalho).
+ */
+
+#ifndef LOTE_H
+#define LOTE_H
+
+#include "mepa.h"
+#include "mepareg.h"
+
+typedef struct {
+    const ProgramaMEPA *prog;
+    const ProgramaReg *reg;     // NULL executa o código de pilha
+    char **entradas;
+    int n_entradas;
+    int n_threads;
+    int entrada_binaria;
+    int saida_binaria;
+    const char *sufixo_saida;   // saída de "x" vai para "x<sufixo>"
+} ConfigLote;
+
+typedef struct {
+    int concluidas;
+    int falhas;
+    long passos;                // instruções despachadas somadas
+    long roubos;                // faixas roubadas entre threads
+    double tempo;               // tempo de parede do lote
+} ResultadoLote;
+
+int lote_executar(const ConfigLote *cfg, ResultadoLote *res);
+
+#endif
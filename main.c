@@ -1,119 +1,205 @@
 /*
  * LPDC - Compilador para LPD com Tradução Dirigida a Sintaxe
  * Projeto 2 de Compiladores
- * 
+ *
  * main.c - Ponto de entrada e orquestração do compilador
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "analex.h"
-#include "asdr.h"
-#include "tabsimb.h"
-#include "gerador.h"
+#include <unistd.h>
+#include "compilador.h"
+#include "servidor.h"
+#include "protocolo.h"
+#include "cache.h"
+#include "estatisticas.h"
 
-// Variável global necessária para analex.o
-FILE *fonte = NULL;
+static void uso(const char *prog) {
+    fprintf(stderr, "Uso: %s [-j N] <arquivo.lpd> [arquivo.lpd ...]\n", prog);
+    fprintf(stderr, "     %s [--ts-fd N] -      (fonte na entrada padrão, MEPA na saída padrão)\n", prog);
+    fprintf(stderr, "     %s -S [-s socket] [-j N]\n", prog);
+    fprintf(stderr, "  -j N       compila os arquivos em N threads (0 = todos os núcleos)\n");
+    fprintf(stderr, "  -S         modo servidor: atende pedidos do lpdcc por um socket Unix\n");
+    fprintf(stderr, "  -s socket  caminho do socket (padrão: $%s, $XDG_RUNTIME_DIR/%s\n"
+                    "             ou /tmp/lpdc-<uid>.sock)\n", PROTO_VAR_SOCKET, PROTO_SOCKET_NOME);
+    fprintf(stderr, "  -C dir     usa o cache de compilação em dir (padrão: $%s)\n", CACHE_VAR_DIR);
+    fprintf(stderr, "  -M MiB     limite de tamanho do cache (padrão: $%s ou %d)\n",
+            CACHE_VAR_MAX, CACHE_MAX_PADRAO);
+    fprintf(stderr, "  --cache-stats  mostra os acertos e falhas do cache e termina\n");
+    fprintf(stderr, "  --ts-fd N  no modo '-', grava a tabela de símbolos no descritor N\n");
+    fprintf(stderr, "  --stats[=json]  tempo por fase e contadores, em stderr\n");
+    fprintf(stderr, "  -O0        analisa e gera código numa passada só (padrão)\n");
+    fprintf(stderr, "  -O1        constrói a árvore sintática: semântica, dobra e propagação de\n"
+                    "             constantes, expansão de chamadas, desenrolamento de for,\n"
+                    "             invariantes para fora dos laços, reuso de endereços de\n"
+                    "             variáveis e geração em passadas separadas\n");
+    fprintf(stderr, "  --analisador rd|ll1  no -O0, análise por descida recursiva (padrão) ou\n"
+                    "             dirigida pela tabela LL(1) de lpd.ll1; a saída é a mesma\n");
+    fprintf(stderr, "  --lexico-paralelo N  com um arquivo, lê os átomos em N threads, um trecho\n"
+                    "             do arquivo cada (0 = todos os núcleos; 1 = tudo antes do parser)\n");
+    fprintf(stderr, "  --max-erros N   pára depois de N erros (padrão %d; 0 = sem limite)\n",
+            MAX_ERROS_PADRAO);
+    fprintf(stderr, "  --threads-geracao N  no -O1, gera as sub-rotinas em N threads (0 = todos\n"
+                    "             os núcleos; padrão: todos, ou 1 com vários arquivos e em -S)\n");
+    fprintf(stderr, "  --desenrolar N  no -O1, desenrola for de contagem conhecida em grupos de N\n"
+                    "             iterações (padrão %d; 1 = só os pequenos, por completo; 0 = não\n"
+                    "             desenrola); com --stats, relata cada laço\n", DESENROLAR_PADRAO);
+    fprintf(stderr, "  --expandir N    no -O1, expande no lugar da chamada as sub-rotinas folha de até\n"
+                    "             N nós chamadas em laços, N/4 fora deles (padrão %d; 0 = não\n"
+                    "             expande); com --stats, relata cada chamada\n", EXPANDIR_PADRAO);
+    fprintf(stderr, "  --desvios-diretos  DSVS/DSVF com o número da instrução de destino, corrigido\n"
+                    "             no arquivo quando o rótulo aparece; a memória da geração fica\n"
+                    "             proporcional ao aninhamento (só com saída num arquivo comum)\n");
+    fprintf(stderr, "  --interface   grava <base>.lpdi, a interface das variáveis globais, para\n"
+                    "             outros programas importarem\n");
+    fprintf(stderr, "  --importar arq.lpdi  enxerga as globais da interface sem analisá-las de novo;\n"
+                    "             elas ocupam o início da área do programa\n");
+    fprintf(stderr, "  --perfil arq    no -O1, arruma os blocos pelo perfil dos desvios gravado pelo\n"
+                    "             mvm -P com o código compilado sem --perfil e com as mesmas opções\n");
+    fprintf(stderr, "  --max-expressao N    parênteses/'nao'/chamadas aninhados numa expressão (padrão %d)\n",
+            MAX_EXPRESSAO_PADRAO);
+    fprintf(stderr, "  --max-aninhamento N  comandos aninhados (padrão %d)\n",
+            MAX_ANINHAMENTO_PADRAO);
+}
 
-// Arquivos de saída
-FILE *arquivo_mepa = NULL;
-FILE *arquivo_ts = NULL;
-char nome_arquivo[256];
+int main(int argc, char *argv[]) {
+    int n_threads = -1;
+    int servidor = 0;
+    const char *caminho_socket = NULL;
+    const char *dir_cache = getenv(CACHE_VAR_DIR);
+    const char *max_cache = getenv(CACHE_VAR_MAX);
+    int relatorio_cache = 0;
+    int fd_ts = -1;
+    int estatisticas = 0;           // 1 = texto, 2 = JSON
+    EstatisticasCompilacao est, *usar_est = NULL;
+    MarcaTempo inicio;
+    OpcoesCompilacao opcoes = OPCOES_PADRAO;
+    int threads_lexico = 0;
+    PerfilDesvios perfil;
+    ModuloTS modulo;
+    Cache cache, *usar_cache = NULL;
+    int i = 1, usadas;
 
-// Função auxiliar para extrair nome base do arquivo
-void extrair_nome_base(const char *caminho, char *base) {
-    const char *ultimo_barra = strrchr(caminho, '/');
-    const char *nome = ultimo_barra ? ultimo_barra + 1 : caminho;
-    
-    strcpy(base, nome);
-    char *ponto = strrchr(base, '.');
-    if (ponto) *ponto = '\0';
-}
+    // Verificar argumentos
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        if ((usadas = compilador_ler_opcao(&opcoes, argc, argv, i)) > 0) {
+            i += usadas - 1;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            n_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-S") == 0) {
+            servidor = 1;
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            caminho_socket = argv[++i];
+        } else if (strcmp(argv[i], "-C") == 0 && i + 1 < argc) {
+            dir_cache = argv[++i];
+        } else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+            max_cache = argv[++i];
+        } else if (strcmp(argv[i], "--cache-stats") == 0) {
+            relatorio_cache = 1;
+        } else if (strcmp(argv[i], "--ts-fd") == 0 && i + 1 < argc) {
+            fd_ts = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            estatisticas = 1;
+        } else if (strcmp(argv[i], "--stats=json") == 0) {
+            estatisticas = 2;
+        } else if (strcmp(argv[i], "--lexico-paralelo") == 0 && i + 1 < argc) {
+            threads_lexico = atoi(argv[++i]);
+            if (threads_lexico <= 0) threads_lexico = compilador_nucleos();
+        } else {
+            uso(argv[0]);
+            return 1;
+        }
+    }
 
-// Função para criar arquivos de saída
-int criar_arquivos_saida(const char *nome_base) {
-    char caminho[300];
-    
-    // Criar arquivo .mepa
-    snprintf(caminho, sizeof(caminho), "%s.mepa", nome_base);
-    arquivo_mepa = fopen(caminho, "w");
-    if (!arquivo_mepa) {
-        fprintf(stderr, "Erro: não foi possível criar arquivo %s\n", caminho);
-        return 0;
+    char erro[300];
+    if (!compilador_carregar_opcoes(&opcoes, &perfil, &modulo, erro, sizeof(erro))) {
+        fprintf(stderr, "Erro: %s\n", erro);
+        return 1;
     }
-    
-    // Criar arquivo .ts
-    snprintf(caminho, sizeof(caminho), "%s.ts", nome_base);
-    arquivo_ts = fopen(caminho, "w");
-    if (!arquivo_ts) {
-        fprintf(stderr, "Erro: não foi possível criar arquivo %s\n", caminho);
-        fclose(arquivo_mepa);
-        return 0;
+    if (opcoes.perfil != NULL && opcoes.otimizacao == 0) {
+        fprintf(stderr, "Aviso: --perfil só tem efeito no -O1\n");
     }
-    
-    return 1;
-}
 
-// Função para fechar todos os arquivos
-void fechar_arquivos() {
-    if (fonte) fclose(fonte);
-    if (arquivo_mepa) fclose(arquivo_mepa);
-    if (arquivo_ts) fclose(arquivo_ts);
-}
+    // Sem a opção, as threads vão para a geração só quando há um arquivo
+    // (com vários, cada um já ocupa uma thread)
+    int um_arquivo = !servidor && argc - i == 1 && n_threads < 0;
+    if (opcoes.threads_geracao < 0) opcoes.threads_geracao = um_arquivo ? compilador_nucleos() : 1;
+    compilador_opcoes(&opcoes);
 
-int main(int argc, char *argv[]) {
-    // Verificar argumentos
-    if (argc != 2) {
-        fprintf(stderr, "Uso: %s <arquivo.lpd>\n", argv[0]);
-        return 1;
+    if (servidor) {
+        if (i < argc) {
+            uso(argv[0]);
+            return 1;
+        }
+        if (n_threads <= 0) n_threads = compilador_nucleos();
+        return servidor_executar(proto_caminho_socket(caminho_socket), n_threads, &opcoes) ? 0 : 1;
     }
-    
-    // Abrir arquivo fonte (variável global para analex.o)
-    fonte = fopen(argv[1], "r");
-    if (!fonte) {
-        fprintf(stderr, "Erro: não foi possível abrir arquivo '%s'\n", argv[1]);
-        return 1;
+
+    if (relatorio_cache) {
+        if (dir_cache == NULL || dir_cache[0] == '\0') {
+            fprintf(stderr, "Erro: informe o diretório do cache (-C ou $%s)\n", CACHE_VAR_DIR);
+            return 1;
+        }
+        return cache_relatorio(dir_cache, stdout) ? 0 : 1;
     }
-    
-    // Extrair nome base para arquivos de saída
-    extrair_nome_base(argv[1], nome_arquivo);
-    
-    // Criar arquivos de saída
-    if (!criar_arquivos_saida(nome_arquivo)) {
-        fechar_arquivos();
+
+    if (i >= argc) {
+        uso(argv[0]);
         return 1;
     }
-    
-    // Inicializar módulos
-    inicializar_tabela_simbolos();
-    inicializar_gerador(arquivo_mepa);
-    
-    // Bootstrap: carregar primeiro token
-    lookahead = obter_atomo();
-    linha_atual = lookahead.linha;
-    
-    printf("Compilando '%s'...\n", argv[1]);
-    
-    // Executar análise sintática
-    if (parse_programa()) {
-        // Sucesso na compilação
-        printf("\nCódigo compilado com sucesso!\n");
-        
-        // Salvar tabela de símbolos
-        salvar_tabela_simbolos(arquivo_ts);
-        
-        // Finalizar geração de código
-        finalizar_gerador();
-        
-        fechar_arquivos();
-        liberar_tabela_simbolos();
-        return 0;
+
+    if (estatisticas) {
+        memset(&est, 0, sizeof(est));
+        usar_est = &est;
+        est_calibrar();
+        est_marcar(&inicio);
+    }
+
+    int falhas;
+    if (strcmp(argv[i], "-") == 0) {
+        // Modo fluxo: "lpdc -" (sem cache nem arquivos intermediários)
+        if (argc - i != 1) {
+            uso(argv[0]);
+            return 1;
+        }
+        falhas = compilar_padrao(fd_ts, usar_est) ? 0 : 1;
+        if (usar_est) {
+            est_finalizar(usar_est, &inicio);
+            est_relatorio(usar_est, stderr, estatisticas == 2);
+        }
+        return falhas;
+    }
+
+    if (dir_cache != NULL && dir_cache[0] != '\0') {
+        long long mib = max_cache ? atoll(max_cache) : CACHE_MAX_PADRAO;
+        if (mib <= 0) mib = CACHE_MAX_PADRAO;
+        if (cache_abrir(&cache, dir_cache, mib << 20)) {
+            usar_cache = &cache;
+        } else {
+            fprintf(stderr, "Aviso: cache '%s' indisponível (compilando sem cache)\n", dir_cache);
+        }
+    }
+
+    if (argc - i == 1 && n_threads < 0) {
+        // Um único arquivo sem -j: compilação direta, como sempre (ou com o
+        // léxico adiantado, com --lexico-paralelo)
+        falhas = compilar_arquivo(argv[i], threads_lexico, stdout, usar_cache, usar_est) ? 0 : 1;
     } else {
-        // Erro na compilação
-        printf("\nCompilação finalizada com erros.\n");
-        fechar_arquivos();
-        liberar_tabela_simbolos();
-        return 1;
+        if (n_threads <= 0) n_threads = compilador_nucleos();
+        falhas = compilar_lote(&argv[i], argc - i, n_threads, usar_cache, usar_est);
+        if (falhas > 0) {
+            fprintf(stderr, "%d de %d arquivo(s) com erros.\n", falhas, argc - i);
+        }
+    }
+
+    if (usar_cache) cache_fechar(usar_cache);
+    if (usar_est) {
+        est_finalizar(usar_est, &inicio);
+        est_relatorio(usar_est, stderr, estatisticas == 2);
     }
+    compilador_liberar_opcoes(&opcoes, &perfil, &modulo);
+    return falhas > 0 ? 1 : 0;
 }
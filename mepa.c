@@ -0,0 +1,620 @@
+/*
+ * mepa.c - Implementação da Máquina de Execução MEPA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "mepa.h"
+#include "mepaio.h"
+
+const char* mepa_nome_op(OpMEPA op) {
+    if (op >= 0 && op < OP_TOTAL) return instrucoes_mepa[op].mnemonico;
+    return "????";
+}
+
+// ------------------------------------------------------------------
+// Tabela de rótulos usada apenas durante a carga (endereçamento aberto)
+// ------------------------------------------------------------------
+
+typedef struct {
+    char nome[32];
+    int indice;                 // instrução rotulada (-1 = vazio)
+} EntradaRotulo;
+
+typedef struct {
+    EntradaRotulo *v;
+    int capacidade;
+    int usados;
+} TabelaRotulos;
+
+static unsigned hash_rotulo(const char *s) {
+    unsigned h = 2166136261u;
+    while (*s) {
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    }
+    return h;
+}
+
+static EntradaRotulo* rotulo_slot(TabelaRotulos *t, const char *nome) {
+    unsigned i = hash_rotulo(nome) & (unsigned)(t->capacidade - 1);
+    while (t->v[i].indice != -1 && strcmp(t->v[i].nome, nome) != 0) {
+        i = (i + 1) & (unsigned)(t->capacidade - 1);
+    }
+    return &t->v[i];
+}
+
+static int rotulo_inserir(TabelaRotulos *t, const char *nome, int indice) {
+    if ((t->usados + 1) * 2 > t->capacidade) {
+        TabelaRotulos nova;
+        nova.capacidade = t->capacidade ? t->capacidade * 2 : 64;
+        nova.usados = 0;
+        nova.v = malloc(sizeof(EntradaRotulo) * nova.capacidade);
+        if (nova.v == NULL) return 0;
+        for (int i = 0; i < nova.capacidade; i++) nova.v[i].indice = -1;
+        for (int i = 0; i < t->capacidade; i++) {
+            if (t->v[i].indice != -1) {
+                *rotulo_slot(&nova, t->v[i].nome) = t->v[i];
+                nova.usados++;
+            }
+        }
+        free(t->v);
+        *t = nova;
+    }
+    EntradaRotulo *e = rotulo_slot(t, nome);
+    if (e->indice != -1) return 0;  // rótulo duplicado
+    strncpy(e->nome, nome, sizeof(e->nome) - 1);
+    e->nome[sizeof(e->nome) - 1] = '\0';
+    e->indice = indice;
+    t->usados++;
+    return 1;
+}
+
+static int rotulo_buscar(TabelaRotulos *t, const char *nome) {
+    if (t->capacidade == 0) return -1;
+    return rotulo_slot(t, nome)->indice;
+}
+
+// ------------------------------------------------------------------
+// Carga do programa
+// ------------------------------------------------------------------
+
+static int adicionar_instr(ProgramaMEPA *prog, InstrMEPA in) {
+    if (prog->n == prog->capacidade) {
+        int nova = prog->capacidade ? prog->capacidade * 2 : 256;
+        InstrMEPA *v = realloc(prog->instr, sizeof(InstrMEPA) * nova);
+        if (v == NULL) return 0;
+        prog->instr = v;
+        prog->capacidade = nova;
+    }
+    prog->instr[prog->n++] = in;
+    return 1;
+}
+
+// Converte o texto de uma constante em célula (real se tiver '.' ou expoente)
+static ValorMEPA valor_de_texto(const char *texto) {
+    ValorMEPA r;
+    if (strpbrk(texto, ".eE") != NULL) {
+        r.real = 1;
+        r.v.f = strtod(texto, NULL);
+    } else {
+        r.real = 0;
+        r.v.i = strtol(texto, NULL, 10);
+    }
+    return r;
+}
+
+// Acrescenta à tabela de cadeias a entrada da linha CADEIA k "texto" (p
+// aponta para o k); as entradas vêm na ordem dos índices. cap_entradas e
+// cap_texto são as capacidades de inicio_cadeia e de cadeias
+static int carregar_cadeia(ProgramaMEPA *prog, const char *p, int *cap_entradas,
+                           int *cap_texto, int num_linha, char *erro, int tam_erro) {
+    char *fim;
+    long k = strtol(p, &fim, 10);
+
+    if (fim == p || k != prog->n_cadeias) {
+        snprintf(erro, tam_erro, "linha %d: entrada da tabela de cadeias fora de ordem",
+                 num_linha);
+        return 0;
+    }
+    p = fim;
+    while (*p == ' ') p++;
+    if (*p != '"') {
+        snprintf(erro, tam_erro, "linha %d: cadeia sem aspas", num_linha);
+        return 0;
+    }
+    p++;
+
+    // O texto sem os escapes nunca é maior que o escrito; +1 para o '\n'
+    int usado = prog->n_cadeias > 0 ? prog->inicio_cadeia[prog->n_cadeias] : 0;
+    int maximo = usado + (int)strlen(p) + 1;
+    if (prog->n_cadeias + 2 > *cap_entradas) {
+        int nova = *cap_entradas ? *cap_entradas * 2 : 16;
+        int *v = realloc(prog->inicio_cadeia, sizeof(int) * nova);
+        if (v == NULL) goto sem_memoria;
+        prog->inicio_cadeia = v;
+        *cap_entradas = nova;
+    }
+    if (maximo > *cap_texto) {
+        int nova = *cap_texto ? *cap_texto * 2 : 1024;
+        while (nova < maximo) nova *= 2;
+        char *v = realloc(prog->cadeias, (size_t)nova);
+        if (v == NULL) goto sem_memoria;
+        prog->cadeias = v;
+        *cap_texto = nova;
+    }
+
+    char *d = prog->cadeias + usado;
+    for (; *p != '"'; p++) {
+        if (*p == '\0' || *p == '\n') {
+            snprintf(erro, tam_erro, "linha %d: cadeia sem as aspas finais", num_linha);
+            return 0;
+        }
+        if (*p == '\\' && p[1] != '\0') {
+            p++;
+            *d++ = *p == 'n' ? '\n' : *p == 't' ? '\t' : *p;
+        } else {
+            *d++ = *p;
+        }
+    }
+    *d++ = '\n';
+    prog->inicio_cadeia[0] = 0;
+    prog->inicio_cadeia[++prog->n_cadeias] = (int)(d - prog->cadeias);
+    return 1;
+
+sem_memoria:
+    snprintf(erro, tam_erro, "memória insuficiente");
+    return 0;
+}
+
+// Lê o arquivo .mepa em duas passagens: instruções e rótulos, depois desvios
+// (para um rótulo ou, no modo de desvios diretos do gerador, um número)
+int mepa_carregar(FILE *arquivo, ProgramaMEPA *prog, char *erro, int tam_erro) {
+    TabelaRotulos rotulos = { NULL, 0, 0 };
+    char **destinos = NULL;     // nome do rótulo de destino por instrução
+    int cap_destinos = 0;
+    int cap_entradas = 0, cap_texto = 0;
+    char linha[256];
+    int num_linha = 0;
+    int ok = 1;
+
+    memset(prog, 0, sizeof(*prog));
+    prog->cab_pilha = -1;
+
+    while (ok && fgets(linha, sizeof(linha), arquivo) != NULL) {
+        num_linha++;
+        char *p = linha;
+        char rotulo[32] = "";
+        char mnem[16];
+        char arg1[64] = "", arg2[64] = "";
+
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '\0') continue;
+
+        // Comentário; "# MEPA dados=D pilha=P" é o cabeçalho do compilador
+        if (*p == '#') {
+            int dados, pilha;
+            if (sscanf(p, "# MEPA dados=%d pilha=%d", &dados, &pilha) == 2 && dados >= 0) {
+                prog->cab_dados = dados;
+                prog->cab_pilha = pilha;
+            }
+            continue;
+        }
+
+        // Entrada da tabela de cadeias (antes do rótulo: o texto pode ter ':')
+        if (strncmp(p, "CADEIA ", 7) == 0) {
+            ok = carregar_cadeia(prog, p + 7, &cap_entradas, &cap_texto, num_linha,
+                                 erro, tam_erro);
+            continue;
+        }
+
+        // Rótulo opcional "Lx: "
+        char *dois_pontos = strchr(p, ':');
+        if (dois_pontos != NULL) {
+            int tam = (int)(dois_pontos - p);
+            if (tam >= (int)sizeof(rotulo)) tam = sizeof(rotulo) - 1;
+            memcpy(rotulo, p, tam);
+            rotulo[tam] = '\0';
+            p = dois_pontos + 1;
+        }
+
+        if (sscanf(p, "%15s %63[^,\n],%63s", mnem, arg1, arg2) < 1) continue;
+        if (strcmp(mnem, "FIM") == 0) break;
+
+        int op = mepa_op_por_nome(mnem);
+        if (op < 0) {
+            snprintf(erro, tam_erro, "linha %d: instrução desconhecida '%s'",
+                     num_linha, mnem);
+            ok = 0;
+            break;
+        }
+
+        InstrMEPA in;
+        memset(&in, 0, sizeof(in));
+        in.op = (OpMEPA)op;
+
+        switch (in.op) {
+            case OP_CRCT:
+                in.k = valor_de_texto(arg1);
+                break;
+            case OP_CRVL:
+            case OP_ARMZ:
+                in.p1 = atoi(arg1);
+                in.p2 = atoi(arg2);
+                if (in.p1 < 0 || in.p1 >= MEPA_MAX_NIVEIS) {
+                    snprintf(erro, tam_erro, "linha %d: nível léxico inválido",
+                             num_linha);
+                    ok = 0;
+                }
+                break;
+            case OP_AMEM:
+            case OP_DMEM:
+                in.p1 = atoi(arg1);
+                if (in.op == OP_AMEM) prog->tam_dados += in.p1;
+                break;
+            case OP_CHPR:
+                in.p2 = atoi(arg2);
+                break;
+            case OP_IMPS:
+                in.p1 = atoi(arg1);
+                break;
+            case OP_ENPR:
+            case OP_RTPR:
+                in.p1 = atoi(arg1);
+                in.p2 = atoi(arg2);
+                if (in.p1 < 0 || in.p1 >= MEPA_MAX_NIVEIS) {
+                    snprintf(erro, tam_erro, "linha %d: nível léxico inválido",
+                             num_linha);
+                    ok = 0;
+                }
+                break;
+            default:
+                break;
+        }
+
+        if (rotulo[0] != '\0' && !rotulo_inserir(&rotulos, rotulo, prog->n)) {
+            snprintf(erro, tam_erro, "linha %d: rótulo '%s' duplicado",
+                     num_linha, rotulo);
+            ok = 0;
+        }
+
+        // Guardar destino de desvio para resolução posterior
+        if (ok && (in.op == OP_DSVS || in.op == OP_DSVF || in.op == OP_CHPR)) {
+            if (prog->n >= cap_destinos) {
+                int nova = cap_destinos ? cap_destinos * 2 : 256;
+                while (nova <= prog->n) nova *= 2;
+                char **v = realloc(destinos, sizeof(char*) * nova);
+                if (v == NULL) { ok = 0; break; }
+                memset(v + cap_destinos, 0, sizeof(char*) * (nova - cap_destinos));
+                destinos = v;
+                cap_destinos = nova;
+            }
+            destinos[prog->n] = malloc(strlen(arg1) + 1);
+            if (destinos[prog->n] == NULL) { ok = 0; break; }
+            strcpy(destinos[prog->n], arg1);
+        }
+
+        if (ok && !adicionar_instr(prog, in)) {
+            snprintf(erro, tam_erro, "memória insuficiente");
+            ok = 0;
+        }
+    }
+
+    // Segunda passagem: resolver rótulos de desvio e conferir as entradas
+    // de IMPS (a tabela de cadeias vem depois do código)
+    for (int i = 0; ok && i < prog->n; i++) {
+        if (prog->instr[i].op == OP_IMPS &&
+            (prog->instr[i].p1 < 0 || prog->instr[i].p1 >= prog->n_cadeias)) {
+            snprintf(erro, tam_erro, "IMPS da cadeia %d, fora da tabela", prog->instr[i].p1);
+            ok = 0;
+            break;
+        }
+        if (prog->instr[i].op != OP_DSVS && prog->instr[i].op != OP_DSVF &&
+            prog->instr[i].op != OP_CHPR) continue;
+        int alvo;
+        if (isdigit((unsigned char)destinos[i][0])) {
+            // Desvio direto (ver gerador.h): já é o número da instrução
+            alvo = atoi(destinos[i]);
+            if (alvo >= prog->n) {
+                snprintf(erro, tam_erro, "desvio para a instrução %d, fora do programa", alvo);
+                ok = 0;
+            }
+        } else {
+            alvo = rotulo_buscar(&rotulos, destinos[i]);
+            if (alvo < 0) {
+                snprintf(erro, tam_erro, "rótulo '%s' não definido", destinos[i]);
+                ok = 0;
+            }
+        }
+        prog->instr[i].p1 = alvo;
+    }
+
+    // Garantir que a execução nunca ultrapasse o fim do código
+    if (ok && (prog->n == 0 || (prog->instr[prog->n - 1].op != OP_PARA &&
+                                prog->instr[prog->n - 1].op != OP_DSVS))) {
+        InstrMEPA para;
+        memset(&para, 0, sizeof(para));
+        para.op = OP_PARA;
+        ok = adicionar_instr(prog, para);
+    }
+
+    for (int i = 0; i < cap_destinos; i++) free(destinos[i]);
+    free(destinos);
+    free(rotulos.v);
+
+    if (!ok) mepa_liberar(prog);
+    return ok;
+}
+
+int mepa_celulas(const ProgramaMEPA *prog) {
+    if (prog->cab_pilha >= 0) {
+        int n = prog->cab_dados + prog->cab_pilha;
+        return n > 0 ? n : 1;
+    }
+    return prog->tam_dados + MEPA_PILHA_PADRAO;
+}
+
+void mepa_liberar(ProgramaMEPA *prog) {
+    free(prog->instr);
+    free(prog->cadeias);
+    free(prog->inicio_cadeia);
+    memset(prog, 0, sizeof(*prog));
+}
+
+// ------------------------------------------------------------------
+// Máquina e E/S
+// ------------------------------------------------------------------
+
+int mepa_criar_maquina(MaquinaMEPA *mq, int celulas,
+                       EntradaMEPA *entrada, SaidaMEPA *saida) {
+    memset(mq, 0, sizeof(*mq));
+    mq->M = calloc(celulas, sizeof(ValorMEPA));
+    if (mq->M == NULL) return 0;
+    mq->tam = celulas;
+    mq->entrada = entrada;
+    mq->saida = saida;
+    return 1;
+}
+
+void mepa_liberar_maquina(MaquinaMEPA *mq) {
+    free(mq->M);
+    mq->M = NULL;
+    mq->tam = 0;
+}
+
+// ------------------------------------------------------------------
+// Execução direta do código de pilha
+// ------------------------------------------------------------------
+
+#define EMPILHA_OK() \
+    if (s + 1 >= mq->tam) { \
+        snprintf(mq->erro, sizeof(mq->erro), "estouro de pilha (instrução %d)", i); \
+        mq->passos += passos; \
+        return 0; \
+    }
+
+int mepa_executar(const ProgramaMEPA *prog, MaquinaMEPA *mq) {
+    const InstrMEPA *codigo = prog->instr;
+    ValorMEPA *M = mq->M;
+    int *D = mq->D;
+    long *perfil = mq->perfil;
+    int s = -1;
+    int i = 0;
+    long passos = 0;
+
+    for (;;) {
+        const InstrMEPA *in = &codigo[i];
+        passos++;
+
+        switch (in->op) {
+            case OP_INPP:
+                s = -1;
+                D[0] = 0;
+                i++;
+                break;
+            case OP_AMEM:
+                if (s + in->p1 >= mq->tam) {
+                    snprintf(mq->erro, sizeof(mq->erro), "área de dados excede a memória");
+                    mq->passos += passos;
+                    return 0;
+                }
+                s += in->p1;
+                i++;
+                break;
+            case OP_DMEM:
+                s -= in->p1;
+                i++;
+                break;
+            case OP_PARA:
+                mq->passos += passos;
+                if (!mepaio_descarregar(mq->saida)) {
+                    snprintf(mq->erro, sizeof(mq->erro), "falha ao escrever a saída");
+                    return 0;
+                }
+                return 1;
+            case OP_CRCT:
+                EMPILHA_OK();
+                M[++s] = in->k;
+                i++;
+                break;
+            case OP_CRVL:
+                EMPILHA_OK();
+                s++;
+                M[s] = M[D[in->p1] + in->p2];
+                i++;
+                break;
+            case OP_ARMZ:
+                M[D[in->p1] + in->p2] = M[s--];
+                i++;
+                break;
+            case OP_DIVI: {
+                const char *erro = mepa_erro_divisao(M[s - 1], M[s]);
+                if (erro != NULL) {
+                    snprintf(mq->erro, sizeof(mq->erro), "%s (instrução %d)", erro, i);
+                    mq->passos += passos;
+                    return 0;
+                }
+            }
+                /* fallthrough */
+            case OP_SOMA:
+            case OP_SUBT:
+            case OP_MULT:
+                M[s - 1] = mepa_aritmetica(in->op, M[s - 1], M[s]);
+                s--;
+                i++;
+                break;
+            case OP_INVR:
+                if (M[s].real) M[s].v.f = -M[s].v.f;
+                else M[s].v.i = (long)(0UL - (unsigned long)M[s].v.i);
+                i++;
+                break;
+            case OP_CONJ:
+                M[s - 1] = mepa_int(mepa_verdadeiro(M[s - 1]) && mepa_verdadeiro(M[s]));
+                s--;
+                i++;
+                break;
+            case OP_DISJ:
+                M[s - 1] = mepa_int(mepa_verdadeiro(M[s - 1]) || mepa_verdadeiro(M[s]));
+                s--;
+                i++;
+                break;
+            case OP_NEGA:
+                M[s] = mepa_int(!mepa_verdadeiro(M[s]));
+                i++;
+                break;
+            case OP_CMME:
+            case OP_CMMA:
+            case OP_CMIG:
+            case OP_CMDG:
+            case OP_CMEG:
+            case OP_CMAG:
+                M[s - 1] = mepa_int(mepa_compara(in->op, M[s - 1], M[s]));
+                s--;
+                i++;
+                break;
+            case OP_DSVS:
+                i = in->p1;
+                break;
+            case OP_DSVF:
+                if (perfil != NULL) {
+                    perfil[2 * i]++;
+                    perfil[2 * i + 1] += !mepa_verdadeiro(M[s]);
+                }
+                i = mepa_verdadeiro(M[s]) ? i + 1 : in->p1;
+                s--;
+                break;
+            case OP_NADA:
+                i++;
+                break;
+            case OP_LEIT:
+                EMPILHA_OK();
+                if (!mepaio_ler(mq->entrada, &M[++s])) {
+                    snprintf(mq->erro, sizeof(mq->erro),
+                             "entrada inválida ou esgotada em LEIT (instrução %d)", i);
+                    mq->passos += passos;
+                    return 0;
+                }
+                i++;
+                break;
+            case OP_IMPR:
+                if (!mepaio_escrever(mq->saida, M[s--])) {
+                    snprintf(mq->erro, sizeof(mq->erro), "falha ao escrever a saída");
+                    mq->passos += passos;
+                    return 0;
+                }
+                i++;
+                break;
+            case OP_IMPS: {
+                const int *ini = prog->inicio_cadeia + in->p1;
+                if (!mepaio_escrever_texto(mq->saida, prog->cadeias + ini[0], ini[1] - ini[0])) {
+                    snprintf(mq->erro, sizeof(mq->erro), "falha ao escrever a saída");
+                    mq->passos += passos;
+                    return 0;
+                }
+                i++;
+                break;
+            }
+            case OP_CHPR:
+                EMPILHA_OK();
+                M[++s] = mepa_int(i + 1);
+                i = in->p1;
+                break;
+            case OP_ENPR:
+                EMPILHA_OK();
+                M[++s] = mepa_int(D[in->p1]);
+                D[in->p1] = s + 1;
+                i++;
+                break;
+            case OP_RTPR:
+                D[in->p1] = (int)M[s].v.i;
+                i = (int)M[s - 1].v.i;
+                s -= in->p2 + 2;
+                break;
+            default:
+                snprintf(mq->erro, sizeof(mq->erro), "instrução inválida %d", i);
+                mq->passos += passos;
+                return 0;
+        }
+    }
+}
+
+// ------------------------------------------------------------------
+// Profundidade da pilha de operandos
+// ------------------------------------------------------------------
+
+// Efeito de cada instrução sobre a pilha de operandos (mepainstr.h). A
+// parte do parâmetro (AMEM/DMEM) fica de fora: sem sub-rotinas, eles só
+// abrem e fecham a área de dados, que não é pilha de operandos
+static int efeito_pilha(OpMEPA op) {
+    return instrucoes_mepa[op].efeito;
+}
+
+// Preenche prof[i] com a profundidade antes da instrução i (-1 se
+// inalcançável). Retorna a profundidade máxima ou -1 se os caminhos que
+// chegam a um mesmo ponto discordam (ou a pilha fica negativa). Programas
+// com sub-rotinas não são analisados (-1): o efeito de uma chamada depende
+// da sub-rotina chamada.
+int mepa_profundidades(const ProgramaMEPA *prog, int *prof) {
+    int *pendentes = malloc(sizeof(int) * (prog->n + 1));
+    int topo = 0;
+    int maximo = 0;
+
+    if (pendentes == NULL) return -1;
+    for (int i = 0; i < prog->n; i++) prof[i] = -1;
+
+    prof[0] = 0;
+    pendentes[topo++] = 0;
+
+    while (topo > 0) {
+        int i = pendentes[--topo];
+        const InstrMEPA *in = &prog->instr[i];
+        int depois = prof[i] + efeito_pilha(in->op);
+        int suc[2], n_suc = 0;
+
+        if (in->op == OP_CHPR) depois = -1;
+        if (depois < 0) { free(pendentes); return -1; }
+        if (depois > maximo) maximo = depois;
+
+        if (in->op == OP_DSVS) {
+            suc[n_suc++] = in->p1;
+        } else if (in->op != OP_PARA) {
+            if (i + 1 < prog->n) suc[n_suc++] = i + 1;
+            if (in->op == OP_DSVF) suc[n_suc++] = in->p1;
+        }
+
+        for (int k = 0; k < n_suc; k++) {
+            int j = suc[k];
+            if (prof[j] == -1) {
+                prof[j] = depois;
+                pendentes[topo++] = j;
+            } else if (prof[j] != depois) {
+                free(pendentes);
+                return -1;
+            }
+        }
+    }
+
+    free(pendentes);
+    return maximo;
+}
@@ -0,0 +1,174 @@
+/*
+ * mepa.h - Interface da Máquina de Execução MEPA
+ *
+ * Carrega o código MEPA gerado pelo lpdc (formato texto) para um vetor de
+ * instruções com rótulos já resolvidos e o executa diretamente na forma de
+ * pilha.
+ *
+ * Sub-rotinas: quem chama reserva a célula do resultado (AMEM 1, só para
+ * funções), empilha os n argumentos e executa CHPR p,k (empilha o endereço
+ * de retorno e desvia para p; k é o nível de quem chama). A sub-rotina de
+ * nível k começa com ENPR k (empilha D[k] e aponta D[k] para o topo + 1) e
+ * termina com RTPR k,n (restaura D[k], volta ao endereço de retorno e
+ * descarta os n argumentos). No corpo, os locais ficam em D[k] + 0, 1, ...,
+ * o argumento i em D[k] - (n + 3) + i e o resultado em D[k] - (n + 3).
+ *
+ * IMPS k imprime a entrada k da tabela de cadeias (ver gerador.h), direto
+ * do texto carregado, sem passar pela pilha.
+ */
+
+#ifndef MEPA_H
+#define MEPA_H
+
+#include <stdio.h>
+#include <limits.h>
+#include "mepainstr.h"
+
+// Tamanho padrão da pilha de avaliação (em células) além da área de dados
+#define MEPA_PILHA_PADRAO 65536
+
+// Número máximo de níveis léxicos (registradores de base D[k])
+#define MEPA_MAX_NIVEIS 16
+
+// Célula de memória: inteiro (também usado para bool/char) ou real
+typedef struct {
+    int real;                   // 1 se o valor é real (float)
+    union {
+        long i;
+        double f;
+    } v;
+} ValorMEPA;
+
+// Instrução carregada (rótulos de desvio já convertidos em índices)
+typedef struct {
+    OpMEPA op;
+    int p1;                     // nível, quantidade, destino do desvio ou
+                                // entrada da tabela de cadeias (IMPS)
+    int p2;                     // deslocamento (CRVL/ARMZ), nível (CHPR) ou
+                                // nº de argumentos (RTPR)
+    ValorMEPA k;                // constante (CRCT)
+} InstrMEPA;
+
+// Programa MEPA carregado
+typedef struct {
+    InstrMEPA *instr;
+    int n;
+    int capacidade;
+    int tam_dados;              // soma dos AMEM do programa
+    int cab_dados;              // cabeçalho "# MEPA" do compilador: dados globais
+    int cab_pilha;              // e células acima deles (-1: sem cabeçalho ou sem limite)
+    char *cadeias;              // tabela de cadeias (linhas CADEIA): os textos,
+                                // cada um seguido de '\n', em sequência
+    int *inicio_cadeia;         // n_cadeias + 1 posições em cadeias
+    int n_cadeias;
+} ProgramaMEPA;
+
+// E/S em blocos usada por LEIT, IMPR e IMPS (mepaio.h)
+struct EntradaMEPA;
+struct SaidaMEPA;
+
+// Estado de execução (memória, registradores e E/S)
+typedef struct {
+    ValorMEPA *M;
+    int tam;
+    int D[MEPA_MAX_NIVEIS];
+    long passos;                // instruções despachadas
+    struct EntradaMEPA *entrada;
+    struct SaidaMEPA *saida;
+    long *perfil;               // não NULL: por instrução, DSVF executados
+                                // (2i) e desviados (2i + 1); ver perfil.h
+    char erro[128];
+} MaquinaMEPA;
+
+// Carga e liberação do programa
+int mepa_carregar(FILE *arquivo, ProgramaMEPA *prog, char *erro, int tam_erro);
+void mepa_liberar(ProgramaMEPA *prog);
+
+// Células de memória para executar o programa: as do cabeçalho, quando o
+// compilador pôde calculá-las, senão a soma dos AMEM mais MEPA_PILHA_PADRAO
+int mepa_celulas(const ProgramaMEPA *prog);
+
+// Criação da máquina e execução direta do código de pilha
+int mepa_criar_maquina(MaquinaMEPA *mq, int celulas,
+                       struct EntradaMEPA *entrada, struct SaidaMEPA *saida);
+void mepa_liberar_maquina(MaquinaMEPA *mq);
+int mepa_executar(const ProgramaMEPA *prog, MaquinaMEPA *mq);
+
+// Análise estática da profundidade da pilha de operandos
+int mepa_profundidades(const ProgramaMEPA *prog, int *prof);
+
+// Funções auxiliares
+const char* mepa_nome_op(OpMEPA op);
+
+// Aritmética sobre células (inteiro, promovendo para real quando necessário)
+static inline double mepa_real(ValorMEPA a) {
+    return a.real ? a.v.f : (double)a.v.i;
+}
+
+static inline ValorMEPA mepa_int(long i) {
+    ValorMEPA r;
+    r.real = 0;
+    r.v.i = i;
+    return r;
+}
+
+static inline ValorMEPA mepa_aritmetica(OpMEPA op, ValorMEPA a, ValorMEPA b) {
+    ValorMEPA r;
+    if (a.real || b.real) {
+        double x = mepa_real(a), y = mepa_real(b);
+        r.real = 1;
+        switch (op) {
+            case OP_SOMA: r.v.f = x + y; break;
+            case OP_SUBT: r.v.f = x - y; break;
+            case OP_MULT: r.v.f = x * y; break;
+            default:      r.v.f = x / y; break;
+        }
+    } else {
+        r.real = 0;
+        switch (op) {
+            // Estouro em complemento de dois, como a dobra de constantes
+            case OP_SOMA: r.v.i = (long)((unsigned long)a.v.i + (unsigned long)b.v.i); break;
+            case OP_SUBT: r.v.i = (long)((unsigned long)a.v.i - (unsigned long)b.v.i); break;
+            case OP_MULT: r.v.i = (long)((unsigned long)a.v.i * (unsigned long)b.v.i); break;
+            default:      r.v.i = a.v.i / b.v.i; break;
+        }
+    }
+    return r;
+}
+
+// Erro de a / b entre inteiros (NULL se não há): por zero ou LONG_MIN / -1,
+// cujo quociente não cabe num long
+static inline const char* mepa_erro_divisao(ValorMEPA a, ValorMEPA b) {
+    if (a.real || b.real) return NULL;
+    if (b.v.i == 0) return "divisão por zero";
+    if (b.v.i == -1 && a.v.i == LONG_MIN) return "estouro na divisão";
+    return NULL;
+}
+
+static inline int mepa_compara(OpMEPA op, ValorMEPA a, ValorMEPA b) {
+    if (a.real || b.real) {
+        double x = mepa_real(a), y = mepa_real(b);
+        switch (op) {
+            case OP_CMME: return x < y;
+            case OP_CMMA: return x > y;
+            case OP_CMIG: return x == y;
+            case OP_CMDG: return x != y;
+            case OP_CMEG: return x <= y;
+            default:      return x >= y;
+        }
+    }
+    switch (op) {
+        case OP_CMME: return a.v.i < b.v.i;
+        case OP_CMMA: return a.v.i > b.v.i;
+        case OP_CMIG: return a.v.i == b.v.i;
+        case OP_CMDG: return a.v.i != b.v.i;
+        case OP_CMEG: return a.v.i <= b.v.i;
+        default:      return a.v.i >= b.v.i;
+    }
+}
+
+static inline int mepa_verdadeiro(ValorMEPA a) {
+    return a.real ? a.v.f != 0.0 : a.v.i != 0;
+}
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * mepainstr.h - Conjunto de instruções MEPA
+ *
+ * Códigos, mnemônicos e efeito de cada instrução sobre a pilha, numa tabela
+ * só: o gerador (gerador.c) a usa para acompanhar a pilha do cabeçalho
+ * "# MEPA" e a máquina (mepa.c) para carregar o código e analisar a
+ * profundidade da pilha de operandos.
+ */
+
+#ifndef MEPAINSTR_H
+#define MEPAINSTR_H
+
+#include <string.h>
+
+// Códigos de operação reconhecidos pela máquina
+typedef enum {
+    OP_INPP, OP_AMEM, OP_DMEM, OP_PARA,
+    OP_CRCT, OP_CRVL, OP_ARMZ,
+    OP_SOMA, OP_SUBT, OP_MULT, OP_DIVI, OP_INVR,
+    OP_CONJ, OP_DISJ, OP_NEGA,
+    OP_CMME, OP_CMMA, OP_CMIG, OP_CMDG, OP_CMEG, OP_CMAG,
+    OP_DSVS, OP_DSVF, OP_NADA,
+    OP_LEIT, OP_IMPR, OP_IMPS,
+    OP_CHPR, OP_ENPR, OP_RTPR,
+    OP_TOTAL
+} OpMEPA;
+
+// Efeito sobre a pilha: efeito células, mais por_parametro vezes o primeiro
+// parâmetro (AMEM e DMEM). Chamadas e retornos (CHPR, ENPR, RTPR) dependem
+// da sub-rotina e ficam com 0: quem acompanha a pilha os trata à parte
+typedef struct {
+    const char *mnemonico;
+    int efeito;
+    int por_parametro;
+} InstrucaoMEPA;
+
+// Na ordem de OpMEPA
+static const InstrucaoMEPA instrucoes_mepa[OP_TOTAL] = {
+    {"INPP",  0,  0}, {"AMEM",  0,  1}, {"DMEM",  0, -1}, {"PARA",  0,  0},
+    {"CRCT",  1,  0}, {"CRVL",  1,  0}, {"ARMZ", -1,  0},
+    {"SOMA", -1,  0}, {"SUBT", -1,  0}, {"MULT", -1,  0}, {"DIVI", -1,  0},
+    {"INVR",  0,  0},
+    {"CONJ", -1,  0}, {"DISJ", -1,  0}, {"NEGA",  0,  0},
+    {"CMME", -1,  0}, {"CMMA", -1,  0}, {"CMIG", -1,  0},
+    {"CMDG", -1,  0}, {"CMEG", -1,  0}, {"CMAG", -1,  0},
+    {"DSVS",  0,  0}, {"DSVF", -1,  0}, {"NADA",  0,  0},
+    {"LEIT",  1,  0}, {"IMPR", -1,  0}, {"IMPS",  0,  0},
+    {"CHPR",  0,  0}, {"ENPR",  0,  0}, {"RTPR",  0,  0},
+};
+
+// Código da instrução de mnemônico nome (-1 se não existe)
+static inline int mepa_op_por_nome(const char *nome) {
+    for (int i = 0; i < OP_TOTAL; i++) {
+        if (strcmp(instrucoes_mepa[i].mnemonico, nome) == 0) return i;
+    }
+    return -1;
+}
+
+#endif
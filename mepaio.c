@@ -0,0 +1,266 @@
+/*
+ * mepaio.c - Implementação da E/S em blocos para LEIT, IMPR e IMPS
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <unistd.h>
+#include "mepaio.h"
+
+// ------------------------------------------------------------------
+// Entrada
+// ------------------------------------------------------------------
+
+int mepaio_abrir_entrada(EntradaMEPA *e, int fd, int binaria) {
+    memset(e, 0, sizeof(*e));
+    e->buf = malloc(MEPAIO_BLOCO);
+    if (e->buf == NULL) return 0;
+    e->fd = fd;
+    e->binaria = binaria;
+    e->tam = MEPAIO_BLOCO;
+    return 1;
+}
+
+void mepaio_fechar_entrada(EntradaMEPA *e) {
+    free(e->buf);
+    e->buf = NULL;
+}
+
+int mepaio_rebobinar(EntradaMEPA *e) {
+    if (lseek(e->fd, 0, SEEK_SET) < 0) return 0;
+    e->pos = e->fim = 0;
+    e->esgotada = 0;
+    return 1;
+}
+
+// Reaproveita o buffer para ler de outro descritor
+void mepaio_trocar_entrada(EntradaMEPA *e, int fd) {
+    e->fd = fd;
+    e->pos = e->fim = 0;
+    e->esgotada = 0;
+}
+
+// Lê o próximo bloco; retorna 0 no fim da entrada
+static int recarregar(EntradaMEPA *e) {
+    ssize_t n;
+
+    if (e->esgotada) return 0;
+    do {
+        n = read(e->fd, e->buf, e->tam);
+    } while (n < 0 && errno == EINTR);
+
+    if (n <= 0) {
+        e->esgotada = 1;
+        e->pos = e->fim = 0;
+        return 0;
+    }
+    e->pos = 0;
+    e->fim = (int)n;
+    return 1;
+}
+
+// Próximo byte sem consumir (-1 no fim)
+static inline int espia(EntradaMEPA *e) {
+    if (e->pos == e->fim && !recarregar(e)) return -1;
+    return (unsigned char)e->buf[e->pos];
+}
+
+static inline int eh_espaco(int c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static int ler_binario(EntradaMEPA *e, ValorMEPA *valor) {
+    unsigned char reg[9];
+
+    for (int k = 0; k < 9; k++) {
+        int c = espia(e);
+        if (c < 0) return 0;
+        reg[k] = (unsigned char)c;
+        e->pos++;
+    }
+
+    if (reg[0] == 'i') {
+        int64_t i;
+        memcpy(&i, reg + 1, sizeof(i));
+        valor->real = 0;
+        valor->v.i = (long)i;
+    } else if (reg[0] == 'f') {
+        memcpy(&valor->v.f, reg + 1, sizeof(double));
+        valor->real = 1;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// Converte o próximo número: inteiros no caminho rápido, reais via strtod.
+// Como strtol e strtod com ERANGE, rejeita inteiros fora de long e reais
+// fora de double; rejeita também reais que não cabem em texto
+int mepaio_ler(EntradaMEPA *e, ValorMEPA *valor) {
+    char texto[64];
+    int n = 0, cortado = 0;
+    int c;
+
+    if (e->binaria) return ler_binario(e, valor);
+
+    while ((c = espia(e)) >= 0 && eh_espaco(c)) e->pos++;
+    if (c < 0) return 0;
+
+    int negativo = 0;
+    if (c == '-' || c == '+') {
+        negativo = (c == '-');
+        texto[n++] = (char)c;
+        e->pos++;
+    }
+
+    // O módulo de LONG_MIN passa de LONG_MAX por um
+    unsigned long limite = negativo ? (unsigned long)LONG_MAX + 1 : (unsigned long)LONG_MAX;
+    unsigned long acumulado = 0;
+    int digitos = 0, estouro = 0;
+    while ((c = espia(e)) >= '0' && c <= '9') {
+        unsigned long d = (unsigned long)(c - '0');
+        if (acumulado > (limite - d) / 10) estouro = 1;
+        else acumulado = acumulado * 10 + d;
+        if (n < (int)sizeof(texto) - 1) texto[n++] = (char)c;
+        else cortado = 1;
+        digitos++;
+        e->pos++;
+    }
+
+    if (c == '.' || c == 'e' || c == 'E') {
+        // Real: acumula o restante do token e converte
+        while ((c = espia(e)) >= 0 && !eh_espaco(c)) {
+            if (n < (int)sizeof(texto) - 1) texto[n++] = (char)c;
+            else cortado = 1;
+            e->pos++;
+        }
+        if (cortado) return 0;
+        texto[n] = '\0';
+        char *fim;
+        errno = 0;
+        valor->real = 1;
+        valor->v.f = strtod(texto, &fim);
+        if (errno == ERANGE && (valor->v.f == HUGE_VAL || valor->v.f == -HUGE_VAL)) return 0;
+        return fim != texto && *fim == '\0';
+    }
+
+    if (digitos == 0 || estouro || (c >= 0 && !eh_espaco(c))) return 0;
+
+    valor->real = 0;
+    valor->v.i = negativo && acumulado > 0 ? -(long)(acumulado - 1) - 1 : (long)acumulado;
+    return 1;
+}
+
+// ------------------------------------------------------------------
+// Saída
+// ------------------------------------------------------------------
+
+int mepaio_abrir_saida(SaidaMEPA *s, int fd, int binaria) {
+    memset(s, 0, sizeof(*s));
+    s->buf = malloc(MEPAIO_BLOCO);
+    if (s->buf == NULL) return 0;
+    s->fd = fd;
+    s->binaria = binaria;
+    s->tam = MEPAIO_BLOCO;
+    return 1;
+}
+
+void mepaio_fechar_saida(SaidaMEPA *s) {
+    mepaio_descarregar(s);
+    free(s->buf);
+    s->buf = NULL;
+}
+
+int mepaio_descarregar(SaidaMEPA *s) {
+    int escrito = 0;
+
+    while (escrito < s->usado) {
+        ssize_t n = write(s->fd, s->buf + escrito, s->usado - escrito);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            s->erro = 1;
+            break;
+        }
+        escrito += (int)n;
+    }
+    s->usado = 0;
+    return !s->erro;
+}
+
+// Descarrega o que estiver pendente e passa a escrever em outro descritor
+int mepaio_trocar_saida(SaidaMEPA *s, int fd) {
+    int ok = mepaio_descarregar(s);
+    s->fd = fd;
+    s->erro = 0;
+    return ok;
+}
+
+// Formata um valor no buffer (um por linha, como o IMPR sempre fez)
+int mepaio_escrever(SaidaMEPA *s, ValorMEPA valor) {
+    // Maior registro: real em %g com sinal e expoente, ou inteiro de 20 dígitos
+    if (s->tam - s->usado < 64 && !mepaio_descarregar(s)) return 0;
+
+    char *p = s->buf + s->usado;
+
+    if (s->binaria) {
+        if (valor.real) {
+            *p = 'f';
+            memcpy(p + 1, &valor.v.f, sizeof(double));
+        } else {
+            int64_t i = valor.v.i;
+            *p = 'i';
+            memcpy(p + 1, &i, sizeof(i));
+        }
+        s->usado += 9;
+        return 1;
+    }
+
+    if (valor.real) {
+        s->usado += snprintf(p, 64, "%g\n", valor.v.f);
+        return 1;
+    }
+
+    // Inteiro: dígitos gerados de trás para frente
+    char tmp[24];
+    int n = 0;
+    unsigned long u = valor.v.i < 0 ? 0UL - (unsigned long)valor.v.i
+                                    : (unsigned long)valor.v.i;
+    do {
+        tmp[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u != 0);
+    if (valor.v.i < 0) *p++ = '-';
+    while (n > 0) *p++ = tmp[--n];
+    *p++ = '\n';
+    s->usado = (int)(p - s->buf);
+    return 1;
+}
+
+// Copia o texto para o buffer (descarregando-o quando enche); na forma
+// binária, sem o fim de linha e depois da marca e do tamanho
+int mepaio_escrever_texto(SaidaMEPA *s, const char *texto, int tam) {
+    if (s->binaria) {
+        uint32_t n = (uint32_t)(tam - 1);
+        if (s->tam - s->usado < 5 && !mepaio_descarregar(s)) return 0;
+        s->buf[s->usado] = 's';
+        memcpy(s->buf + s->usado + 1, &n, sizeof(n));
+        s->usado += 5;
+        tam--;
+    }
+    while (tam > 0) {
+        if (s->usado == s->tam && !mepaio_descarregar(s)) return 0;
+        int n = s->tam - s->usado < tam ? s->tam - s->usado : tam;
+        memcpy(s->buf + s->usado, texto, (size_t)n);
+        s->usado += n;
+        texto += n;
+        tam -= n;
+    }
+    return 1;
+}
@@ -0,0 +1,57 @@
+/*
+ * mepaio.h - E/S em blocos para LEIT, IMPR e IMPS
+ *
+ * A entrada é lida em blocos grandes direto do descritor e os números são
+ * convertidos por um analisador próprio (sem scanf). A saída é formatada num
+ * buffer grande, descarregado quando enche ou no PARA.
+ *
+ * Modo binário (opcional, por direção): cada valor ocupa 9 bytes, uma marca
+ * 'i' (inteiro, int64) ou 'f' (real, double) seguida dos 8 bytes do valor na
+ * ordem nativa da máquina. Na saída, o texto de um IMPS vem com a marca
+ * 's', o tamanho (uint32, sem o fim de linha) e os bytes do texto.
+ */
+
+#ifndef MEPAIO_H
+#define MEPAIO_H
+
+#include "mepa.h"
+
+// Tamanho padrão dos buffers de entrada e saída
+#define MEPAIO_BLOCO (1 << 20)
+
+typedef struct EntradaMEPA {
+    int fd;
+    int binaria;
+    char *buf;
+    int tam;
+    int pos;
+    int fim;
+    int esgotada;               // fim de arquivo (ou erro) no descritor
+} EntradaMEPA;
+
+typedef struct SaidaMEPA {
+    int fd;
+    int binaria;
+    char *buf;
+    int tam;
+    int usado;
+    int erro;                   // falha de escrita no descritor
+} SaidaMEPA;
+
+// Entrada
+int mepaio_abrir_entrada(EntradaMEPA *e, int fd, int binaria);
+void mepaio_fechar_entrada(EntradaMEPA *e);
+int mepaio_rebobinar(EntradaMEPA *e);
+void mepaio_trocar_entrada(EntradaMEPA *e, int fd);
+int mepaio_ler(EntradaMEPA *e, ValorMEPA *valor);
+
+// Saída
+int mepaio_abrir_saida(SaidaMEPA *s, int fd, int binaria);
+void mepaio_fechar_saida(SaidaMEPA *s);
+int mepaio_escrever(SaidaMEPA *s, ValorMEPA valor);
+// Escreve os tam bytes de texto, que terminam com '\n' (IMPS)
+int mepaio_escrever_texto(SaidaMEPA *s, const char *texto, int tam);
+int mepaio_descarregar(SaidaMEPA *s);
+int mepaio_trocar_saida(SaidaMEPA *s, int fd);
+
+#endif
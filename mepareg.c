@@ -0,0 +1,482 @@
+/*
+ * mepareg.c - Tradutor pilha -> registradores e interpretador de três endereços
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mepareg.h"
+#include "mepaio.h"
+
+// Entrada da pilha simbólica usada durante a tradução
+typedef struct {
+    int celula;                 // onde o valor está (variável, constante ou registrador)
+    int pendente;               // 1 se ainda não foi copiado para o seu registrador
+} EntradaSimb;
+
+typedef struct {
+    ProgramaReg *reg;
+    int capacidade;
+    EntradaSimb *pilha;
+    int topo;
+    int base_regs;
+    int base_const;
+    int inicio_bloco;           // primeira instrução do bloco básico atual
+    int ultimo_produtor;        // posição da pilha escrita pela última instrução
+} Tradutor;
+
+static int emite(Tradutor *t, OpReg op, int d, int a, int b) {
+    ProgramaReg *reg = t->reg;
+    if (reg->n == t->capacidade) {
+        int nova = t->capacidade ? t->capacidade * 2 : 256;
+        InstrReg *v = realloc(reg->instr, sizeof(InstrReg) * nova);
+        if (v == NULL) return 0;
+        reg->instr = v;
+        t->capacidade = nova;
+    }
+    InstrReg *in = &reg->instr[reg->n++];
+    in->op = op;
+    in->d = d;
+    in->a = a;
+    in->b = b;
+    t->ultimo_produtor = -1;
+    return 1;
+}
+
+static int registrador(Tradutor *t, int posicao) {
+    return t->base_regs + posicao;
+}
+
+// Copia para os registradores todos os valores ainda pendentes
+static int descarrega(Tradutor *t) {
+    for (int p = 0; p < t->topo; p++) {
+        if (t->pilha[p].pendente) {
+            if (!emite(t, R_MOV, registrador(t, p), t->pilha[p].celula, 0)) return 0;
+            t->pilha[p].celula = registrador(t, p);
+            t->pilha[p].pendente = 0;
+        }
+    }
+    return 1;
+}
+
+// Empilha o resultado de uma operação em registrador
+static int produz(Tradutor *t, OpReg op, int a, int b) {
+    int p = t->topo;
+    if (!emite(t, op, registrador(t, p), a, b)) return 0;
+    t->pilha[p].celula = registrador(t, p);
+    t->pilha[p].pendente = 0;
+    t->topo++;
+    t->ultimo_produtor = p;
+    return 1;
+}
+
+static OpReg op_reg(OpMEPA op) {
+    switch (op) {
+        case OP_SOMA: return R_ADD;
+        case OP_SUBT: return R_SUB;
+        case OP_MULT: return R_MUL;
+        case OP_DIVI: return R_DIV;
+        case OP_CONJ: return R_AND;
+        case OP_DISJ: return R_OR;
+        case OP_CMME: return R_LT;
+        case OP_CMMA: return R_GT;
+        case OP_CMIG: return R_EQ;
+        case OP_CMDG: return R_NE;
+        case OP_CMEG: return R_LE;
+        default:      return R_GE;
+    }
+}
+
+int mepareg_traduzir(const ProgramaMEPA *prog, ProgramaReg *reg,
+                     char *erro, int tam_erro) {
+    Tradutor t;
+    int *prof = malloc(sizeof(int) * prog->n);
+    int *mapa = malloc(sizeof(int) * prog->n);
+    char *eh_alvo = calloc(prog->n, 1);
+    int ok = 1;
+
+    erro[0] = '\0';
+    memset(reg, 0, sizeof(*reg));
+    memset(&t, 0, sizeof(t));
+    t.reg = reg;
+
+    if (prof == NULL || mapa == NULL || eh_alvo == NULL) {
+        snprintf(erro, tam_erro, "memória insuficiente");
+        ok = 0;
+        goto fim;
+    }
+
+    for (int i = 0; i < prog->n; i++) {
+        if (prog->instr[i].op == OP_CHPR) {
+            snprintf(erro, tam_erro, "sub-rotinas não suportadas");
+            ok = 0;
+            goto fim;
+        }
+    }
+
+    int max_prof = mepa_profundidades(prog, prof);
+    if (max_prof < 0) {
+        snprintf(erro, tam_erro, "profundidade de pilha inconsistente");
+        ok = 0;
+        goto fim;
+    }
+
+    // Layout das células: dados, registradores (um por posição da pilha), constantes
+    reg->n_dados = prog->tam_dados;
+    reg->n_regs = max_prof + 1;
+    t.base_regs = reg->n_dados;
+    t.base_const = reg->n_dados + reg->n_regs;
+    t.pilha = malloc(sizeof(EntradaSimb) * (max_prof + 1));
+    reg->constantes = malloc(sizeof(ValorMEPA) * (prog->n + 1));
+    if (t.pilha == NULL || reg->constantes == NULL) {
+        snprintf(erro, tam_erro, "memória insuficiente");
+        ok = 0;
+        goto fim;
+    }
+
+    for (int i = 0; i < prog->n; i++) {
+        const InstrMEPA *in = &prog->instr[i];
+        if (in->op == OP_DSVS || in->op == OP_DSVF) eh_alvo[in->p1] = 1;
+        if ((in->op == OP_DSVS || in->op == OP_PARA) && i + 1 < prog->n) eh_alvo[i + 1] = 1;
+    }
+
+    t.ultimo_produtor = -1;
+    reg->cadeias = prog->cadeias;
+    reg->inicio_cadeia = prog->inicio_cadeia;
+
+    for (int i = 0; ok && i < prog->n; i++) {
+        const InstrMEPA *in = &prog->instr[i];
+
+        if (prof[i] < 0) {              // código inalcançável
+            mapa[i] = reg->n;
+            continue;
+        }
+
+        // Início de bloco: valores devem estar nos registradores
+        if (eh_alvo[i]) {
+            if (!descarrega(&t)) { ok = 0; break; }
+            t.topo = prof[i];
+            for (int p = 0; p < t.topo; p++) {
+                t.pilha[p].celula = registrador(&t, p);
+                t.pilha[p].pendente = 0;
+            }
+            t.inicio_bloco = reg->n;
+            t.ultimo_produtor = -1;
+        }
+        mapa[i] = reg->n;
+
+        switch (in->op) {
+            case OP_INPP:
+            case OP_NADA:
+                break;
+            case OP_AMEM:
+            case OP_DMEM:
+                if (t.topo != 0) {
+                    snprintf(erro, tam_erro, "instrução %d: %s com operandos na pilha",
+                             i, mepa_nome_op(in->op));
+                    ok = 0;
+                }
+                break;
+            case OP_CRCT:
+                reg->constantes[reg->n_const] = in->k;
+                t.pilha[t.topo].celula = t.base_const + reg->n_const++;
+                t.pilha[t.topo].pendente = 1;
+                t.topo++;
+                break;
+            case OP_CRVL:
+            case OP_ARMZ:
+                if (in->p1 != 0 || in->p2 < 0 || in->p2 >= reg->n_dados) {
+                    snprintf(erro, tam_erro, "instrução %d: endereço %d,%d não suportado",
+                             i, in->p1, in->p2);
+                    ok = 0;
+                    break;
+                }
+                if (in->op == OP_CRVL) {
+                    t.pilha[t.topo].celula = in->p2;
+                    t.pilha[t.topo].pendente = 1;
+                    t.topo++;
+                } else {
+                    EntradaSimb topo = t.pilha[--t.topo];
+                    int produtor = t.ultimo_produtor;
+
+                    // Leituras adiadas da variável precisam do valor antigo
+                    for (int p = 0; p < t.topo; p++) {
+                        if (t.pilha[p].pendente && t.pilha[p].celula == in->p2) {
+                            if (!emite(&t, R_MOV, registrador(&t, p), in->p2, 0)) { ok = 0; break; }
+                            t.pilha[p].celula = registrador(&t, p);
+                            t.pilha[p].pendente = 0;
+                            produtor = -1;
+                        }
+                    }
+
+                    if (ok && produtor == t.topo && reg->n > t.inicio_bloco &&
+                        reg->instr[reg->n - 1].d == topo.celula) {
+                        // Redireciona o resultado direto para a variável
+                        reg->instr[reg->n - 1].d = in->p2;
+                        t.ultimo_produtor = -1;
+                    } else if (ok) {
+                        ok = emite(&t, R_MOV, in->p2, topo.celula, 0);
+                    }
+                }
+                break;
+            case OP_SOMA: case OP_SUBT: case OP_MULT: case OP_DIVI:
+            case OP_CONJ: case OP_DISJ:
+            case OP_CMME: case OP_CMMA: case OP_CMIG:
+            case OP_CMDG: case OP_CMEG: case OP_CMAG: {
+                int b = t.pilha[--t.topo].celula;
+                int a = t.pilha[--t.topo].celula;
+                ok = produz(&t, op_reg(in->op), a, b);
+                break;
+            }
+            case OP_INVR:
+            case OP_NEGA: {
+                int a = t.pilha[--t.topo].celula;
+                ok = produz(&t, in->op == OP_INVR ? R_NEG : R_NOT, a, 0);
+                break;
+            }
+            case OP_LEIT:
+                ok = produz(&t, R_READ, 0, 0);
+                break;
+            case OP_IMPR:
+                ok = emite(&t, R_PRINT, 0, t.pilha[--t.topo].celula, 0);
+                break;
+            case OP_IMPS:
+                ok = emite(&t, R_PRINTS, 0, in->p1, 0);
+                break;
+            case OP_DSVF: {
+                int cond = t.pilha[--t.topo].celula;
+                ok = descarrega(&t) && emite(&t, R_JF, in->p1, cond, 0);
+                break;
+            }
+            case OP_DSVS:
+                ok = descarrega(&t) && emite(&t, R_JMP, in->p1, 0, 0);
+                break;
+            case OP_PARA:
+                ok = emite(&t, R_HALT, 0, 0, 0);
+                break;
+            default:
+                snprintf(erro, tam_erro, "instrução %d: %s não suportada",
+                         i, mepa_nome_op(in->op));
+                ok = 0;
+                break;
+        }
+        if (!ok && erro[0] == '\0') snprintf(erro, tam_erro, "memória insuficiente");
+    }
+
+    // Destinos de desvio: índice MEPA -> índice na forma de registradores
+    for (int k = 0; ok && k < reg->n; k++) {
+        if (reg->instr[k].op == R_JMP || reg->instr[k].op == R_JF) {
+            reg->instr[k].d = mapa[reg->instr[k].d];
+        }
+    }
+
+fim:
+    free(prof);
+    free(mapa);
+    free(eh_alvo);
+    free(t.pilha);
+    if (!ok) mepareg_liberar(reg);
+    return ok;
+}
+
+void mepareg_liberar(ProgramaReg *reg) {
+    free(reg->instr);
+    free(reg->constantes);
+    memset(reg, 0, sizeof(*reg));
+}
+
+int mepareg_celulas(const ProgramaReg *reg) {
+    return reg->n_dados + reg->n_regs + reg->n_const;
+}
+
+int mepareg_executar(const ProgramaReg *reg, MaquinaMEPA *mq) {
+    const InstrReg *codigo = reg->instr;
+    ValorMEPA *C = mq->M;
+    int i = 0;
+    long passos = 0;
+
+    if (mq->tam < mepareg_celulas(reg)) {
+        snprintf(mq->erro, sizeof(mq->erro), "memória insuficiente para o programa");
+        return 0;
+    }
+    memcpy(C + reg->n_dados + reg->n_regs, reg->constantes,
+           sizeof(ValorMEPA) * reg->n_const);
+
+    for (;;) {
+        const InstrReg *in = &codigo[i];
+        passos++;
+
+        switch (in->op) {
+            case R_MOV:
+                C[in->d] = C[in->a];
+                i++;
+                break;
+            case R_ADD:
+                C[in->d] = mepa_aritmetica(OP_SOMA, C[in->a], C[in->b]);
+                i++;
+                break;
+            case R_SUB:
+                C[in->d] = mepa_aritmetica(OP_SUBT, C[in->a], C[in->b]);
+                i++;
+                break;
+            case R_MUL:
+                C[in->d] = mepa_aritmetica(OP_MULT, C[in->a], C[in->b]);
+                i++;
+                break;
+            case R_DIV: {
+                const char *erro = mepa_erro_divisao(C[in->a], C[in->b]);
+                if (erro != NULL) {
+                    snprintf(mq->erro, sizeof(mq->erro), "%s", erro);
+                    mq->passos += passos;
+                    return 0;
+                }
+                C[in->d] = mepa_aritmetica(OP_DIVI, C[in->a], C[in->b]);
+                i++;
+                break;
+            }
+            case R_NEG:
+                C[in->d] = C[in->a];
+                if (C[in->d].real) C[in->d].v.f = -C[in->d].v.f;
+                else C[in->d].v.i = (long)(0UL - (unsigned long)C[in->d].v.i);
+                i++;
+                break;
+            case R_AND:
+                C[in->d] = mepa_int(mepa_verdadeiro(C[in->a]) && mepa_verdadeiro(C[in->b]));
+                i++;
+                break;
+            case R_OR:
+                C[in->d] = mepa_int(mepa_verdadeiro(C[in->a]) || mepa_verdadeiro(C[in->b]));
+                i++;
+                break;
+            case R_NOT:
+                C[in->d] = mepa_int(!mepa_verdadeiro(C[in->a]));
+                i++;
+                break;
+            case R_LT:
+                C[in->d] = mepa_int(mepa_compara(OP_CMME, C[in->a], C[in->b]));
+                i++;
+                break;
+            case R_GT:
+                C[in->d] = mepa_int(mepa_compara(OP_CMMA, C[in->a], C[in->b]));
+                i++;
+                break;
+            case R_EQ:
+                C[in->d] = mepa_int(mepa_compara(OP_CMIG, C[in->a], C[in->b]));
+                i++;
+                break;
+            case R_NE:
+                C[in->d] = mepa_int(mepa_compara(OP_CMDG, C[in->a], C[in->b]));
+                i++;
+                break;
+            case R_LE:
+                C[in->d] = mepa_int(mepa_compara(OP_CMEG, C[in->a], C[in->b]));
+                i++;
+                break;
+            case R_GE:
+                C[in->d] = mepa_int(mepa_compara(OP_CMAG, C[in->a], C[in->b]));
+                i++;
+                break;
+            case R_JMP:
+                i = in->d;
+                break;
+            case R_JF:
+                i = mepa_verdadeiro(C[in->a]) ? i + 1 : in->d;
+                break;
+            case R_READ:
+                if (!mepaio_ler(mq->entrada, &C[in->d])) {
+                    snprintf(mq->erro, sizeof(mq->erro), "entrada inválida ou esgotada em LEIT");
+                    mq->passos += passos;
+                    return 0;
+                }
+                i++;
+                break;
+            case R_PRINT:
+                if (!mepaio_escrever(mq->saida, C[in->a])) {
+                    snprintf(mq->erro, sizeof(mq->erro), "falha ao escrever a saída");
+                    mq->passos += passos;
+                    return 0;
+                }
+                i++;
+                break;
+            case R_PRINTS: {
+                const int *ini = reg->inicio_cadeia + in->a;
+                if (!mepaio_escrever_texto(mq->saida, reg->cadeias + ini[0], ini[1] - ini[0])) {
+                    snprintf(mq->erro, sizeof(mq->erro), "falha ao escrever a saída");
+                    mq->passos += passos;
+                    return 0;
+                }
+                i++;
+                break;
+            }
+            case R_HALT:
+                mq->passos += passos;
+                if (!mepaio_descarregar(mq->saida)) {
+                    snprintf(mq->erro, sizeof(mq->erro), "falha ao escrever a saída");
+                    return 0;
+                }
+                return 1;
+        }
+    }
+}
+
+// ------------------------------------------------------------------
+// Listagem (depuração)
+// ------------------------------------------------------------------
+
+static const char *nomes_reg[] = {
+    "MOV", "ADD", "SUB", "MUL", "DIV", "NEG", "AND", "OR", "NOT",
+    "LT", "GT", "EQ", "NE", "LE", "GE", "JMP", "JF", "READ", "PRINT",
+    "PRINTS", "HALT"
+};
+
+static void operando(const ProgramaReg *reg, int c, FILE *saida) {
+    if (c < reg->n_dados) {
+        fprintf(saida, "M%d", c);
+    } else if (c < reg->n_dados + reg->n_regs) {
+        fprintf(saida, "R%d", c - reg->n_dados);
+    } else {
+        ValorMEPA k = reg->constantes[c - reg->n_dados - reg->n_regs];
+        if (k.real) fprintf(saida, "#%g", k.v.f);
+        else fprintf(saida, "#%ld", k.v.i);
+    }
+}
+
+void mepareg_listar(const ProgramaReg *reg, FILE *saida) {
+    for (int i = 0; i < reg->n; i++) {
+        const InstrReg *in = &reg->instr[i];
+        fprintf(saida, "%5d  %-5s ", i, nomes_reg[in->op]);
+        switch (in->op) {
+            case R_JMP:
+                fprintf(saida, "%d", in->d);
+                break;
+            case R_JF:
+                operando(reg, in->a, saida);
+                fprintf(saida, ", %d", in->d);
+                break;
+            case R_PRINT:
+                operando(reg, in->a, saida);
+                break;
+            case R_PRINTS:
+                fprintf(saida, "cadeia %d", in->a);
+                break;
+            case R_READ:
+                operando(reg, in->d, saida);
+                break;
+            case R_HALT:
+                break;
+            case R_MOV: case R_NEG: case R_NOT:
+                operando(reg, in->d, saida);
+                fprintf(saida, ", ");
+                operando(reg, in->a, saida);
+                break;
+            default:
+                operando(reg, in->d, saida);
+                fprintf(saida, ", ");
+                operando(reg, in->a, saida);
+                fprintf(saida, ", ");
+                operando(reg, in->b, saida);
+                break;
+        }
+        fprintf(saida, "\n");
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * mepareg.h - Tradução do código MEPA de pilha para a forma de registradores
+ *
+ * Na carga, as posições da pilha de operandos viram registradores virtuais
+ * e cada sequência "CRVL b; CRVL c; SOMA; ARMZ a" vira uma única instrução
+ * de três endereços "ADD a, b, c". Os operandos são índices num único vetor
+ * de células: [dados | registradores | constantes].
+ */
+
+#ifndef MEPAREG_H
+#define MEPAREG_H
+
+#include "mepa.h"
+
+// Operações da forma de três endereços
+typedef enum {
+    R_MOV,                      // d <- a
+    R_ADD, R_SUB, R_MUL, R_DIV, // d <- a op b
+    R_NEG,                      // d <- -a
+    R_AND, R_OR, R_NOT,         // lógicas
+    R_LT, R_GT, R_EQ, R_NE, R_LE, R_GE,
+    R_JMP,                      // desvia para d
+    R_JF,                       // se a é falso, desvia para d
+    R_READ,                     // d <- leitura
+    R_PRINT,                    // imprime a
+    R_PRINTS,                   // imprime a entrada a da tabela de cadeias
+    R_HALT
+} OpReg;
+
+typedef struct {
+    OpReg op;
+    int d;                      // célula de destino ou índice de desvio
+    int a;
+    int b;
+} InstrReg;
+
+typedef struct {
+    InstrReg *instr;
+    int n;
+    int n_dados;                // células [0, n_dados)
+    int n_regs;                 // células [n_dados, n_dados + n_regs)
+    int n_const;                // células seguintes, pré-carregadas
+    ValorMEPA *constantes;
+    const char *cadeias;        // tabela de cadeias do ProgramaMEPA traduzido,
+    const int *inicio_cadeia;   // que precisa durar tanto quanto a tradução
+} ProgramaReg;
+
+// Retorna 0 se o programa usa construções fora do subconjunto traduzível
+// (níveis léxicos > 0, sub-rotinas, AMEM com operandos na pilha, pilha
+// inconsistente)
+int mepareg_traduzir(const ProgramaMEPA *prog, ProgramaReg *reg,
+                     char *erro, int tam_erro);
+void mepareg_liberar(ProgramaReg *reg);
+
+// Número de células que a máquina precisa para executar o programa
+int mepareg_celulas(const ProgramaReg *reg);
+
+int mepareg_executar(const ProgramaReg *reg, MaquinaMEPA *mq);
+
+void mepareg_listar(const ProgramaReg *reg, FILE *saida);
+
+#endif
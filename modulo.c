@@ -0,0 +1,166 @@
+/*
+ * modulo.c - Gravação e mapeamento das interfaces de módulo
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "modulo.h"
+
+static uint32_t hash_nome(const char *s) {
+    uint32_t h = 2166136261u;
+    for (; *s != '\0'; s++) h = (h ^ (unsigned char)*s) * 16777619u;
+    return h;
+}
+
+static void somar(uint64_t *h, const void *dados, size_t n) {
+    const unsigned char *p = dados;
+    for (size_t i = 0; i < n; i++) *h = (*h ^ p[i]) * 1099511628211ULL;
+}
+
+// Globais exportadas: variáveis e constantes do programa
+static int exportada(const RegistroTS *r) {
+    return r->nivel == 0 && (r->categoria == CAT_VARIAVEL || r->categoria == CAT_CONSTANTE);
+}
+
+int modulo_gravar(const TabelaSimbolos *ts, const char *caminho) {
+    const ModuloTS *importado = ts->modulo;
+    uint32_t n = importado != NULL ? importado->cab->n : 0, proprios = 0;
+
+    for (RegistroTS *r = ts->cabeca; r != NULL; r = r->proximo) {
+        if (exportada(r)) proprios++;
+    }
+
+    uint32_t total = n + proprios, cap = 2;
+    while (cap < 2 * total) cap *= 2;
+    RegistroTS *registros = calloc((size_t)total + 1, sizeof(RegistroTS));
+    uint32_t *indice = calloc(cap, sizeof(uint32_t));
+    if (registros == NULL || indice == NULL) {
+        free(registros);
+        free(indice);
+        return 0;
+    }
+
+    // Os importados primeiro; os próprios na ordem da declaração (a lista
+    // está ao contrário). Os bytes de alinhamento ficam zerados
+    if (n > 0) memcpy(registros, importado->registros, sizeof(RegistroTS) * n);
+    uint32_t k = total;
+    for (RegistroTS *r = ts->cabeca; r != NULL; r = r->proximo) {
+        if (!exportada(r)) continue;
+        RegistroTS *novo = &registros[--k];
+        memcpy(novo->lexema, r->lexema, sizeof(novo->lexema));
+        novo->categoria = r->categoria;
+        novo->tipo = r->tipo;
+        novo->endereco = r->endereco;
+    }
+    for (k = 0; k < total; k++) {
+        uint32_t p = hash_nome(registros[k].lexema) & (cap - 1);
+        while (indice[p] != 0) p = (p + 1) & (cap - 1);
+        indice[p] = k + 1;
+    }
+
+    CabecalhoModulo cab;
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.magica, MODULO_MAGICA, sizeof(cab.magica));
+    cab.versao = MODULO_VERSAO;
+    cab.tam_registro = sizeof(RegistroTS);
+    cab.n = total;
+    cab.cap = cap;
+    cab.tamanho = (uint32_t)ts->proximo_endereco;
+    cab.registros = sizeof(cab);
+    cab.indice = cab.registros + (uint64_t)sizeof(RegistroTS) * total;
+    cab.soma = 14695981039346656037ULL;
+    somar(&cab.soma, registros, sizeof(RegistroTS) * total);
+    somar(&cab.soma, indice, sizeof(uint32_t) * cap);
+
+    FILE *f = fopen(caminho, "wb");
+    int ok = f != NULL;
+    if (ok) {
+        ok = fwrite(&cab, sizeof(cab), 1, f) == 1 &&
+             fwrite(registros, sizeof(RegistroTS), total, f) == total &&
+             fwrite(indice, sizeof(uint32_t), cap, f) == cap;
+        if (fclose(f) != 0) ok = 0;
+    }
+    free(registros);
+    free(indice);
+    return ok;
+}
+
+int modulo_abrir(const char *caminho, ModuloTS *m, char *erro, int tam_erro) {
+    struct stat st;
+    int fd = open(caminho, O_RDONLY);
+
+    memset(m, 0, sizeof(*m));
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        snprintf(erro, tam_erro, "não foi possível abrir '%s'", caminho);
+        if (fd >= 0) close(fd);
+        return 0;
+    }
+    if ((size_t)st.st_size < sizeof(CabecalhoModulo)) {
+        snprintf(erro, tam_erro, "'%s' não é uma interface de módulo", caminho);
+        close(fd);
+        return 0;
+    }
+
+    m->tam = (size_t)st.st_size;
+    m->base = mmap(NULL, m->tam, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m->base == MAP_FAILED) {
+        m->base = NULL;
+        snprintf(erro, tam_erro, "não foi possível mapear '%s'", caminho);
+        return 0;
+    }
+
+    // Só o cabeçalho é conferido: os registros e o índice são lidos sob
+    // demanda, e modulo_buscar confere cada um que usa
+    const CabecalhoModulo *cab = m->base;
+    if (memcmp(cab->magica, MODULO_MAGICA, sizeof(cab->magica)) != 0 ||
+        cab->versao != MODULO_VERSAO) {
+        snprintf(erro, tam_erro, "'%s' não é uma interface de módulo", caminho);
+    } else if (cab->tam_registro != sizeof(RegistroTS)) {
+        snprintf(erro, tam_erro, "'%s' foi gravado com outro formato de registro", caminho);
+    } else if (cab->cap == 0 || (cab->cap & (cab->cap - 1)) != 0 || cab->n > cab->cap ||
+               cab->registros % sizeof(void*) != 0 || cab->indice % sizeof(uint32_t) != 0 ||
+               cab->registros > m->tam ||
+               (uint64_t)cab->n * sizeof(RegistroTS) > m->tam - cab->registros ||
+               cab->indice > m->tam ||
+               (uint64_t)cab->cap * sizeof(uint32_t) > m->tam - cab->indice) {
+        snprintf(erro, tam_erro, "'%s': interface de módulo corrompida", caminho);
+    } else {
+        m->cab = cab;
+        m->registros = (const RegistroTS*)((const char*)m->base + cab->registros);
+        m->indice = (const uint32_t*)((const char*)m->base + cab->indice);
+        return 1;
+    }
+    modulo_fechar(m);
+    return 0;
+}
+
+void modulo_fechar(ModuloTS *m) {
+    if (m->base != NULL) munmap(m->base, m->tam);
+    memset(m, 0, sizeof(*m));
+}
+
+const RegistroTS* modulo_buscar(const ModuloTS *m, const char *lexema, long *sondagens) {
+    uint32_t mascara = m->cab->cap - 1;
+
+    for (uint32_t p = hash_nome(lexema) & mascara, k = 0; k <= mascara; p = (p + 1) & mascara, k++) {
+        (*sondagens)++;
+        uint32_t i = m->indice[p];
+        if (i == 0) return NULL;
+        if (i > m->cab->n) continue;
+
+        const RegistroTS *r = &m->registros[i - 1];
+        if (memchr(r->lexema, '\0', sizeof(r->lexema)) != NULL && exportada(r) &&
+            r->n_param == 0 && strcmp(r->lexema, lexema) == 0) {
+            return r;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,66 @@
+/*
+ * modulo.h - Interfaces de módulo pré-compiladas (.lpdi)
+ *
+ * Um módulo é um programa LPD cujas declarações globais são compartilhadas
+ * por outros. O lpdc com --interface grava, junto do .mepa e do .ts, um
+ * <base>.lpdi binário com as variáveis globais dele (nome, categoria, tipo
+ * e endereço) e um índice de hash sobre os nomes. Com --importar arq.lpdi,
+ * o arquivo é mapeado na memória e a tabela de símbolos (tabsimb.h) busca
+ * nele o que não achou nas suas listas: nada é copiado nem analisado, e a
+ * importação só lê o cabeçalho. As globais do módulo ocupam o início da
+ * área do programa (endereços 0 .. tamanho - 1), e as do programa vêm
+ * depois; uma interface gravada por um programa que importou outra inclui
+ * os símbolos dela.
+ *
+ * Formato (na ordem dos bytes e com o RegistroTS da máquina que gravou):
+ *   CabecalhoModulo
+ *   n registros RegistroTS, com nivel 0, sem parâmetros e proximo NULL
+ *   cap posições uint32_t do índice: 0 = livre, senão 1 + registro
+ * Sub-rotinas não entram: o código delas não vai junto.
+ */
+
+#ifndef MODULO_H
+#define MODULO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "tabsimb.h"
+
+#define MODULO_MAGICA "LPDI"
+#define MODULO_VERSAO 1
+
+typedef struct {
+    char magica[4];
+    uint32_t versao;
+    uint32_t tam_registro;      // sizeof(RegistroTS)
+    uint32_t n;                 // registros
+    uint32_t cap;               // posições do índice (potência de 2)
+    uint32_t tamanho;           // posições da área global do módulo
+    uint64_t registros;         // deslocamentos no arquivo
+    uint64_t indice;
+    uint64_t soma;              // hash dos registros e do índice
+} CabecalhoModulo;
+
+struct ModuloTS {
+    void *base;                 // arquivo mapeado
+    size_t tam;
+    const CabecalhoModulo *cab;
+    const RegistroTS *registros;
+    const uint32_t *indice;
+};
+
+// Grava a interface das globais de ts (e das que ts importou). Retorna 0
+// se a gravação falhou
+int modulo_gravar(const TabelaSimbolos *ts, const char *caminho);
+
+// Mapeia a interface gravada por modulo_gravar. Retorna 0 (com a mensagem
+// em erro) se o arquivo não existe, não é uma interface ou foi gravado com
+// outro RegistroTS
+int modulo_abrir(const char *caminho, ModuloTS *m, char *erro, int tam_erro);
+void modulo_fechar(ModuloTS *m);
+
+// Registro do nome no módulo (NULL se não existe); sondagens conta as
+// posições do índice visitadas
+const RegistroTS* modulo_buscar(const ModuloTS *m, const char *lexema, long *sondagens);
+
+#endif
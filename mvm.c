@@ -0,0 +1,391 @@
+/*
+ * mvm.c - Executor de programas MEPA gerados pelo lpdc
+ *
+ * Executa o código de pilha diretamente ou, com -r, traduzido na carga para
+ * a forma de registradores (mepareg.c). Com -c executa as duas formas sobre
+ * a mesma entrada e compara instruções despachadas e tempo de parede. Com
+ * -j executa o programa sobre muitas entradas em paralelo (lote.c). Com -P
+ * grava o perfil dos desvios condicionais (perfil.h).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "mepa.h"
+#include "mepareg.h"
+#include "mepaio.h"
+#include "lote.h"
+#include "perfil.h"
+
+// Opções de linha de comando
+static int modo_registradores = 0;
+static int mostrar_estatisticas = 0;
+static int listar_traducao = 0;
+static int comparar = 0;
+static int entrada_binaria = 0;
+static int saida_binaria = 0;
+static int threads_lote = 0;            // > 0 ativa o modo lote
+static int medir_escala = 0;
+static const char *arquivo_perfil = NULL;
+static long *contagem_desvios = NULL;   // com -P: ver MaquinaMEPA.perfil
+
+static double agora() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void uso(const char *prog) {
+    fprintf(stderr, "Uso: %s [-r] [-e] [-l] [-c] [-bi] [-bo] [-P perfil] <arquivo.mepa> [entrada]\n", prog);
+    fprintf(stderr, "     %s [-r] [-bi] [-bo] -j N [-E] [-L lista] <arquivo.mepa> entradas...\n", prog);
+    fprintf(stderr, "  arquivo.mepa pode ser '-' (programa lido da entrada padrão)\n");
+    fprintf(stderr, "  -r  executa na forma de registradores (traduzida na carga)\n");
+    fprintf(stderr, "  -e  imprime instruções despachadas e tempo em stderr\n");
+    fprintf(stderr, "  -l  lista a tradução para registradores e termina\n");
+    fprintf(stderr, "  -c  compara pilha x registradores (saída descartada)\n");
+    fprintf(stderr, "  -bi entrada binária (marca 'i'/'f' + 8 bytes por valor)\n");
+    fprintf(stderr, "  -bo saída binária (mesmo formato)\n");
+    fprintf(stderr, "  -j  executa em lote com N threads (0 = todos os núcleos);\n"
+                    "      a saída de cada entrada vai para <entrada>.out\n");
+    fprintf(stderr, "  -E  no lote, mede a escala de 1 a N threads\n");
+    fprintf(stderr, "  -L  lê os nomes das entradas (um por linha) de um arquivo\n");
+    fprintf(stderr, "  -P  grava o perfil dos DSVF (executados e desviados) para o\n"
+                    "      lpdc -O1 --perfil; executa o código de pilha, sem -j, -c e -l\n");
+}
+
+// Executa uma vez; retorna 1 em caso de sucesso
+static int executar(const ProgramaMEPA *prog, const ProgramaReg *reg,
+                    EntradaMEPA *entrada, SaidaMEPA *saida, long *passos, double *tempo) {
+    MaquinaMEPA mq;
+    int celulas = reg ? mepareg_celulas(reg) : mepa_celulas(prog);
+
+    if (!mepa_criar_maquina(&mq, celulas, entrada, saida)) {
+        fprintf(stderr, "Erro: memória insuficiente para a máquina\n");
+        return 0;
+    }
+    mq.perfil = contagem_desvios;
+
+    double inicio = agora();
+    int ok = reg ? mepareg_executar(reg, &mq) : mepa_executar(prog, &mq);
+    mepaio_descarregar(saida);
+    *tempo = agora() - inicio;
+    *passos = mq.passos;
+
+    if (!ok) {
+        fprintf(stderr, "Erro de execução: %s\n", mq.erro);
+    }
+    mepa_liberar_maquina(&mq);
+    return ok;
+}
+
+// Grava o perfil contado na execução: os DSVF na ordem do código
+static int gravar_perfil(const ProgramaMEPA *prog, const char *caminho) {
+    long *executados = malloc(sizeof(long) * (prog->n + 1));
+    long *tomados = malloc(sizeof(long) * (prog->n + 1));
+    int n = 0, ok = 0;
+
+    if (executados != NULL && tomados != NULL) {
+        for (int i = 0; i < prog->n; i++) {
+            if (prog->instr[i].op != OP_DSVF) continue;
+            executados[n] = contagem_desvios[2 * i];
+            tomados[n++] = contagem_desvios[2 * i + 1];
+        }
+        ok = perfil_gravar(caminho, executados, tomados, n);
+    }
+    if (!ok) fprintf(stderr, "Erro: não foi possível gravar o perfil '%s'\n", caminho);
+    free(executados);
+    free(tomados);
+    return ok;
+}
+
+// Copia a entrada padrão para um arquivo temporário (para reexecução)
+static FILE* entrada_rebobinavel(FILE *entrada) {
+    FILE *tmp = tmpfile();
+    char bloco[65536];
+    size_t n;
+
+    if (tmp == NULL) return NULL;
+    while ((n = fread(bloco, 1, sizeof(bloco), entrada)) > 0) {
+        fwrite(bloco, 1, n, tmp);
+    }
+    fflush(tmp);
+    return tmp;
+}
+
+// Acrescenta os nomes listados (um por linha) ao vetor de entradas
+static int ler_lista(const char *arquivo, char ***entradas, int *n, int *cap) {
+    FILE *lista = fopen(arquivo, "r");
+    char linha[4096];
+
+    if (!lista) {
+        fprintf(stderr, "Erro: não foi possível abrir arquivo '%s'\n", arquivo);
+        return 0;
+    }
+    while (fgets(linha, sizeof(linha), lista) != NULL) {
+        linha[strcspn(linha, "\r\n")] = '\0';
+        if (linha[0] == '\0') continue;
+        if (*n == *cap) {
+            *cap = *cap ? *cap * 2 : 1024;
+            *entradas = realloc(*entradas, sizeof(char*) * *cap);
+            if (*entradas == NULL) break;
+        }
+        (*entradas)[*n] = malloc(strlen(linha) + 1);
+        if ((*entradas)[*n] == NULL) break;
+        strcpy((*entradas)[(*n)++], linha);
+    }
+    fclose(lista);
+    return *entradas != NULL;
+}
+
+static void relatorio_lote(int threads, const ResultadoLote *r, double base) {
+    printf("%7d %10d %7d %9.3f %12.1f %14.0f %8.2fx %8ld\n",
+           threads, r->concluidas, r->falhas, r->tempo,
+           r->concluidas / r->tempo, r->passos / r->tempo,
+           base > 0 ? base / r->tempo : 1.0, r->roubos);
+}
+
+// Modo lote: um programa carregado uma vez, executado sobre todas as entradas
+static int executar_lote(const ProgramaMEPA *prog, const ProgramaReg *reg,
+                         char **entradas, int n_entradas) {
+    ConfigLote cfg;
+    ResultadoLote res;
+    int max_threads = threads_lote;
+    int ok = 1;
+
+    if (n_entradas == 0) {
+        fprintf(stderr, "Erro: nenhuma entrada para o lote\n");
+        return 0;
+    }
+    if (max_threads <= 0) {
+        long nucleos = sysconf(_SC_NPROCESSORS_ONLN);
+        max_threads = nucleos > 0 ? (int)nucleos : 1;
+    }
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.prog = prog;
+    cfg.reg = reg;
+    cfg.entradas = entradas;
+    cfg.n_entradas = n_entradas;
+    cfg.entrada_binaria = entrada_binaria;
+    cfg.saida_binaria = saida_binaria;
+    cfg.sufixo_saida = ".out";
+
+    printf("%7s %10s %7s %9s %12s %14s %9s %8s\n", "threads", "entradas", "falhas",
+           "tempo(s)", "entradas/s", "instruções/s", "escala", "roubos");
+
+    // Na medição de escala: 1, 2, 4, ... até o máximo pedido
+    double base = 0;
+    int threads = medir_escala ? 1 : max_threads;
+    for (;;) {
+        cfg.n_threads = threads;
+        ok = lote_executar(&cfg, &res) && ok;
+        if (base == 0) base = res.tempo;
+        relatorio_lote(threads, &res, medir_escala ? base : 0);
+        if (!medir_escala || threads == max_threads) break;
+        threads = threads * 2 > max_threads ? max_threads : threads * 2;
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    const char *arquivo_prog = NULL;
+    const char *arquivo_entrada = NULL;
+    const char *arquivo_lista = NULL;
+    char **entradas_lote = NULL;
+    int n_lote = 0, cap_lote = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0) {
+            modo_registradores = 1;
+        } else if (strcmp(argv[i], "-e") == 0) {
+            mostrar_estatisticas = 1;
+        } else if (strcmp(argv[i], "-l") == 0) {
+            listar_traducao = 1;
+        } else if (strcmp(argv[i], "-c") == 0) {
+            comparar = 1;
+        } else if (strcmp(argv[i], "-bi") == 0) {
+            entrada_binaria = 1;
+        } else if (strcmp(argv[i], "-bo") == 0) {
+            saida_binaria = 1;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads_lote = atoi(argv[++i]);
+            if (threads_lote <= 0) threads_lote = -1;   // todos os núcleos
+        } else if (strcmp(argv[i], "-E") == 0) {
+            medir_escala = 1;
+        } else if (strcmp(argv[i], "-L") == 0 && i + 1 < argc) {
+            arquivo_lista = argv[++i];
+        } else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+            arquivo_perfil = argv[++i];
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            uso(argv[0]);
+            return 1;
+        } else if (arquivo_prog == NULL) {
+            arquivo_prog = argv[i];
+        } else if (threads_lote != 0) {
+            if (n_lote == cap_lote) {
+                cap_lote = cap_lote ? cap_lote * 2 : 64;
+                entradas_lote = realloc(entradas_lote, sizeof(char*) * cap_lote);
+                if (entradas_lote == NULL) return 1;
+            }
+            entradas_lote[n_lote] = malloc(strlen(argv[i]) + 1);
+            if (entradas_lote[n_lote] == NULL) return 1;
+            strcpy(entradas_lote[n_lote++], argv[i]);
+        } else if (arquivo_entrada == NULL) {
+            arquivo_entrada = argv[i];
+        } else {
+            uso(argv[0]);
+            return 1;
+        }
+    }
+
+    if (arquivo_prog == NULL ||
+        (arquivo_perfil != NULL && (threads_lote != 0 || comparar || listar_traducao))) {
+        uso(argv[0]);
+        return 1;
+    }
+    if (arquivo_perfil != NULL) modo_registradores = 0;
+
+    // "-": programa lido da entrada padrão (lpdc - | mvm - entrada)
+    int prog_padrao = strcmp(arquivo_prog, "-") == 0;
+    FILE *arq = prog_padrao ? stdin : fopen(arquivo_prog, "r");
+    if (!arq) {
+        fprintf(stderr, "Erro: não foi possível abrir arquivo '%s'\n", arquivo_prog);
+        return 1;
+    }
+
+    ProgramaMEPA prog;
+    char erro[160];
+    double t_carga = agora();
+    int carregou = mepa_carregar(arq, &prog, erro, sizeof(erro));
+    if (!prog_padrao) fclose(arq);
+    if (!carregou) {
+        fprintf(stderr, "Erro ao carregar '%s': %s\n", arquivo_prog, erro);
+        return 1;
+    }
+    t_carga = agora() - t_carga;
+    if (arquivo_perfil != NULL) {
+        contagem_desvios = calloc((size_t)prog.n * 2 + 1, sizeof(long));
+        if (contagem_desvios == NULL) {
+            fprintf(stderr, "Erro: memória insuficiente para o perfil\n");
+            mepa_liberar(&prog);
+            return 1;
+        }
+    }
+
+    // Tradução para registradores (feita na carga)
+    ProgramaReg reg;
+    int traduzido = 0;
+    double t_traducao = 0;
+    if (modo_registradores || listar_traducao || comparar) {
+        t_traducao = agora();
+        traduzido = mepareg_traduzir(&prog, &reg, erro, sizeof(erro));
+        t_traducao = agora() - t_traducao;
+        if (!traduzido) {
+            fprintf(stderr, "Aviso: tradução para registradores indisponível (%s); "
+                    "executando código de pilha\n", erro);
+        }
+    }
+
+    if (threads_lote != 0) {
+        if (threads_lote < 0) threads_lote = 0;
+        int ok = arquivo_lista == NULL ||
+                 ler_lista(arquivo_lista, &entradas_lote, &n_lote, &cap_lote);
+        ok = ok && executar_lote(&prog, traduzido ? &reg : NULL, entradas_lote, n_lote);
+        for (int i = 0; i < n_lote; i++) free(entradas_lote[i]);
+        free(entradas_lote);
+        if (traduzido) mepareg_liberar(&reg);
+        mepa_liberar(&prog);
+        return ok ? 0 : 1;
+    }
+
+    if (listar_traducao) {
+        if (traduzido) {
+            mepareg_listar(&reg, stdout);
+            mepareg_liberar(&reg);
+        }
+        mepa_liberar(&prog);
+        return traduzido ? 0 : 1;
+    }
+
+    int fd_entrada = STDIN_FILENO;
+    if (arquivo_entrada != NULL) {
+        fd_entrada = open(arquivo_entrada, O_RDONLY);
+        if (fd_entrada < 0) {
+            fprintf(stderr, "Erro: não foi possível abrir arquivo '%s'\n", arquivo_entrada);
+            mepa_liberar(&prog);
+            return 1;
+        }
+    }
+
+    // Na comparação a entrada é relida, então a entrada padrão vai para um temporário
+    FILE *tmp = NULL;
+    if (comparar && arquivo_entrada == NULL) {
+        tmp = entrada_rebobinavel(stdin);
+        if (tmp == NULL) {
+            fprintf(stderr, "Erro: não foi possível preparar a comparação\n");
+            return 1;
+        }
+        fd_entrada = fileno(tmp);
+    }
+
+    int fd_saida = comparar ? open("/dev/null", O_WRONLY) : STDOUT_FILENO;
+    EntradaMEPA entrada;
+    SaidaMEPA saida;
+    if (fd_saida < 0 ||
+        !mepaio_abrir_entrada(&entrada, fd_entrada, entrada_binaria) ||
+        !mepaio_abrir_saida(&saida, fd_saida, saida_binaria)) {
+        fprintf(stderr, "Erro: não foi possível preparar a E/S\n");
+        return 1;
+    }
+
+    int ok;
+    long passos;
+    double tempo;
+
+    if (comparar) {
+        long passos_reg = 0;
+        double tempo_reg = 0;
+
+        mepaio_rebobinar(&entrada);
+        ok = executar(&prog, NULL, &entrada, &saida, &passos, &tempo);
+        if (ok && traduzido) {
+            mepaio_rebobinar(&entrada);
+            ok = executar(&prog, &reg, &entrada, &saida, &passos_reg, &tempo_reg);
+        }
+
+        printf("%-15s %12s %12s %10s\n", "forma", "instruções", "despachos", "tempo(s)");
+        printf("%-15s %12d %12ld %10.4f\n", "pilha", prog.n, passos, tempo);
+        if (traduzido) {
+            printf("%-15s %12d %12ld %10.4f\n", "registradores", reg.n, passos_reg, tempo_reg);
+            if (passos_reg > 0 && tempo_reg > 0) {
+                printf("redução de despachos: %.2fx   aceleração: %.2fx   "
+                       "tradução: %.4fs\n",
+                       (double)passos / passos_reg, tempo / tempo_reg, t_traducao);
+            }
+        }
+    } else {
+        ok = executar(&prog, traduzido ? &reg : NULL, &entrada, &saida, &passos, &tempo);
+        if (ok && arquivo_perfil != NULL) ok = gravar_perfil(&prog, arquivo_perfil);
+        if (mostrar_estatisticas) {
+            fprintf(stderr, "forma: %s | instruções: %d | despachos: %ld | "
+                    "carga: %.4fs | tradução: %.4fs | execução: %.4fs\n",
+                    traduzido ? "registradores" : "pilha",
+                    traduzido ? reg.n : prog.n, passos, t_carga, t_traducao, tempo);
+        }
+    }
+
+    mepaio_fechar_entrada(&entrada);
+    mepaio_fechar_saida(&saida);
+    if (tmp != NULL) fclose(tmp);
+    else if (fd_entrada != STDIN_FILENO) close(fd_entrada);
+    if (fd_saida != STDOUT_FILENO) close(fd_saida);
+    if (traduzido) mepareg_liberar(&reg);
+    free(contagem_desvios);
+    mepa_liberar(&prog);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+/*
+ * otimizador.c - Dobra de constantes na árvore
+ *
+ * Operações cujos operandos são constantes inteiras viram uma constante.
+ * A varredura segue a ordem da arena (pós-ordem): quando um nó é visitado,
+ * seus operandos já foram dobrados, então expressões inteiras se reduzem
+ * numa passada. O nó dobrado passa a ser uma AST_INT e os operandos são
+ * marcados AST_MORTO (a geração de código os pula).
+ *
+ * O resultado é o que a MEPA calcularia: aritmética de long com estouro em
+ * complemento de dois, divisão truncada e comparações e operadores lógicos
+ * valendo 0 ou 1. Divisões por zero (e LONG_MIN / -1) não são dobradas,
+ * para que o erro continue acontecendo na execução.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "otimizador.h"
+
+// Valor de um operando constante (como a MEPA lê CRCT); 0 se não for
+static int constante(const ArvoreAST *t, NoId id, long *valor) {
+    const NoAST *no = ast_no(t, id);
+
+    if (no->tipo != AST_INT) return 0;
+    *valor = strtol(ast_lexema(t, no), NULL, 10);
+    return 1;
+}
+
+// Calcula op sobre dois inteiros; 0 se a operação deve ficar para a execução
+static int calcular(TAtomo op, long a, long b, long *r) {
+    unsigned long ua = (unsigned long)a, ub = (unsigned long)b;
+
+    switch (op) {
+        case sSOMA: *r = (long)(ua + ub); return 1;
+        case sSUBT: *r = (long)(ua - ub); return 1;
+        case sMULT: *r = (long)(ua * ub); return 1;
+        case sDIV:
+            if (b == 0 || (a == LONG_MIN && b == -1)) return 0;
+            *r = a / b;
+            return 1;
+        case sMENOR:     *r = a < b; return 1;
+        case sMENOR_IG:  *r = a <= b; return 1;
+        case sIGUAL:     *r = a == b; return 1;
+        case sDIFERENTE: *r = a != b; return 1;
+        case sMAIOR:     *r = a > b; return 1;
+        case sMAIOR_IG:  *r = a >= b; return 1;
+        case sE:         *r = a != 0 && b != 0; return 1;
+        case sOU:        *r = a != 0 || b != 0; return 1;
+        default:         return 0;
+    }
+}
+
+// Troca o nó por uma constante; 0 se faltar memória para o texto
+static int dobrar(ArvoreAST *t, NoId id, long valor) {
+    char texto[32];
+    snprintf(texto, sizeof(texto), "%ld", valor);
+    uint32_t desloc = ast_texto(t, texto);
+    if (desloc == UINT32_MAX) return 0;
+
+    NoAST *no = ast_no(t, id);
+    ast_no(t, no->a)->flags |= AST_MORTO;
+    if (no->b != 0) ast_no(t, no->b)->flags |= AST_MORTO;
+    no->tipo = AST_INT;
+    no->op = 0;
+    no->a = no->b = 0;
+    no->texto = desloc;
+    return 1;
+}
+
+long otimizar_ast(ArvoreAST *t) {
+    long dobradas = 0;
+
+    for (NoId id = 1; id < t->n; id++) {
+        NoAST *no = ast_no(t, id);
+        long a, b, r;
+
+        if (no->tipo == AST_UNARIO) {
+            if (!constante(t, no->a, &a)) continue;
+            r = no->op == sSUBT ? (long)(0UL - (unsigned long)a) : a == 0;
+        } else if (no->tipo == AST_BINARIO) {
+            if (!constante(t, no->a, &a) || !constante(t, no->b, &b)) continue;
+            if (!calcular((TAtomo)no->op, a, b, &r)) continue;
+        } else {
+            continue;
+        }
+
+        // Sem memória, o resto fica como está (o código continua correto)
+        if (!dobrar(t, id, r)) break;
+        dobradas++;
+    }
+    return dobradas;
+}
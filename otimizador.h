@@ -0,0 +1,14 @@
+/*
+ * otimizador.h - Otimizações sobre a árvore (modo -O1)
+ */
+
+#ifndef OTIMIZADOR_H
+#define OTIMIZADOR_H
+
+#include "ast.h"
+
+// Dobra de constantes inteiras numa árvore já checada pela semântica.
+// Retorna o número de operações dobradas.
+long otimizar_ast(ArvoreAST *t);
+
+#endif
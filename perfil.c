@@ -0,0 +1,71 @@
+/*
+ * perfil.c - Leitura e gravação do perfil dos desvios condicionais
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "perfil.h"
+
+int perfil_gravar(const char *caminho, const long *executados, const long *tomados, int n) {
+    FILE *f = fopen(caminho, "w");
+    if (f == NULL) return 0;
+
+    fprintf(f, "# perfil LPD desvios=%d\n", n);
+    for (int k = 0; k < n; k++) fprintf(f, "%d %ld %ld\n", k, executados[k], tomados[k]);
+
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    return ok;
+}
+
+static void somar(uint64_t *h, long v) {
+    for (int i = 0; i < (int)sizeof(v); i++) {
+        *h = (*h ^ (uint64_t)((unsigned long)v >> (8 * i) & 0xff)) * 1099511628211ULL;
+    }
+}
+
+int perfil_carregar(const char *caminho, PerfilDesvios *p, char *erro, int tam_erro) {
+    FILE *f = fopen(caminho, "r");
+    int ok = 1;
+
+    memset(p, 0, sizeof(*p));
+    if (f == NULL) {
+        snprintf(erro, tam_erro, "não foi possível abrir '%s'", caminho);
+        return 0;
+    }
+    if (fscanf(f, "# perfil LPD desvios=%d", &p->n) != 1 || p->n < 0) {
+        snprintf(erro, tam_erro, "'%s' não é um perfil do mvm -P", caminho);
+        fclose(f);
+        return 0;
+    }
+
+    p->executados = calloc((size_t)p->n + 1, sizeof(long));
+    p->tomados = calloc((size_t)p->n + 1, sizeof(long));
+    if (p->executados == NULL || p->tomados == NULL) {
+        snprintf(erro, tam_erro, "memória insuficiente");
+        ok = 0;
+    }
+    p->soma = 14695981039346656037ULL;
+    for (int k = 0; ok && k < p->n; k++) {
+        int j;
+        if (fscanf(f, "%d %ld %ld", &j, &p->executados[k], &p->tomados[k]) != 3 || j != k ||
+            p->tomados[k] < 0 || p->tomados[k] > p->executados[k]) {
+            snprintf(erro, tam_erro, "'%s': linha do desvio %d inválida", caminho, k);
+            ok = 0;
+            break;
+        }
+        somar(&p->soma, p->executados[k]);
+        somar(&p->soma, p->tomados[k]);
+    }
+
+    fclose(f);
+    if (!ok) perfil_liberar(p);
+    return ok;
+}
+
+void perfil_liberar(PerfilDesvios *p) {
+    free(p->executados);
+    free(p->tomados);
+    memset(p, 0, sizeof(*p));
+}
@@ -0,0 +1,37 @@
+/*
+ * perfil.h - Perfil dos desvios condicionais (layout guiado por perfil)
+ *
+ * O mvm com -P conta, para cada DSVF do programa, quantas vezes ele foi
+ * executado e quantas desviou (condição falsa), e grava o perfil num
+ * arquivo texto:
+ *
+ *   # perfil LPD desvios=N
+ *   k executados tomados          (uma linha por DSVF, k = 0 .. N-1)
+ *
+ * k é a ordem do DSVF no código. O lpdc -O1 com --perfil lê o arquivo e
+ * numera os desvios condicionais da árvore na ordem em que o gerador os
+ * emitiria sem o perfil (gerador_ast.c): o perfil vale para o código
+ * compilado com as mesmas opções, sem --perfil.
+ */
+
+#ifndef PERFIL_H
+#define PERFIL_H
+
+#include <stdint.h>
+
+typedef struct {
+    int n;                      // DSVF do programa
+    long *executados;
+    long *tomados;
+    uint64_t soma;              // hash das contagens (chave do cache)
+} PerfilDesvios;
+
+// Grava o perfil de n desvios. Retorna 0 se a gravação falhou
+int perfil_gravar(const char *caminho, const long *executados, const long *tomados, int n);
+
+// Lê o perfil gravado por perfil_gravar. Retorna 0 (com a mensagem em erro)
+// se o arquivo não existe ou está malformado
+int perfil_carregar(const char *caminho, PerfilDesvios *p, char *erro, int tam_erro);
+void perfil_liberar(PerfilDesvios *p);
+
+#endif
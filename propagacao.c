@@ -0,0 +1,560 @@
+/*
+ * propagacao.c - Propagação de constantes e cópias na árvore
+ *
+ * Cada área de dados (programa e sub-rotinas) é percorrida na ordem de
+ * execução, com o valor de cada variável da área: uma constante, uma cópia
+ * de outra variável ou desconhecido (no início, depois de um read e onde
+ * caminhos que discordam se juntam). Leituras de variáveis de valor
+ * conhecido viram a constante (CRCT no lugar de CRVL) ou a leitura da
+ * original. A MEPA guarda o valor com o tipo dele, então a constante é o
+ * mesmo lexema da atribuição.
+ *
+ * A árvore só tem controle estruturado, então o fluxo de dados segue a
+ * forma dos comandos: os dois ramos de um if partem do mesmo estado e se
+ * juntam no fim; num laço, tudo o que é atribuído em algum ponto dele fica
+ * desconhecido desde a entrada, e o estado vale para todas as iterações
+ * numa passada só. Cada mudança de valor vai para uma trilha com o valor
+ * anterior, para desfazer um ramo: o custo acompanha as atribuições, não o
+ * número de variáveis.
+ *
+ * Uma cópia vale enquanto a original não muda: cada variável tem uma versão
+ * que sobe a cada escrita, e a cópia guarda a versão que viu. No programa,
+ * as globais que alguma sub-rotina atribui deixam de ser conhecidas a cada
+ * chamada (a época sobe); nas sub-rotinas, globais não são acompanhadas.
+ *
+ * Um if de condição constante vira um bloco com o ramo tomado, um while ou
+ * for de condição falsa some (do for fica a inicialização) e um repeat de
+ * condição verdadeira vira o corpo. Depois de cada passada a dobra de
+ * constantes roda de novo (condições que passam a ser constantes são
+ * eliminadas na passada seguinte), até não haver mais trocas.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "propagacao.h"
+#include "otimizador.h"
+
+// Cada rodada troca ou elimina algo; o limite só evita um ciclo de cópias
+#define MAX_RODADAS 16
+
+typedef enum {
+    DESCONHECIDO = 0,
+    CONSTANTE,
+    COPIA
+} TipoValor;
+
+typedef struct {
+    uint8_t tipo;               // TipoValor
+    uint8_t literal;            // constante: AST_INT ou AST_FLOAT
+    uint32_t texto;             // constante: lexema
+    NoId origem;                // cópia: um AST_VAR da original
+    int indice;                 // cópia: índice da original
+    unsigned versao;            // cópia: versão da original
+    unsigned epoca;             // chamadas já feitas quando o valor surgiu
+} Valor;
+
+// Valor anterior de uma variável (trilha) ou valor no fim de um ramo
+typedef struct {
+    int var;
+    Valor valor;
+} Mudanca;
+
+// Área de dados em análise: locais (0..n_locais-1), depois parâmetros
+typedef struct {
+    ArvoreAST *t;
+    int nivel;
+    int n_locais;
+    int n_param;
+    Valor *valor;
+    unsigned *versao;
+    const uint8_t *muda_em_chamada; // programa: globais atribuídas em sub-rotinas
+    unsigned epoca;
+
+    Mudanca *trilha;
+    size_t n_trilha, cap_trilha;
+    Mudanca *ramos;             // fins de ramos de ifs em aberto
+    size_t n_ramos, cap_ramos;
+    unsigned *marca_senao;      // junção: a variável mudou no else
+    Valor *valor_senao;
+    unsigned n_juncoes;
+
+    uint8_t *atribuidas;        // globais atribuídas (ver marcar_global)
+    int falhou;                 // faltou memória: não troca mais nada
+    long trocas;
+} Propagacao;
+
+static int contar(const ArvoreAST *t, NoId id) {
+    int n = 0;
+    for (; id != 0; id = ast_no(t, id)->prox) n++;
+    return n;
+}
+
+// Índice da variável na área (-1 se não é acompanhada)
+static int indice(const Propagacao *p, const NoAST *var) {
+    int e = var->u.endereco;
+
+    if (var->op != p->nivel) return -1;
+    if (e >= 0) return e < p->n_locais ? e : -1;
+    // O parâmetro i (1, 2, ...) fica em -(n + 3) + i
+    e += p->n_param + 2;
+    return e >= 0 && e < p->n_param ? p->n_locais + e : -1;
+}
+
+static int muda_em_chamada(const Propagacao *p, int var) {
+    return p->muda_em_chamada != NULL && var < p->n_locais && p->muda_em_chamada[var];
+}
+
+// O valor ainda vale? (a original da cópia não mudou, nem houve chamada
+// que pudesse mudar uma delas)
+static Valor normalizar(const Propagacao *p, int var, Valor v) {
+    if (v.tipo == COPIA && p->versao[v.indice] != v.versao) v.tipo = DESCONHECIDO;
+    if (v.tipo != DESCONHECIDO && v.epoca != p->epoca &&
+        (muda_em_chamada(p, var) || (v.tipo == COPIA && muda_em_chamada(p, v.indice)))) {
+        v.tipo = DESCONHECIDO;
+    }
+    return v;
+}
+
+static Valor atual(const Propagacao *p, int var) {
+    return normalizar(p, var, p->valor[var]);
+}
+
+// Valor na junção de dois caminhos (já normalizados)
+static Valor juntar(const Propagacao *p, Valor a, Valor b) {
+    Valor r = {0};
+    const char *textos = p->t->textos;
+
+    if (a.tipo == CONSTANTE && b.tipo == CONSTANTE && a.literal == b.literal &&
+        strcmp(textos + a.texto, textos + b.texto) == 0) {
+        r = a;
+    } else if (a.tipo == COPIA && b.tipo == COPIA && a.indice == b.indice && a.versao == b.versao) {
+        r = a;
+    }
+    r.epoca = p->epoca;
+    return r;
+}
+
+static int empilhar(Propagacao *p, Mudanca **v, size_t *n, size_t *cap, int var, Valor valor) {
+    if (*n == *cap) {
+        size_t novo = *cap ? *cap * 2 : 64;
+        Mudanca *m = realloc(*v, sizeof(Mudanca) * novo);
+        if (m == NULL) {
+            p->falhou = 1;
+            return 0;
+        }
+        *v = m;
+        *cap = novo;
+    }
+    (*v)[*n].var = var;
+    (*v)[*n].valor = valor;
+    (*n)++;
+    return 1;
+}
+
+static void definir(Propagacao *p, int var, Valor v) {
+    empilhar(p, &p->trilha, &p->n_trilha, &p->cap_trilha, var, p->valor[var]);
+    p->valor[var] = v;
+}
+
+// Atribuição: cópias da variável deixam de valer
+static void escrever(Propagacao *p, int var, Valor v) {
+    p->versao[var]++;
+    v.epoca = p->epoca;
+    definir(p, var, v);
+}
+
+static void desfazer(Propagacao *p, size_t marca) {
+    while (p->n_trilha > marca) {
+        p->n_trilha--;
+        p->valor[p->trilha[p->n_trilha].var] = p->trilha[p->n_trilha].valor;
+    }
+}
+
+// Troca uma leitura de variável pelo valor conhecido
+static void trocar(Propagacao *p, NoId id, Valor v) {
+    NoAST *no = ast_no(p->t, id);
+
+    if (v.tipo == DESCONHECIDO || p->falhou) return;
+    if (v.tipo == CONSTANTE) {
+        no->tipo = v.literal;
+        no->op = 0;
+        no->u.endereco = 0;
+        no->texto = v.texto;
+    } else {
+        const NoAST *origem = ast_no(p->t, v.origem);
+        no->op = origem->op;
+        no->u.endereco = origem->u.endereco;
+        no->texto = origem->texto;
+    }
+    p->trocas++;
+}
+
+// Leituras de uma expressão, na ordem em que a MEPA as faz
+static void visitar_exp(Propagacao *p, NoId raiz) {
+    for (NoId id = ast_inicio(p->t, raiz); id <= raiz; id++) {
+        const NoAST *no = ast_no(p->t, id);
+        if (no->flags & AST_MORTO) continue;
+
+        if (no->tipo == AST_CHAMADA) {
+            p->epoca++;
+        } else if (no->tipo == AST_VAR && !(no->flags & AST_ALVO)) {
+            int var = indice(p, no);
+            if (var >= 0) trocar(p, id, atual(p, var));
+        }
+    }
+}
+
+// valor: expressão atribuída (0 num read)
+static void atribuir(Propagacao *p, NoId alvo, NoId valor) {
+    int var = indice(p, ast_no(p->t, alvo));
+    Valor v = {0};
+
+    if (var < 0) return;
+    if (valor != 0) {
+        const NoAST *no = ast_no(p->t, valor);
+        if (no->tipo == AST_INT || no->tipo == AST_FLOAT) {
+            v.tipo = CONSTANTE;
+            v.literal = no->tipo;
+            v.texto = no->texto;
+        } else if (no->tipo == AST_VAR) {
+            int origem = indice(p, no);
+            if (origem >= 0 && origem != var) {
+                v.tipo = COPIA;
+                v.origem = valor;
+                v.indice = origem;
+                v.versao = p->versao[origem];
+            }
+        }
+    }
+    escrever(p, var, v);
+}
+
+// Variáveis atribuídas num trecho, e se ele chama sub-rotinas
+typedef void (*Escrita)(Propagacao *p, const NoAST *var);
+
+static void escritas_exp(Propagacao *p, NoId raiz) {
+    for (NoId id = ast_inicio(p->t, raiz); id <= raiz; id++) {
+        const NoAST *no = ast_no(p->t, id);
+        if (no->tipo == AST_CHAMADA && !(no->flags & AST_MORTO)) p->epoca++;
+    }
+}
+
+static void escritas_cmd(Propagacao *p, NoId id, Escrita escrita);
+
+static void escritas_lista(Propagacao *p, NoId id, Escrita escrita) {
+    for (; id != 0; id = ast_no(p->t, id)->prox) escritas_cmd(p, id, escrita);
+}
+
+// O que repete num laço (num for, tudo menos a inicialização)
+static void escritas_repeticao(Propagacao *p, const NoAST *no, Escrita escrita) {
+    switch (no->tipo) {
+        case AST_ENQUANTO:
+            escritas_exp(p, no->a);
+            escritas_cmd(p, no->b, escrita);
+            break;
+        case AST_REPITA:
+            escritas_lista(p, no->a, escrita);
+            escritas_exp(p, no->b);
+            break;
+        case AST_PARA:
+            escritas_exp(p, no->b);
+            escritas_cmd(p, no->c, escrita);
+            escritas_cmd(p, no->u.d, escrita);
+            break;
+        default:
+            break;
+    }
+}
+
+static void escritas_cmd(Propagacao *p, NoId id, Escrita escrita) {
+    const NoAST no = *ast_no(p->t, id);
+
+    switch (no.tipo) {
+        case AST_ATRIB:
+            escritas_exp(p, no.b);
+            escrita(p, ast_no(p->t, no.a));
+            break;
+        case AST_LEITURA:
+            escrita(p, ast_no(p->t, no.a));
+            break;
+        case AST_ESCRITA:
+            escritas_exp(p, no.a);
+            break;
+        case AST_CHAMADA:
+            escritas_exp(p, id);
+            break;
+        case AST_RETORNO:
+            if (no.a != 0) escritas_exp(p, no.a);
+            break;
+        case AST_SE:
+            escritas_exp(p, no.a);
+            escritas_cmd(p, no.b, escrita);
+            if (no.c != 0) escritas_cmd(p, no.c, escrita);
+            break;
+        case AST_PARA:
+            if (no.a != 0) escritas_cmd(p, no.a, escrita);
+            escritas_repeticao(p, &no, escrita);
+            break;
+        case AST_ENQUANTO:
+        case AST_REPITA:
+            escritas_repeticao(p, &no, escrita);
+            break;
+        case AST_BLOCO:
+            escritas_lista(p, no.a, escrita);
+            break;
+        default:
+            break;
+    }
+}
+
+static void esquecer(Propagacao *p, const NoAST *var) {
+    Valor desconhecido = {0};
+    int i = indice(p, var);
+    if (i >= 0) escrever(p, i, desconhecido);
+}
+
+// Condição que a dobra reduziu a uma constante inteira
+static int condicao_constante(const ArvoreAST *t, NoId raiz, int *verdade) {
+    const NoAST *no = ast_no(t, raiz);
+    if (no->tipo != AST_INT) return 0;
+    *verdade = strtol(ast_lexema(t, no), NULL, 10) != 0;
+    return 1;
+}
+
+// Troca um desvio de condição constante pelo bloco que sempre executa
+static void virar_bloco(Propagacao *p, NoId id, NoId condicao, NoId primeiro) {
+    NoAST *no = ast_no(p->t, id);
+
+    ast_no(p->t, condicao)->flags |= AST_MORTO;
+    no->tipo = AST_BLOCO;
+    no->op = 0;
+    no->a = primeiro;
+    no->b = no->c = 0;
+    no->u.d = 0;
+    p->trocas++;
+}
+
+static void visitar_cmd(Propagacao *p, NoId id);
+
+static void visitar_lista(Propagacao *p, NoId id) {
+    for (; id != 0; id = ast_no(p->t, id)->prox) visitar_cmd(p, id);
+}
+
+// Guarda os valores do fim de um ramo e volta ao estado de antes dele
+static void guardar_ramo(Propagacao *p, size_t marca) {
+    for (size_t k = marca; k < p->n_trilha; k++) {
+        int var = p->trilha[k].var;
+        empilhar(p, &p->ramos, &p->n_ramos, &p->cap_ramos, var, p->valor[var]);
+    }
+    desfazer(p, marca);
+}
+
+// Junta os ramos [base, meio) (then) e [meio, n_ramos) (else). Quem só
+// mudou num ramo tem, no outro, o valor de antes do if
+static void juntar_ramos(Propagacao *p, size_t base, size_t meio) {
+    size_t fim = p->n_ramos;
+    unsigned juncao = ++p->n_juncoes;
+
+    for (size_t k = meio; k < fim; k++) {
+        int var = p->ramos[k].var;
+        p->marca_senao[var] = juncao;
+        p->valor_senao[var] = p->ramos[k].valor;
+    }
+    for (size_t k = base; k < meio; k++) {
+        int var = p->ramos[k].var;
+        Valor senao = p->marca_senao[var] == juncao ? p->valor_senao[var] : p->valor[var];
+        definir(p, var, juntar(p, normalizar(p, var, p->ramos[k].valor), normalizar(p, var, senao)));
+    }
+    for (size_t k = meio; k < fim; k++) {
+        int var = p->ramos[k].var;
+        definir(p, var, juntar(p, atual(p, var), normalizar(p, var, p->ramos[k].valor)));
+    }
+    p->n_ramos = base;
+}
+
+static void visitar_se(Propagacao *p, NoId id) {
+    const NoAST no = *ast_no(p->t, id);
+    int verdade;
+
+    visitar_exp(p, no.a);
+    if (condicao_constante(p->t, no.a, &verdade)) {
+        NoId ramo = verdade ? no.b : no.c;
+        virar_bloco(p, id, no.a, ramo);
+        if (ramo != 0) {
+            ast_no(p->t, ramo)->prox = 0;
+            visitar_cmd(p, ramo);
+        }
+        return;
+    }
+
+    size_t marca = p->n_trilha, base = p->n_ramos;
+    visitar_cmd(p, no.b);
+    guardar_ramo(p, marca);
+    size_t meio = p->n_ramos;
+    if (no.c != 0) visitar_cmd(p, no.c);
+    guardar_ramo(p, marca);
+    juntar_ramos(p, base, meio);
+}
+
+static void visitar_laco(Propagacao *p, NoId id) {
+    const NoAST no = *ast_no(p->t, id);
+    int verdade;
+    size_t marca;
+
+    // Laço que não repete
+    if (no.tipo == AST_ENQUANTO && condicao_constante(p->t, no.a, &verdade) && !verdade) {
+        virar_bloco(p, id, no.a, 0);
+        return;
+    }
+    if (no.tipo == AST_PARA && condicao_constante(p->t, no.b, &verdade) && !verdade) {
+        virar_bloco(p, id, no.b, no.a);
+        if (no.a != 0) visitar_cmd(p, no.a);
+        return;
+    }
+    if (no.tipo == AST_REPITA && condicao_constante(p->t, no.b, &verdade) && verdade) {
+        virar_bloco(p, id, no.b, no.a);
+        visitar_lista(p, no.a);
+        return;
+    }
+
+    // O que muda no laço fica desconhecido desde a entrada; na saída de um
+    // while ou for vale o estado do teste
+    if (no.tipo == AST_PARA && no.a != 0) visitar_cmd(p, no.a);
+    escritas_repeticao(p, &no, esquecer);
+    switch (no.tipo) {
+        case AST_ENQUANTO:
+            visitar_exp(p, no.a);
+            marca = p->n_trilha;
+            visitar_cmd(p, no.b);
+            desfazer(p, marca);
+            break;
+        case AST_REPITA:
+            visitar_lista(p, no.a);
+            visitar_exp(p, no.b);
+            break;
+        case AST_PARA:
+            visitar_exp(p, no.b);
+            marca = p->n_trilha;
+            visitar_cmd(p, no.u.d);
+            visitar_cmd(p, no.c);
+            desfazer(p, marca);
+            break;
+        default:
+            break;
+    }
+}
+
+static void visitar_cmd(Propagacao *p, NoId id) {
+    const NoAST no = *ast_no(p->t, id);
+
+    switch (no.tipo) {
+        case AST_ATRIB:
+            visitar_exp(p, no.b);
+            atribuir(p, no.a, no.b);
+            break;
+        case AST_LEITURA:
+            atribuir(p, no.a, 0);
+            break;
+        case AST_ESCRITA:
+            visitar_exp(p, no.a);
+            break;
+        case AST_CHAMADA:
+            visitar_exp(p, id);
+            break;
+        case AST_RETORNO:
+            if (no.a != 0) visitar_exp(p, no.a);
+            break;
+        case AST_SE:
+            visitar_se(p, id);
+            break;
+        case AST_ENQUANTO:
+        case AST_REPITA:
+        case AST_PARA:
+            visitar_laco(p, id);
+            break;
+        case AST_BLOCO:
+            visitar_lista(p, no.a);
+            break;
+        default:
+            break;
+    }
+}
+
+// Propaga numa área; retorna as trocas (-1 se faltou memória)
+static long propagar_area(ArvoreAST *t, int nivel, int n_locais, int n_param,
+                          const uint8_t *muda_em_chamada, NoId corpo) {
+    Propagacao p;
+    size_t n = (size_t)n_locais + n_param + 1;
+
+    memset(&p, 0, sizeof(p));
+    p.t = t;
+    p.nivel = nivel;
+    p.n_locais = n_locais;
+    p.n_param = n_param;
+    p.muda_em_chamada = muda_em_chamada;
+    p.valor = calloc(n, sizeof(Valor));
+    p.versao = calloc(n, sizeof(unsigned));
+    p.marca_senao = calloc(n, sizeof(unsigned));
+    p.valor_senao = calloc(n, sizeof(Valor));
+    if (p.valor != NULL && p.versao != NULL && p.marca_senao != NULL && p.valor_senao != NULL) {
+        visitar_cmd(&p, corpo);
+    } else {
+        p.falhou = 1;
+    }
+
+    free(p.valor);
+    free(p.versao);
+    free(p.marca_senao);
+    free(p.valor_senao);
+    free(p.trilha);
+    free(p.ramos);
+    return p.falhou ? -1 : p.trocas;
+}
+
+// Globais atribuídas em alguma sub-rotina
+static void marcar_global(Propagacao *p, const NoAST *var) {
+    int e = var->u.endereco;
+    if (var->op == 0 && e >= 0 && e < p->n_locais) p->atribuidas[e] = 1;
+}
+
+static long propagar(ArvoreAST *t) {
+    const NoAST *prg = ast_no(t, t->raiz);
+    NoId dcl_prg = prg->a, corpo_prg = prg->c, subs = prg->u.d;
+    int n_globais = ast_no(t, dcl_prg)->u.endereco;
+    long trocas = 0, r;
+    Propagacao p;
+
+    uint8_t *atribuidas = calloc((size_t)n_globais + 1, 1);
+    if (atribuidas == NULL) return 0;
+    memset(&p, 0, sizeof(p));
+    p.t = t;
+    p.n_locais = n_globais;
+    p.atribuidas = atribuidas;
+    for (NoId sub = subs; sub != 0; sub = ast_no(t, sub)->prox) {
+        escritas_cmd(&p, ast_no(t, sub)->c, marcar_global);
+    }
+
+    for (NoId sub = subs; sub != 0; sub = ast_no(t, sub)->prox) {
+        const NoAST *no = ast_no(t, sub);
+        r = propagar_area(t, 1, no->u.endereco, contar(t, ast_no(t, no->a)->a), NULL, no->c);
+        if (r < 0) break;
+        trocas += r;
+    }
+    r = propagar_area(t, 0, n_globais, 0, atribuidas, corpo_prg);
+    if (r > 0) trocas += r;
+
+    free(atribuidas);
+    return trocas;
+}
+
+long propagar_constantes(ArvoreAST *t) {
+    long total = 0;
+
+    for (int rodada = 0; rodada < MAX_RODADAS; rodada++) {
+        long trocas = propagar(t);
+        if (trocas <= 0) break;
+        total += trocas;
+        otimizar_ast(t);
+    }
+    return total;
+}
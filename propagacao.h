@@ -0,0 +1,16 @@
+/*
+ * propagacao.h - Propagação de constantes e cópias (modo -O1)
+ */
+
+#ifndef PROPAGACAO_H
+#define PROPAGACAO_H
+
+#include "ast.h"
+
+// Troca leituras de variáveis de valor conhecido pela constante (ou pela
+// variável de que são cópia) e elimina os desvios cuja condição ficou
+// constante, dobrando as constantes de novo a cada rodada, numa árvore já
+// checada pela semântica. Retorna o número de trocas.
+long propagar_constantes(ArvoreAST *t);
+
+#endif
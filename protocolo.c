@@ -0,0 +1,121 @@
+/*
+ * protocolo.c - Implementação do protocolo cliente/servidor
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "protocolo.h"
+
+// Opções de compilação aceitas nos pedidos
+static const struct {
+    const char *nome;
+    int argumentos;
+    int caminho;
+} opcoes[] = {
+    {"-O0", 0, 0},
+    {"-O1", 0, 0},
+    {"--analisador", 1, 0},
+    {"--threads-geracao", 1, 0},
+    {"--desenrolar", 1, 0},
+    {"--expandir", 1, 0},
+    {"--max-erros", 1, 0},
+    {"--max-expressao", 1, 0},
+    {"--max-aninhamento", 1, 0},
+    {"--perfil", 1, 1},
+    {"--importar", 1, 1},
+};
+
+int proto_opcao(const char *opcao, int *caminho) {
+    for (size_t k = 0; k < sizeof(opcoes) / sizeof(opcoes[0]); k++) {
+        if (strcmp(opcao, opcoes[k].nome) == 0) {
+            *caminho = opcoes[k].caminho;
+            return opcoes[k].argumentos;
+        }
+    }
+    return -1;
+}
+
+const char* proto_caminho_socket(const char *explicito) {
+    static char padrao[256];
+
+    if (explicito != NULL) return explicito;
+    const char *env = getenv(PROTO_VAR_SOCKET);
+    if (env != NULL && env[0] != '\0') return env;
+
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+    if (dir != NULL && dir[0] == '/') {
+        snprintf(padrao, sizeof(padrao), "%s/%s", dir, PROTO_SOCKET_NOME);
+    } else {
+        snprintf(padrao, sizeof(padrao), "/tmp/lpdc-%u.sock", (unsigned)getuid());
+    }
+    return padrao;
+}
+
+// Escreve os n bytes (retorna 0 em caso de erro)
+int proto_escrever(int fd, const void *buf, size_t n) {
+    const char *p = buf;
+    while (n > 0) {
+        ssize_t k = write(fd, p, n);
+        if (k < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        p += k;
+        n -= (size_t)k;
+    }
+    return 1;
+}
+
+// Lê exatamente n bytes. Retorna 1 se leu, 0 se a conexão terminou antes
+// do primeiro byte e -1 em caso de erro ou mensagem truncada.
+int proto_ler(int fd, void *buf, size_t n) {
+    char *p = buf;
+    size_t lidos = 0;
+    while (lidos < n) {
+        ssize_t k = read(fd, p + lidos, n - lidos);
+        if (k < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (k == 0) return lidos == 0 ? 0 : -1;
+        lidos += (size_t)k;
+    }
+    return 1;
+}
+
+int proto_enviar_bloco(int fd, const void *dados, uint32_t tam) {
+    if (!proto_escrever(fd, &tam, sizeof(tam))) return 0;
+    return tam == 0 || proto_escrever(fd, dados, tam);
+}
+
+// Recebe um bloco, crescendo o buffer só quando necessário. O conteúdo
+// sempre termina em '\0' (não contado em tam).
+int proto_receber_bloco(int fd, Bloco *b) {
+    uint32_t tam;
+
+    if (proto_ler(fd, &tam, sizeof(tam)) != 1) return 0;
+    if (tam > PROTO_MAX_BLOCO) return 0;
+    if (b->dados == NULL || tam + 1 > b->cap) {
+        uint32_t cap = b->cap ? b->cap : 4096;
+        while (cap < tam + 1) cap *= 2;
+        char *novo = realloc(b->dados, cap);
+        if (novo == NULL) return 0;
+        b->dados = novo;
+        b->cap = cap;
+    }
+    if (tam > 0 && proto_ler(fd, b->dados, tam) != 1) return 0;
+    b->dados[tam] = '\0';
+    b->tam = tam;
+    return 1;
+}
+
+void proto_liberar_bloco(Bloco *b) {
+    free(b->dados);
+    b->dados = NULL;
+    b->tam = b->cap = 0;
+}
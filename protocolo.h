@@ -0,0 +1,64 @@
+/*
+ * protocolo.h - Protocolo entre o servidor de compilação e o cliente
+ *
+ * Mensagens trafegam por um socket Unix (SOCK_STREAM). Um bloco é um
+ * tamanho de 32 bits (ordem nativa: cliente e servidor estão na mesma
+ * máquina) seguido dos bytes. Uma conexão pode levar vários pedidos.
+ *
+ *   pedido:   tipo (1 byte), bloco opções, bloco nome, bloco conteúdo
+ *             tipo PROTO_CAMINHO: conteúdo é o caminho absoluto da fonte
+ *             tipo PROTO_TEXTO:   conteúdo é o próprio texto da fonte
+ *   resposta: situação (1 byte), blocos saída, erros, .mepa e .ts
+ *
+ * As opções são as de compilação da linha de comando do lpdc (só as que
+ * proto_opcao aceita), cada palavra terminada por '\0', valendo só para o
+ * pedido. O nome é o que aparece nas mensagens ("Compilando '<nome>'...")
+ * e de onde o cliente tira o nome base dos arquivos gerados.
+ */
+
+#ifndef PROTOCOLO_H
+#define PROTOCOLO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PROTO_CAMINHO 'P'
+#define PROTO_TEXTO 'T'
+
+// Situação da resposta
+#define PROTO_OK 0              // compilado; .mepa e .ts válidos
+#define PROTO_ERRO 1            // erro de compilação; .mepa e .ts parciais
+#define PROTO_FALHA 2           // fonte não pôde ser lida; nada a gravar
+
+// Limite de um bloco (protege o servidor de pedidos malformados)
+#define PROTO_MAX_BLOCO (256u << 20)
+
+// Variável de ambiente e nome padrão do socket. Sem -s nem a variável, o
+// socket fica em $XDG_RUNTIME_DIR (só o usuário entra) ou, se ela não
+// existe, em /tmp/lpdc-<uid>.sock
+#define PROTO_VAR_SOCKET "LPDC_SOCKET"
+#define PROTO_SOCKET_NOME "lpdc.sock"
+
+// Buffer reaproveitado entre mensagens
+typedef struct {
+    char *dados;
+    uint32_t tam;
+    uint32_t cap;
+} Bloco;
+
+// Caminho do socket: o explícito (-s), o da variável ou o padrão. O padrão
+// fica num buffer estático, válido até a próxima chamada
+const char* proto_caminho_socket(const char *explicito);
+int proto_escrever(int fd, const void *buf, size_t n);
+int proto_ler(int fd, void *buf, size_t n);
+int proto_enviar_bloco(int fd, const void *dados, uint32_t tam);
+int proto_receber_bloco(int fd, Bloco *b);
+void proto_liberar_bloco(Bloco *b);
+
+// Opção do lpdc que vai no pedido: retorna quantos argumentos ela usa (0
+// ou 1) e, em *caminho, se o argumento é um arquivo, mandado como caminho
+// absoluto. -1 se o servidor não a aceita (--interface e --desvios-diretos
+// gravam o que a resposta não leva; as demais são do processo lpdc)
+int proto_opcao(const char *opcao, int *caminho);
+
+#endif
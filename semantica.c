@@ -0,0 +1,197 @@
+/*
+ * semantica.c - Implementação da análise semântica da árvore
+ *
+ * Uma varredura linear da arena. Os nós estão em pós-ordem, então cada um é
+ * visitado depois dos filhos, e as declarações antes dos usos que as seguem
+ * no texto: as checagens acontecem na mesma ordem que no analisador de uma
+ * passada, com as mesmas mensagens e linhas. Nós soltos (de comandos
+ * descartados por erro sintático) também são checados, como lá.
+ *
+ * O escopo de uma sub-rotina é aberto na sua declaração, que precede os
+ * parâmetros na arena, e fechado no AST_SUBROT, criado depois do corpo.
+ */
+
+#include <stdio.h>
+#include <setjmp.h>
+#include "semantica.h"
+#include "asdr.h"
+#include "ast.h"
+
+static void checar_var(ContextoCompilacao *ctx, NoAST *no) {
+    RegistroTS *registro = buscar_variavel(ctx, ast_lexema(ctx->ast, no), no->linha);
+
+    if (registro == NULL) {
+        no->dado = TIPO_ERRO;
+        no->u.endereco = -1;
+        return;
+    }
+    no->dado = registro->tipo;
+    no->op = (uint8_t)registro->nivel;
+    no->u.endereco = registro->endereco;
+}
+
+// Declaração de sub-rotina: entra no escopo dela
+static void declarar_subrotina(ContextoCompilacao *ctx, NoAST *no) {
+    RegistroTS *sub = declarar(ctx, ast_lexema(ctx->ast, no), CAT_FUNCAO, (TAtomo)no->op,
+                               ctx->ts.n_subrotinas + 1);
+
+    no->u.endereco = sub != NULL ? sub->endereco : 0;
+    ts_abrir_escopo(&ctx->ts);
+    ctx->sub_atual = sub;
+}
+
+static void declarar_parametro(ContextoCompilacao *ctx, NoAST *no) {
+    declarar(ctx, ast_lexema(ctx->ast, no), CAT_PARAMETRO, (TAtomo)no->op, no->u.endereco);
+    if (ctx->sub_atual != NULL && !ts_adicionar_parametro(ctx->sub_atual, (TAtomo)no->op)) {
+        sem_memoria_ts(ctx);
+    }
+}
+
+// Sub-rotina de um AST_RESULTADO já resolvido (NULL se não declarada)
+static RegistroTS* subrotina_chamada(ContextoCompilacao *ctx, NoId resultado) {
+    int numero = ast_no(ctx->ast, resultado)->u.endereco;
+    return numero > 0 ? ts_subrotina(&ctx->ts, numero) : NULL;
+}
+
+static void checar_resultado(ContextoCompilacao *ctx, NoAST *no) {
+    RegistroTS *sub = buscar_subrotina(ctx, ast_lexema(ctx->ast, no), no->op, no->linha);
+
+    no->u.endereco = sub != NULL ? sub->endereco : 0;
+    no->dado = sub != NULL ? sub->tipo : TIPO_ERRO;
+}
+
+static void checar_unario(ContextoCompilacao *ctx, NoAST *no) {
+    TipoDado tipo = ast_no(ctx->ast, no->a)->dado;
+
+    if (no->op == sSUBT) {
+        if (!eh_numerico(tipo)) {
+            fprintf(ctx->diag, "Erro semântico (%d): operador unário '-' aplicado a tipo não-numérico '%s'\n",
+                    no->linha, nome_tipo(tipo));
+            registrar_erro(ctx);
+            tipo = TIPO_ERRO;
+        }
+        no->dado = tipo;
+        return;
+    }
+
+    if (!eh_bool(tipo)) {
+        fprintf(ctx->diag, "Erro semântico (%d): operador 'nao' requer operando booleano, "
+                "encontrado '%s'\n", no->linha, nome_tipo(tipo));
+        registrar_erro(ctx);
+    }
+    no->dado = TIPO_BOOL;
+}
+
+static void checar_binario(ContextoCompilacao *ctx, NoAST *no) {
+    TipoDado esq = ast_no(ctx->ast, no->a)->dado;
+    TipoDado dir = ast_no(ctx->ast, no->b)->dado;
+
+    if (eh_op_relacional(no->op)) {
+        if (!tipos_compativeis(esq, dir)) {
+            fprintf(ctx->diag, "Erro semântico (%d): operandos incompatíveis na comparação - "
+                    "'%s' e '%s'\n", no->linha, nome_tipo(esq), nome_tipo(dir));
+            registrar_erro(ctx);
+        }
+        no->dado = TIPO_BOOL;
+        return;
+    }
+
+    if (no->op == sOU || no->op == sE) {
+        if (!eh_bool(esq) || !eh_bool(dir)) {
+            fprintf(ctx->diag, "Erro semântico (%d): operador '%s' requer operandos booleanos\n",
+                    no->linha, nome_token(no->op));
+            registrar_erro(ctx);
+        }
+        no->dado = TIPO_BOOL;
+        return;
+    }
+
+    // Aritméticos: se um é float, o resultado é float
+    if (!tipos_compativeis(esq, dir)) {
+        fprintf(ctx->diag, "Erro semântico (%d): operandos incompatíveis em operação aritmética - "
+                "'%s' e '%s'\n", no->linha, nome_tipo(esq), nome_tipo(dir));
+        registrar_erro(ctx);
+        esq = dir = TIPO_ERRO;
+    }
+    no->dado = (esq == TIPO_FLOAT || dir == TIPO_FLOAT) ? TIPO_FLOAT : esq;
+}
+
+static void checar_atrib(ContextoCompilacao *ctx, NoAST *no) {
+    NoAST *var = ast_no(ctx->ast, no->a);
+    TipoDado tipo_exp = ast_no(ctx->ast, no->b)->dado;
+
+    var->flags |= AST_ALVO;
+    // Variável não declarada (já relatada) tem TIPO_ERRO, compatível com tudo
+    if (!tipos_compativeis(tipo_exp, var->dado)) {
+        fprintf(ctx->diag, "Erro semântico (%d): incompatibilidade de tipos na atribuição - "
+                "tentando atribuir '%s' a variável '%s' do tipo '%s'\n",
+                no->linha, nome_tipo(tipo_exp), ast_lexema(ctx->ast, var),
+                nome_tipo(var->dado));
+        registrar_erro(ctx);
+    }
+}
+
+static void checar_retorno_no(ContextoCompilacao *ctx, NoAST *no) {
+    // No programa principal a expressão não é checada (ver parse_ret)
+    if (ctx->sub_atual == NULL) return;
+    TipoDado tipo = no->a != 0 ? ast_no(ctx->ast, no->a)->dado : TIPO_VOID;
+    checar_retorno(ctx, ctx->sub_atual, no->a != 0, tipo, no->linha);
+}
+
+int analisar_ast(ContextoCompilacao *ctx) {
+    ArvoreAST *t = ctx->ast;
+
+    ctx->recuperar = NULL;
+    if (setjmp(ctx->fuga) != 0) return 0;
+
+    for (NoId id = 1; id < t->n; id++) {
+        NoAST *no = ast_no(t, id);
+
+        switch (no->tipo) {
+            case AST_DECL:
+                if (no->dado == CAT_PROGRAMA) {
+                    declarar(ctx, ast_lexema(t, no), CAT_PROGRAMA, sVOID, -1);
+                } else if (no->dado == CAT_FUNCAO) {
+                    declarar_subrotina(ctx, no);
+                } else if (no->dado == CAT_PARAMETRO) {
+                    declarar_parametro(ctx, no);
+                } else {
+                    declarar(ctx, ast_lexema(t, no), CAT_VARIAVEL, (TAtomo)no->op,
+                             obter_proximo_endereco(&ctx->ts));
+                }
+                break;
+            case AST_VAR:     checar_var(ctx, no); break;
+            case AST_INT:     no->dado = TIPO_INT; break;
+            case AST_FLOAT:   no->dado = TIPO_FLOAT; break;
+            case AST_UNARIO:  checar_unario(ctx, no); break;
+            case AST_BINARIO: checar_binario(ctx, no); break;
+            case AST_ATRIB:   checar_atrib(ctx, no); break;
+            case AST_LEITURA: ast_no(t, no->a)->flags |= AST_ALVO; break;
+            case AST_RETORNO: checar_retorno_no(ctx, no); break;
+            case AST_RESULTADO:
+                checar_resultado(ctx, no);
+                break;
+            case AST_ARG:
+                checar_argumento(ctx, subrotina_chamada(ctx, no->b), no->c,
+                                 ast_no(t, no->a)->dado, no->linha);
+                break;
+            case AST_CHAMADA: {
+                RegistroTS *sub = subrotina_chamada(ctx, no->a);
+                checar_n_argumentos(ctx, sub, no->c, no->linha);
+                no->dado = tipo_chamada(sub, ast_no(t, no->a)->op);
+                break;
+            }
+            case AST_SUBROT:
+                no->u.endereco = obter_proximo_endereco(&ctx->ts);
+                ts_fechar_escopo(&ctx->ts);
+                ctx->sub_atual = NULL;
+                break;
+            default:          break;
+        }
+    }
+
+    // Tamanho da área de dados do programa (as das sub-rotinas ficam nos
+    // seus AST_SUBROT)
+    if (t->raiz != 0) ast_no(t, ast_no(t, t->raiz)->a)->u.endereco = obter_proximo_endereco(&ctx->ts);
+    return ctx->erros == 0;
+}
@@ -0,0 +1,15 @@
+/*
+ * semantica.h - Análise semântica da árvore (modo -O1)
+ */
+
+#ifndef SEMANTICA_H
+#define SEMANTICA_H
+
+#include "contexto.h"
+
+// Declara os identificadores de ctx->ast na tabela de símbolos, resolve as
+// variáveis e checa os tipos. Retorna 1 se não houve erro (nem antes, na
+// análise sintática).
+int analisar_ast(ContextoCompilacao *ctx);
+
+#endif
@@ -0,0 +1,312 @@
+/*
+ * servidor.c - Implementação do servidor de compilação
+ */
+
+#define _GNU_SOURCE             // struct ucred (SO_PEERCRED)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "servidor.h"
+#include "protocolo.h"
+#include "compilador.h"
+
+// Caminho do socket, removido ao encerrar (SIGINT/SIGTERM)
+static char caminho_socket[sizeof(((struct sockaddr_un*)0)->sun_path)];
+
+static void encerrar(int sinal) {
+    (void)sinal;
+    unlink(caminho_socket);
+    _exit(0);
+}
+
+// Opções das compilações sem opções no pedido (as da linha de comando do
+// lpdc -S)
+static const OpcoesCompilacao *opcoes_servidor;
+
+// Buffers de uma thread, reaproveitados entre pedidos
+typedef struct {
+    int fd_escuta;
+    Bloco opcoes;
+    Bloco nome;
+    Bloco conteudo;
+    char **palavras;            // palavras do bloco de opções
+    int cap_palavras;
+} Atendente;
+
+// Saídas de um pedido, acumuladas em memória
+typedef struct {
+    char *texto[4];             // saída, erros, .mepa, .ts
+    size_t tam[4];
+    FILE *fluxo[4];
+} Resposta;
+
+static int abrir_resposta(Resposta *r) {
+    memset(r, 0, sizeof(*r));
+    for (int k = 0; k < 4; k++) {
+        r->fluxo[k] = open_memstream(&r->texto[k], &r->tam[k]);
+        if (r->fluxo[k] == NULL) return 0;
+    }
+    return 1;
+}
+
+static void fechar_resposta(Resposta *r) {
+    for (int k = 0; k < 4; k++) {
+        if (r->fluxo[k]) fclose(r->fluxo[k]);
+        r->fluxo[k] = NULL;
+    }
+}
+
+static void liberar_resposta(Resposta *r) {
+    fechar_resposta(r);
+    for (int k = 0; k < 4; k++) free(r->texto[k]);
+}
+
+// Aplica as opções do pedido sobre as do servidor. Retorna 0 (com a
+// mensagem em diag) se uma delas não é aceita ou é inválida
+static int ler_opcoes(Atendente *a, OpcoesCompilacao *op, FILE *diag) {
+    const Bloco *b = &a->opcoes;
+    int n = 0;
+
+    *op = *opcoes_servidor;
+    if (b->tam == 0) return 1;
+    if (b->dados[b->tam - 1] != '\0') {
+        fprintf(diag, "Erro: opções malformadas no pedido\n");
+        return 0;
+    }
+
+    for (uint32_t k = 0; k < b->tam; k += (uint32_t)strlen(b->dados + k) + 1) {
+        if (n == a->cap_palavras) {
+            int cap = a->cap_palavras ? a->cap_palavras * 2 : 16;
+            char **novo = realloc(a->palavras, sizeof(char*) * cap);
+            if (novo == NULL) {
+                fprintf(diag, "Erro: memória insuficiente\n");
+                return 0;
+            }
+            a->palavras = novo;
+            a->cap_palavras = cap;
+        }
+        a->palavras[n++] = b->dados + k;
+    }
+
+    for (int k = 0; k < n; ) {
+        int caminho, argumentos = proto_opcao(a->palavras[k], &caminho);
+        int usadas = argumentos < 0 ? 0 : compilador_ler_opcao(op, n, a->palavras, k);
+        if (usadas != argumentos + 1) {
+            fprintf(diag, "Erro: opção '%s' inválida ou não aceita pelo servidor\n", a->palavras[k]);
+            return 0;
+        }
+        k += usadas;
+    }
+    return 1;
+}
+
+// Compila um pedido já recebido e envia a resposta
+static int responder(int con, Atendente *a, char tipo) {
+    Resposta r;
+    OpcoesCompilacao op;
+    PerfilDesvios perfil;
+    ModuloTS modulo;
+    FILE *fonte_lpd;
+    unsigned char situacao;
+    char erro[300];
+    int ok = 1;
+
+    if (!abrir_resposta(&r)) {
+        liberar_resposta(&r);
+        return 0;
+    }
+
+    if (!ler_opcoes(a, &op, r.fluxo[1])) {
+        situacao = PROTO_FALHA;
+    } else if (!compilador_carregar_opcoes(&op, &perfil, &modulo, erro, sizeof(erro))) {
+        fprintf(r.fluxo[1], "Erro: %s\n", erro);
+        situacao = PROTO_FALHA;
+    } else {
+        if (tipo == PROTO_TEXTO) {
+            // fmemopen não aceita buffer vazio em todas as versões
+            fonte_lpd = a->conteudo.tam > 0
+                      ? fmemopen(a->conteudo.dados, a->conteudo.tam, "r")
+                      : fopen("/dev/null", "r");
+        } else {
+            fonte_lpd = fopen(a->conteudo.dados, "r");
+        }
+
+        if (fonte_lpd == NULL) {
+            fprintf(r.fluxo[1], "Erro: não foi possível abrir arquivo '%s'\n", a->nome.dados);
+            situacao = PROTO_FALHA;
+        } else {
+            situacao = compilar_fluxos(fonte_lpd, a->nome.dados, 1,
+                                       r.fluxo[2], r.fluxo[3], r.fluxo[0], &op, NULL)
+                     ? PROTO_OK : PROTO_ERRO;
+            fclose(fonte_lpd);
+        }
+    }
+    compilador_liberar_opcoes(&op, &perfil, &modulo);
+    fechar_resposta(&r);
+
+    ok = proto_escrever(con, &situacao, 1);
+    for (int k = 0; k < 4 && ok; k++) {
+        ok = proto_enviar_bloco(con, r.texto[k], (uint32_t)r.tam[k]);
+    }
+    liberar_resposta(&r);
+    return ok;
+}
+
+// Atende uma conexão até o cliente fechá-la
+static void atender(int con, Atendente *a) {
+    for (;;) {
+        char tipo;
+        if (proto_ler(con, &tipo, 1) != 1) break;
+        if (tipo != PROTO_CAMINHO && tipo != PROTO_TEXTO) break;
+        if (!proto_receber_bloco(con, &a->opcoes)) break;
+        if (!proto_receber_bloco(con, &a->nome)) break;
+        if (!proto_receber_bloco(con, &a->conteudo)) break;
+        if (!responder(con, a, tipo)) break;
+    }
+    close(con);
+}
+
+// 1 se o processo do outro lado da conexão é do mesmo usuário do servidor
+static int mesmo_usuario(int con) {
+    struct ucred cred;
+    socklen_t tam = sizeof(cred);
+
+    if (getsockopt(con, SOL_SOCKET, SO_PEERCRED, &cred, &tam) != 0) return 0;
+    return cred.uid == getuid();
+}
+
+static void* trabalhar(void *arg) {
+    Atendente *a = arg;
+
+    for (;;) {
+        int con = accept(a->fd_escuta, NULL, NULL);
+        if (con < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("accept");
+            break;
+        }
+        // O servidor lê e grava arquivos com os direitos de quem o rodou:
+        // pedidos de outros usuários são recusados
+        if (!mesmo_usuario(con)) {
+            close(con);
+            continue;
+        }
+        atender(con, a);
+    }
+    return NULL;
+}
+
+// Antes do bind: um socket deixado por um servidor que já terminou é
+// removido; um que ainda aceita conexões, ou um arquivo que não é socket,
+// fica. Retorna 0 nesses dois casos
+static int liberar_caminho(const struct sockaddr_un *end) {
+    struct stat st;
+
+    if (lstat(end->sun_path, &st) != 0) {
+        if (errno == ENOENT) return 1;
+        fprintf(stderr, "Erro: não foi possível verificar '%s'\n", end->sun_path);
+        return 0;
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        fprintf(stderr, "Erro: '%s' existe e não é um socket\n", end->sun_path);
+        return 0;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return 0;
+    }
+    int vivo = connect(fd, (const struct sockaddr*)end, sizeof(*end)) == 0 || errno != ECONNREFUSED;
+    close(fd);
+    if (vivo) {
+        fprintf(stderr, "Erro: já há um servidor em '%s'\n", end->sun_path);
+        return 0;
+    }
+    return unlink(end->sun_path) == 0 || errno == ENOENT;
+}
+
+int servidor_executar(const char *caminho, int n_threads, const OpcoesCompilacao *op) {
+    struct sockaddr_un end;
+    int fd;
+
+    if (strlen(caminho) >= sizeof(end.sun_path)) {
+        fprintf(stderr, "Erro: caminho do socket muito longo '%s'\n", caminho);
+        return 0;
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return 0;
+    }
+    memset(&end, 0, sizeof(end));
+    end.sun_family = AF_UNIX;
+    strcpy(end.sun_path, caminho);
+
+    if (!liberar_caminho(&end)) {
+        close(fd);
+        return 0;
+    }
+
+    // O socket nasce com modo 0600 (ainda não há outras threads para
+    // enxergar a máscara trocada)
+    mode_t mascara = umask(0177);
+    int ligado = bind(fd, (struct sockaddr*)&end, sizeof(end)) == 0;
+    umask(mascara);
+    if (!ligado || listen(fd, 128) < 0) {
+        fprintf(stderr, "Erro: não foi possível escutar em '%s'\n", caminho);
+        close(fd);
+        if (ligado) unlink(caminho);
+        return 0;
+    }
+
+    strcpy(caminho_socket, caminho);
+    opcoes_servidor = op;
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, encerrar);
+    signal(SIGTERM, encerrar);
+
+    if (n_threads < 1) n_threads = 1;
+    Atendente *atendentes = calloc(n_threads, sizeof(Atendente));
+    pthread_t *threads = malloc(sizeof(pthread_t) * n_threads);
+    if (atendentes == NULL || threads == NULL) {
+        free(atendentes);
+        free(threads);
+        close(fd);
+        unlink(caminho);
+        return 0;
+    }
+
+    fprintf(stderr, "lpdc: servidor em '%s' (%d thread(s))\n", caminho, n_threads);
+
+    int criadas = 0;
+    for (int k = 0; k < n_threads; k++) {
+        atendentes[k].fd_escuta = fd;
+        if (k > 0 && pthread_create(&threads[criadas], NULL, trabalhar, &atendentes[k]) == 0) {
+            criadas++;
+        }
+    }
+    // A thread principal também atende
+    trabalhar(&atendentes[0]);
+
+    for (int k = 0; k < criadas; k++) pthread_join(threads[k], NULL);
+    for (int k = 0; k < n_threads; k++) {
+        proto_liberar_bloco(&atendentes[k].opcoes);
+        proto_liberar_bloco(&atendentes[k].nome);
+        proto_liberar_bloco(&atendentes[k].conteudo);
+        free(atendentes[k].palavras);
+    }
+    free(atendentes);
+    free(threads);
+    close(fd);
+    unlink(caminho);
+    return 1;
+}
@@ -0,0 +1,19 @@
+/*
+ * servidor.h - Servidor de compilação residente (socket Unix)
+ *
+ * O processo fica no ar atendendo pedidos (ver protocolo.h). A partida do
+ * processo e a carga dinâmica são pagas uma vez só; os buffers de pedido
+ * de cada thread são mantidos entre um pedido e outro.
+ */
+
+#ifndef SERVIDOR_H
+#define SERVIDOR_H
+
+#include "compilador.h"
+
+// Atende pedidos em n_threads threads até ser interrompido, compilando com
+// as opções op mais as de cada pedido (op deve durar até o fim).
+// Retorna 0 se não foi possível abrir o socket.
+int servidor_executar(const char *caminho, int n_threads, const OpcoesCompilacao *op);
+
+#endif
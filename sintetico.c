@@ -0,0 +1,313 @@
+/*
+ * sintetico.c - Gerador de programas LPD sintéticos (lpdgen)
+ *
+ * Produz programas válidos para medir como o compilador escala com cada
+ * dimensão da entrada: número de variáveis, número de comandos, profundidade
+ * das expressões e aninhamento de if/while/for. Com -t, repete comandos até
+ * o arquivo atingir o tamanho pedido (centenas de MB, se preciso).
+ *
+ * Com -r, gera também sub-rotinas (s0, s1, ...) com -c comandos cada, todas
+ * chamadas do bloco principal: uma em cada quatro é void e chamada como
+ * comando; as funções retornam uma chamada à anterior, em cadeias de no
+ * máximo oito.
+ *
+ * Os programas também executam na MVM: laços usam contadores próprios
+ * (l0, l1, ...; locais nas sub-rotinas) com limite constante e divisões têm
+ * divisor literal.
+ *
+ * Uso: lpdgen [-v N] [-c N] [-p N] [-n N] [-r N] [-t tamanho] [-s semente] [-o arquivo]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    long variaveis;             // -v: variáveis declaradas (v0, v1, ...)
+    long comandos;              // -c: comandos no bloco principal
+    int profundidade;           // -p: parênteses aninhados por expressão
+    int aninhamento;            // -n: if/while/for aninhados por comando
+    long subrotinas;            // -r: sub-rotinas (s0, s1, ...)
+    long long tamanho;          // -t: bytes mínimos (substitui -c)
+    unsigned semente;
+
+    FILE *saida;
+    long long escritos;
+} Gerador;
+
+static void uso(const char *prog) {
+    fprintf(stderr, "Uso: %s [-v N] [-c N] [-p N] [-n N] [-r N] [-t tamanho] [-s semente] [-o arquivo]\n", prog);
+    fprintf(stderr, "  -v  variáveis declaradas (padrão 16)\n");
+    fprintf(stderr, "  -c  comandos no bloco principal (padrão 1000)\n");
+    fprintf(stderr, "  -p  profundidade das expressões (padrão 2)\n");
+    fprintf(stderr, "  -n  aninhamento de if/while/for (padrão 1)\n");
+    fprintf(stderr, "  -r  sub-rotinas, com -c comandos cada (padrão 0)\n");
+    fprintf(stderr, "  -t  gera comandos até o arquivo ter este tamanho\n"
+                    "      (sufixos K, M e G; ignora -c)\n");
+    fprintf(stderr, "  -s  semente do sorteio (padrão 1)\n");
+    fprintf(stderr, "  -o  arquivo de saída (padrão: saída padrão)\n");
+}
+
+static void escrever(Gerador *g, const char *texto) {
+    fputs(texto, g->saida);
+    g->escritos += strlen(texto);
+}
+
+static void escreverf(Gerador *g, const char *formato, long valor) {
+    char buffer[64];
+    int n = snprintf(buffer, sizeof(buffer), formato, valor);
+    fputs(buffer, g->saida);
+    g->escritos += n;
+}
+
+// Recuo limitado: com aninhamento grande, o arquivo continua crescendo
+// linearmente com -n
+static void recuar(Gerador *g, int nivel) {
+    if (nivel > 16) nivel = 16;
+    for (int k = 0; k < nivel; k++) escrever(g, "    ");
+}
+
+// Número pseudoaleatório em [0, n)
+static long sortear(Gerador *g, long n) {
+    g->semente = g->semente * 1103515245u + 12345u;
+    return (long)(((g->semente >> 8) & 0xFFFFFF) % (unsigned long)n);
+}
+
+static void operando(Gerador *g) {
+    if (sortear(g, 3) == 0) escreverf(g, "%ld", 1 + sortear(g, 99));
+    else escreverf(g, "v%ld", sortear(g, g->variaveis));
+}
+
+// Expressão inteira com 'profundidade' parênteses aninhados à esquerda,
+// ((x op y) op z)...; o tamanho cresce linearmente com a profundidade.
+// Sem recursão: profundidades de milhões não estouram a pilha
+static void expressao(Gerador *g, int profundidade) {
+    static const char *ops[] = { " + ", " - ", " * " };
+
+    for (int k = 0; k < profundidade; k++) escrever(g, "(");
+    operando(g);
+    for (int k = 0; k < profundidade; k++) {
+        if (sortear(g, 4) == 0) {
+            escreverf(g, " / %ld", 1 + sortear(g, 9));
+        } else {
+            escrever(g, ops[sortear(g, 3)]);
+            operando(g);
+        }
+        escrever(g, ")");
+    }
+}
+
+static void atribuicao(Gerador *g, int nivel) {
+    recuar(g, nivel);
+    escreverf(g, "v%ld <- ", sortear(g, g->variaveis));
+    expressao(g, g->profundidade);
+    escrever(g, ";\n");
+}
+
+// Um comando com 'restante' estruturas aninhadas; cada nível tem seu
+// contador de laço (l<nivel>) e uma atribuição antes do nível interno
+static void comando(Gerador *g, int nivel, int restante) {
+    int l = g->aninhamento - restante;
+
+    if (restante == 0) {
+        atribuicao(g, nivel);
+        return;
+    }
+
+    switch (sortear(g, 3)) {
+        case 0:
+            recuar(g, nivel);
+            escreverf(g, "if v%ld > ", sortear(g, g->variaveis));
+            expressao(g, g->profundidade);
+            escrever(g, " then\n");
+            recuar(g, nivel);
+            escrever(g, "begin\n");
+            atribuicao(g, nivel + 1);
+            comando(g, nivel + 1, restante - 1);
+            recuar(g, nivel);
+            escrever(g, "end\n");
+            recuar(g, nivel);
+            escrever(g, "else\n");
+            atribuicao(g, nivel + 1);
+            break;
+        case 1:
+            recuar(g, nivel);
+            escreverf(g, "l%ld <- 0;\n", l);
+            recuar(g, nivel);
+            escreverf(g, "while l%ld < 2 do\n", l);
+            recuar(g, nivel);
+            escrever(g, "begin\n");
+            atribuicao(g, nivel + 1);
+            comando(g, nivel + 1, restante - 1);
+            recuar(g, nivel + 1);
+            escreverf(g, "l%ld <- ", l);
+            escreverf(g, "l%ld + 1;\n", l);
+            recuar(g, nivel);
+            escrever(g, "end;\n");
+            return;
+        default:
+            recuar(g, nivel);
+            escreverf(g, "for (l%ld <- 0; ", l);
+            escreverf(g, "l%ld < 2; ", l);
+            escreverf(g, "l%ld <- ", l);
+            escreverf(g, "l%ld + 1)\n", l);
+            recuar(g, nivel);
+            escrever(g, "begin\n");
+            atribuicao(g, nivel + 1);
+            comando(g, nivel + 1, restante - 1);
+            recuar(g, nivel);
+            escrever(g, "end;\n");
+            return;
+    }
+}
+
+// Contadores dos laços (l0, l1, ...)
+static void contadores(Gerador *g) {
+    if (g->aninhamento > 0) {
+        escrever(g, "    int l0");
+        for (long k = 1; k < g->aninhamento; k++) escreverf(g, ", l%ld", k);
+        escrever(g, ";\n");
+    }
+}
+
+static void declaracoes(Gerador *g) {
+    escrever(g, "var\n");
+
+    // Todas numa só lista: exercita <mais_var> com N variáveis
+    escrever(g, "    int v0");
+    for (long k = 1; k < g->variaveis; k++) {
+        escrever(g, k % 16 == 0 ? ",\n        " : ", ");
+        escreverf(g, "v%ld", k);
+    }
+    escrever(g, ";\n");
+    contadores(g);
+}
+
+static int eh_procedimento(long k) {
+    return k % 4 == 3;
+}
+
+// <dcl_sub> de sk, com contadores de laço locais
+static void subrotina(Gerador *g, long k) {
+    escreverf(g, eh_procedimento(k) ? "void s%ld(int a, int b);\n" : "int s%ld(int a, int b);\n", k);
+    if (g->aninhamento > 0) {
+        escrever(g, "var\n");
+        contadores(g);
+    }
+    escrever(g, "begin\n");
+
+    for (long c = 0; c < g->comandos; c++) comando(g, 1, g->aninhamento);
+
+    if (eh_procedimento(k)) {
+        escreverf(g, "    v%ld <- a - b;\n", k % g->variaveis);
+    } else if (k % 8 == 0) {
+        escrever(g, "    return a + b;\n");
+    } else {
+        // A anterior, ou a antes dela se for void (k - 2 nunca é)
+        escreverf(g, "    return s%ld(b, a) + a;\n", eh_procedimento(k - 1) ? k - 2 : k - 1);
+    }
+    escrever(g, "end;\n");
+}
+
+// Uma chamada de cada sub-rotina
+static void chamadas(Gerador *g) {
+    for (long k = 0; k < g->subrotinas; k++) {
+        if (eh_procedimento(k)) {
+            escreverf(g, "    s%ld(", k);
+        } else {
+            escreverf(g, "    v%ld <- ", k % g->variaveis);
+            escreverf(g, "s%ld(", k);
+        }
+        escreverf(g, "v%ld, ", sortear(g, g->variaveis));
+        escreverf(g, "%ld);\n", 1 + sortear(g, 99));
+    }
+}
+
+static void programa(Gerador *g) {
+    escrever(g, "prg sintetico;\n");
+    declaracoes(g);
+    if (g->subrotinas > 0) {
+        escrever(g, "subrot\n");
+        for (long k = 0; k < g->subrotinas; k++) subrotina(g, k);
+    }
+    escrever(g, "begin\n");
+
+    // Variáveis começam com valor conhecido
+    for (long k = 0; k < g->variaveis; k++) {
+        escreverf(g, "    v%ld <- ", k);
+        escreverf(g, "%ld;\n", k % 100);
+    }
+
+    long gerados = 0;
+    while (g->tamanho > 0 ? g->escritos < g->tamanho : gerados < g->comandos) {
+        comando(g, 1, g->aninhamento);
+        gerados++;
+    }
+    chamadas(g);
+
+    escrever(g, "    write(v0);\n");
+    escrever(g, "end.\n");
+}
+
+// Lê um tamanho com sufixo opcional K, M ou G
+static long long ler_tamanho(const char *texto) {
+    char *fim;
+    long long valor = strtoll(texto, &fim, 10);
+
+    if (*fim == 'K' || *fim == 'k') valor <<= 10;
+    else if (*fim == 'M' || *fim == 'm') valor <<= 20;
+    else if (*fim == 'G' || *fim == 'g') valor <<= 30;
+    else if (*fim != '\0') return -1;
+    return valor;
+}
+
+int main(int argc, char *argv[]) {
+    Gerador g;
+    const char *arquivo = NULL;
+
+    memset(&g, 0, sizeof(g));
+    g.variaveis = 16;
+    g.comandos = 1000;
+    g.profundidade = 2;
+    g.aninhamento = 1;
+    g.semente = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && argv[i][0] == '-' && argv[i][1] != '\0' && argv[i][2] == '\0') {
+            const char *valor = argv[++i];
+            switch (argv[i - 1][1]) {
+                case 'v': g.variaveis = atol(valor); continue;
+                case 'c': g.comandos = atol(valor); continue;
+                case 'p': g.profundidade = atoi(valor); continue;
+                case 'n': g.aninhamento = atoi(valor); continue;
+                case 'r': g.subrotinas = atol(valor); continue;
+                case 't': g.tamanho = ler_tamanho(valor); continue;
+                case 's': g.semente = (unsigned)strtoul(valor, NULL, 10); continue;
+                case 'o': arquivo = valor; continue;
+            }
+        }
+        uso(argv[0]);
+        return 1;
+    }
+
+    if (g.variaveis < 1 || g.comandos < 0 || g.profundidade < 0 ||
+        g.aninhamento < 0 || g.subrotinas < 0 || g.tamanho < 0) {
+        uso(argv[0]);
+        return 1;
+    }
+
+    g.saida = arquivo ? fopen(arquivo, "w") : stdout;
+    if (g.saida == NULL) {
+        fprintf(stderr, "Erro: não foi possível criar arquivo '%s'\n", arquivo);
+        return 1;
+    }
+    setvbuf(g.saida, NULL, _IOFBF, 1 << 20);
+
+    programa(&g);
+
+    if (fclose(g.saida) != 0) {
+        perror("lpdgen");
+        return 1;
+    }
+    return 0;
+}
@@ -6,15 +6,21 @@
 #include <stdlib.h>
 #include <string.h>
 #include "tabsimb.h"
-
-// Lista encadeada simples para a tabela de símbolos
-static RegistroTS *cabeca = NULL;
-static int proximo_endereco = 0;
+#include "modulo.h"
 
 // Inicializa a tabela de símbolos
-void inicializar_tabela_simbolos() {
-    cabeca = NULL;
-    proximo_endereco = 0;
+void inicializar_tabela_simbolos(TabelaSimbolos *ts) {
+    ts->cabeca = NULL;
+    ts->proximo_endereco = 0;
+    ts->nivel = 0;
+    ts->base_escopo = NULL;
+    ts->endereco_global = 0;
+    ts->fechados = ts->ultimo_fechado = NULL;
+    ts->subrotinas = NULL;
+    ts->n_subrotinas = ts->cap_subrotinas = 0;
+    ts->modulo = NULL;
+    ts->erro = TS_OK;
+    ts->est = NULL;
 }
 
 // Converte TAtomo para TipoDado
@@ -28,34 +34,78 @@ static TipoDado atomo_para_tipo(TAtomo tipo_atomo) {
     }
 }
 
-// Busca um identificador na tabela
-RegistroTS* ts_buscar(const char *lexema) {
-    RegistroTS *atual = cabeca;
+// Percorre a lista contando os registros visitados e, se o nome não está
+// nela, o índice do módulo importado. Os registros do módulo estão num
+// mapeamento só de leitura; nada muda as globais depois de declaradas
+static RegistroTS* buscar(TabelaSimbolos *ts, const char *lexema, long *sondagens) {
+    RegistroTS *atual = ts->cabeca;
     
     while (atual != NULL) {
+        (*sondagens)++;
         if (strcmp(atual->lexema, lexema) == 0) {
             return atual;
         }
         atual = atual->proximo;
     }
     
+    if (ts->modulo != NULL) return (RegistroTS*)modulo_buscar(ts->modulo, lexema, sondagens);
+    return NULL;
+}
+
+// Busca só no escopo local (até base_escopo): um nome local pode repetir
+// um global, que fica escondido
+static RegistroTS* buscar_local(TabelaSimbolos *ts, const char *lexema, long *sondagens) {
+    for (RegistroTS *atual = ts->cabeca; atual != ts->base_escopo; atual = atual->proximo) {
+        (*sondagens)++;
+        if (strcmp(atual->lexema, lexema) == 0) return atual;
+    }
     return NULL;
 }
 
+// Busca um identificador na tabela
+RegistroTS* ts_buscar(TabelaSimbolos *ts, const char *lexema) {
+    long sondagens = 0;
+    
+    if (!EST_ATIVO(ts->est)) return buscar(ts, lexema, &sondagens);
+    
+    MarcaTempo m;
+    est_entrar(ts->est, FASE_TABELA, &m);
+    RegistroTS *registro = buscar(ts, lexema, &sondagens);
+    est_sair(ts->est, FASE_TABELA, &m);
+    ts->est->ts_buscas++;
+    ts->est->ts_sondagens += sondagens;
+    return registro;
+}
+
 // Insere um identificador na tabela
-RegistroTS* ts_inserir(const char *lexema, Categoria cat, TAtomo tipo_atomo, int endereco) {
-    // Verificar se já existe (regra de unicidade)
-    RegistroTS *existente = ts_buscar(lexema);
+// Retorna NULL em caso de erro (motivo em ts->erro); quem chama reporta
+static RegistroTS* inserir(TabelaSimbolos *ts, const char *lexema, Categoria cat,
+                           TAtomo tipo_atomo, int endereco, long *sondagens) {
+    // Verificar se já existe no escopo atual (regra de unicidade)
+    RegistroTS *existente = ts->nivel > 0 ? buscar_local(ts, lexema, sondagens)
+                                          : buscar(ts, lexema, sondagens);
     if (existente != NULL && cat != CAT_PROGRAMA) {
-        printf("Erro semântico: identificador '%s' já declarado\n", lexema);
-        exit(1);
+        ts->erro = TS_ERRO_DUPLICADO;
+        return NULL;
+    }
+    
+    // Sub-rotinas também ficam num vetor pelo número (o endereço)
+    if (cat == CAT_FUNCAO && ts->n_subrotinas == ts->cap_subrotinas) {
+        int cap = ts->cap_subrotinas ? ts->cap_subrotinas * 2 : 16;
+        RegistroTS **maior = realloc(ts->subrotinas, sizeof(RegistroTS*) * cap);
+        if (maior == NULL) {
+            ts->erro = TS_ERRO_MEMORIA;
+            return NULL;
+        }
+        ts->subrotinas = maior;
+        ts->cap_subrotinas = cap;
     }
     
     // Criar novo registro
     RegistroTS *novo = (RegistroTS*)malloc(sizeof(RegistroTS));
     if (novo == NULL) {
-        printf("Erro: falha ao alocar memória para tabela de símbolos\n");
-        exit(1);
+        ts->erro = TS_ERRO_MEMORIA;
+        return NULL;
     }
     
     // Preencher campos
@@ -64,22 +114,88 @@ RegistroTS* ts_inserir(const char *lexema, Categoria cat, TAtomo tipo_atomo, int
     novo->categoria = cat;
     novo->tipo = atomo_para_tipo(tipo_atomo);
     novo->endereco = endereco;
-    novo->proximo = cabeca;
+    novo->nivel = ts->nivel;
+    novo->n_param = 0;
+    novo->tipos_param = NULL;
+    novo->proximo = ts->cabeca;
     
     // Inserir no início da lista
-    cabeca = novo;
+    ts->cabeca = novo;
     
     // Atualizar contador de endereços para variáveis
     if (cat == CAT_VARIAVEL && endereco >= 0) {
-        proximo_endereco = endereco + 1;
+        ts->proximo_endereco = endereco + 1;
     }
+    if (cat == CAT_FUNCAO) ts->subrotinas[ts->n_subrotinas++] = novo;
+    
+    return novo;
+}
+
+RegistroTS* ts_inserir(TabelaSimbolos *ts, const char *lexema, Categoria cat,
+                       TAtomo tipo_atomo, int endereco) {
+    long sondagens = 0;
+    
+    if (!EST_ATIVO(ts->est)) return inserir(ts, lexema, cat, tipo_atomo, endereco, &sondagens);
     
+    MarcaTempo m;
+    est_entrar(ts->est, FASE_TABELA, &m);
+    RegistroTS *novo = inserir(ts, lexema, cat, tipo_atomo, endereco, &sondagens);
+    est_sair(ts->est, FASE_TABELA, &m);
+    ts->est->ts_insercoes++;
+    ts->est->ts_sondagens += sondagens;
+    if (novo != NULL) ts->est->alocacoes++;
     return novo;
 }
 
+// Sub-rotina pelo número (NULL se não existe)
+RegistroTS* ts_subrotina(TabelaSimbolos *ts, int numero) {
+    if (numero < 1 || numero > ts->n_subrotinas) return NULL;
+    return ts->subrotinas[numero - 1];
+}
+
+// Acrescenta um parâmetro à assinatura de uma sub-rotina (0 se faltar memória)
+int ts_adicionar_parametro(RegistroTS *sub, TAtomo tipo) {
+    TipoDado *maior = realloc(sub->tipos_param, sizeof(TipoDado) * (sub->n_param + 1));
+    if (maior == NULL) return 0;
+    sub->tipos_param = maior;
+    sub->tipos_param[sub->n_param++] = atomo_para_tipo(tipo);
+    return 1;
+}
+
+// Abre o escopo de uma sub-rotina: os endereços locais recomeçam em 0
+void ts_abrir_escopo(TabelaSimbolos *ts) {
+    ts->nivel = 1;
+    ts->base_escopo = ts->cabeca;
+    ts->endereco_global = ts->proximo_endereco;
+    ts->proximo_endereco = 0;
+}
+
+// Fecha o escopo local, movendo os seus registros (na ordem da lista) para
+// o fim da lista de fechados
+void ts_fechar_escopo(TabelaSimbolos *ts) {
+    if (ts->cabeca != ts->base_escopo) {
+        RegistroTS *ultimo = ts->cabeca;
+        while (ultimo->proximo != ts->base_escopo) ultimo = ultimo->proximo;
+        
+        if (ts->ultimo_fechado != NULL) ts->ultimo_fechado->proximo = ts->cabeca;
+        else ts->fechados = ts->cabeca;
+        ts->ultimo_fechado = ultimo;
+        ultimo->proximo = NULL;
+        ts->cabeca = ts->base_escopo;
+    }
+    ts->nivel = 0;
+    ts->base_escopo = NULL;
+    ts->proximo_endereco = ts->endereco_global;
+}
+
+void ts_importar(TabelaSimbolos *ts, const ModuloTS *modulo) {
+    ts->modulo = modulo;
+    ts->proximo_endereco = (int)modulo->cab->tamanho;
+}
+
 // Obtém o próximo endereço disponível para alocação
-int obter_proximo_endereco() {
-    return proximo_endereco;
+int obter_proximo_endereco(TabelaSimbolos *ts) {
+    return ts->proximo_endereco;
 }
 
 // Converte categoria para string
@@ -102,38 +218,56 @@ const char* tipo_para_string(TipoDado tipo) {
         case TIPO_BOOL: return "bool";
         case TIPO_CHAR: return "char";
         case TIPO_VOID: return "void";
+        case TIPO_ERRO: return "erro";
         default: return "desconhecido";
     }
 }
 
-// Salva a tabela de símbolos em arquivo
-void salvar_tabela_simbolos(FILE *arquivo) {
-    if (arquivo == NULL) return;
-    
-    // Percorrer lista e salvar cada registro
-    RegistroTS *atual = cabeca;
-    
+static void salvar_lista(RegistroTS *atual, FILE *arquivo) {
     while (atual != NULL) {
-        fprintf(arquivo, "TS[ lex: %s | cat: %s | tip: %s | end: %d ]\n",
+        fprintf(arquivo, "TS[ lex: %s | cat: %s | tip: %s | end: %d",
                 atual->lexema,
                 categoria_para_string(atual->categoria),
                 tipo_para_string(atual->tipo),
                 atual->endereco);
+        // Só símbolos locais mostram o nível (os globais mantêm o formato)
+        if (atual->nivel > 0) fprintf(arquivo, " | nív: %d", atual->nivel);
+        fprintf(arquivo, " ]\n");
         atual = atual->proximo;
     }
 }
 
-// Libera memória da tabela de símbolos
-void liberar_tabela_simbolos() {
-    RegistroTS *atual = cabeca;
+// Salva a tabela de símbolos em arquivo: os globais e, depois, os locais
+// de cada sub-rotina, na ordem das sub-rotinas
+void salvar_tabela_simbolos(TabelaSimbolos *ts, FILE *arquivo) {
+    if (arquivo == NULL) return;
+    
+    salvar_lista(ts->cabeca, arquivo);
+    salvar_lista(ts->fechados, arquivo);
+}
+
+static void liberar_lista(RegistroTS *atual) {
     RegistroTS *proximo;
     
     while (atual != NULL) {
         proximo = atual->proximo;
+        free(atual->tipos_param);
         free(atual);
         atual = proximo;
     }
+}
+
+// Libera memória da tabela de símbolos
+void liberar_tabela_simbolos(TabelaSimbolos *ts) {
+    liberar_lista(ts->cabeca);
+    liberar_lista(ts->fechados);
+    free(ts->subrotinas);
     
-    cabeca = NULL;
-    proximo_endereco = 0;
+    ts->cabeca = NULL;
+    ts->fechados = ts->ultimo_fechado = NULL;
+    ts->subrotinas = NULL;
+    ts->n_subrotinas = ts->cap_subrotinas = 0;
+    ts->nivel = 0;
+    ts->base_escopo = NULL;
+    ts->proximo_endereco = 0;
 }
\ No newline at end of file
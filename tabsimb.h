@@ -7,6 +7,7 @@
 
 #include <stdio.h>
 #include "analex.h"
+#include "estatisticas.h"
 
 // Categorias de identificadores
 typedef enum {
@@ -20,30 +21,76 @@ typedef enum {
 // Tipos de dados (mapeados dos tokens)
 typedef enum {
     TIPO_VOID = 0,
+    TIPO_ERRO = 1,     // expressão com erro já relatado
     TIPO_INT = 4,      // sINT
     TIPO_FLOAT = 5,    // sFLOAT
     TIPO_BOOL = 6,     // sBOOL
     TIPO_CHAR = 7      // sCHAR
 } TipoDado;
 
-// Registro da Tabela de Símbolos
+// Registro da Tabela de Símbolos. O endereço de uma variável é o
+// deslocamento no registro de ativação do seu nível; o de um parâmetro é
+// negativo (abaixo do registro, ver asdr.c) e o de uma sub-rotina é o seu
+// número (1, 2, ...), que dá o rótulo de entrada R<n>
 typedef struct RegistroTS {
     char lexema[50];
     Categoria categoria;
     TipoDado tipo;
     int endereco;
+    int nivel;                  // nível léxico: 0 = programa, 1 = sub-rotina
+    int n_param;                // sub-rotina: parâmetros e seus tipos
+    TipoDado *tipos_param;
     struct RegistroTS *proximo;
 } RegistroTS;
 
+// Códigos de erro de ts_inserir
+typedef enum {
+    TS_OK,
+    TS_ERRO_DUPLICADO,
+    TS_ERRO_MEMORIA
+} ErroTS;
+
+// Interface de módulo importada (modulo.h)
+typedef struct ModuloTS ModuloTS;
+
+// Tabela de Símbolos de uma compilação (lista encadeada simples). Os
+// símbolos de uma sub-rotina ficam no início da lista enquanto ela é
+// analisada (escopo local, nível 1), à frente dos globais; ao fechar o
+// escopo saem da busca e vão para a lista de fechados, que só é usada pelo
+// arquivo .ts. As globais de um módulo importado não entram na lista: a
+// busca as procura no arquivo mapeado depois dela, e os nomes locais podem
+// escondê-las como escondem as globais do programa
+typedef struct {
+    RegistroTS *cabeca;
+    int proximo_endereco;
+    int nivel;                  // 0 fora de sub-rotinas
+    RegistroTS *base_escopo;    // cabeca quando o escopo local foi aberto
+    int endereco_global;        // proximo_endereco do programa, guardado
+    RegistroTS *fechados, *ultimo_fechado;
+    RegistroTS **subrotinas;    // por número (subrotinas[n - 1])
+    int n_subrotinas, cap_subrotinas;
+    const ModuloTS *modulo;     // NULL: sem importação
+    ErroTS erro;                // motivo da última falha de ts_inserir
+    EstatisticasCompilacao *est; // NULL: sem medição
+} TabelaSimbolos;
+
 // Funções da Tabela de Símbolos
-void inicializar_tabela_simbolos();
-RegistroTS* ts_inserir(const char *lexema, Categoria cat, TAtomo tipo, int endereco);
-RegistroTS* ts_buscar(const char *lexema);
-void salvar_tabela_simbolos(FILE *arquivo);
-void liberar_tabela_simbolos();
+void inicializar_tabela_simbolos(TabelaSimbolos *ts);
+RegistroTS* ts_inserir(TabelaSimbolos *ts, const char *lexema, Categoria cat,
+                       TAtomo tipo, int endereco);
+RegistroTS* ts_buscar(TabelaSimbolos *ts, const char *lexema);
+RegistroTS* ts_subrotina(TabelaSimbolos *ts, int numero);
+int ts_adicionar_parametro(RegistroTS *sub, TAtomo tipo);
+void ts_abrir_escopo(TabelaSimbolos *ts);
+void ts_fechar_escopo(TabelaSimbolos *ts);
+// Torna visíveis as globais do módulo, que ocupam o início da área do
+// programa; deve vir antes da primeira inserção
+void ts_importar(TabelaSimbolos *ts, const ModuloTS *modulo);
+void salvar_tabela_simbolos(TabelaSimbolos *ts, FILE *arquivo);
+void liberar_tabela_simbolos(TabelaSimbolos *ts);
 
 // Funções auxiliares
-int obter_proximo_endereco();
+int obter_proximo_endereco(TabelaSimbolos *ts);
 const char* categoria_para_string(Categoria cat);
 const char* tipo_para_string(TipoDado tipo);
 